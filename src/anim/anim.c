@@ -43,6 +43,7 @@
 #include "../lib/public/pf_string.h"
 #include "../render/public/render.h"
 #include "../render/public/render_ctrl.h"
+#include "../game/public/game.h"
 
 #include <SDL.h>
 
@@ -169,7 +170,7 @@ void A_SetActiveClip(const struct entity *ent, const char *name,
     ctx->mode = mode;
     ctx->key_fps = key_fps;
     ctx->curr_frame = 0;
-    ctx->curr_frame_start_ticks = SDL_GetTicks();
+    ctx->curr_frame_start_ticks = G_Timer_SimMillis();
 }
 
 void A_Update(struct entity *ent)
@@ -177,7 +178,7 @@ void A_Update(struct entity *ent)
     struct anim_ctx *ctx = ent->anim_ctx;
 
     float frame_period_secs = 1.0f/ctx->key_fps;
-    uint32_t curr_ticks = SDL_GetTicks();
+    uint32_t curr_ticks = G_Timer_SimMillis();
     float elapsed_secs = (curr_ticks - ctx->curr_frame_start_ticks)/1000.0f;
 
     if(elapsed_secs > frame_period_secs) {
@@ -355,7 +356,7 @@ bool A_SaveState(struct SDL_RWops *stream, const struct entity *ent)
 
     struct attr curr_frame_ticks_elapsed = (struct attr){
         .type = TYPE_INT,
-        .val.as_int = SDL_GetTicks() - ctx->curr_frame_start_ticks
+        .val.as_int = G_Timer_SimMillis() - ctx->curr_frame_start_ticks
     };
     CHK_TRUE_RET(Attr_Write(stream, &curr_frame_ticks_elapsed, "curr_frame_ticks_elapsed"));
 
@@ -393,7 +394,7 @@ bool A_LoadState(struct SDL_RWops *stream, const struct entity *ent)
 
     CHK_TRUE_RET(Attr_Parse(stream, &attr, true));
     CHK_TRUE_RET(attr.type == TYPE_INT);
-    ctx->curr_frame_start_ticks = SDL_GetTicks() - attr.val.as_int;
+    ctx->curr_frame_start_ticks = G_Timer_SimMillis() - attr.val.as_int;
 
     return true;
 }
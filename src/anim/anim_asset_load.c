@@ -269,6 +269,12 @@ fail_alloc:
     return NULL;
 }
 
+const mat4x4_t *A_AL_InvBindPoses(const void *priv_data)
+{
+    const struct anim_data *priv = priv_data;
+    return priv->skel.inv_bind_poses;
+}
+
 void A_AL_DumpPrivate(FILE *stream, void *priv_data)
 {
     struct anim_data *priv = priv_data;
@@ -188,6 +188,13 @@ size_t A_AL_CtxBuffSize(void);
  */
 void  *A_AL_PrivFromStream(const struct pfobj_hdr *header, SDL_RWops *stream);
 
+/* ---------------------------------------------------------------------------
+ * Returns the inverse bind pose matrices of the skeleton in the private data,
+ * one per joint. These are what gets uploaded when drawing animated entities.
+ * ---------------------------------------------------------------------------
+ */
+const mat4x4_t *A_AL_InvBindPoses(const void *priv_data);
+
 /* ---------------------------------------------------------------------------
  * Dumps private animation data in PF Object format.
  * ---------------------------------------------------------------------------
@@ -55,6 +55,7 @@
 
 struct shared_resource{
     char         key[64];
+    char         basedir[64];
     uint32_t     ent_flags;
     void        *render_private;
     void        *anim_private;
@@ -178,6 +179,7 @@ static void al_set_ent_defaults(struct entity *ent)
     ent->max_speed = 0.0f;
     ent->faction_id = 0; 
     ent->vision_range = 0.0f;
+    Entity_InvalidateXform(ent);
 }
 
 /*****************************************************************************/
@@ -218,6 +220,7 @@ struct entity *AL_EntityFromPFObj(const char *base_path, const char *pfobj_name,
     pf_snprintf(abs_basepath, sizeof(abs_basepath), "%s/%s", g_basepath, base_path);
     pf_snprintf(pfobj_path, sizeof(pfobj_path), "%s/%s/%s", g_basepath, base_path, pfobj_name);
     pf_snprintf(res.key, sizeof(res.key), pfobj_name);
+    pf_snprintf(res.basedir, sizeof(res.basedir), "%s", base_path);
 
     khiter_t k = kh_get(entity_res, s_name_resource_table, pfobj_name);
     if(k != kh_end(s_name_resource_table)) {
@@ -336,6 +339,24 @@ void AL_MapFree(struct map *map)
     free(map);
 }
 
+void AL_ForEachModel(void (*callback)(const struct al_model*, void*), void *arg)
+{
+    for(khiter_t k = kh_begin(s_name_resource_table); k != kh_end(s_name_resource_table); k++) {
+
+        if(!kh_exist(s_name_resource_table, k))
+            continue;
+
+        const struct shared_resource *res = &kh_value(s_name_resource_table, k);
+        callback(&(struct al_model){
+            .basedir = res->basedir,
+            .pfobj_name = res->key,
+            .animated = !!(res->ent_flags & ENTITY_FLAG_ANIMATED),
+            .render_private = res->render_private,
+            .anim_private = res->anim_private,
+        }, arg);
+    }
+}
+
 bool AL_ReadLine(SDL_RWops *stream, char *outbuff)
 {
     int idx = 0;
@@ -73,6 +73,15 @@ struct pfmap_hdr{
     unsigned num_cols;
 };
 
+/* The data shared by all the entities loaded from the same PF Object file */
+struct al_model{
+    const char *basedir;
+    const char *pfobj_name;
+    bool        animated;
+    const void *render_private;
+    const void *anim_private;
+};
+
 
 bool           AL_Init(void);
 void           AL_Shutdown(void);
@@ -80,6 +89,7 @@ void           AL_Shutdown(void);
 struct entity *AL_EntityFromPFObj(const char *base_path, const char *pfobj_name, 
                                   const char *name, uint32_t uid);
 void           AL_EntityFree(struct entity *entity);
+void           AL_ForEachModel(void (*callback)(const struct al_model*, void*), void *arg);
 
 struct map    *AL_MapFromPFMapStream(SDL_RWops *stream, bool update_navgrid);
 void           AL_MapFree(struct map *map);
@@ -37,6 +37,10 @@
 #include <assert.h>
 #include <float.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #define MIN(a, b)     ((a) < (b) ? (a) : (b))
 #define MAX(a, b)     ((a) > (b) ? (a) : (b))
 #define MAX3(a, b, c) (MAX(MAX(a, b), c))
@@ -528,6 +532,93 @@ enum volume_intersec_type C_FrustumOBBIntersectionFast(const struct frustum *fru
     return VOLUME_INTERSEC_INSIDE;
 }
 
+enum volume_intersec_type C_FrustumAABBIntersectionPN(const struct frustum *frustum, const struct aabb *aabb)
+{
+    const struct plane *planes[] = {&frustum->top, &frustum->bot, &frustum->left, 
+                                    &frustum->right, &frustum->near, &frustum->far};
+    enum volume_intersec_type ret = VOLUME_INTERSEC_INSIDE;
+
+    for(int i = 0; i < ARR_SIZE(planes); i++) {
+
+        const vec3_t n = planes[i]->normal;
+        /* The corners furthest along and against the plane normal */
+        vec3_t p = (vec3_t){
+            n.x >= 0.0f ? aabb->x_max : aabb->x_min,
+            n.y >= 0.0f ? aabb->y_max : aabb->y_min,
+            n.z >= 0.0f ? aabb->z_max : aabb->z_min,
+        };
+        vec3_t q = (vec3_t){
+            n.x >= 0.0f ? aabb->x_min : aabb->x_max,
+            n.y >= 0.0f ? aabb->y_min : aabb->y_max,
+            n.z >= 0.0f ? aabb->z_min : aabb->z_max,
+        };
+
+        if(plane_point_signed_distance(planes[i], p) < 0.0f)
+            return VOLUME_INTERSEC_OUTSIDE;
+        if(plane_point_signed_distance(planes[i], q) < 0.0f)
+            ret = VOLUME_INTERSEC_INTERSECTION;
+    }
+    return ret;
+}
+
+bool C_FrustumOBBOutsideFast(const struct frustum *frustum, const struct obb *obb)
+{
+    const struct plane *planes[] = {&frustum->top, &frustum->bot, &frustum->left, 
+                                    &frustum->right, &frustum->near, &frustum->far};
+#if defined(__SSE__)
+    /* Test 4 corners against a plane at a time. The box is outside if all of 
+     * its corners are on the negative side of any one plane. */
+    const vec3_t *c = obb->corners;
+    __m128 xs[2] = {
+        _mm_setr_ps(c[0].x, c[1].x, c[2].x, c[3].x),
+        _mm_setr_ps(c[4].x, c[5].x, c[6].x, c[7].x),
+    };
+    __m128 ys[2] = {
+        _mm_setr_ps(c[0].y, c[1].y, c[2].y, c[3].y),
+        _mm_setr_ps(c[4].y, c[5].y, c[6].y, c[7].y),
+    };
+    __m128 zs[2] = {
+        _mm_setr_ps(c[0].z, c[1].z, c[2].z, c[3].z),
+        _mm_setr_ps(c[4].z, c[5].z, c[6].z, c[7].z),
+    };
+    const __m128 zero = _mm_setzero_ps();
+
+    for(int i = 0; i < ARR_SIZE(planes); i++) {
+
+        __m128 px = _mm_set1_ps(planes[i]->point.x);
+        __m128 py = _mm_set1_ps(planes[i]->point.y);
+        __m128 pz = _mm_set1_ps(planes[i]->point.z);
+        __m128 nx = _mm_set1_ps(planes[i]->normal.x);
+        __m128 ny = _mm_set1_ps(planes[i]->normal.y);
+        __m128 nz = _mm_set1_ps(planes[i]->normal.z);
+
+        int in = 0;
+        for(int j = 0; j < 2; j++) {
+
+            __m128 dist = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_sub_ps(xs[j], px), nx),
+                _mm_mul_ps(_mm_sub_ps(ys[j], py), ny)),
+                _mm_mul_ps(_mm_sub_ps(zs[j], pz), nz));
+            in |= _mm_movemask_ps(_mm_cmpge_ps(dist, zero));
+        }
+        if(!in)
+            return true;
+    }
+    return false;
+#else
+    for(int i = 0; i < ARR_SIZE(planes); i++) {
+
+        bool in = false;
+        for(int k = 0; k < 8; k++) {
+            in |= (plane_point_signed_distance(planes[i], obb->corners[k]) >= 0.0f);
+        }
+        if(!in)
+            return true;
+    }
+    return false;
+#endif
+}
+
 bool C_FrustumAABBIntersectionExact(const struct frustum *frustum, const struct aabb *aabb)
 {
     vec3_t aabb_axes[3] = {
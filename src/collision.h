@@ -89,6 +89,14 @@ bool C_RayIntersectsPlane(vec3_t ray_origin, vec3_t ray_dir, struct plane plane,
 enum volume_intersec_type C_FrustumPointIntersectionFast(const struct frustum *frustum, vec3_t point);
 enum volume_intersec_type C_FrustumAABBIntersectionFast (const struct frustum *frustum, const struct aabb *aabb);
 enum volume_intersec_type C_FrustumOBBIntersectionFast  (const struct frustum *frustum, const struct obb *obb);
+/* Tests only the two corners of the box that are the furthest along and against 
+ * each plane's normal. Never reports a box as 'inside' or 'outside' when it is not. */
+enum volume_intersec_type C_FrustumAABBIntersectionPN   (const struct frustum *frustum, const struct aabb *aabb);
+/* Branchless (and vectorized, where SSE is available) check for whether all the 
+ * corners of the OBB lie behind any one of the frustum planes. This culls a superset 
+ * of the boxes reported as outside by 'C_FrustumOBBIntersectionFast', which gives up 
+ * at the first plane that the box straddles. */
+bool                      C_FrustumOBBOutsideFast       (const struct frustum *frustum, const struct obb *obb);
 
 bool C_FrustumAABBIntersectionExact(const struct frustum *frustum, const struct aabb *aabb);
 bool C_FrustumOBBIntersectionExact(const struct frustum *frustum, const struct obb *obb);
@@ -204,8 +204,11 @@ bool Cursor_InitAll(const char *basedir)
             goto fail;
 
         curr->cursor = SDL_CreateColorCursor(curr->surface, curr->hot_x, curr->hot_y);
+#if !defined(PF_NULL_RENDER)
+        /* Headless video drivers (used with the null renderer) have no cursor support */
         if(!curr->cursor)
             goto fail;
+#endif
     }
 
     return true;
@@ -38,6 +38,7 @@
 #include "anim/public/anim.h"
 
 #include <assert.h>
+#include <string.h>
 
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
@@ -46,13 +47,47 @@
 static uint32_t s_next_uid = 0;
 
 /*****************************************************************************/
-/* EXTERN FUNCTIONS                                                          */
+/* STATIC FUNCTIONS                                                          */
 /*****************************************************************************/
 
-void Entity_ModelMatrix(const struct entity *ent, mat4x4_t *out)
+static const struct aabb *entity_curr_aabb(const struct entity *ent)
+{
+    if(ent->flags & ENTITY_FLAG_ANIMATED)
+        return A_GetCurrPoseAABB(ent);
+    return &ent->identity_aabb;
+}
+
+/* The cache is logically not a part of the entity's state, hence it can be 
+ * updated through a const pointer. Returns the cache after re-keying it, 
+ * invalidating its' contents if any of the inputs have changed. */
+static struct ent_xform_cache *entity_xform_cache(const struct entity *ent, vec3_t pos, 
+                                                  const struct aabb *aabb)
+{
+    struct ent_xform_cache *cache = (struct ent_xform_cache*)&ent->xform_cache;
+
+    if(0 == memcmp(&cache->pos, &pos, sizeof(pos))
+    && 0 == memcmp(&cache->scale, &ent->scale, sizeof(ent->scale))
+    && 0 == memcmp(&cache->rotation, &ent->rotation, sizeof(ent->rotation))) {
+
+        if(cache->aabb != aabb) {
+            cache->aabb = aabb;
+            cache->obb_valid = false;
+        }
+        return cache;
+    }
+
+    cache->pos = pos;
+    cache->scale = ent->scale;
+    cache->rotation = ent->rotation;
+    cache->aabb = aabb;
+    cache->model_valid = false;
+    cache->obb_valid = false;
+    return cache;
+}
+
+static void entity_make_model(const struct entity *ent, vec3_t pos, mat4x4_t *out)
 {
     mat4x4_t trans, scale, rot, tmp;
-    vec3_t pos = G_Pos_Get(ent->uid);
 
     PFM_Mat4x4_MakeTrans(pos.x, pos.y, pos.z, &trans);
     PFM_Mat4x4_MakeScale(ent->scale.x, ent->scale.y, ent->scale.z, &scale);
@@ -62,24 +97,9 @@ void Entity_ModelMatrix(const struct entity *ent, mat4x4_t *out)
     PFM_Mat4x4_Mult4x4(&trans, &tmp, out);
 }
 
-uint32_t Entity_NewUID(void)
+static void entity_make_obb(const struct entity *ent, const struct aabb *aabb, 
+                            const mat4x4_t *model, struct obb *out)
 {
-    return s_next_uid++;
-}
-
-void Entity_SetNextUID(uint32_t uid)
-{
-    s_next_uid = uid;
-}
-
-void Entity_CurrentOBB(const struct entity *ent, struct obb *out)
-{
-    const struct aabb *aabb;
-    if(ent->flags & ENTITY_FLAG_ANIMATED)
-        aabb = A_GetCurrPoseAABB(ent);
-    else
-        aabb = &ent->identity_aabb;
-
     vec4_t identity_verts_homo[8] = {
         {aabb->x_min, aabb->y_min, aabb->z_min, 1.0f},
         {aabb->x_min, aabb->y_min, aabb->z_max, 1.0f},
@@ -98,12 +118,9 @@ void Entity_CurrentOBB(const struct entity *ent, struct obb *out)
         1.0f
     };
 
-    mat4x4_t model;
-    Entity_ModelMatrix(ent, &model);
-
     vec4_t obb_verts_homo[8];
     for(int i = 0; i < 8; i++) {
-        PFM_Mat4x4_Mult4x1(&model, identity_verts_homo + i, obb_verts_homo + i);
+        PFM_Mat4x4_Mult4x1((mat4x4_t*)model, identity_verts_homo + i, obb_verts_homo + i);
         out->corners[i] = (vec3_t){
             obb_verts_homo[i].x / obb_verts_homo[i].w,
             obb_verts_homo[i].y / obb_verts_homo[i].w,
@@ -112,7 +129,7 @@ void Entity_CurrentOBB(const struct entity *ent, struct obb *out)
     }
 
     vec4_t obb_center_homo;
-    PFM_Mat4x4_Mult4x1(&model, &identity_center_homo, &obb_center_homo);
+    PFM_Mat4x4_Mult4x1((mat4x4_t*)model, &identity_center_homo, &obb_center_homo);
     out->center = (vec3_t){
         obb_center_homo.x / obb_center_homo.w,
         obb_center_homo.y / obb_center_homo.w,
@@ -132,6 +149,63 @@ void Entity_CurrentOBB(const struct entity *ent, struct obb *out)
     PFM_Vec3_Normal(&axis2, &out->axes[2]);
 }
 
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+void Entity_ModelMatrix(const struct entity *ent, mat4x4_t *out)
+{
+    Entity_ModelMatrixAt(ent, G_Pos_Get(ent->uid), out);
+}
+
+void Entity_ModelMatrixAt(const struct entity *ent, vec3_t pos, mat4x4_t *out)
+{
+    struct ent_xform_cache *cache = entity_xform_cache(ent, pos, ent->xform_cache.aabb);
+    if(!cache->model_valid) {
+        entity_make_model(ent, pos, &cache->model);
+        cache->model_valid = true;
+    }
+    *out = cache->model;
+}
+
+uint32_t Entity_NewUID(void)
+{
+    return s_next_uid++;
+}
+
+void Entity_SetNextUID(uint32_t uid)
+{
+    s_next_uid = uid;
+}
+
+void Entity_CurrentOBB(const struct entity *ent, struct obb *out)
+{
+    Entity_CurrentOBBAt(ent, G_Pos_Get(ent->uid), out);
+}
+
+void Entity_CurrentOBBAt(const struct entity *ent, vec3_t pos, struct obb *out)
+{
+    const struct aabb *aabb = entity_curr_aabb(ent);
+    struct ent_xform_cache *cache = entity_xform_cache(ent, pos, aabb);
+
+    if(!cache->obb_valid) {
+        if(!cache->model_valid) {
+            entity_make_model(ent, pos, &cache->model);
+            cache->model_valid = true;
+        }
+        entity_make_obb(ent, aabb, &cache->model, &cache->obb);
+        cache->obb_valid = true;
+    }
+    *out = cache->obb;
+}
+
+void Entity_InvalidateXform(struct entity *ent)
+{
+    ent->xform_cache.aabb = NULL;
+    ent->xform_cache.model_valid = false;
+    ent->xform_cache.obb_valid = false;
+}
+
 vec3_t Entity_TopCenterPointWS(const struct entity *ent)
 {
     const struct aabb *aabb = &ent->identity_aabb;
@@ -75,6 +75,19 @@ struct entity{
     int          faction_id;       /* The faction to which this entity belongs to. */
     int          max_hp;           /* 0 for 'invulnerable' entities */
     float        vision_range;     /* in OpenGL coordinates */
+    /* The last computed world-space transform. It is keyed by the inputs it was 
+     * computed from, so any change to the position, scale, rotation or the current 
+     * animation sample invalidates it. Static entities never pay for it again. */
+    struct ent_xform_cache{
+        vec3_t             pos;
+        vec3_t             scale;
+        quat_t             rotation;
+        const struct aabb *aabb;
+        bool               model_valid;
+        bool               obb_valid;
+        mat4x4_t           model;
+        struct obb         obb;
+    }xform_cache;
 };
 
 /* State needed for rendering a static entity */
@@ -106,9 +119,14 @@ VEC_IMPL(static inline, ranim, struct ent_anim_rstate)
 
 
 void     Entity_ModelMatrix(const struct entity *ent, mat4x4_t *out);
+/* The 'At' variants take the entity's position instead of looking it up, 
+ * making them safe to call off the main thread (for different entities). */
+void     Entity_ModelMatrixAt(const struct entity *ent, vec3_t pos, mat4x4_t *out);
 uint32_t Entity_NewUID(void);
 void     Entity_SetNextUID(uint32_t uid);
 void     Entity_CurrentOBB(const struct entity *ent, struct obb *out);
+void     Entity_CurrentOBBAt(const struct entity *ent, vec3_t pos, struct obb *out);
 vec3_t   Entity_TopCenterPointWS(const struct entity *ent);
+void     Entity_InvalidateXform(struct entity *ent);
 
 #endif
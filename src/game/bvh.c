@@ -0,0 +1,586 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#include "bvh.h"
+#include "../entity.h"
+#include "../collision.h"
+#include "../main.h"
+#include "../perf.h"
+#include "../lib/public/khash.h"
+#include "../lib/public/vec.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#define NULL_NODE       (-1)
+#define MAX_FRUSTA      (8)
+#define MIN(a, b)       ((a) < (b) ? (a) : (b))
+#define MAX(a, b)       ((a) > (b) ? (a) : (b))
+
+struct node{
+    struct aabb    aabb;
+    /* Doubles as the next link of the free list */
+    int            parent;
+    int            child1, child2;
+    /* 0 for leaves, -1 for free nodes */
+    int            height;
+    struct entity *ent;
+};
+
+struct visit{
+    int     node;
+    /* The frusta that the node still needs to be tested against */
+    uint8_t test_mask;
+};
+
+KHASH_MAP_INIT_INT(leaf, int)
+KHASH_MAP_INIT_INT(unbounded, struct entity*)
+
+VEC_TYPE(visit, struct visit)
+VEC_IMPL(static inline, visit, struct visit)
+
+VEC_TYPE(int, int)
+VEC_IMPL(static inline, int, int)
+
+/*****************************************************************************/
+/* STATIC VARIABLES                                                          */
+/*****************************************************************************/
+
+static struct node           *s_nodes;
+static int                    s_capacity;
+static int                    s_free_list;
+static int                    s_root;
+/* Map of entity UID to leaf node index */
+static khash_t(leaf)         *s_leaves;
+/* Static entities with no fixed bounds (i.e. animated ones) */
+static khash_t(unbounded)    *s_unbounded;
+static vec_visit_t            s_visit_stack;
+static vec_int_t              s_leaf_stack;
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static bool is_leaf(const struct node *node)
+{
+    return (node->child1 == NULL_NODE);
+}
+
+static struct aabb aabb_union(const struct aabb *a, const struct aabb *b)
+{
+    return (struct aabb){
+        .x_min = MIN(a->x_min, b->x_min),
+        .x_max = MAX(a->x_max, b->x_max),
+        .y_min = MIN(a->y_min, b->y_min),
+        .y_max = MAX(a->y_max, b->y_max),
+        .z_min = MIN(a->z_min, b->z_min),
+        .z_max = MAX(a->z_max, b->z_max),
+    };
+}
+
+static float aabb_area(const struct aabb *aabb)
+{
+    float dx = aabb->x_max - aabb->x_min;
+    float dy = aabb->y_max - aabb->y_min;
+    float dz = aabb->z_max - aabb->z_min;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static struct aabb ent_bounds(const struct entity *ent)
+{
+    struct obb obb;
+    Entity_CurrentOBB(ent, &obb);
+
+    struct aabb ret = (struct aabb){
+        obb.corners[0].x, obb.corners[0].x,
+        obb.corners[0].y, obb.corners[0].y,
+        obb.corners[0].z, obb.corners[0].z,
+    };
+    for(int i = 1; i < 8; i++) {
+        ret.x_min = MIN(ret.x_min, obb.corners[i].x);
+        ret.x_max = MAX(ret.x_max, obb.corners[i].x);
+        ret.y_min = MIN(ret.y_min, obb.corners[i].y);
+        ret.y_max = MAX(ret.y_max, obb.corners[i].y);
+        ret.z_min = MIN(ret.z_min, obb.corners[i].z);
+        ret.z_max = MAX(ret.z_max, obb.corners[i].z);
+    }
+    return ret;
+}
+
+static int node_alloc(void)
+{
+    if(s_free_list == NULL_NODE) {
+
+        int new_cap = s_capacity ? s_capacity * 2 : 256;
+        struct node *new_nodes = realloc(s_nodes, new_cap * sizeof(struct node));
+        if(!new_nodes)
+            return NULL_NODE;
+
+        for(int i = s_capacity; i < new_cap; i++) {
+            new_nodes[i].parent = (i + 1 < new_cap) ? i + 1 : NULL_NODE;
+            new_nodes[i].height = -1;
+        }
+        s_free_list = s_capacity;
+        s_nodes = new_nodes;
+        s_capacity = new_cap;
+    }
+
+    int ret = s_free_list;
+    s_free_list = s_nodes[ret].parent;
+    s_nodes[ret] = (struct node){
+        .parent = NULL_NODE,
+        .child1 = NULL_NODE,
+        .child2 = NULL_NODE,
+        .height = 0,
+    };
+    return ret;
+}
+
+static void node_free(int idx)
+{
+    assert(idx >= 0 && idx < s_capacity);
+    s_nodes[idx].parent = s_free_list;
+    s_nodes[idx].height = -1;
+    s_free_list = idx;
+}
+
+static void replace_child(int parent, int old_child, int new_child)
+{
+    if(parent == NULL_NODE) {
+        s_root = new_child;
+        return;
+    }
+    if(s_nodes[parent].child1 == old_child)
+        s_nodes[parent].child1 = new_child;
+    else
+        s_nodes[parent].child2 = new_child;
+}
+
+/* Perform a left or right rotation if node 'ia' is imbalanced. Returns the 
+ * index of the new root of the subtree. */
+static int balance(int ia)
+{
+    struct node *a = &s_nodes[ia];
+    if(is_leaf(a) || a->height < 2)
+        return ia;
+
+    int ib = a->child1, ic = a->child2;
+    struct node *b = &s_nodes[ib], *c = &s_nodes[ic];
+    int bal = c->height - b->height;
+
+    /* Rotate 'c' up */
+    if(bal > 1) {
+
+        int iF = c->child1, ig = c->child2;
+        struct node *f = &s_nodes[iF], *g = &s_nodes[ig];
+
+        c->child1 = ia;
+        c->parent = a->parent;
+        a->parent = ic;
+        replace_child(c->parent, ia, ic);
+
+        if(f->height > g->height) {
+            c->child2 = iF;
+            a->child2 = ig;
+            g->parent = ia;
+            a->aabb = aabb_union(&b->aabb, &g->aabb);
+            c->aabb = aabb_union(&a->aabb, &f->aabb);
+            a->height = 1 + MAX(b->height, g->height);
+            c->height = 1 + MAX(a->height, f->height);
+        }else{
+            c->child2 = ig;
+            a->child2 = iF;
+            f->parent = ia;
+            a->aabb = aabb_union(&b->aabb, &f->aabb);
+            c->aabb = aabb_union(&a->aabb, &g->aabb);
+            a->height = 1 + MAX(b->height, f->height);
+            c->height = 1 + MAX(a->height, g->height);
+        }
+        return ic;
+    }
+
+    /* Rotate 'b' up */
+    if(bal < -1) {
+
+        int id = b->child1, ie = b->child2;
+        struct node *d = &s_nodes[id], *e = &s_nodes[ie];
+
+        b->child1 = ia;
+        b->parent = a->parent;
+        a->parent = ib;
+        replace_child(b->parent, ia, ib);
+
+        if(d->height > e->height) {
+            b->child2 = id;
+            a->child1 = ie;
+            e->parent = ia;
+            a->aabb = aabb_union(&c->aabb, &e->aabb);
+            b->aabb = aabb_union(&a->aabb, &d->aabb);
+            a->height = 1 + MAX(c->height, e->height);
+            b->height = 1 + MAX(a->height, d->height);
+        }else{
+            b->child2 = ie;
+            a->child1 = id;
+            d->parent = ia;
+            a->aabb = aabb_union(&c->aabb, &d->aabb);
+            b->aabb = aabb_union(&a->aabb, &e->aabb);
+            a->height = 1 + MAX(c->height, d->height);
+            b->height = 1 + MAX(a->height, e->height);
+        }
+        return ib;
+    }
+
+    return ia;
+}
+
+static void refit_ancestors(int idx)
+{
+    while(idx != NULL_NODE) {
+
+        idx = balance(idx);
+        struct node *node = &s_nodes[idx];
+        const struct node *c1 = &s_nodes[node->child1];
+        const struct node *c2 = &s_nodes[node->child2];
+
+        node->height = 1 + MAX(c1->height, c2->height);
+        node->aabb = aabb_union(&c1->aabb, &c2->aabb);
+        idx = node->parent;
+    }
+}
+
+/* Descends along the path of the least increase in total surface area to 
+ * find the sibling for the new leaf. */
+static int find_sibling(const struct aabb *leaf_aabb)
+{
+    int idx = s_root;
+    while(!is_leaf(&s_nodes[idx])) {
+
+        const struct node *node = &s_nodes[idx];
+        float area = aabb_area(&node->aabb);
+        struct aabb combined = aabb_union(&node->aabb, leaf_aabb);
+        float combined_area = aabb_area(&combined);
+
+        /* Cost of creating a new parent for this node and the new leaf */
+        float cost = 2.0f * combined_area;
+        /* Minimum cost of pushing the leaf further down the tree */
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        float child_costs[2];
+        const int children[2] = {node->child1, node->child2};
+
+        for(int i = 0; i < 2; i++) {
+
+            const struct node *child = &s_nodes[children[i]];
+            struct aabb child_combined = aabb_union(leaf_aabb, &child->aabb);
+            child_costs[i] = aabb_area(&child_combined) + inheritance_cost;
+            if(!is_leaf(child)) {
+                child_costs[i] -= aabb_area(&child->aabb);
+            }
+        }
+
+        if(cost < child_costs[0] && cost < child_costs[1])
+            break;
+        idx = (child_costs[0] < child_costs[1]) ? children[0] : children[1];
+    }
+    return idx;
+}
+
+static void insert_leaf(int leaf)
+{
+    if(s_root == NULL_NODE) {
+        s_root = leaf;
+        s_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    struct aabb leaf_aabb = s_nodes[leaf].aabb;
+    int sibling = find_sibling(&leaf_aabb);
+
+    int new_parent = node_alloc();
+    if(new_parent == NULL_NODE)
+        return;
+
+    int old_parent = s_nodes[sibling].parent;
+    s_nodes[new_parent].parent = old_parent;
+    s_nodes[new_parent].aabb = aabb_union(&leaf_aabb, &s_nodes[sibling].aabb);
+    s_nodes[new_parent].height = s_nodes[sibling].height + 1;
+    s_nodes[new_parent].child1 = sibling;
+    s_nodes[new_parent].child2 = leaf;
+
+    replace_child(old_parent, sibling, new_parent);
+    s_nodes[sibling].parent = new_parent;
+    s_nodes[leaf].parent = new_parent;
+
+    refit_ancestors(s_nodes[leaf].parent);
+}
+
+static void remove_leaf(int leaf)
+{
+    if(leaf == s_root) {
+        s_root = NULL_NODE;
+        return;
+    }
+
+    int parent = s_nodes[leaf].parent;
+    int grandparent = s_nodes[parent].parent;
+    int sibling = (s_nodes[parent].child1 == leaf) ? s_nodes[parent].child2 
+                                                   : s_nodes[parent].child1;
+
+    replace_child(grandparent, parent, sibling);
+    s_nodes[sibling].parent = grandparent;
+    node_free(parent);
+
+    refit_ancestors(grandparent);
+}
+
+static void push_subtree_leaves(int root, vec_pentity_t *out)
+{
+    vec_int_reset(&s_leaf_stack);
+    vec_int_push(&s_leaf_stack, root);
+
+    while(vec_size(&s_leaf_stack) > 0) {
+
+        const struct node *node = &s_nodes[vec_int_pop(&s_leaf_stack)];
+        if(is_leaf(node)) {
+            vec_pentity_push(out, node->ent);
+            continue;
+        }
+        /* Push in reverse so that the leaves come out left to right */
+        vec_int_push(&s_leaf_stack, node->child2);
+        vec_int_push(&s_leaf_stack, node->child1);
+    }
+}
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+bool G_Bvh_Init(void)
+{
+    s_leaves = kh_init(leaf);
+    if(!s_leaves)
+        goto fail_leaves;
+
+    s_unbounded = kh_init(unbounded);
+    if(!s_unbounded)
+        goto fail_unbounded;
+
+    vec_visit_init(&s_visit_stack);
+    vec_int_init(&s_leaf_stack);
+
+    s_nodes = NULL;
+    s_capacity = 0;
+    s_free_list = NULL_NODE;
+    s_root = NULL_NODE;
+    return true;
+
+fail_unbounded:
+    kh_destroy(leaf, s_leaves);
+fail_leaves:
+    return false;
+}
+
+void G_Bvh_Shutdown(void)
+{
+    vec_int_destroy(&s_leaf_stack);
+    vec_visit_destroy(&s_visit_stack);
+    kh_destroy(unbounded, s_unbounded);
+    kh_destroy(leaf, s_leaves);
+    free(s_nodes);
+}
+
+void G_Bvh_Clear(void)
+{
+    kh_clear(leaf, s_leaves);
+    kh_clear(unbounded, s_unbounded);
+
+    for(int i = 0; i < s_capacity; i++) {
+        s_nodes[i].parent = (i + 1 < s_capacity) ? i + 1 : NULL_NODE;
+        s_nodes[i].height = -1;
+    }
+    s_free_list = s_capacity ? 0 : NULL_NODE;
+    s_root = NULL_NODE;
+}
+
+void G_Bvh_Insert(struct entity *ent)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    if(G_Bvh_Contains(ent))
+        return;
+
+    int status;
+    if(ent->flags & ENTITY_FLAG_ANIMATED) {
+
+        khiter_t k = kh_put(unbounded, s_unbounded, ent->uid, &status);
+        if(status == -1)
+            return;
+        kh_value(s_unbounded, k) = ent;
+        return;
+    }
+
+    int leaf = node_alloc();
+    if(leaf == NULL_NODE)
+        return;
+
+    khiter_t k = kh_put(leaf, s_leaves, ent->uid, &status);
+    if(status == -1) {
+        node_free(leaf);
+        return;
+    }
+    kh_value(s_leaves, k) = leaf;
+
+    s_nodes[leaf].ent = ent;
+    s_nodes[leaf].aabb = ent_bounds(ent);
+    insert_leaf(leaf);
+}
+
+void G_Bvh_Remove(const struct entity *ent)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    khiter_t k = kh_get(unbounded, s_unbounded, ent->uid);
+    if(k != kh_end(s_unbounded)) {
+        kh_del(unbounded, s_unbounded, k);
+        return;
+    }
+
+    k = kh_get(leaf, s_leaves, ent->uid);
+    if(k == kh_end(s_leaves))
+        return;
+
+    int leaf = kh_value(s_leaves, k);
+    kh_del(leaf, s_leaves, k);
+
+    remove_leaf(leaf);
+    node_free(leaf);
+}
+
+void G_Bvh_Update(const struct entity *ent)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    khiter_t k = kh_get(leaf, s_leaves, ent->uid);
+    if(k == kh_end(s_leaves))
+        return;
+
+    int leaf = kh_value(s_leaves, k);
+    struct aabb bounds = ent_bounds(ent);
+    if(0 == memcmp(&bounds, &s_nodes[leaf].aabb, sizeof(bounds)))
+        return;
+
+    remove_leaf(leaf);
+    s_nodes[leaf].aabb = bounds;
+    insert_leaf(leaf);
+}
+
+bool G_Bvh_Contains(const struct entity *ent)
+{
+    return (kh_get(leaf, s_leaves, ent->uid) != kh_end(s_leaves))
+        || (kh_get(unbounded, s_unbounded, ent->uid) != kh_end(s_unbounded));
+}
+
+void G_Bvh_EntsInFrusta(const struct frustum *frusta, size_t nfrusta, vec_pentity_t *out)
+{
+    PERF_ENTER();
+    ASSERT_IN_MAIN_THREAD();
+    assert(nfrusta <= MAX_FRUSTA);
+
+    uint32_t key;
+    struct entity *curr;
+    (void)key;
+
+    kh_foreach(s_unbounded, key, curr, {
+        vec_pentity_push(out, curr);
+    });
+
+    if(s_root == NULL_NODE)
+        PERF_RETURN_VOID();
+
+    vec_visit_reset(&s_visit_stack);
+    vec_visit_push(&s_visit_stack, (struct visit){s_root, (1 << nfrusta) - 1});
+
+    while(vec_size(&s_visit_stack) > 0) {
+
+        struct visit visit = vec_visit_pop(&s_visit_stack);
+        const struct node *node = &s_nodes[visit.node];
+
+        uint8_t test_mask = 0;
+        bool inside = false;
+
+        for(int i = 0; i < nfrusta; i++) {
+
+            if(!(visit.test_mask & (1 << i)))
+                continue;
+
+            switch(C_FrustumAABBIntersectionPN(&frusta[i], &node->aabb)) {
+            case VOLUME_INTERSEC_INSIDE:
+                inside = true;
+                break;
+            case VOLUME_INTERSEC_INTERSECTION:
+                test_mask |= (1 << i);
+                break;
+            default:
+                break;
+            }
+            if(inside)
+                break;
+        }
+
+        /* Once the node is completely inside one of the frusta, all the 
+         * leaves under it are results */
+        if(inside) {
+            push_subtree_leaves(visit.node, out);
+            continue;
+        }
+
+        if(!test_mask)
+            continue;
+
+        if(is_leaf(node)) {
+            vec_pentity_push(out, node->ent);
+            continue;
+        }
+
+        vec_visit_push(&s_visit_stack, (struct visit){node->child2, test_mask});
+        vec_visit_push(&s_visit_stack, (struct visit){node->child1, test_mask});
+    }
+
+    PERF_RETURN_VOID();
+}
+
@@ -0,0 +1,68 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "public/game.h"
+#include <stddef.h>
+
+struct entity;
+struct frustum;
+
+/* A bounding volume hierarchy over the static entities of the game. Since 
+ * static entities seldom move, the tree is kept up to date incrementally 
+ * with every insertion, removal and transform change. Static entities with 
+ * animations have no fixed bounds - they are kept outside of the tree and 
+ * are returned by every query. 
+ */
+
+bool G_Bvh_Init(void);
+void G_Bvh_Shutdown(void);
+void G_Bvh_Clear(void);
+
+void G_Bvh_Insert(struct entity *ent);
+/* Removing or updating an entity that is not in the tree is a no-op */
+void G_Bvh_Remove(const struct entity *ent);
+void G_Bvh_Update(const struct entity *ent);
+bool G_Bvh_Contains(const struct entity *ent);
+
+/* Appends all the entities whose bounds intersect any one of the frusta 
+ * to 'out'. The order of the results only depends on the sequence of 
+ * modifications made to the tree. */
+void G_Bvh_EntsInFrusta(const struct frustum *frusta, size_t nfrusta, vec_pentity_t *out);
+
+#endif
+
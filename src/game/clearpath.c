@@ -58,9 +58,17 @@
 #include <stdbool.h>
 #include <string.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
-#define EPSILON         (1.0/1024)
+
+#define EPSILON         (1.0f/1024)
 #define MAX_SAVED_VOS   (512)
+/* Only the closest neighbours are taken into account. The pairwise ray 
+ * intersection step yields O(n^2) candidates, each of which has to be
+ * tested against all n obstacles, so crowds would otherwise blow up. */
+#define MAX_NEIGHBOURS  (32)
 
 VEC_TYPE(vec2, vec2_t)
 VEC_IMPL(static inline, vec2, vec2_t)
@@ -83,6 +91,35 @@ struct HRVO{
     vec2_t xz_right_side;
 };
 
+struct neighbour{
+    struct cp_ent ent;
+    float         dist_sq;
+    bool          dynamic;
+};
+
+/* The combined velocity obstacle, in structure-of-arrays form */
+struct obstacles{
+    size_t n;
+    float  apex_x[MAX_NEIGHBOURS];
+    float  apex_z[MAX_NEIGHBOURS];
+    float  left_x[MAX_NEIGHBOURS];
+    float  left_z[MAX_NEIGHBOURS];
+    float  right_x[MAX_NEIGHBOURS];
+    float  right_z[MAX_NEIGHBOURS];
+    /* The same sides, one entry per ray */
+    float  ray_px[MAX_NEIGHBOURS * 2];
+    float  ray_pz[MAX_NEIGHBOURS * 2];
+    float  ray_dx[MAX_NEIGHBOURS * 2];
+    float  ray_dz[MAX_NEIGHBOURS * 2];
+};
+
+/* The permissible velocity (in worldspace) closest to the desired one */
+struct candidate{
+    float des_x, des_z;
+    float dist_sq;
+    float x, z;
+};
+
 struct saved_ctx{
     struct cp_ent cpent;
     vec2_t        ent_des_v;
@@ -190,204 +227,255 @@ static struct HRVO compute_hrvo(struct cp_ent ent, struct cp_ent neighb)
     return ret;
 }
 
-static size_t compute_all_vos(struct cp_ent ent, vec_cp_ent_t stat_neighbs, 
-                              struct VO *out)
+static float dist_sq(vec2_t a, vec2_t b)
 {
-    size_t ret = 0; 
+    float dx = a.raw[0] - b.raw[0];
+    float dz = a.raw[1] - b.raw[1];
+    return dx * dx + dz * dz;
+}
 
-    for(struct cp_ent *nb = stat_neighbs.array; 
-        nb < stat_neighbs.array + vec_size(&stat_neighbs); nb++) {
-        
-        out[ret++] = compute_vo(ent, *nb);
-    }
+/* Keep the (at most) MAX_NEIGHBOURS neighbours closest to the entity, sorted 
+ * by increasing distance. Neighbours at equal distances keep their relative 
+ * order, with the dynamic neighbours coming first. */
+static size_t select_neighbours(struct cp_ent ent, vec_cp_ent_t dyn_neighbs, 
+                                vec_cp_ent_t stat_neighbs, struct neighbour *out)
+{
+    size_t ret = 0;
 
+    for(int i = 0; i < 2; i++) {
+
+        const vec_cp_ent_t *curr_vec = (i == 0) ? &dyn_neighbs : &stat_neighbs;
+        for(int j = 0; j < vec_size(curr_vec); j++) {
+
+            struct neighbour nb = (struct neighbour){
+                .ent = vec_AT(curr_vec, j),
+                .dist_sq = dist_sq(ent.xz_pos, vec_AT(curr_vec, j).xz_pos),
+                .dynamic = (i == 0)
+            };
+
+            if(ret == MAX_NEIGHBOURS && nb.dist_sq >= out[ret - 1].dist_sq)
+                continue;
+
+            size_t idx = (ret < MAX_NEIGHBOURS) ? ret++ : ret - 1;
+            while(idx > 0 && out[idx - 1].dist_sq > nb.dist_sq) {
+                out[idx] = out[idx - 1];
+                idx--;
+            }
+            out[idx] = nb;
+        }
+    }
     return ret;
 }
 
-static size_t compute_all_hrvos(struct cp_ent ent, vec_cp_ent_t dyn_neighbs, 
-                                struct HRVO *out)
+static void obstacles_add(struct obstacles *obs, vec2_t apex, vec2_t left, vec2_t right)
 {
-    size_t ret = 0; 
+    size_t i = obs->n++;
+    assert(i < MAX_NEIGHBOURS);
+
+    obs->apex_x[i] = apex.raw[0];
+    obs->apex_z[i] = apex.raw[1];
+    obs->left_x[i] = left.raw[0];
+    obs->left_z[i] = left.raw[1];
+    obs->right_x[i] = right.raw[0];
+    obs->right_z[i] = right.raw[1];
+
+    obs->ray_px[2 * i + 0] = apex.raw[0];
+    obs->ray_pz[2 * i + 0] = apex.raw[1];
+    obs->ray_dx[2 * i + 0] = left.raw[0];
+    obs->ray_dz[2 * i + 0] = left.raw[1];
+
+    obs->ray_px[2 * i + 1] = apex.raw[0];
+    obs->ray_pz[2 * i + 1] = apex.raw[1];
+    obs->ray_dx[2 * i + 1] = right.raw[0];
+    obs->ray_dz[2 * i + 1] = right.raw[1];
+}
 
-    for(struct cp_ent *nb = dyn_neighbs.array; 
-        nb < dyn_neighbs.array + vec_size(&dyn_neighbs); nb++) {
-        
-        out[ret++] = compute_hrvo(ent, *nb);
+/* Following the ClearPath approach, which is applicable to many variations 
+ * of velocity obstacles, we represent the combined hybrid reciprocal velocity 
+ * obstacle as a union of rays. Obstacle 'i' is bounded by the rays '2i' (left 
+ * side) and '2i + 1' (right side). Dynamic neighbours contribute an HRVO and
+ * static neighbours contribute a VO.
+ */
+static void compute_obstacles(struct cp_ent ent, const struct neighbour *nbs, size_t n_nbs,
+                              struct obstacles *out)
+{
+    out->n = 0;
+    for(int i = 0; i < n_nbs; i++) {
+
+        if(nbs[i].dynamic) {
+            struct HRVO hrvo = compute_hrvo(ent, nbs[i].ent);
+            obstacles_add(out, hrvo.xz_apex, hrvo.xz_left_side, hrvo.xz_right_side);
+        }else{
+            struct VO vo = compute_vo(ent, nbs[i].ent);
+            obstacles_add(out, vo.xz_apex, vo.xz_left_side, vo.xz_right_side);
+        }
     }
-
-    return ret;
 }
 
-/* Points exactly 'on' the boundary will be considered as 'not inside' of the PCR for our purposes. */
-static bool inside_pcr(const struct line_2d *vo_lr_pairs, size_t n_rays, vec2_t test)
+/* Returns true if the point is inside the combined velocity obstacle formed
+ * by the first 'n' obstacles. A point is inside an obstacle when it is right
+ * of its' left side and left of its' right side. Points exactly 'on' the 
+ * boundary will be considered as 'not inside' of the PCR for our purposes. 
+ */
+static bool inside_pcr(const struct obstacles *obs, size_t n, float x, float z)
 {
-    assert(n_rays % 2 == 0);
-    for(int i = 0; i < n_rays; i+=2) {
+    size_t i = 0;
+
+#if defined(__SSE__)
+    const __m128 tx = _mm_set1_ps(x);
+    const __m128 tz = _mm_set1_ps(z);
+    const __m128 eps = _mm_set1_ps(EPSILON);
 
-        assert(fabs(PFM_Vec2_Len(&vo_lr_pairs[i + 0].dir) - 1.0f) < EPSILON);
-        const float left_dir_x = vo_lr_pairs[i + 0].dir.raw[0];
-        const float left_dir_z = vo_lr_pairs[i + 0].dir.raw[1];
+    for(; i + 4 <= n; i += 4) {
 
-        vec2_t point_to_test;
-        PFM_Vec2_Sub(&test, (vec2_t*)&vo_lr_pairs[i + 0].point, &point_to_test);
-        PFM_Vec2_Normal(&point_to_test, &point_to_test);
+        __m128 px = _mm_sub_ps(tx, _mm_loadu_ps(obs->apex_x + i));
+        __m128 pz = _mm_sub_ps(tz, _mm_loadu_ps(obs->apex_z + i));
 
-        float left_det = (point_to_test.raw[1] * left_dir_x) - (point_to_test.raw[0] * left_dir_z);
-        bool left_of_vo = (left_det < EPSILON);
+        /* Rather than normalizing the apex-to-point vector, scale the 
+         * tolerance by its' length */
+        __m128 tol = _mm_mul_ps(eps, _mm_sqrt_ps(
+            _mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(pz, pz))));
 
-        if(left_of_vo)
-            continue;
+        __m128 left_det = _mm_sub_ps(
+            _mm_mul_ps(pz, _mm_loadu_ps(obs->left_x + i)), 
+            _mm_mul_ps(px, _mm_loadu_ps(obs->left_z + i)));
+        __m128 right_det = _mm_sub_ps(
+            _mm_mul_ps(pz, _mm_loadu_ps(obs->right_x + i)), 
+            _mm_mul_ps(px, _mm_loadu_ps(obs->right_z + i)));
 
-        assert(fabs(PFM_Vec2_Len(&vo_lr_pairs[i + 1].dir) - 1.0f) < EPSILON);
-        const float right_dir_x = vo_lr_pairs[i + 1].dir.raw[0];
-        const float right_dir_z = vo_lr_pairs[i + 1].dir.raw[1];
+        __m128 inside = _mm_and_ps(
+            _mm_cmpge_ps(left_det, tol),
+            _mm_cmple_ps(right_det, _mm_sub_ps(_mm_setzero_ps(), tol)));
 
-        PFM_Vec2_Sub(&test, (vec2_t*)&vo_lr_pairs[i + 1].point, &point_to_test);
-        PFM_Vec2_Normal(&point_to_test, &point_to_test);
+        if(_mm_movemask_ps(inside))
+            return true;
+    }
+#endif
 
-        float right_det = (point_to_test.raw[1] * right_dir_x) - (point_to_test.raw[0] * right_dir_z);
-        bool right_of_vo = (right_det > -EPSILON);
+    for(; i < n; i++) {
 
-        if(right_of_vo)
-            continue;
+        float px = x - obs->apex_x[i];
+        float pz = z - obs->apex_z[i];
+        float tol = EPSILON * sqrtf(px * px + pz * pz);
 
-        assert(!left_of_vo && !right_of_vo);
-        return true;
-    }
+        float left_det = pz * obs->left_x[i] - px * obs->left_z[i];
+        float right_det = pz * obs->right_x[i] - px * obs->right_z[i];
 
+        if(left_det >= tol && right_det <= -tol)
+            return true;
+    }
     return false;
 }
 
-static void rays_repr(const struct HRVO *hrvos, size_t n_hrvos,
-                      const struct VO *vos, size_t n_vos,
-                      struct line_2d *out)
+/* Any candidate velocity that is no closer to the desired velocity than the
+ * best one so far can be skipped without testing it against the obstacles. 
+ * When 'debug_out' is set, all the permissible candidates are collected. 
+ */
+static void consider_candidate(struct candidate *best, const struct obstacles *obs, size_t n,
+                               float x, float z, vec_vec2_t *debug_out)
 {
-    size_t rays_idx  = 0;
-
-    for(int i = 0; i < n_hrvos; i++) {
-         
-        out[rays_idx + 0].point = hrvos[i].xz_apex;
-        out[rays_idx + 0].dir = hrvos[i].xz_left_side;
+    float dx = x - best->des_x;
+    float dz = z - best->des_z;
+    float d = dx * dx + dz * dz;
 
-        out[rays_idx + 1].point = hrvos[i].xz_apex;
-        out[rays_idx + 1].dir = hrvos[i].xz_right_side;
-
-        rays_idx += 2;
-    }
+    if(d >= best->dist_sq && !debug_out)
+        return;
 
-    for(int i = 0; i < n_vos; i++) {
-    
-        out[rays_idx + 0].point = vos[i].xz_apex;
-        out[rays_idx + 0].dir = vos[i].xz_left_side;
+    if(inside_pcr(obs, n, x, z))
+        return;
 
-        out[rays_idx + 1].point = vos[i].xz_apex;
-        out[rays_idx + 1].dir = vos[i].xz_right_side;
+    if(debug_out)
+        vec_vec2_push(debug_out, (vec2_t){x, z});
 
-        rays_idx += 2;
+    if(d < best->dist_sq) {
+        best->dist_sq = d;
+        best->x = x;
+        best->z = z;
     }
 }
 
-static size_t compute_vo_xpoints(struct line_2d *rays, size_t n_rays,
-                                 vec_vec2_t *inout)
+/* The rays are intersected pairwise and the intersection points inside the 
+ * combined velocity obstacle are discarded. The remaining intersection points 
+ * are permissible new velocities on its' boundary.
+ */
+static void compute_vo_xpoints(const struct obstacles *obs, size_t n, 
+                               struct candidate *best, vec_vec2_t *debug_out)
 {
-    size_t ret = 0;
+    const size_t n_rays = n * 2;
 
-    for(int i = 0; i < n_rays; i++) {
-        for(int j = 0; j < n_rays; j++) {
+    for(size_t i = 0; i < n_rays; i++) {
 
-            if(i == j) 
-                continue;
+        const float p1x = obs->ray_px[i], p1z = obs->ray_pz[i];
+        const float d1x = obs->ray_dx[i], d1z = obs->ray_dz[i];
+        size_t j = i + 1;
 
-            vec2_t isec_point;
-            if(!C_RayRayIntersection2D(rays[i], rays[j], &isec_point))
-                continue;
+#if defined(__SSE__)
+        const __m128 vp1x = _mm_set1_ps(p1x), vp1z = _mm_set1_ps(p1z);
+        const __m128 vd1x = _mm_set1_ps(d1x), vd1z = _mm_set1_ps(d1z);
+        const __m128 eps = _mm_set1_ps(EPSILON);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 sign = _mm_set1_ps(-0.0f);
 
-            if(inside_pcr(rays, n_rays, isec_point))
-                continue;
+        for(; j + 4 <= n_rays; j += 4) {
 
-            vec_vec2_push(inout, isec_point);
-            ret++;
-        }
-    }
-
-    return ret;
-}
+            __m128 d2x = _mm_loadu_ps(obs->ray_dx + j);
+            __m128 d2z = _mm_loadu_ps(obs->ray_dz + j);
+            __m128 wx = _mm_sub_ps(_mm_loadu_ps(obs->ray_px + j), vp1x);
+            __m128 wz = _mm_sub_ps(_mm_loadu_ps(obs->ray_pz + j), vp1z);
 
-static size_t compute_vdes_proj_points(struct line_2d *rays, size_t n_rays,
-                                       vec2_t des_v, vec_vec2_t *inout)
-{
-    vec2_t proj;
-    size_t ret = 0;
+            __m128 denom = _mm_sub_ps(_mm_mul_ps(vd1x, d2z), _mm_mul_ps(vd1z, d2x));
+            __m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(wx, d2z), _mm_mul_ps(wz, d2x)), denom);
+            __m128 u = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(wx, vd1z), _mm_mul_ps(wz, vd1x)), denom);
 
-    for(int i = 0; i < n_rays; i++) {
-    
-        assert(fabs(PFM_Vec2_Len(&rays[i].dir) - 1.0f) < EPSILON);
+            __m128 hit = _mm_and_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign, denom), eps),
+                         _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmpge_ps(u, zero)));
+            int mask = _mm_movemask_ps(hit);
+            if(!mask)
+                continue;
 
-        float len = PFM_Vec2_Dot(&rays[i].dir, &des_v);
-        PFM_Vec2_Scale(&rays[i].dir, len, &proj);
-        PFM_Vec2_Add(&rays[i].point, &proj, &proj);
+            float xs[4], zs[4];
+            _mm_storeu_ps(xs, _mm_add_ps(vp1x, _mm_mul_ps(t, vd1x)));
+            _mm_storeu_ps(zs, _mm_add_ps(vp1z, _mm_mul_ps(t, vd1z)));
 
-        if(!inside_pcr(rays, n_rays, proj)) {
-        
-            vec_vec2_push(inout, proj);
-            ret++;
+            for(int k = 0; k < 4; k++) {
+                if(mask & (1 << k))
+                    consider_candidate(best, obs, n, xs[k], zs[k], debug_out);
+            }
         }
-    }
+#endif
 
-    return ret;
-}
+        for(; j < n_rays; j++) {
 
-static vec2_t compute_vnew(const vec_vec2_t *outside_points, vec2_t des_v, vec2_t ent_xz_pos)
-{
-    float min_dist = INFINITY, len;
-    vec2_t ret;
-
-    for(int i = 0; i < vec_size(outside_points); i++) {
+            const float d2x = obs->ray_dx[j], d2z = obs->ray_dz[j];
+            const float wx = obs->ray_px[j] - p1x;
+            const float wz = obs->ray_pz[j] - p1z;
 
-        /* The points are in worldspace coordinates. Convert them to the entity's 
-         * local space to get the adimissible velocities. */
-        vec2_t curr = vec_AT(outside_points, i), diff;
-        PFM_Vec2_Sub(&curr, &ent_xz_pos, &curr);
+            float denom = d1x * d2z - d1z * d2x;
+            float t = (wx * d2z - wz * d2x) / denom;
+            float u = (wx * d1z - wz * d1x) / denom;
 
-        PFM_Vec2_Sub(&des_v, &curr, &diff);
-        if((len = PFM_Vec2_Len(&diff)) < min_dist) {
+            if(!(fabsf(denom) > EPSILON && t >= 0.0f && u >= 0.0f))
+                continue;
 
-            min_dist = len;
-            ret = curr;
+            consider_candidate(best, obs, n, p1x + t * d1x, p1z + t * d1z, debug_out);
         }
     }
-
-    assert(min_dist < INFINITY);
-    return ret;
 }
 
-static void remove_furthest(vec2_t xz_pos, vec_cp_ent_t *dyn_inout, vec_cp_ent_t *stat_inout)
+/* In addition we project the preferred velocity (des_v) on to the rays and 
+ * also retain those points that are outside the combined velocity obstacle.
+ */
+static void compute_vdes_proj_points(const struct obstacles *obs, size_t n, vec2_t des_v, 
+                                     struct candidate *best, vec_vec2_t *debug_out)
 {
-    float max_dist = -INFINITY;
-    vec_cp_ent_t *del_vec = NULL;
-    int del_idx = -1;
+    for(size_t i = 0; i < n * 2; i++) {
 
-    for(int i = 0; i < 2; i++) {
-    
-        vec_cp_ent_t *curr_vec = (i == 0) ? dyn_inout : stat_inout;
-        for(int j = 0; j < vec_size(curr_vec); j++) {
-        
-            float len;
-            vec2_t diff;
-            struct cp_ent *ent = &vec_AT(curr_vec, j);
-
-            PFM_Vec2_Sub(&xz_pos, &ent->xz_pos, &diff);
-            if((len = PFM_Vec2_Len(&diff)) > max_dist) {
-                max_dist = len; 
-                del_vec = curr_vec;
-                del_idx = j;
-            }
-        }
-    }
+        const float dx = obs->ray_dx[i], dz = obs->ray_dz[i];
+        assert(fabs(sqrtf(dx * dx + dz * dz) - 1.0f) < EPSILON);
 
-    if(max_dist > -INFINITY) {
-        assert(del_idx != -1);
-        vec_cp_ent_del(del_vec, del_idx);
+        float len = dx * des_v.raw[0] + dz * des_v.raw[1];
+        consider_candidate(best, obs, n, obs->ray_px[i] + dx * len, 
+            obs->ray_pz[i] + dz * len, debug_out);
     }
 }
 
@@ -457,17 +545,7 @@ static void on_render_3d(void *user, void *event)
     float radius = CLEARPATH_NEIGHBOUR_RADIUS;
     float width = 0.5f;
 
-    R_PushCmd((struct rcmd){
-        .func = R_GL_DrawSelectionCircle,
-        .nargs = 5,
-        .args = {
-            R_PushArg(&cpent->xz_pos, sizeof(cpent->xz_pos)),
-            R_PushArg(&radius, sizeof(radius)),
-            R_PushArg(&width, sizeof(width)),
-            R_PushArg(&yellow, sizeof(yellow)),
-            (void*)G_GetPrevTickMap(),
-        },
-    });
+    R_PushSelectionCircle(cpent->xz_pos, radius, width, yellow, G_GetPrevTickMap());
 
     mat4x4_t ident;
     PFM_Mat4x4_Identity(&ident);
@@ -517,17 +595,8 @@ static void on_render_3d(void *user, void *event)
 
     for(int i = 0; i < vec_size(&s_debug_saved.xpoints); i++) {
 
-        R_PushCmd((struct rcmd){
-            .func = R_GL_DrawSelectionCircle,
-            .nargs = 5,
-            .args = {
-                R_PushArg(&vec_AT(&s_debug_saved.xpoints, i), sizeof(vec_AT(&s_debug_saved.xpoints, 0))),
-                R_PushArg(&radius, sizeof(radius)),
-                R_PushArg(&width, sizeof(width)),
-                R_PushArg(&green, sizeof(green)),
-                (void*)G_GetPrevTickMap(),
-            },
-        });
+        R_PushSelectionCircle(vec_AT(&s_debug_saved.xpoints, i), radius, width, green, 
+            G_GetPrevTickMap());
     }
 
     char strbuff[256];
@@ -541,35 +610,27 @@ static void on_render_3d(void *user, void *event)
 static bool clearpath_new_velocity(struct cp_ent cpent,
                                    uint32_t ent_uid,
                                    vec2_t ent_des_v,
-                                   const vec_cp_ent_t dyn_neighbs,
-                                   const vec_cp_ent_t stat_neighbs,
+                                   const struct neighbour *nbs,
+                                   const struct obstacles *obs,
+                                   size_t n,
                                    vec2_t *out)
 {
-    struct HRVO dyn_hrvos[vec_size(&dyn_neighbs)];
-    struct VO stat_vos[vec_size(&stat_neighbs)];
-
-    size_t n_hrvos = compute_all_hrvos(cpent, dyn_neighbs, dyn_hrvos);
-    size_t n_vos = compute_all_vos(cpent, stat_neighbs, stat_vos);
-
-    assert(n_hrvos == vec_size(&dyn_neighbs));
-    assert(n_vos == vec_size(&stat_neighbs));
+    bool debug = should_save_debug(ent_uid);
+    if(debug) {
 
-    /* Following the ClearPath approach, which is applicable to many variations 
-     * of velocity obstacles, we represent the combined hybrid reciprocal velocity 
-     * obstacle as a union of line segments. 
-     */
-    const size_t n_rays = (n_hrvos + n_vos) * 2;
-    struct line_2d rays[n_rays];
-    rays_repr(dyn_hrvos, n_hrvos, stat_vos, n_vos, rays);
+        size_t nsaved_hrvos = 0, nsaved_vos = 0;
+        for(int i = 0; i < n; i++) {
 
-    if(should_save_debug(ent_uid)) {
+            vec2_t apex = (vec2_t){obs->apex_x[i], obs->apex_z[i]};
+            vec2_t left = (vec2_t){obs->left_x[i], obs->left_z[i]};
+            vec2_t right = (vec2_t){obs->right_x[i], obs->right_z[i]};
 
-        size_t nsaved_hrvos = n_hrvos <= MAX_SAVED_VOS ? n_hrvos : MAX_SAVED_VOS;
-        memcpy(s_debug_saved.hrvos, dyn_hrvos, nsaved_hrvos * sizeof(struct HRVO));
+            if(nbs[i].dynamic && nsaved_hrvos < MAX_SAVED_VOS)
+                s_debug_saved.hrvos[nsaved_hrvos++] = (struct HRVO){apex, left, right};
+            else if(!nbs[i].dynamic && nsaved_vos < MAX_SAVED_VOS)
+                s_debug_saved.vos[nsaved_vos++] = (struct VO){apex, left, right};
+        }
         s_debug_saved.n_hrvos = nsaved_hrvos;
-
-        size_t nsaved_vos = n_vos <= MAX_SAVED_VOS ? n_vos : MAX_SAVED_VOS;
-        memcpy(s_debug_saved.vos, stat_vos, nsaved_vos * sizeof(struct VO));
         s_debug_saved.n_vos = nsaved_vos;
 
         vec_vec2_reset(&s_debug_saved.xpoints);
@@ -582,44 +643,38 @@ static bool clearpath_new_velocity(struct cp_ent cpent,
 
     vec2_t des_v_ws;
     PFM_Vec2_Add(&cpent.xz_pos, &ent_des_v, &des_v_ws);
-    if(!inside_pcr(rays, n_rays, des_v_ws)) {
+    if(!inside_pcr(obs, n, des_v_ws.raw[0], des_v_ws.raw[1])) {
 
         s_debug_saved.des_v_in_pcr = false;
         *out = ent_des_v;
         return true;
     }
 
-    vec_vec2_t xpoints;
-    vec_vec2_init(&xpoints);
-
-    /* The line segments are intersected pairwise and the intersection points 
-     * inside the combined hybrid reciprocal velocity obstacle are discarded. 
-     * The remaining intersection points are permissible new velocities on the 
-     * boundary of the combined hybrid reciprocal velocity obstacle.
-     */
-    compute_vo_xpoints(rays, n_rays, &xpoints); 
-
-    /* In addition we project the preferred velocity (des_v) on to the line 
-     * segments (xz_left_side and xz_right_side of each hrvo) and also retain 
-     * those points that are outside the combined hybrid reciprocal velocity 
-     * obstacle.
-     */
-    compute_vdes_proj_points(rays, n_rays, ent_des_v, &xpoints);
-
-    if(vec_size(&xpoints) == 0) {
-        return false;    
-    }
+    struct candidate best = (struct candidate){
+        .des_x = des_v_ws.raw[0],
+        .des_z = des_v_ws.raw[1],
+        .dist_sq = INFINITY
+    };
+    vec_vec2_t *debug_out = debug ? &s_debug_saved.xpoints : NULL;
 
-    vec2_t ret = compute_vnew(&xpoints, ent_des_v, cpent.xz_pos);
+    compute_vo_xpoints(obs, n, &best, debug_out);
+    compute_vdes_proj_points(obs, n, ent_des_v, &best, debug_out);
 
-    if(should_save_debug(ent_uid)) {
-    
-        vec_vec2_copy(&s_debug_saved.xpoints, &xpoints);
+    if(best.dist_sq == INFINITY)
+        return false;
+
+    /* The points are in worldspace coordinates. Convert them to the entity's 
+     * local space to get the adimissible velocities. */
+    vec2_t ret = (vec2_t){
+        best.x - cpent.xz_pos.raw[0],
+        best.z - cpent.xz_pos.raw[1]
+    };
+
+    if(debug) {
         s_debug_saved.v_new = ret;
         s_debug_saved.des_v_in_pcr = true;
     }
 
-    vec_vec2_destroy(&xpoints);
     *out = ret;
     return true;
 }
@@ -649,16 +704,33 @@ vec2_t G_ClearPath_NewVelocity(struct cp_ent cpent,
 {
     PERF_ENTER();
 
+    struct neighbour nbs[MAX_NEIGHBOURS];
+    size_t n = select_neighbours(cpent, dyn_neighbs, stat_neighbs, nbs);
+
+    /* The obstacles are sorted by distance so dropping the furthest 
+     * neighbour only means considering one obstacle less. */
+    struct obstacles obs;
+    compute_obstacles(cpent, nbs, n, &obs);
+
+    size_t n_dyn = 0;
+    for(int i = 0; i < n; i++)
+        n_dyn += !!nbs[i].dynamic;
+    size_t n_stat = n - n_dyn;
+
     do{
         vec2_t ret;
-        bool found = clearpath_new_velocity(cpent, ent_uid, ent_des_v, dyn_neighbs, stat_neighbs, &ret);
+        bool found = clearpath_new_velocity(cpent, ent_uid, ent_des_v, nbs, &obs, n, &ret);
         if(found)
             PERF_RETURN(ret);
 
-        remove_furthest(cpent.xz_pos, &dyn_neighbs, &stat_neighbs);
+        assert(n > 0);
+        n--;
+        if(nbs[n].dynamic)
+            n_dyn--;
+        else
+            n_stat--;
 
-    }while(vec_size(&dyn_neighbs) > 0 && vec_size(&stat_neighbs) > 0);
+    }while(n_dyn > 0 && n_stat > 0);
 
     PERF_RETURN((vec2_t){0.0f, 0.0f});
 }
-
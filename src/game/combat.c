@@ -51,6 +51,9 @@
 #define ENEMY_TARGET_ACQUISITION_RANGE (50.0f)
 #define ENEMY_MELEE_ATTACK_RANGE       (5.0f)
 #define EPSILON                        (1.0f/1024)
+/* Entities that are not in combat only scan for enemies on one out of 
+ * every IDLE_SCAN_PERIOD ticks, staggered by UID. */
+#define IDLE_SCAN_PERIOD               (3)
 #define MAX(a, b)                      ((a) > (b) ? (a) : (b))
 #define MIN(a, b)                      ((a) < (b) ? (a) : (b))
 #define ARR_SIZE(a)                    (sizeof(a)/sizeof(a[0]))
@@ -108,6 +111,20 @@ struct combatstate{
 
 KHASH_MAP_INIT_INT(state, struct combatstate)
 
+/* Potential targets are bucketed by faction and by cell, with cells the
+ * size of the acquisition range. Entities sharing a bucket are chained
+ * through 'next'. */
+struct target{
+    struct entity *ent;
+    vec2_t         xz_pos;
+    int            next;
+};
+
+VEC_TYPE(target, struct target)
+VEC_IMPL(static inline, target, struct target)
+
+KHASH_MAP_INIT_INT64(cell, int)
+
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
 /*****************************************************************************/
@@ -115,6 +132,11 @@ KHASH_MAP_INIT_INT(state, struct combatstate)
 static khash_t(state) *s_entity_state_table;
 /* For saving/restoring state */
 static vec_pentity_t   s_dying_ents;
+/* Index of combatable entities, rebuilt at the start of every tick */
+static vec_target_t    s_targets;
+static khash_t(cell)  *s_target_cells;
+static uint16_t        s_target_factions;
+static uint32_t        s_tick;
 
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
@@ -186,37 +208,122 @@ static float ents_distance(const struct entity *a, const struct entity *b)
     return PFM_Vec2_Len(&dist) - a->selection_radius - b->selection_radius;
 }
 
+static uint64_t target_cell_key(int faction_id, int r, int c)
+{
+    return ((uint64_t)faction_id << 32) | ((uint64_t)(uint16_t)r << 16) | (uint16_t)c;
+}
+
+static void target_cell_coords(vec2_t xz_pos, int *out_r, int *out_c)
+{
+    *out_r = floorf(xz_pos.z / ENEMY_TARGET_ACQUISITION_RANGE);
+    *out_c = floorf(xz_pos.x / ENEMY_TARGET_ACQUISITION_RANGE);
+}
+
+static void targets_rebuild(void)
+{
+    kh_clear(cell, s_target_cells);
+    vec_target_reset(&s_targets);
+    s_target_factions = 0;
+
+    uint32_t key;
+    struct combatstate curr;
+
+    kh_foreach(s_entity_state_table, key, curr, {
+
+        if(curr.state == STATE_DEATH_ANIM_PLAYING)
+            continue;
+
+        struct entity *ent = G_EntityForUID(key);
+        if(!ent || (ent->flags & ENTITY_FLAG_ZOMBIE))
+            continue;
+
+        vec2_t xz_pos = G_Pos_GetXZ(key);
+        int r, c;
+        target_cell_coords(xz_pos, &r, &c);
+
+        int ret;
+        khiter_t k = kh_put(cell, s_target_cells, target_cell_key(ent->faction_id, r, c), &ret);
+        if(ret == -1)
+            continue;
+        if(ret != 0)
+            kh_value(s_target_cells, k) = -1;
+
+        struct target target = (struct target){
+            .ent = ent,
+            .xz_pos = xz_pos,
+            .next = kh_value(s_target_cells, k),
+        };
+        if(!vec_target_push(&s_targets, target))
+            continue;
+
+        kh_value(s_target_cells, k) = vec_size(&s_targets) - 1;
+        s_target_factions |= (0x1 << ent->faction_id);
+    });
+}
+
 static struct entity *closest_enemy_in_range(const struct entity *ent)
 {
     float min_dist = FLT_MAX;
     struct entity *ret = NULL;
 
-    struct entity *near_ents[128];
-    int num_near = G_Pos_EntsInCircle(G_Pos_GetXZ(ent->uid), 
-        ENEMY_TARGET_ACQUISITION_RANGE, near_ents, ARR_SIZE(near_ents));
+    vec2_t xz_pos = G_Pos_GetXZ(ent->uid);
+    int r0, c0, r1, c1;
+    target_cell_coords((vec2_t){xz_pos.x - ENEMY_TARGET_ACQUISITION_RANGE, 
+                                xz_pos.z - ENEMY_TARGET_ACQUISITION_RANGE}, &r0, &c0);
+    target_cell_coords((vec2_t){xz_pos.x + ENEMY_TARGET_ACQUISITION_RANGE, 
+                                xz_pos.z + ENEMY_TARGET_ACQUISITION_RANGE}, &r1, &c1);
 
-    for(int i = 0; i < num_near; i++) {
+    for(int fac_id = 0; fac_id < MAX_FACTIONS; fac_id++) {
 
-        struct entity *curr = near_ents[i];
-        if(curr == ent)
-            continue;
-        if(!(curr->flags & ENTITY_FLAG_COMBATABLE))
-            continue;
-        if(curr->flags & ENTITY_FLAG_ZOMBIE)
+        if(!(s_target_factions & (0x1 << fac_id)))
             continue;
-        if(!enemies(ent, curr))
+        if(fac_id == ent->faction_id)
             continue;
 
-        struct combatstate *cs = combatstate_get(curr->uid);
-        assert(cs);
-        if(cs->state == STATE_DEATH_ANIM_PLAYING)
+        enum diplomacy_state ds;
+        if(!G_GetDiplomacyState(ent->faction_id, fac_id, &ds) || ds != DIPLOMACY_STATE_WAR)
             continue;
-   
-        float dist = ents_distance(ent, curr);
-        if(dist < min_dist) {
-            min_dist = dist; 
-            ret = curr;
-        }
+
+        for(int r = r0; r <= r1; r++) {
+        for(int c = c0; c <= c1; c++) {
+
+            khiter_t k = kh_get(cell, s_target_cells, target_cell_key(fac_id, r, c));
+            if(k == kh_end(s_target_cells))
+                continue;
+
+            for(int i = kh_value(s_target_cells, k); i != -1; i = vec_AT(&s_targets, i).next) {
+
+                const struct target *target = &vec_AT(&s_targets, i);
+                struct entity *curr = target->ent;
+
+                /* The index is a snapshot from the start of the tick; re-check 
+                 * anything that may have changed since. */
+                if(!(curr->flags & ENTITY_FLAG_COMBATABLE))
+                    continue;
+                if(curr->flags & ENTITY_FLAG_ZOMBIE)
+                    continue;
+                if(!enemies(ent, curr))
+                    continue;
+
+                struct combatstate *cs = combatstate_get(curr->uid);
+                if(!cs || cs->state == STATE_DEATH_ANIM_PLAYING)
+                    continue;
+
+                vec2_t delta;
+                vec2_t curr_xz_pos = target->xz_pos;
+                PFM_Vec2_Sub(&xz_pos, &curr_xz_pos, &delta);
+
+                float center_dist = PFM_Vec2_Len(&delta);
+                if(center_dist > ENEMY_TARGET_ACQUISITION_RANGE)
+                    continue;
+           
+                float dist = center_dist - ent->selection_radius - curr->selection_radius;
+                if(dist < min_dist) {
+                    min_dist = dist; 
+                    ret = curr;
+                }
+            }
+        }}
     }
     return ret;
 }
@@ -243,6 +350,7 @@ static void entity_turn_to_target(struct entity *ent, const struct entity *targe
     PFM_Vec2_Sub(&tar_pos_xz, &ent_pos_xz, &ent_to_target);
     PFM_Vec2_Normal(&ent_to_target, &ent_to_target);
     ent->rotation = quat_from_vec(ent_to_target);
+    G_UpdateBounds(ent);
 }
 
 static void on_death_anim_finish(void *user, void *event)
@@ -302,12 +410,14 @@ static void on_30hz_tick(void *user, void *event)
 {
     PERF_ENTER();
 
-    uint32_t key;
-    struct entity *curr;
-    (void)key;
+    const vec_pentity_t *ents = G_GetDynamicEntsOrdered();
 
-    kh_foreach(G_GetDynamicEntsSet(), key, curr, {
+    targets_rebuild();
+    s_tick++;
 
+    for(int i = 0; i < vec_size(ents); i++) {
+
+        struct entity *curr = vec_AT(ents, i);
         if(!(curr->flags & ENTITY_FLAG_COMBATABLE))
             continue;
 
@@ -320,6 +430,9 @@ static void on_30hz_tick(void *user, void *event)
             if(cs->stance == COMBAT_STANCE_NO_ENGAGEMENT)
                 break;
 
+            if((curr->uid + s_tick) % IDLE_SCAN_PERIOD)
+                break;
+
             /* Make the entity seek enemy units. */
             struct entity *enemy;
             if((enemy = closest_enemy_in_range(curr)) != NULL) {
@@ -422,7 +535,8 @@ static void on_30hz_tick(void *user, void *event)
         default: assert(0);
         };
     
-    });
+    }
+
     PERF_RETURN_VOID();
 }
 
@@ -433,16 +547,26 @@ static void on_30hz_tick(void *user, void *event)
 bool G_Combat_Init(void)
 {
     if(NULL == (s_entity_state_table = kh_init(state)))
-        return false;
+        goto fail_table;
+    if(NULL == (s_target_cells = kh_init(cell)))
+        goto fail_cells;
 
     vec_pentity_init(&s_dying_ents);
+    vec_target_init(&s_targets);
     E_Global_Register(EVENT_30HZ_TICK, on_30hz_tick, NULL, G_RUNNING);
     return true;
+
+fail_cells:
+    kh_destroy(state, s_entity_state_table);
+fail_table:
+    return false;
 }
 
 void G_Combat_Shutdown(void)
 {
     E_Global_Unregister(EVENT_30HZ_TICK, on_30hz_tick);
+    vec_target_destroy(&s_targets);
+    kh_destroy(cell, s_target_cells);
     vec_pentity_destroy(&s_dying_ents);
     kh_destroy(state, s_entity_state_table);
 }
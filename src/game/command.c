@@ -0,0 +1,508 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#include "command.h"
+#include "game_private.h"
+#include "selection.h"
+#include "movement.h"
+#include "combat.h"
+#include "../entity.h"
+#include "../main.h"
+#include "../lib/public/vec.h"
+#include "../lib/public/SDL_vec_rwops.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+
+#define CMD_LOG_MAGIC   (0x4c434650) /* 'PFCL' */
+#define CMD_LOG_VERSION (1)
+
+enum cmd_type{
+    CMD_END = 0,
+    CMD_SEL_CLEAR,
+    CMD_SEL_ADD,
+    CMD_SEL_REMOVE,
+    CMD_SEL_SET,
+    CMD_ORDER_SELECTION,
+    CMD_MOVE,
+    CMD_STOP,
+    CMD_ATTACK,
+    CMD_HOLD_POSITION,
+    CMD_MAX,
+};
+
+struct cmd{
+    uint64_t tick;      /* relative to the start of the recording */
+    uint8_t  type;
+    uint8_t  attack;
+    uint32_t uid;
+    vec3_t   pos;
+    /* The range of UIDs in 'uids' taken by a CMD_SEL_SET command */
+    uint32_t uids_begin;
+    uint32_t uids_count;
+};
+
+VEC_TYPE(cmd, struct cmd)
+VEC_IMPL(static inline, cmd, struct cmd)
+
+VEC_TYPE(uid, uint32_t)
+VEC_IMPL(static inline, uid, uint32_t)
+
+/*****************************************************************************/
+/* STATIC VARIABLES                                                          */
+/*****************************************************************************/
+
+static struct{
+    bool        active;
+    uint64_t    start_tick;
+    SDL_RWops  *log;
+}s_record;
+
+static struct{
+    bool        active;
+    uint64_t    start_tick;
+    size_t      next;
+    vec_cmd_t   cmds;
+    vec_uid_t   uids;
+}s_play;
+
+/* Set while playback is re-issuing a logged command */
+static bool s_replaying;
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static uint64_t curr_tick(uint64_t start)
+{
+    return G_Timer_SimTick() - start;
+}
+
+static bool cmd_write(SDL_RWops *stream, const struct cmd *cmd, const uint32_t *uids)
+{
+    bool ret = SDL_WriteLE64(stream, cmd->tick)
+            && SDL_WriteU8(stream, cmd->type)
+            && SDL_WriteU8(stream, cmd->attack)
+            && SDL_WriteLE32(stream, cmd->uid)
+            && SDL_WriteLE32(stream, cmd->uids_count);
+    if(!ret)
+        return false;
+
+    float coords[3] = {cmd->pos.x, cmd->pos.y, cmd->pos.z};
+    for(int i = 0; i < 3; i++) {
+        uint32_t bits;
+        memcpy(&bits, &coords[i], sizeof(bits));
+        if(!SDL_WriteLE32(stream, bits))
+            return false;
+    }
+
+    for(int i = 0; i < cmd->uids_count; i++) {
+        if(!SDL_WriteLE32(stream, uids[i]))
+            return false;
+    }
+    return true;
+}
+
+static bool cmd_read(SDL_RWops *stream, struct cmd *out, vec_uid_t *uids)
+{
+    uint8_t bytes[2];
+    if(1 != SDL_RWread(stream, &out->tick, sizeof(out->tick), 1))
+        return false;
+    if(1 != SDL_RWread(stream, bytes, sizeof(bytes), 1))
+        return false;
+
+    out->tick = SDL_SwapLE64(out->tick);
+    out->type = bytes[0];
+    out->attack = bytes[1];
+
+    uint32_t words[5];
+    if(1 != SDL_RWread(stream, words, sizeof(words), 1))
+        return false;
+
+    for(int i = 0; i < 5; i++)
+        words[i] = SDL_SwapLE32(words[i]);
+
+    out->uid = words[0];
+    out->uids_count = words[1];
+    memcpy(&out->pos.x, &words[2], sizeof(float));
+    memcpy(&out->pos.y, &words[3], sizeof(float));
+    memcpy(&out->pos.z, &words[4], sizeof(float));
+
+    if(out->type >= CMD_MAX)
+        return false;
+    if(out->type != CMD_SEL_SET && out->uids_count > 0)
+        return false;
+
+    out->uids_begin = vec_size(uids);
+    for(int i = 0; i < out->uids_count; i++) {
+        uint32_t uid;
+        if(1 != SDL_RWread(stream, &uid, sizeof(uid), 1))
+            return false;
+        if(!vec_uid_push(uids, SDL_SwapLE32(uid)))
+            return false;
+    }
+    return true;
+}
+
+/* Returns true if the command should be carried out */
+static bool cmd_issue(struct cmd cmd, const uint32_t *uids)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    /* The recording is the only source of commands during playback */
+    if(s_play.active && !s_replaying)
+        return false;
+
+    if(s_record.active) {
+
+        cmd.tick = curr_tick(s_record.start_tick);
+        if(!cmd_write(s_record.log, &cmd, uids)) {
+            fprintf(stderr, "Failed to record command. Ending the recording.\n");
+            fflush(stderr);
+            G_Cmd_ClearState();
+        }
+    }
+    return true;
+}
+
+static struct entity *cmd_entity(const struct cmd *cmd)
+{
+    struct entity *ret = G_EntityForUID(cmd->uid);
+    if(!ret || (ret->flags & ENTITY_FLAG_ZOMBIE))
+        return NULL;
+    return ret;
+}
+
+static void cmd_apply(const struct cmd *cmd)
+{
+    struct entity *ent = NULL;
+
+    switch(cmd->type) {
+    case CMD_SEL_CLEAR:
+        G_Cmd_ClearSelection();
+        break;
+    case CMD_SEL_ADD:
+        if((ent = cmd_entity(cmd)) && (ent->flags & ENTITY_FLAG_SELECTABLE))
+            G_Cmd_Select(ent);
+        break;
+    case CMD_SEL_REMOVE:
+        if((ent = cmd_entity(cmd)) && (ent->flags & ENTITY_FLAG_SELECTABLE))
+            G_Cmd_Deselect(ent);
+        break;
+    case CMD_SEL_SET: {
+
+        vec_pentity_t ents;
+        vec_pentity_init(&ents);
+
+        for(int i = 0; i < cmd->uids_count; i++) {
+            struct entity *curr = G_EntityForUID(vec_AT(&s_play.uids, cmd->uids_begin + i));
+            if(curr && (curr->flags & ENTITY_FLAG_SELECTABLE))
+                vec_pentity_push(&ents, curr);
+        }
+        if(vec_size(&ents) > 0)
+            G_Cmd_SetSelection(&ents);
+
+        vec_pentity_destroy(&ents);
+        break;
+    }
+    case CMD_ORDER_SELECTION:
+        G_Cmd_OrderSelection(cmd->pos, cmd->attack);
+        break;
+    case CMD_MOVE:
+        if((ent = cmd_entity(cmd)))
+            G_Cmd_Move(ent, (vec2_t){cmd->pos.x, cmd->pos.z});
+        break;
+    case CMD_STOP:
+        if((ent = cmd_entity(cmd)))
+            G_Cmd_Stop(ent);
+        break;
+    case CMD_ATTACK:
+        if((ent = cmd_entity(cmd)) && (ent->flags & ENTITY_FLAG_COMBATABLE))
+            G_Cmd_Attack(ent, (vec2_t){cmd->pos.x, cmd->pos.z});
+        break;
+    case CMD_HOLD_POSITION:
+        if((ent = cmd_entity(cmd)) && (ent->flags & ENTITY_FLAG_COMBATABLE))
+            G_Cmd_HoldPosition(ent);
+        break;
+    default: 
+        break;
+    }
+}
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+bool G_Cmd_Init(void)
+{
+    vec_cmd_init(&s_play.cmds);
+    vec_uid_init(&s_play.uids);
+    return true;
+}
+
+void G_Cmd_Shutdown(void)
+{
+    G_Cmd_ClearState();
+    vec_cmd_destroy(&s_play.cmds);
+    vec_uid_destroy(&s_play.uids);
+}
+
+void G_Cmd_ClearState(void)
+{
+    if(s_record.log)
+        SDL_RWclose(s_record.log);
+    s_record.log = NULL;
+    s_record.active = false;
+
+    G_Cmd_EndPlayback();
+}
+
+void G_Cmd_OnSimTick(uint64_t tick)
+{
+    if(!s_play.active)
+        return;
+
+    uint64_t rel_tick = tick - s_play.start_tick;
+    s_replaying = true;
+
+    while(s_play.active && s_play.next < vec_size(&s_play.cmds)) {
+
+        const struct cmd *cmd = &vec_AT(&s_play.cmds, s_play.next);
+        if(cmd->tick > rel_tick)
+            break;
+        s_play.next++;
+
+        if(cmd->type == CMD_END) {
+            G_Cmd_EndPlayback();
+            break;
+        }
+        cmd_apply(cmd);
+    }
+
+    s_replaying = false;
+}
+
+void G_Cmd_SetSelection(const vec_pentity_t *ents)
+{
+    uint32_t uids[vec_size(ents) + 1];
+    for(int i = 0; i < vec_size(ents); i++)
+        uids[i] = vec_AT(ents, i)->uid;
+
+    struct cmd cmd = (struct cmd){
+        .type = CMD_SEL_SET, 
+        .uids_count = vec_size(ents)
+    };
+    if(cmd_issue(cmd, uids))
+        G_Sel_Set(ents);
+}
+
+void G_Cmd_OrderSelection(vec3_t target, bool attack)
+{
+    struct cmd cmd = (struct cmd){
+        .type = CMD_ORDER_SELECTION, 
+        .pos = target, 
+        .attack = attack
+    };
+    if(cmd_issue(cmd, NULL))
+        G_Move_OrderSelection(target, attack);
+}
+
+void G_Cmd_ClearSelection(void)
+{
+    struct cmd cmd = (struct cmd){ .type = CMD_SEL_CLEAR };
+    if(cmd_issue(cmd, NULL))
+        G_Sel_Clear();
+}
+
+void G_Cmd_Select(struct entity *ent)
+{
+    struct cmd cmd = (struct cmd){ .type = CMD_SEL_ADD, .uid = ent->uid };
+    if(cmd_issue(cmd, NULL))
+        G_Sel_Add(ent);
+}
+
+void G_Cmd_Deselect(struct entity *ent)
+{
+    struct cmd cmd = (struct cmd){ .type = CMD_SEL_REMOVE, .uid = ent->uid };
+    if(cmd_issue(cmd, NULL))
+        G_Sel_Remove(ent);
+}
+
+void G_Cmd_Move(const struct entity *ent, vec2_t dest_xz)
+{
+    struct cmd cmd = (struct cmd){ 
+        .type = CMD_MOVE, 
+        .uid = ent->uid, 
+        .pos = (vec3_t){dest_xz.x, 0.0f, dest_xz.z}
+    };
+    if(cmd_issue(cmd, NULL))
+        G_Move_SetDest(ent, dest_xz);
+}
+
+void G_Cmd_Stop(const struct entity *ent)
+{
+    struct cmd cmd = (struct cmd){ .type = CMD_STOP, .uid = ent->uid };
+    if(cmd_issue(cmd, NULL))
+        G_StopEntity(ent);
+}
+
+void G_Cmd_Attack(const struct entity *ent, vec2_t dest_xz)
+{
+    assert(ent->flags & ENTITY_FLAG_COMBATABLE);
+    struct cmd cmd = (struct cmd){ 
+        .type = CMD_ATTACK, 
+        .uid = ent->uid, 
+        .pos = (vec3_t){dest_xz.x, 0.0f, dest_xz.z}
+    };
+    if(!cmd_issue(cmd, NULL))
+        return;
+
+    G_Combat_SetStance(ent, COMBAT_STANCE_AGGRESSIVE);
+    if(!(ent->flags & ENTITY_FLAG_STATIC))
+        G_Move_SetDest(ent, dest_xz);
+}
+
+void G_Cmd_HoldPosition(const struct entity *ent)
+{
+    assert(ent->flags & ENTITY_FLAG_COMBATABLE);
+    struct cmd cmd = (struct cmd){ .type = CMD_HOLD_POSITION, .uid = ent->uid };
+    if(!cmd_issue(cmd, NULL))
+        return;
+
+    if(!(ent->flags & ENTITY_FLAG_STATIC))
+        G_StopEntity(ent);
+    G_Combat_SetStance(ent, COMBAT_STANCE_HOLD_POSITION);
+}
+
+bool G_Cmd_BeginRecording(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    if(s_play.active)
+        return false;
+
+    if(s_record.log)
+        SDL_RWclose(s_record.log);
+
+    s_record.log = PFSDL_VectorRWOps();
+    if(!s_record.log) {
+        s_record.active = false;
+        return false;
+    }
+
+    s_record.start_tick = G_Timer_SimTick();
+    s_record.active = true;
+    return true;
+}
+
+bool G_Cmd_EndRecording(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    if(!s_record.active)
+        return false;
+
+    struct cmd end = (struct cmd){
+        .type = CMD_END,
+        .tick = curr_tick(s_record.start_tick)
+    };
+    bool ret = cmd_write(s_record.log, &end, NULL)
+            && SDL_WriteLE32(stream, CMD_LOG_MAGIC)
+            && SDL_WriteLE32(stream, CMD_LOG_VERSION);
+
+    size_t size = SDL_RWsize(s_record.log);
+    if(ret && size) {
+        ret = SDL_RWwrite(stream, PFSDL_VectorRWOpsRaw(s_record.log), size, 1);
+    }
+
+    SDL_RWclose(s_record.log);
+    s_record.log = NULL;
+    s_record.active = false;
+    return ret;
+}
+
+bool G_Cmd_Recording(void)
+{
+    return s_record.active;
+}
+
+bool G_Cmd_BeginPlayback(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    if(s_record.active)
+        return false;
+
+    G_Cmd_EndPlayback();
+
+    if(SDL_ReadLE32(stream) != CMD_LOG_MAGIC)
+        return false;
+    if(SDL_ReadLE32(stream) != CMD_LOG_VERSION)
+        return false;
+
+    struct cmd cmd;
+    do{
+        if(!cmd_read(stream, &cmd, &s_play.uids))
+            goto fail;
+        if(!vec_cmd_push(&s_play.cmds, cmd))
+            goto fail;
+    }while(cmd.type != CMD_END);
+
+    s_play.start_tick = G_Timer_SimTick();
+    s_play.next = 0;
+    s_play.active = true;
+    return true;
+
+fail:
+    vec_cmd_reset(&s_play.cmds);
+    vec_uid_reset(&s_play.uids);
+    return false;
+}
+
+void G_Cmd_EndPlayback(void)
+{
+    s_play.active = false;
+    s_play.next = 0;
+    vec_cmd_reset(&s_play.cmds);
+    vec_uid_reset(&s_play.uids);
+}
+
+bool G_Cmd_Playing(void)
+{
+    return s_play.active;
+}
+
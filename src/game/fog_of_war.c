@@ -48,6 +48,7 @@
 #include "../map/public/tile.h"
 
 #include <stdint.h>
+#include <stddef.h>
 #include <assert.h>
 #include <SDL.h>
 
@@ -56,7 +57,10 @@
 #define MAX(a, b)               ((a) > (b) ? (a) : (b))
 #define CLAMP(a, min, max)      (MIN(MAX((a), (min)), (max)))
 #define ARR_SIZE(a)             (sizeof(a)/sizeof(a[0]))
-#define FAC_STATE(val, fac_id)  (((val) >> ((fac_id) * 2)) & 0x3)
+#define WORD_BITS               (64)
+#define REGION_DIM              (8)
+#define MAX_COVER_SPANS         (32)
+#define MAX_COVER_REGIONS       (16)
 
 #define CHK_TRUE_RET(_pred)             \
     do{                                 \
@@ -73,41 +77,142 @@ enum fog_state{
 PQUEUE_TYPE(td, struct tile_desc)
 PQUEUE_IMPL(static, td, struct tile_desc)
 
+/* A run of tiles with consecutive indices */
+struct tile_span{
+    uint32_t first;
+    uint32_t count;
+};
+
+/* The tiles under an object's bounds and the fog state of those tiles as
+ * last seen by a particular set of factions. The tiles of a chunk row are 
+ * adjacent in the bit planes, so even large objects take only a few spans. */
+struct obj_cover{
+    struct obb obb;
+    /* -1 until the tiles have been found for the first time */
+    int        nspans;
+    /* The object spans too many regions to be cached. Kept around so that 
+     * the tiles aren't searched for again until the object changes. */
+    bool       too_large;
+    struct tile_span spans[MAX_COVER_SPANS];
+    int        nregions;
+    uint32_t   regions[MAX_COVER_REGIONS];
+    uint16_t   fac_mask;
+    uint32_t   epoch;
+    bool       visible;
+    bool       explored;
+};
+
 KHASH_SET_INIT_INT(uid)
+KHASH_MAP_INIT_INT(cover, struct obj_cover)
 
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
 /*****************************************************************************/
 
 static const struct map *s_map;
-/* Holds a 32-bit value for every tile of the map. The chunks are stored in row-major
- * order. Within a chunk, the tiles are in row-major order. Each 32-bit value encodes
- * a 2-bit faction state for up to 16 factions. */
-static uint32_t         *s_fog_state;
+/* Per-faction bit planes holding a bit for every tile of the map. The chunks are 
+ * stored in row-major order. Within a chunk, the tiles are in row-major order. A 
+ * set 'visible' bit means that the faction currently sees the tile. A set 'explored' 
+ * bit means that the faction has seen the tile at some point. Visible tiles are 
+ * always explored. */
+static size_t            s_nwords;
+static uint64_t         *s_planes;
+static uint64_t         *s_visible[MAX_FACTIONS];
+static uint64_t         *s_explored[MAX_FACTIONS];
+/* Scratch planes for merging the state of all the player-controlled factions */
+static uint64_t         *s_merged_visible;
+static uint64_t         *s_merged_explored;
+/* Maps 8 bits to 8 bytes, each holding 0 or 1 */
+static uint64_t          s_bits_to_bytes[256];
 /* How many units of a faction currently 'see' every tile. */
 static uint8_t          *s_vision_refcnts[MAX_FACTIONS];
 /* Cache all the entities that have been explored by the player, for faster queries */
 static khash_t(uid)     *s_explored_cache;
+/* The tiles are grouped into REGION_DIM x REGION_DIM regions. Each region holds the
+ * epoch during which the visibility of any of its tiles last changed. The epoch is
+ * advanced once per frame. */
+static uint32_t          s_fog_epoch = 1;
+static uint32_t         *s_region_epochs;
+/* Cached tile coverage and fog state of the objects queried by the renderer */
+static khash_t(cover)   *s_obj_covers;
 
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
 /*****************************************************************************/
 
-static bool fog_any_matches(uint32_t val, enum fog_state state)
+static bool fog_bit_test(const uint64_t *plane, int idx)
 {
-    for(;val; val >>= 2) {
-        if((val & 0x3) == state)
+    return (plane[idx / WORD_BITS] >> (idx % WORD_BITS)) & 0x1;
+}
+
+static bool fog_span_test(const uint64_t *plane, struct tile_span span)
+{
+    uint32_t curr = span.first;
+    uint32_t end = span.first + span.count;
+
+    while(curr < end) {
+
+        uint32_t bit = curr % WORD_BITS;
+        uint32_t nbits = MIN(WORD_BITS - bit, end - curr);
+        uint64_t mask = (nbits == WORD_BITS) ? ~((uint64_t)0) 
+                                             : (((uint64_t)1 << nbits) - 1) << bit;
+        if(plane[curr / WORD_BITS] & mask)
             return true;
+        curr += nbits;
     }
     return false;
 }
 
-static void fog_set_state(uint32_t *inout_tileval, int faction_id, enum fog_state state)
+static int compare_idx(const void *a, const void *b)
 {
-    assert(state >= 0 && state < 4);
-    uint32_t val = *inout_tileval & ~(0x3 << faction_id * 2);
-    val |= (state << (faction_id * 2));
-    *inout_tileval = val;
+    uint32_t ia = *(const uint32_t*)a, ib = *(const uint32_t*)b;
+    return (ia > ib) - (ia < ib);
+}
+
+static void fog_bit_set(uint64_t *plane, int idx)
+{
+    plane[idx / WORD_BITS] |= ((uint64_t)1 << (idx % WORD_BITS));
+}
+
+static void fog_bit_clear(uint64_t *plane, int idx)
+{
+    plane[idx / WORD_BITS] &= ~((uint64_t)1 << (idx % WORD_BITS));
+}
+
+static enum fog_state fog_state_at(int faction_id, int idx)
+{
+    if(fog_bit_test(s_visible[faction_id], idx))
+        return STATE_VISIBLE;
+    if(fog_bit_test(s_explored[faction_id], idx))
+        return STATE_IN_FOG;
+    return STATE_UNEXPLORED;
+}
+
+static uint32_t fog_region(int idx)
+{
+    struct map_resolution res;
+    M_GetResolution(s_map, &res);
+
+    const int tiles_per_chunk = res.tile_w * res.tile_h;
+    const int regions_per_row = (res.tile_w + REGION_DIM - 1) / REGION_DIM;
+    const int regions_per_col = (res.tile_h + REGION_DIM - 1) / REGION_DIM;
+
+    int chunk = idx / tiles_per_chunk;
+    int tile_r = (idx % tiles_per_chunk) / res.tile_w;
+    int tile_c = (idx % tiles_per_chunk) % res.tile_w;
+
+    return chunk * (regions_per_row * regions_per_col) 
+         + (tile_r / REGION_DIM) * regions_per_row + (tile_c / REGION_DIM);
+}
+
+static size_t fog_num_regions(void)
+{
+    struct map_resolution res;
+    M_GetResolution(s_map, &res);
+
+    const int regions_per_row = (res.tile_w + REGION_DIM - 1) / REGION_DIM;
+    const int regions_per_col = (res.tile_h + REGION_DIM - 1) / REGION_DIM;
+    return res.chunk_w * res.chunk_h * regions_per_row * regions_per_col;
 }
 
 static int td_index(struct tile_desc td)
@@ -122,16 +227,22 @@ static int td_index(struct tile_desc td)
 
 static void update_tile(int faction_id, struct tile_desc td, int delta)
 {
-    uint8_t old = s_vision_refcnts[faction_id][td_index(td)];
+    int idx = td_index(td);
+    uint8_t old = s_vision_refcnts[faction_id][idx];
     uint8_t new = old + delta;
 
+    if(!!old != !!new || !fog_bit_test(s_explored[faction_id], idx)) {
+        s_region_epochs[fog_region(idx)] = s_fog_epoch;
+    }
+
     if(new) {
-        fog_set_state(s_fog_state + td_index(td), faction_id, STATE_VISIBLE);
+        fog_bit_set(s_visible[faction_id], idx);
     }else{
-        fog_set_state(s_fog_state + td_index(td), faction_id, STATE_IN_FOG);
+        fog_bit_clear(s_visible[faction_id], idx);
     }
+    fog_bit_set(s_explored[faction_id], idx);
 
-    s_vision_refcnts[faction_id][td_index(td)] = new;
+    s_vision_refcnts[faction_id][idx] = new;
 }
 
 static size_t neighbours(struct tile_desc curr, struct tile_desc *out)
@@ -346,16 +457,17 @@ static void fog_update_visible(int faction_id, vec2_t xz_pos, float radius, int
     pq_td_destroy(&frontier);
 }
 
-static bool fog_obj_matches(uint16_t fac_mask, const struct obb *obj, enum fog_state *states, size_t nstates)
+static bool fog_obj_matches(uint16_t fac_mask, const struct obb *obj, uint64_t *const planes[])
 {
     vec3_t pos = M_GetPos(s_map);
     struct map_resolution res;
     M_GetResolution(s_map, &res);
 
-    uint32_t facstate_mask = 0;
+    int nfacs = 0;
+    const uint64_t *fac_planes[MAX_FACTIONS];
     for(int i = 0; fac_mask; fac_mask >>= 1, i++) {
         if(fac_mask & 0x1) {
-            facstate_mask |= (0x3 << (i * 2));
+            fac_planes[nfacs++] = planes[i];
         }
     }
 
@@ -365,16 +477,138 @@ static bool fog_obj_matches(uint16_t fac_mask, const struct obb *obj, enum fog_s
     for(int i = 0; i < ntiles; i++) {
 
         int idx = td_index(tds[i]);
-        uint32_t fac_state = s_fog_state[idx] & facstate_mask;
-
-        for(int j = 0; j < nstates; j++) {
-            if(fog_any_matches(fac_state, states[j]))
+        for(int j = 0; j < nfacs; j++) {
+            if(fog_bit_test(fac_planes[j], idx))
                 return true;
         }
     }
     return false;
 }
 
+static bool fog_cover_add_region(struct obj_cover *cover, uint32_t region)
+{
+    for(int i = 0; i < cover->nregions; i++) {
+        if(cover->regions[i] == region)
+            return true;
+    }
+    if(cover->nregions == MAX_COVER_REGIONS)
+        return false;
+    cover->regions[cover->nregions++] = region;
+    return true;
+}
+
+static bool fog_cover_update_tiles(struct obj_cover *cover, const struct obb *obb)
+{
+    vec3_t pos = M_GetPos(s_map);
+    struct map_resolution res;
+    M_GetResolution(s_map, &res);
+
+    struct tile_desc tds[2048];
+    size_t ntiles = M_Tile_AllUnderObj(pos, res, obb, tds, ARR_SIZE(tds));
+
+    uint32_t idxs[ARR_SIZE(tds)];
+    for(int i = 0; i < ntiles; i++) {
+        idxs[i] = td_index(tds[i]);
+    }
+    qsort(idxs, ntiles, sizeof(idxs[0]), compare_idx);
+
+    cover->obb = *obb;
+    cover->nspans = 0;
+    cover->nregions = 0;
+    cover->too_large = true;
+
+    for(int i = 0; i < ntiles; i++) {
+
+        if(!fog_cover_add_region(cover, fog_region(idxs[i])))
+            return false;
+
+        if(cover->nspans > 0) {
+            struct tile_span *last = &cover->spans[cover->nspans - 1];
+            if(idxs[i] == last->first + last->count) {
+                last->count++;
+                continue;
+            }
+            if(idxs[i] < last->first + last->count)
+                continue;
+        }
+
+        if(cover->nspans == MAX_COVER_SPANS)
+            return false;
+        cover->spans[cover->nspans++] = (struct tile_span){idxs[i], 1};
+    }
+
+    /* Force the state to be re-evaluated */
+    cover->too_large = false;
+    cover->epoch = 0;
+    return true;
+}
+
+static bool fog_cover_fresh(const struct obj_cover *cover, uint16_t fac_mask)
+{
+    if(cover->fac_mask != fac_mask)
+        return false;
+
+    /* Changes made during the same epoch as the evaluation may have come 
+     * after it, so only the strictly older ones are safe */
+    for(int i = 0; i < cover->nregions; i++) {
+        if(s_region_epochs[cover->regions[i]] >= cover->epoch)
+            return false;
+    }
+    return true;
+}
+
+static void fog_cover_eval(struct obj_cover *cover, uint16_t fac_mask)
+{
+    int nfacs = 0;
+    int facs[MAX_FACTIONS];
+    for(int i = 0, mask = fac_mask; mask; mask >>= 1, i++) {
+        if(mask & 0x1)
+            facs[nfacs++] = i;
+    }
+
+    cover->fac_mask = fac_mask;
+    cover->epoch = s_fog_epoch;
+    cover->visible = false;
+    cover->explored = false;
+
+    for(int i = 0; i < cover->nspans; i++) {
+        for(int j = 0; j < nfacs; j++) {
+            cover->visible |= fog_span_test(s_visible[facs[j]], cover->spans[i]);
+            cover->explored |= fog_span_test(s_explored[facs[j]], cover->spans[i]);
+        }
+        if(cover->visible && cover->explored)
+            break;
+    }
+}
+
+/* Returns NULL for objects that span too many regions to be cached */
+static const struct obj_cover *fog_obj_cover(uint16_t fac_mask, uint32_t uid, const struct obb *obb)
+{
+    khiter_t k = kh_get(cover, s_obj_covers, uid);
+    if(k == kh_end(s_obj_covers)) {
+
+        int status;
+        k = kh_put(cover, s_obj_covers, uid, &status);
+        if(status == -1)
+            return NULL;
+        kh_val(s_obj_covers, k).nspans = -1;
+    }
+
+    /* The tiles need to be found again only when the object has been moved, 
+     * rotated or scaled. The corners are derived from the rest of the fields. */
+    struct obj_cover *cover = &kh_val(s_obj_covers, k);
+    if(cover->nspans < 0 || memcmp(&cover->obb, obb, offsetof(struct obb, corners))) {
+        fog_cover_update_tiles(cover, obb);
+    }
+
+    if(cover->too_large)
+        return NULL;
+
+    if(!fog_cover_fresh(cover, fac_mask))
+        fog_cover_eval(cover, fac_mask);
+    return cover;
+}
+
 static void on_render_3d(void *user, void *event)
 {
     const struct camera *cam = G_GetActiveCamera();
@@ -402,12 +636,30 @@ bool G_Fog_Init(const struct map *map)
     M_GetResolution(map, &res);
     const size_t ntiles = res.chunk_w * res.chunk_h * res.tile_w * res.tile_h;
 
-    s_fog_state = calloc(sizeof(s_fog_state[0]), ntiles);
-    if(!s_fog_state)
+    /* A visible and explored plane for every faction, plus the two merged ones */
+    s_nwords = (ntiles + WORD_BITS - 1) / WORD_BITS;
+    s_planes = calloc(sizeof(s_planes[0]), s_nwords * (2 * MAX_FACTIONS + 2));
+    if(!s_planes)
         goto fail;
 
     for(int i = 0; i < MAX_FACTIONS; i++) {
-        s_vision_refcnts[i] = calloc(sizeof(s_vision_refcnts[0]), ntiles);
+        s_visible[i] = s_planes + (2 * i + 0) * s_nwords;
+        s_explored[i] = s_planes + (2 * i + 1) * s_nwords;
+    }
+    s_merged_visible = s_planes + (2 * MAX_FACTIONS + 0) * s_nwords;
+    s_merged_explored = s_planes + (2 * MAX_FACTIONS + 1) * s_nwords;
+
+    for(int i = 0; i < ARR_SIZE(s_bits_to_bytes); i++) {
+        uint64_t bytes = 0;
+        for(int j = 0; j < 8; j++) {
+            if(i & (1 << j))
+                bytes |= ((uint64_t)1 << (j * 8));
+        }
+        s_bits_to_bytes[i] = bytes;
+    }
+
+    for(int i = 0; i < MAX_FACTIONS; i++) {
+        s_vision_refcnts[i] = calloc(sizeof(s_vision_refcnts[0][0]), ntiles);
         if(!s_vision_refcnts[i])
             goto fail;
     }
@@ -416,13 +668,24 @@ bool G_Fog_Init(const struct map *map)
     if(!s_explored_cache)
         goto fail;
 
+    s_obj_covers = kh_init(cover);
+    if(!s_obj_covers)
+        goto fail;
+
     s_map = map;
+    s_region_epochs = calloc(sizeof(s_region_epochs[0]), fog_num_regions());
+    if(!s_region_epochs)
+        goto fail;
+    s_fog_epoch = 1;
+
     E_Global_Register(EVENT_RENDER_3D, on_render_3d, NULL, G_RUNNING | G_PAUSED_UI_RUNNING | G_PAUSED_FULL);
     return true;
 
 fail:
+    s_map = NULL;
+    kh_destroy(cover, s_obj_covers);
     kh_destroy(uid, s_explored_cache);
-    free(s_fog_state);
+    free(s_planes);
     for(int i = 0; i < MAX_FACTIONS; i++) {
         free(s_vision_refcnts[i]);
     }
@@ -432,9 +695,14 @@ fail:
 void G_Fog_Shutdown(void)
 {
     E_Global_Unregister(EVENT_RENDER_3D, on_render_3d);
+    kh_destroy(cover, s_obj_covers);
     kh_destroy(uid, s_explored_cache);
-    free(s_fog_state);
-    s_fog_state = NULL;
+    free(s_region_epochs);
+    s_region_epochs = NULL;
+    free(s_planes);
+    s_planes = NULL;
+    memset(s_visible, 0, sizeof(s_visible));
+    memset(s_explored, 0, sizeof(s_explored));
     for(int i = 0; i < MAX_FACTIONS; i++) {
         free(s_vision_refcnts[i]);
     }
@@ -467,7 +735,7 @@ bool G_Fog_Visible(int faction_id, vec2_t xz_pos)
     if(!M_Tile_DescForPoint2D(res, M_GetPos(s_map), xz_pos, &td))
         return false;
 
-    return (FAC_STATE(s_fog_state[td_index(td)], faction_id) == STATE_VISIBLE);
+    return fog_bit_test(s_visible[faction_id], td_index(td));
 }
 
 bool G_Fog_Explored(int faction_id, vec2_t xz_pos)
@@ -479,7 +747,7 @@ bool G_Fog_Explored(int faction_id, vec2_t xz_pos)
     if(!M_Tile_DescForPoint2D(res, M_GetPos(s_map), xz_pos, &td))
         return false;
 
-    return (FAC_STATE(s_fog_state[td_index(td)], faction_id) == STATE_UNEXPLORED);
+    return fog_bit_test(s_explored[faction_id], td_index(td));
 }
 
 void G_Fog_RenderChunkVisibility(int faction_id, int chunk_r, int chunk_c, mat4x4_t *model)
@@ -510,7 +778,7 @@ void G_Fog_RenderChunkVisibility(int faction_id, int chunk_r, int chunk_c, mat4x
         *corners_base++ = (vec2_t){square_x - square_x_len, square_z};
 
         struct tile_desc curr = (struct tile_desc){chunk_r, chunk_c, r, c};
-        enum fog_state state = FAC_STATE(s_fog_state[td_index(curr)], faction_id);
+        enum fog_state state = fog_state_at(faction_id, td_index(curr));
         *colors_base++ = state == STATE_UNEXPLORED ? (vec3_t){0.0f, 0.0f, 0.0f}
                        : state == STATE_IN_FOG     ? (vec3_t){1.0f, 1.0f, 0.0f}
                        : state == STATE_VISIBLE    ? (vec3_t){0.0f, 1.0f, 0.0f}
@@ -536,20 +804,23 @@ void G_Fog_RenderChunkVisibility(int faction_id, int chunk_r, int chunk_c, mat4x
 
 void G_Fog_UpdateVisionState(void)
 {
+    s_fog_epoch++;
+
     bool controllable[MAX_FACTIONS];
     uint16_t facs = G_GetFactions(NULL, NULL, controllable);
 
-    uint32_t player_mask = 0;
+    int nplayers = 0;
+    int players[MAX_FACTIONS];
     for(int i = 0; facs; facs >>= 1, i++) {
         if((facs & 0x1) && controllable[i])
-            player_mask |= (0x3 << (i * 2));
+            players[nplayers++] = i;
     }
 
     struct map_resolution res;
     M_GetResolution(s_map, &res);
 
     size_t size = res.chunk_h * res.tile_h * res.chunk_w * res.tile_w;
-    unsigned char *visbuff = stalloc(&G_GetSimWS()->args, size);
+    unsigned char *visbuff = R_AllocArg(size);
 
     struct sval fog_setting;
     ss_e status = Settings_Get("pf.game.fog_of_war_enabled", &fog_setting);
@@ -560,24 +831,43 @@ void G_Fog_UpdateVisionState(void)
         goto submit;
     }
 
-    for(int cr = 0; cr < res.chunk_h; cr++) {
-    for(int cc = 0; cc < res.chunk_w; cc++) {
+    /* Merge the planes of all the player factions one at a time, so that 
+     * the inner loops are plain ORs over contiguous words. */
+    memset(s_merged_visible, 0, s_nwords * sizeof(uint64_t));
+    memset(s_merged_explored, 0, s_nwords * sizeof(uint64_t));
 
-        for(int tr = 0; tr < res.tile_h; tr++) {
-        for(int tc = 0; tc < res.tile_w; tc++) {
+    for(int i = 0; i < nplayers; i++) {
 
-            struct tile_desc td = (struct tile_desc){cr, cc, tr, tc};
-            int idx = td_index(td);
-            uint32_t player_state = s_fog_state[idx] & player_mask;
+        const uint64_t *visible = s_visible[players[i]];
+        const uint64_t *explored = s_explored[players[i]];
 
-            if(!player_state)
-                visbuff[idx] = STATE_UNEXPLORED;
-            else if(fog_any_matches(player_state, STATE_VISIBLE))
-                visbuff[idx] = STATE_VISIBLE;
-            else
-                visbuff[idx] = STATE_IN_FOG;
-        }}
-    }}
+        for(size_t w = 0; w < s_nwords; w++) {
+            s_merged_visible[w] |= visible[w];
+            s_merged_explored[w] |= explored[w];
+        }
+    }
+
+    /* Expand the bits to one byte per tile, 8 tiles at a time. Every explored 
+     * tile gets STATE_IN_FOG (1) and every visible one (which is always also 
+     * explored) gets another 1 on top of that, making it STATE_VISIBLE (2). 
+     */
+    for(size_t w = 0; w < s_nwords; w++) {
+
+        uint64_t visible = s_merged_visible[w];
+        uint64_t explored = s_merged_explored[w];
+        unsigned char bytes[WORD_BITS];
+
+        for(int i = 0; i < WORD_BITS / 8; i++) {
+
+            uint64_t val = s_bits_to_bytes[(explored >> (i * 8)) & 0xff]
+                         + s_bits_to_bytes[(visible >> (i * 8)) & 0xff];
+            val = SDL_SwapLE64(val);
+            memcpy(bytes + i * 8, &val, sizeof(val));
+        }
+
+        size_t base = w * WORD_BITS;
+        memcpy(visbuff + base, bytes, MIN(WORD_BITS, size - base));
+    }
 
 submit:
     R_PushCmd((struct rcmd){
@@ -602,8 +892,8 @@ bool G_Fog_ObjExplored(uint16_t fac_mask, uint32_t uid, const struct obb *obb)
     if(k != kh_end(s_explored_cache))
         return true;
 
-    enum fog_state states[] = {STATE_IN_FOG, STATE_VISIBLE};
-    bool result = fog_obj_matches(fac_mask, obb, states, ARR_SIZE(states));
+    const struct obj_cover *cover = fog_obj_cover(fac_mask, uid, obb);
+    bool result = cover ? cover->explored : fog_obj_matches(fac_mask, obb, s_explored);
 
     if(result) {
         int status;
@@ -613,7 +903,7 @@ bool G_Fog_ObjExplored(uint16_t fac_mask, uint32_t uid, const struct obb *obb)
     return result;
 }
 
-bool G_Fog_ObjVisible(uint16_t fac_mask, const struct obb *obb)
+bool G_Fog_ObjVisible(uint16_t fac_mask, uint32_t uid, const struct obb *obb)
 {
     struct sval fog_setting;
     ss_e status = Settings_Get("pf.game.fog_of_war_enabled", &fog_setting);
@@ -621,8 +911,17 @@ bool G_Fog_ObjVisible(uint16_t fac_mask, const struct obb *obb)
     if(!fog_setting.as_bool)
         return true;
 
-    enum fog_state states[] = {STATE_VISIBLE};
-    return fog_obj_matches(fac_mask, obb, states, ARR_SIZE(states));
+    const struct obj_cover *cover = fog_obj_cover(fac_mask, uid, obb);
+    if(cover)
+        return cover->visible;
+    return fog_obj_matches(fac_mask, obb, s_visible);
+}
+
+void G_Fog_RemoveObj(uint32_t uid)
+{
+    khiter_t k = kh_get(cover, s_obj_covers, uid);
+    if(k != kh_end(s_obj_covers))
+        kh_del(cover, s_obj_covers, k);
 }
 
 void G_Fog_ClearExploredCache(void)
@@ -642,23 +941,24 @@ bool G_Fog_SaveState(struct SDL_RWops *stream)
     };
     CHK_TRUE_RET(Attr_Write(stream, &ntiles_attr, "num_tiles"));
 
-    for(int i = 0; i < ntiles; i++) {
+    /* The tile states are dumped as a raw little-endian array, written out
+     * in blocks, rather than as one record per tile. Each 32-bit value packs 
+     * a 2-bit state for every faction. Visible tiles are saved as being in 
+     * fog, as vision is restored by the entities themselves on load. */
+    uint32_t block[1024];
+    for(int base = 0; base < ntiles; base += ARR_SIZE(block)) {
+
+        size_t nblock = MIN(ARR_SIZE(block), ntiles - base);
+        for(int i = 0; i < nblock; i++) {
 
-        uint32_t fs = s_fog_state[i];
-        for(int j = 0; j < MAX_FACTIONS; j++) {
-            enum fog_state curr = (fs >> (j * 2)) & 0x3;
-            if(curr == STATE_VISIBLE) {
-                curr = STATE_IN_FOG;
+            uint32_t fs = 0;
+            for(int j = 0; j < MAX_FACTIONS; j++) {
+                if(fog_bit_test(s_explored[j], base + i))
+                    fs |= ((uint32_t)STATE_IN_FOG << (j * 2));
             }
-            fs = fs & ~(0x3 << (j * 2));
-            fs = fs | (curr << (j * 2));
+            block[i] = SDL_SwapLE32(fs);
         }
-
-        struct attr tilestate = (struct attr){
-            .type = TYPE_INT,
-            .val.as_int = fs
-        };
-        CHK_TRUE_RET(Attr_Write(stream, &tilestate, "tilestate"));
+        CHK_TRUE_RET(SDL_RWwrite(stream, block, sizeof(block[0]), nblock) == nblock);
     }
 
     return true;
@@ -672,11 +972,34 @@ bool G_Fog_LoadState(struct SDL_RWops *stream)
     CHK_TRUE_RET(attr.type == TYPE_INT);
     const size_t ntiles = attr.val.as_int;
 
-    for(int i = 0; i < ntiles; i++) {
-    
-        CHK_TRUE_RET(Attr_Parse(stream, &attr, true));
-        CHK_TRUE_RET(attr.type == TYPE_INT);
-        s_fog_state[i] = attr.val.as_int;
+    struct map_resolution res;
+    M_GetResolution(s_map, &res);
+    CHK_TRUE_RET(ntiles == res.chunk_w * res.chunk_h * res.tile_w * res.tile_h);
+
+    for(int i = 0; i < MAX_FACTIONS; i++) {
+        memset(s_visible[i], 0, s_nwords * sizeof(uint64_t));
+        memset(s_explored[i], 0, s_nwords * sizeof(uint64_t));
+    }
+    kh_clear(cover, s_obj_covers);
+
+    uint32_t block[1024];
+    for(int base = 0; base < ntiles; base += ARR_SIZE(block)) {
+
+        size_t nblock = MIN(ARR_SIZE(block), ntiles - base);
+        CHK_TRUE_RET(SDL_RWread(stream, block, sizeof(block[0]), nblock) == nblock);
+
+        for(int i = 0; i < nblock; i++) {
+
+            uint32_t fs = SDL_SwapLE32(block[i]);
+            for(int j = 0; j < MAX_FACTIONS; j++) {
+
+                enum fog_state curr = (fs >> (j * 2)) & 0x3;
+                if(curr == STATE_VISIBLE)
+                    fog_bit_set(s_visible[j], base + i);
+                if(curr != STATE_UNEXPLORED)
+                    fog_bit_set(s_explored[j], base + i);
+            }
+        }
     }
 
     return true;
@@ -54,7 +54,8 @@ void G_Fog_UpdateVisionState(void);
 void G_Fog_ClearExploredCache(void);
 
 bool G_Fog_ObjExplored(uint16_t fac_mask, uint32_t uid, const struct obb *obb);
-bool G_Fog_ObjVisible(uint16_t fac_mask, const struct obb *obb);
+bool G_Fog_ObjVisible(uint16_t fac_mask, uint32_t uid, const struct obb *obb);
+void G_Fog_RemoveObj(uint32_t uid);
 
 bool G_Fog_SaveState(struct SDL_RWops *stream);
 bool G_Fog_LoadState(struct SDL_RWops *stream);
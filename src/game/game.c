@@ -43,6 +43,8 @@
 #include "clearpath.h"
 #include "position.h"
 #include "fog_of_war.h"
+#include "command.h"
+#include "bvh.h"
 #include "../render/public/render.h"
 #include "../render/public/render_ctrl.h"
 #include "../anim/public/anim.h"
@@ -60,14 +62,17 @@
 #include "../main.h"
 #include "../ui.h"
 #include "../perf.h"
+#include "../worker.h"
 
 #include <assert.h> 
+#include <stdlib.h>
 
 
 #define CAM_HEIGHT          175.0f
 #define CAM_TILT_UP_DEGREES 25.0f
 #define CAM_SPEED           0.20f
 #define MAX_VIS_RANGE       150.0f
+#define CULL_GRAIN          (512)
 
 #define MIN(a, b)           ((a) < (b) ? (a) : (b))
 #define MAX(a, b)           ((a) > (b) ? (a) : (b))
@@ -81,6 +86,28 @@
             return false;     \
     }while(0)
 
+enum cull_result{
+    CULL_IN_CAM_FRUSTUM   = (1 << 0),
+    CULL_IN_LIGHT_FRUSTUM = (1 << 1),
+};
+
+struct cull_item{
+    struct entity *ent;
+    vec3_t         pos;
+    /* Filled in by the culling pass */
+    struct obb     obb;
+    uint32_t       result;
+};
+
+struct cull_work{
+    struct frustum    cam_frust;
+    struct frustum    light_frust;
+    struct cull_item *items;
+};
+
+VEC_TYPE(cull, struct cull_item)
+VEC_IMPL(static inline, cull, struct cull_item)
+
 VEC_IMPL(extern, obb, struct obb)
 __KHASH_IMPL(entity, extern, khint32_t, struct entity*, 1, kh_int_hash_func, kh_int_hash_equal)
 
@@ -89,6 +116,9 @@ __KHASH_IMPL(entity, extern, khint32_t, struct entity*, 1, kh_int_hash_func, kh_
 /*****************************************************************************/
 
 static struct gamestate s_gs;
+/* Scratch buffers for the per-frame visibility culling */
+static vec_cull_t       s_cull_items;
+static vec_pentity_t    s_static_cands;
 
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
@@ -238,43 +268,14 @@ static void g_draw_pass(struct render_input *in)
     for(int i = 0; i < vec_size(&in->cam_vis_stat); i++) {
     
         struct ent_stat_rstate *curr = &vec_AT(&in->cam_vis_stat, i);
-        R_PushCmd((struct rcmd){
-            .func = R_GL_Draw,
-            .nargs = 2,
-            .args = {
-                curr->render_private,
-                R_PushArg(&curr->model, sizeof(curr->model)),
-            },
-        });
+        R_PushDraw(curr->render_private, &curr->model);
     }
 
     for(int i = 0; i < vec_size(&in->cam_vis_anim); i++) {
     
         struct ent_anim_rstate *curr = &vec_AT(&in->cam_vis_anim, i);
-
-        mat4x4_t model, normal;
-        PFM_Mat4x4_Inverse(&curr->model, &model);
-        PFM_Mat4x4_Transpose(&model, &normal);
-
-        R_PushCmd((struct rcmd){
-            .func = R_GL_SetAnimUniforms,
-            .nargs = 4,
-            .args = {
-                (void*)curr->inv_bind_pose, 
-                R_PushArg(curr->curr_pose, sizeof(curr->curr_pose)),
-                R_PushArg(&normal, sizeof(normal)),
-                R_PushArg(&curr->njoints, sizeof(curr->njoints)),
-            },
-        });
-
-        R_PushCmd((struct rcmd){
-            .func = R_GL_Draw,
-            .nargs = 2,
-            .args = {
-                curr->render_private,
-                R_PushArg(&curr->model, sizeof(curr->model)),
-            },
-        });
+        R_PushAnimDraw(curr->render_private, &curr->model, curr->inv_bind_pose, 
+            curr->curr_pose, curr->njoints);
     }
 #endif
 }
@@ -564,6 +565,70 @@ static uint16_t g_player_mask(void)
     return ret;
 }
 
+/* Index of the first entity with a UID not less than 'uid' */
+static size_t g_ordered_lower_bound(const vec_pentity_t *ents, uint32_t uid)
+{
+    size_t lo = 0, hi = vec_size(ents);
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(vec_AT(ents, mid)->uid < uid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* The iteration order of the entity sets depends on the history of insertions
+ * and removals, which is not reproduced when a session is loaded. Simulation 
+ * ticks iterate over the dynamic entities in UID order so that they give the 
+ * same result for the same state. */
+static void g_dynamic_add(struct entity *ent)
+{
+    int ret;
+    khiter_t k = kh_put(entity, s_gs.dynamic, ent->uid, &ret);
+    assert(ret != -1 && ret != 0);
+    kh_value(s_gs.dynamic, k) = ent;
+
+    vec_pentity_t *ents = &s_gs.dynamic_ordered;
+    size_t idx = g_ordered_lower_bound(ents, ent->uid);
+    if(!vec_pentity_push(ents, ent))
+        return;
+    memmove(ents->array + idx + 1, ents->array + idx, 
+        (vec_size(ents) - idx - 1) * sizeof(struct entity*));
+    vec_AT(ents, idx) = ent;
+}
+
+static void g_dynamic_remove(struct entity *ent)
+{
+    khiter_t k = kh_get(entity, s_gs.dynamic, ent->uid);
+    assert(k != kh_end(s_gs.dynamic));
+    kh_del(entity, s_gs.dynamic, k);
+
+    vec_pentity_t *ents = &s_gs.dynamic_ordered;
+    size_t idx = g_ordered_lower_bound(ents, ent->uid);
+    if(idx == vec_size(ents) || vec_AT(ents, idx) != ent)
+        return;
+    memmove(ents->array + idx, ents->array + idx + 1, 
+        (vec_size(ents) - idx - 1) * sizeof(struct entity*));
+    vec_pentity_pop(ents);
+}
+
+static void g_on_60hz_tick(void *user, void *event)
+{
+    PERF_ENTER();
+
+    /* The animation update of an entity does not depend on any other entity, 
+     * so there is no need to iterate in any particular order. */
+    struct entity *curr;
+    kh_foreach_value(s_gs.active, curr, {
+        if(curr->flags & ENTITY_FLAG_ANIMATED)
+            A_Update(curr);
+    });
+
+    PERF_RETURN_VOID();
+}
+
 static bool g_ent_visible(uint16_t playermask, const struct entity *ent, const struct obb *obb)
 {
     if(!s_gs.map)
@@ -576,7 +641,29 @@ static bool g_ent_visible(uint16_t playermask, const struct entity *ent, const s
         return G_Fog_ObjExplored(playermask, ent->uid, obb);
     }
 
-    return G_Fog_ObjVisible(playermask, obb);
+    return G_Fog_ObjVisible(playermask, ent->uid, obb);
+}
+
+/* Runs on the worker threads. Only the entity fields that are not modified
+ * during 'G_Update' may be read here. */
+static void g_cull_range(size_t begin, size_t end, void *arg)
+{
+    PERF_ENTER();
+    struct cull_work *work = arg;
+
+    for(size_t i = begin; i < end; i++) {
+
+        struct cull_item *item = &work->items[i];
+        Entity_CurrentOBBAt(item->ent, item->pos, &item->obb);
+
+        /* Note that there may be some false positives due to using the fast frustum cull. */
+        item->result = 0;
+        if(!C_FrustumOBBOutsideFast(&work->cam_frust, &item->obb))
+            item->result |= CULL_IN_CAM_FRUSTUM;
+        if(!C_FrustumOBBOutsideFast(&work->light_frust, &item->obb))
+            item->result |= CULL_IN_LIGHT_FRUSTUM;
+    }
+    PERF_RETURN_VOID();
 }
 
 /*****************************************************************************/
@@ -590,7 +677,10 @@ bool G_Init(void)
     vec_pentity_init(&s_gs.visible);
     vec_pentity_init(&s_gs.light_visible);
     vec_obb_init(&s_gs.visible_obbs);
+    vec_cull_init(&s_cull_items);
+    vec_pentity_init(&s_static_cands);
     vec_pentity_init(&s_gs.deleted);
+    vec_pentity_init(&s_gs.dynamic_ordered);
 
     s_gs.active = kh_init(entity);
     if(!s_gs.active)
@@ -600,6 +690,9 @@ bool G_Init(void)
     if(!s_gs.dynamic)
         goto fail_dynamic;
 
+    if(!G_Bvh_Init())
+        goto fail_bvh;
+
     if(!g_init_cameras())
         goto fail_cams; 
 
@@ -615,6 +708,9 @@ bool G_Init(void)
     G_Sel_Init();
     G_Sel_Enable();
     G_Timer_Init();
+    G_Cmd_Init();
+    /* Animations are part of the simulation - they drive the timing of attacks */
+    E_Global_Register(EVENT_60HZ_TICK, g_on_60hz_tick, NULL, G_RUNNING);
     R_PushCmd((struct rcmd){ R_GL_WaterInit, 0 });
 
     ss_e status;
@@ -780,6 +876,8 @@ fail_ws:
     for(int i = 0; i < NUM_CAMERAS; i++)
         Camera_Free(s_gs.cameras[i]);
 fail_cams:
+    G_Bvh_Shutdown();
+fail_bvh:
     kh_destroy(entity, s_gs.dynamic);
 fail_dynamic:
     kh_destroy(entity, s_gs.active);
@@ -822,6 +920,7 @@ bool G_NewGameWithMap(SDL_RWops *stream, bool update_navgrid)
 void G_ClearState(void)
 {
     PERF_ENTER();
+    G_Cmd_ClearState();
     G_Sel_Clear();
 
     uint32_t key;
@@ -838,6 +937,8 @@ void G_ClearState(void)
 
     kh_clear(entity, s_gs.active);
     kh_clear(entity, s_gs.dynamic);
+    vec_pentity_reset(&s_gs.dynamic_ordered);
+    G_Bvh_Clear();
     vec_pentity_reset(&s_gs.visible);
     vec_pentity_reset(&s_gs.light_visible);
     vec_obb_reset(&s_gs.visible_obbs);
@@ -1015,22 +1116,31 @@ void G_Shutdown(void)
 
     G_ClearState();
 
+    /* Commands are queued in the simulation workspace, so this must 
+     * happen before it is destroyed. */
+    R_PushCmd((struct rcmd){ R_GL_WaterShutdown, 0 });
+
     R_DestroyWS(&s_gs.ws[0]);
     R_DestroyWS(&s_gs.ws[1]);
 
-    R_PushCmd((struct rcmd){ R_GL_WaterShutdown, 0 });
+    E_Global_Unregister(EVENT_60HZ_TICK, g_on_60hz_tick);
+    G_Cmd_Shutdown();
     G_Timer_Shutdown();
     G_Sel_Shutdown();
 
     for(int i = 0; i < NUM_CAMERAS; i++)
         Camera_Free(s_gs.cameras[i]);
 
+    G_Bvh_Shutdown();
     kh_destroy(entity, s_gs.active);
     kh_destroy(entity, s_gs.dynamic);
     vec_pentity_destroy(&s_gs.light_visible);
     vec_pentity_destroy(&s_gs.visible);
     vec_obb_destroy(&s_gs.visible_obbs);
+    vec_cull_destroy(&s_cull_items);
+    vec_pentity_destroy(&s_static_cands);
     vec_pentity_destroy(&s_gs.deleted);
+    vec_pentity_destroy(&s_gs.dynamic_ordered);
 }
 
 void G_Update(void)
@@ -1050,44 +1160,73 @@ void G_Update(void)
     vec3_t pos = Camera_GetPos(ACTIVE_CAM);
     vec3_t dir = Camera_GetDir(ACTIVE_CAM);
 
-    struct frustum cam_frust;
-    Camera_MakeFrustum(ACTIVE_CAM, &cam_frust);
+    struct cull_work work;
+    Camera_MakeFrustum(ACTIVE_CAM, &work.cam_frust);
+    R_LightFrustum(s_gs.light_pos, pos, dir, &work.light_frust);
 
-    struct frustum light_frust;
-    R_LightFrustum(s_gs.light_pos, pos, dir, &light_frust);
+    /* The static candidates come from the BVH, followed by all the dynamic entities 
+     * in the iteration order of their set. The positions are looked up here, as the 
+     * position table may only be accessed from the main thread. */
+    const struct frustum frusta[] = {work.cam_frust, work.light_frust};
+    vec_pentity_reset(&s_static_cands);
+    G_Bvh_EntsInFrusta(frusta, ARR_SIZE(frusta), &s_static_cands);
 
-    uint16_t pm = g_player_mask();
+    vec_cull_reset(&s_cull_items);
+    if(!vec_cull_resize(&s_cull_items, vec_size(&s_static_cands) + kh_size(s_gs.dynamic)))
+        PERF_RETURN_VOID();
+
+    for(int i = 0; i < vec_size(&s_static_cands); i++) {
+
+        struct entity *curr = vec_AT(&s_static_cands, i);
+        if(curr->flags & ENTITY_FLAG_INVISIBLE)
+            continue;
+
+        vec_cull_push(&s_cull_items, (struct cull_item){
+            .ent = curr,
+            .pos = G_Pos_Get(curr->uid),
+        });
+    }
 
     uint32_t key;
     struct entity *curr;
     (void)key;
 
-    kh_foreach(s_gs.active, key, curr, {
-
-        if(s_gs.ss == G_RUNNING && curr->flags & ENTITY_FLAG_ANIMATED)
-            A_Update(curr);
+    kh_foreach(s_gs.dynamic, key, curr, {
 
         if(curr->flags & ENTITY_FLAG_INVISIBLE)
             continue;
 
+        vec_cull_push(&s_cull_items, (struct cull_item){
+            .ent = curr,
+            .pos = G_Pos_Get(curr->uid),
+        });
+    });
+
+    work.items = s_cull_items.array;
+    Worker_ParallelFor(vec_size(&s_cull_items), CULL_GRAIN, g_cull_range, &work);
+
+    /* Gather the results serially to keep the output order deterministic. The fog 
+     * of war is only queried for the entities that passed the camera frustum test. */
+    uint16_t pm = g_player_mask();
+
+    for(int i = 0; i < vec_size(&s_cull_items); i++) {
+
+        const struct cull_item *item = &vec_AT(&s_cull_items, i);
         bool vis = false;
-        struct obb obb;
-        Entity_CurrentOBB(curr, &obb);
 
-        /* Note that there may be some false positives due to using the fast frustum cull. */
-        if(C_FrustumOBBIntersectionFast(&cam_frust, &obb) != VOLUME_INTERSEC_OUTSIDE
-        && (vis = g_ent_visible(pm, curr, &obb))) {
+        if((item->result & CULL_IN_CAM_FRUSTUM)
+        && (vis = g_ent_visible(pm, item->ent, &item->obb))) {
 
-            vec_pentity_push(&s_gs.visible, curr);
-            vec_obb_push(&s_gs.visible_obbs, obb);
+            vec_pentity_push(&s_gs.visible, item->ent);
+            vec_obb_push(&s_gs.visible_obbs, item->obb);
         }
 
-        if(C_FrustumOBBIntersectionFast(&light_frust, &obb) != VOLUME_INTERSEC_OUTSIDE 
-        && (vis || (curr->flags & ENTITY_FLAG_STATIC))) {
+        if((item->result & CULL_IN_LIGHT_FRUSTUM)
+        && (vis || (item->ent->flags & ENTITY_FLAG_STATIC))) {
 
-            vec_pentity_push(&s_gs.light_visible, curr);
+            vec_pentity_push(&s_gs.light_visible, item->ent);
         }
-    });
+    }
 
     G_Sel_Update(ACTIVE_CAM, &s_gs.visible, &s_gs.visible_obbs);
 
@@ -1127,6 +1266,7 @@ void G_Render(void)
                 R_PushArg(&reflect_setting.as_bool, sizeof(bool)),
             },
         });
+        R_FlushCmds();
     }
     g_destroy_render_input(&in);
 
@@ -1138,20 +1278,13 @@ void G_Render(void)
         vec2_t curr_pos = G_Pos_GetXZ(curr->uid);
         const float width = 0.4f;
 
-        R_PushCmd((struct rcmd){
-            .func = R_GL_DrawSelectionCircle,
-            .nargs = 5,
-            .args = {
-                R_PushArg(&curr_pos, sizeof(curr_pos)),
-                R_PushArg(&curr->selection_radius, sizeof(curr->selection_radius)),
-                R_PushArg(&width, sizeof(width)),
-                R_PushArg(&g_seltype_color_map[sel_type], sizeof(g_seltype_color_map[0])),
-                (void*)s_gs.prev_tick_map,
-            },
-        });
+        R_PushSelectionCircle(curr_pos, curr->selection_radius, width, 
+            g_seltype_color_map[sel_type], s_gs.prev_tick_map);
     }
 
     E_Global_NotifyImmediate(EVENT_RENDER_3D, NULL, ES_ENGINE);
+    R_FlushCmds();
+
     R_PushCmd((struct rcmd) { R_GL_SetScreenspaceDrawMode, 0 });
     E_Global_NotifyImmediate(EVENT_RENDER_UI, NULL, ES_ENGINE);
 
@@ -1167,6 +1300,7 @@ void G_Render(void)
         M_RenderMinimap(s_gs.map, ACTIVE_CAM);
         R_PushCmd((struct rcmd){ R_GL_MapInvalidate, 0 });
     }
+    R_FlushCmds();
 
     PERF_RETURN_VOID();
 }
@@ -1176,8 +1310,10 @@ void G_RenderMapAndEntities(struct render_input *in)
     PERF_ENTER();
     if(in->shadows) {
         g_shadow_pass(in);
+        R_FlushCmds();
     }
     g_draw_pass(in);
+    R_FlushCmds();
     PERF_RETURN_VOID();
 }
 
@@ -1197,13 +1333,12 @@ bool G_AddEntity(struct entity *ent, vec3_t pos)
         G_Combat_AddEntity(ent, COMBAT_STANCE_AGGRESSIVE);
 
     G_Pos_Set(ent, pos);
-    if(ent->flags & ENTITY_FLAG_STATIC)
+    if(ent->flags & ENTITY_FLAG_STATIC) {
+        G_Bvh_Insert(ent);
         return true;
+    }
 
-    k = kh_put(entity, s_gs.dynamic, ent->uid, &ret);
-    assert(ret != -1 && ret != 0);
-    kh_value(s_gs.dynamic, k) = ent;
-
+    g_dynamic_add(ent);
     G_Move_AddEntity(ent);
     return true;
 }
@@ -1221,14 +1356,16 @@ bool G_RemoveEntity(struct entity *ent)
         G_Sel_Remove(ent);
 
     if(!(ent->flags & ENTITY_FLAG_STATIC)) {
-        k = kh_get(entity, s_gs.dynamic, ent->uid);
-        assert(k != kh_end(s_gs.dynamic));
-        kh_del(entity, s_gs.dynamic, k);
+        g_dynamic_remove(ent);
     }
 
     G_Move_RemoveEntity(ent);
     G_Combat_RemoveEntity(ent);
+    G_Bvh_Remove(ent);
     G_Pos_Delete(ent->uid);
+
+    if(s_gs.map)
+        G_Fog_RemoveObj(ent->uid);
     return true;
 }
 
@@ -1245,29 +1382,32 @@ void G_StopEntity(const struct entity *ent)
 
 void G_SetStatic(struct entity *ent, bool on)
 {
-    khiter_t k;
-    int ret;
+    if(on && !(ent->flags & ENTITY_FLAG_STATIC)) {
 
-    if(on && (ent->flags & ~ENTITY_FLAG_STATIC)) {
-
-        k = kh_get(entity, s_gs.dynamic, ent->uid);
-        assert(k != kh_end(s_gs.dynamic));
-        kh_del(entity, s_gs.dynamic, k);
+        g_dynamic_remove(ent);
 
         G_Move_RemoveEntity(ent);
         ent->flags |= ENTITY_FLAG_STATIC;
+        G_Bvh_Insert(ent);
 
     }else if(!on && (ent->flags & ENTITY_FLAG_STATIC)){
 
-        k = kh_put(entity, s_gs.dynamic, ent->uid, &ret);
-        assert(ret != -1 && ret != 0);
-        kh_value(s_gs.dynamic, k) = ent;
+        G_Bvh_Remove(ent);
+        g_dynamic_add(ent);
 
         G_Move_AddEntity(ent);
         ent->flags &= ~ENTITY_FLAG_STATIC;
     }
 }
 
+void G_UpdateBounds(const struct entity *ent)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    if(ent->flags & ENTITY_FLAG_STATIC)
+        G_Bvh_Update(ent);
+}
+
 void G_SafeFree(struct entity *ent)
 {
     ASSERT_IN_MAIN_THREAD();
@@ -1463,6 +1603,13 @@ const khash_t(entity) *G_GetDynamicEntsSet(void)
     return s_gs.dynamic;
 }
 
+const vec_pentity_t *G_GetDynamicEntsOrdered(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    return &s_gs.dynamic_ordered;
+}
+
 const khash_t(entity) *G_GetAllEntsSet(void)
 {
     ASSERT_IN_MAIN_THREAD();
@@ -1477,23 +1624,9 @@ void G_SetSimState(enum simstate ss)
     if(ss == s_gs.ss)
         return;
 
-    uint32_t curr_tick = SDL_GetTicks();
-    if(ss == G_RUNNING) {
-    
-        uint32_t key;
-        struct entity *curr;
-        (void)key;
-
-        kh_foreach(s_gs.active, key, curr, {
-           
-            if(!(curr->flags & ENTITY_FLAG_ANIMATED))
-                continue;
-            A_AddTimeDelta(curr, curr_tick - s_gs.ss_change_tick);
-        });
-    }
-
+    /* Animations are timed with the simulation clock, which is stopped 
+     * while the game is paused, so there's nothing to compensate here. */
     E_Global_Notify(EVENT_GAME_SIMSTATE_CHANGED, (void*)ss, ES_ENGINE);
-    s_gs.ss_change_tick = curr_tick;
     s_gs.ss = ss;
 }
 
@@ -1524,9 +1657,7 @@ void G_Zombiefy(struct entity *ent)
         G_Sel_Remove(ent);
 
     if(!(ent->flags & ENTITY_FLAG_STATIC)) {
-        khiter_t k = kh_get(entity, s_gs.dynamic, ent->uid);
-        assert(k != kh_end(s_gs.dynamic));
-        kh_del(entity, s_gs.dynamic, k);
+        g_dynamic_remove(ent);
     }
 
     G_Move_RemoveEntity(ent);
@@ -1584,6 +1715,13 @@ void G_SwapBuffers(void)
     s_gs.curr_ws_idx = render_idx;
 }
 
+const struct map *G_GetMap(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    return s_gs.map;
+}
+
 const struct map *G_GetPrevTickMap(void)
 {
     ASSERT_IN_MAIN_THREAD();
@@ -1620,8 +1758,6 @@ bool G_SaveGlobalState(SDL_RWops *stream)
             .val.as_int = G_GetMinimapSize()
         };
         CHK_TRUE_RET(Attr_Write(stream, &minimap_size, "minimap_size"));
-
-        CHK_TRUE_RET(G_Fog_SaveState(stream));
     }
 
     struct attr ss = (struct attr){
@@ -1749,8 +1885,6 @@ bool G_LoadGlobalState(SDL_RWops *stream)
         CHK_TRUE_RET(Attr_Parse(stream, &attr, true));
         CHK_TRUE_RET(attr.type == TYPE_INT);
         G_SetMinimapSize(attr.val.as_int);
-
-        CHK_TRUE_RET(G_Fog_LoadState(stream));
     }else{
         G_ClearState();
         E_Global_Notify(EVENT_NEW_GAME, NULL, ES_ENGINE);
@@ -1847,12 +1981,6 @@ bool G_SaveEntityState(SDL_RWops *stream)
     if(!g_save_anim_state(stream))
         return false;
 
-    if(!G_Move_SaveState(stream))
-        return false;
-
-    if(!G_Combat_SaveState(stream))
-        return false;
-
     if(!G_Sel_SaveState(stream))
         return false;
 
@@ -1868,15 +1996,64 @@ bool G_LoadEntityState(SDL_RWops *stream)
     if(!g_load_anim_state(stream))
         return false;
 
-    if(!G_Move_LoadState(stream))
+    if(!G_Sel_LoadState(stream))
         return false;
 
-    if(!G_Combat_LoadState(stream))
+    return true;
+}
+
+bool G_SaveFogState(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    struct attr hasmap = (struct attr){
+        .type = TYPE_BOOL, 
+        .val.as_bool = (s_gs.map != NULL)
+    };
+    CHK_TRUE_RET(Attr_Write(stream, &hasmap, "has_map"));
+
+    if(hasmap.val.as_bool && !G_Fog_SaveState(stream))
         return false;
 
-    if(!G_Sel_LoadState(stream))
+    return true;
+}
+
+bool G_LoadFogState(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+    struct attr attr;
+
+    CHK_TRUE_RET(Attr_Parse(stream, &attr, true));
+    CHK_TRUE_RET(attr.type == TYPE_BOOL);
+    CHK_TRUE_RET(attr.val.as_bool == (s_gs.map != NULL));
+
+    if(attr.val.as_bool && !G_Fog_LoadState(stream))
         return false;
 
     return true;
 }
 
+bool G_SaveMovementState(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+    return G_Move_SaveState(stream);
+}
+
+bool G_LoadMovementState(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+    return G_Move_LoadState(stream);
+}
+
+bool G_SaveCombatState(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+    return G_Combat_SaveState(stream);
+}
+
+bool G_LoadCombatState(SDL_RWops *stream)
+{
+    ASSERT_IN_MAIN_THREAD();
+    return G_Combat_LoadState(stream);
+}
+
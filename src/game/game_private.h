@@ -46,6 +46,10 @@ const khash_t(entity) *G_GetAllEntsSet(void);
 const struct camera   *G_GetActiveCamera(void);
 void                   G_Zombiefy(struct entity *ent);
 struct entity         *G_EntityForUID(uint32_t uid);
+/* The dynamic entities, sorted by UID. Simulation ticks should iterate in this 
+ * order rather than the (non-reproducible) hash set order. The entities must 
+ * not be added or removed while iterating. */
+const vec_pentity_t   *G_GetDynamicEntsOrdered(void);
 
 
 #endif
@@ -49,11 +49,6 @@
 
 struct gamestate{
     enum simstate           ss;
-    /*-------------------------------------------------------------------------
-     * The SDL tick during which we last changed simulation states.
-     *-------------------------------------------------------------------------
-     */
-    uint32_t                ss_change_tick;
     /*-------------------------------------------------------------------------
      * Currently loaded map. May be NULL.
      *-------------------------------------------------------------------------
@@ -134,6 +129,12 @@ struct gamestate{
      *-------------------------------------------------------------------------
      */
     vec_pentity_t           deleted;
+    /*-------------------------------------------------------------------------
+     * The same entities as in the 'dynamic' set, kept sorted by UID as they 
+     * are added and removed. Simulation ticks iterate over this.
+     *-------------------------------------------------------------------------
+     */
+    vec_pentity_t           dynamic_ordered;
 };
 
 #endif
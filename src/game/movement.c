@@ -37,6 +37,7 @@
 #include "game_private.h"
 #include "combat.h"
 #include "clearpath.h"
+#include "command.h"
 #include "public/game.h"
 #include "../config.h"
 #include "../camera.h"
@@ -68,6 +69,7 @@
 
 #define SIGNUM(x)    (((x) > 0) - ((x) < 0))
 #define MIN(a, b)    ((a) < (b) ? (a) : (b))
+#define MAX(a, b)    ((a) > (b) ? (a) : (b))
 #define ARR_SIZE(a)  (sizeof(a)/sizeof(a[0]))
 #define STR(a)       #a
 
@@ -124,11 +126,48 @@ struct flock{
     khash_t(entity) *ents;
     vec2_t           target_xz; 
     dest_id_t        dest_id;
+    /* Index of this flock's grid in 's_flock_grids'. Only valid when
+     * 'grid_tick' matches the current movement tick. */
+    int              grid_idx;
+    uint32_t         grid_tick;
 };
 
 VEC_TYPE(flock, struct flock)
 VEC_IMPL(static inline, flock, struct flock)
 
+struct flock_member{
+    struct entity *ent;
+    vec2_t         xz_pos;
+    vec2_t         velocity;
+};
+
+VEC_TYPE(fmember, struct flock_member)
+VEC_IMPL(static inline, fmember, struct flock_member)
+
+VEC_TYPE(int, int)
+VEC_IMPL(static inline, int, int)
+
+/* A snapshot of a flock's members taken once per movement tick, bucketed 
+ * into a uniform grid spanning the flock's bounds. This allows the flocking 
+ * forces to only visit the members in the vicinity of an entity rather than 
+ * the entire flock. */
+struct flock_grid{
+    vec2_t         origin;
+    float          cell_size;
+    int            nrows, ncols;
+    /* The largest selection radius of any member */
+    float          max_radius;
+    /* The largest distance that any member can travel in a single tick */
+    float          max_step;
+    /* Members are sorted by cell. The members of cell 'i' are in the 
+     * range [cell_start[i], cell_start[i+1]) */
+    vec_int_t      cell_start;
+    vec_fmember_t  members;
+};
+
+VEC_TYPE(fgrid, struct flock_grid)
+VEC_IMPL(static inline, fgrid, struct flock_grid)
+
 /* Parameters controlling steering/flocking behaviours */
 #define SEPARATION_FORCE_SCALE          (0.6f)
 #define MOVE_ARRIVE_FORCE_SCALE         (0.5f)
@@ -143,6 +182,14 @@ VEC_IMPL(static inline, flock, struct flock)
 
 #define COLLISION_MAX_SEE_AHEAD         (10.0f)
 #define WAIT_TICKS                      (60)
+#define MAX_STEER_PER_TICK              (256)
+
+/* Past this distance, the exponential falloff of the cohesion weight makes 
+ * a neighbour's contribution negligible (less than 1/100th of that of a 
+ * neighbour at COHESION_NEIGHBOUR_RADIUS). */
+#define COHESION_CUTOFF_RADIUS          (COHESION_NEIGHBOUR_RADIUS * 2.0f)
+#define FLOCK_GRID_CELL_SIZE            (20.0f)
+#define FLOCK_GRID_MAX_DIM              (256)
 
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
@@ -160,6 +207,15 @@ static khash_t(state)         *s_entity_state_table;
 static bool                    s_last_cmd_dest_valid = false;
 static dest_id_t               s_last_cmd_dest;
 
+/* The flock grids are rebuilt every tick. The pool is only ever grown so 
+ * that the member buffers can be re-used between ticks. */
+static vec_fgrid_t             s_flock_grids;
+static size_t                  s_flock_grids_used = 0;
+static vec_fmember_t           s_flock_scratch;
+static uint32_t                s_flock_tick = 1;
+/* Index in the ordered entity list from which to resume steering updates */
+static size_t                  s_steer_cursor = 0;
+
 static const char *s_state_str[] = {
     [STATE_MOVING]       = STR(STATE_MOVING),
     [STATE_ARRIVED]      = STR(STATE_ARRIVED),
@@ -185,8 +241,10 @@ static struct movestate *movestate_get(const struct entity *ent)
 static void flock_try_remove(struct flock *flock, const struct entity *ent)
 {
     khiter_t k;
-    if((k = kh_get(entity, flock->ents, ent->uid)) != kh_end(flock->ents))
+    if((k = kh_get(entity, flock->ents, ent->uid)) != kh_end(flock->ents)) {
         kh_del(entity, flock->ents, k);
+        flock->grid_tick = 0;
+    }
 }
 
 static void flock_add(struct flock *flock, const struct entity *ent)
@@ -195,6 +253,7 @@ static void flock_add(struct flock *flock, const struct entity *ent)
     khiter_t k = kh_put(entity, flock->ents, ent->uid, &ret);
     assert(ret != -1 && ret != 0);
     kh_value(flock->ents, k) = (struct entity*)ent;
+    flock->grid_tick = 0;
 }
 
 static bool flock_contains(const struct flock *flock, const struct entity *ent)
@@ -227,6 +286,131 @@ static struct flock *flock_for_dest(dest_id_t id)
     return NULL;
 }
 
+static struct flock_grid *flock_grid_alloc(void)
+{
+    if(s_flock_grids_used == vec_size(&s_flock_grids)) {
+
+        struct flock_grid new_grid;
+        vec_int_init(&new_grid.cell_start);
+        vec_fmember_init(&new_grid.members);
+        if(!vec_fgrid_push(&s_flock_grids, new_grid))
+            return NULL;
+    }
+    return &vec_AT(&s_flock_grids, s_flock_grids_used++);
+}
+
+/* Returns the grid of the flock for the current tick, building it 
+ * if the flock hasn't been queried yet or its' membership changed. 
+ */
+static const struct flock_grid *flock_grid(struct flock *flock)
+{
+    if(flock->grid_tick == s_flock_tick)
+        return &vec_AT(&s_flock_grids, flock->grid_idx);
+
+    struct flock_grid *grid = flock_grid_alloc();
+    if(!grid)
+        return NULL;
+
+    vec_fmember_reset(&s_flock_scratch);
+    vec_fmember_reset(&grid->members);
+    vec_int_reset(&grid->cell_start);
+
+    if(!vec_fmember_resize(&s_flock_scratch, kh_size(flock->ents))
+    || !vec_fmember_resize(&grid->members, kh_size(flock->ents)))
+        return NULL;
+
+    vec2_t min = (vec2_t){ INFINITY,  INFINITY};
+    vec2_t max = (vec2_t){-INFINITY, -INFINITY};
+    grid->max_radius = 0.0f;
+    grid->max_step = 0.0f;
+
+    uint32_t key;
+    struct entity *curr;
+    (void)key;
+
+    kh_foreach(flock->ents, key, curr, {
+
+        struct movestate *ms = movestate_get(curr);
+        assert(ms);
+
+        struct flock_member member = (struct flock_member){
+            .ent = curr,
+            .xz_pos = G_Pos_GetXZ(curr->uid),
+            .velocity = ms->velocity,
+        };
+        vec_fmember_push(&s_flock_scratch, member);
+
+        min.x = MIN(min.x, member.xz_pos.x);
+        min.z = MIN(min.z, member.xz_pos.z);
+        max.x = MAX(max.x, member.xz_pos.x);
+        max.z = MAX(max.z, member.xz_pos.z);
+        grid->max_radius = MAX(grid->max_radius, curr->selection_radius);
+        grid->max_step = MAX(grid->max_step, curr->max_speed / MOVE_TICK_RES);
+    });
+
+    if(vec_size(&s_flock_scratch) == 0)
+        min = max = (vec2_t){0.0f, 0.0f};
+
+    float extent = MAX(max.x - min.x, max.z - min.z);
+    grid->origin = min;
+    grid->cell_size = MAX(FLOCK_GRID_CELL_SIZE, extent / (FLOCK_GRID_MAX_DIM - 1));
+    grid->ncols = (int)((max.x - min.x) / grid->cell_size) + 1;
+    grid->nrows = (int)((max.z - min.z) / grid->cell_size) + 1;
+
+    const int ncells = grid->nrows * grid->ncols;
+    if(!vec_int_resize(&grid->cell_start, ncells + 1))
+        return NULL;
+    for(int i = 0; i < ncells + 1; i++)
+        vec_int_push(&grid->cell_start, 0);
+
+    /* Counting sort of the members by cell */
+    for(int i = 0; i < vec_size(&s_flock_scratch); i++) {
+
+        const struct flock_member *member = &vec_AT(&s_flock_scratch, i);
+        int c = MIN((int)((member->xz_pos.x - min.x) / grid->cell_size), grid->ncols-1);
+        int r = MIN((int)((member->xz_pos.z - min.z) / grid->cell_size), grid->nrows-1);
+        vec_AT(&grid->cell_start, r * grid->ncols + c + 1)++;
+    }
+
+    for(int i = 0; i < ncells; i++)
+        vec_AT(&grid->cell_start, i + 1) += vec_AT(&grid->cell_start, i);
+
+    vec_fmember_copy(&grid->members, &s_flock_scratch);
+    for(int i = 0; i < vec_size(&s_flock_scratch); i++) {
+
+        const struct flock_member *member = &vec_AT(&s_flock_scratch, i);
+        int c = MIN((int)((member->xz_pos.x - min.x) / grid->cell_size), grid->ncols-1);
+        int r = MIN((int)((member->xz_pos.z - min.z) / grid->cell_size), grid->nrows-1);
+        vec_AT(&grid->members, vec_AT(&grid->cell_start, r * grid->ncols + c)++) = *member;
+    }
+
+    /* The placement pass advanced each cell's start to the start of the next 
+     * cell. Shift the offsets back into place. */
+    for(int i = ncells; i > 0; i--)
+        vec_AT(&grid->cell_start, i) = vec_AT(&grid->cell_start, i - 1);
+    vec_AT(&grid->cell_start, 0) = 0;
+
+    flock->grid_idx = grid - &vec_AT(&s_flock_grids, 0);
+    flock->grid_tick = s_flock_tick;
+    return grid;
+}
+
+/* Get the (inclusive) range of grid cells overlapping the square 
+ * bounding a circle. */
+static void flock_grid_range(const struct flock_grid *grid, vec2_t xz_pos, float radius,
+                             int *out_r0, int *out_r1, int *out_c0, int *out_c1)
+{
+    float c0 = (xz_pos.x - radius - grid->origin.x) / grid->cell_size;
+    float c1 = (xz_pos.x + radius - grid->origin.x) / grid->cell_size;
+    float r0 = (xz_pos.z - radius - grid->origin.z) / grid->cell_size;
+    float r1 = (xz_pos.z + radius - grid->origin.z) / grid->cell_size;
+
+    *out_c0 = MAX((int)floorf(c0), 0);
+    *out_c1 = MIN((int)floorf(c1), grid->ncols-1);
+    *out_r0 = MAX((int)floorf(r0), 0);
+    *out_r1 = MIN((int)floorf(r1), grid->nrows-1);
+}
+
 static void entity_block(const struct entity *ent)
 {
     M_NavBlockersIncref(G_Pos_GetXZ(ent->uid), ent->selection_radius, s_map);
@@ -418,29 +602,40 @@ static bool make_flock_from_selection(const vec_pentity_t *sel, vec2_t target_xz
     }
 }
 
-size_t adjacent_flock_members(const struct entity *ent, const struct flock *flock, 
-                              struct entity *out[])
+static size_t adjacent_flock_members(const struct entity *ent, struct flock *flock, 
+                                     struct entity *out[])
 {
+    const struct flock_grid *grid = flock_grid(flock);
+    if(!grid)
+        return 0;
+
     vec2_t ent_xz_pos = G_Pos_GetXZ(ent->uid);
     size_t ret = 0;
 
-    uint32_t key;
-    struct entity *curr;
-    (void)key;
+    /* Entities may have moved since the grid was built. Pad the search 
+     * radius by the maximum distance they could have travelled. */
+    float radius = ent->selection_radius + grid->max_radius + ADJACENCY_SEP_DIST + grid->max_step;
+    int r0, r1, c0, c1;
+    flock_grid_range(grid, ent_xz_pos, radius, &r0, &r1, &c0, &c1);
 
-    kh_foreach(flock->ents, key, curr, {
+    for(int r = r0; r <= r1; r++) {
+    for(int c = c0; c <= c1; c++) {
 
-        if(curr == ent)
-            continue;
+        int cell = r * grid->ncols + c;
+        for(int i = vec_AT(&grid->cell_start, cell); i < vec_AT(&grid->cell_start, cell + 1); i++) {
 
-        vec2_t diff;
+            struct entity *curr = vec_AT(&grid->members, i).ent;
+            if(curr == ent)
+                continue;
 
-        vec2_t curr_xz_pos = G_Pos_GetXZ(curr->uid);
-        PFM_Vec2_Sub(&ent_xz_pos, &curr_xz_pos, &diff);
+            vec2_t diff;
+            vec2_t curr_xz_pos = G_Pos_GetXZ(curr->uid);
+            PFM_Vec2_Sub(&ent_xz_pos, &curr_xz_pos, &diff);
 
-        if(PFM_Vec2_Len(&diff) <= ent->selection_radius + curr->selection_radius + ADJACENCY_SEP_DIST)
-            out[ret++] = curr;  
-    });
+            if(PFM_Vec2_Len(&diff) <= ent->selection_radius + curr->selection_radius + ADJACENCY_SEP_DIST)
+                out[ret++] = curr;  
+        }
+    }}
     return ret;
 }
 
@@ -490,25 +685,7 @@ static void on_mousedown(void *user, void *event)
     if(!M_Raycast_IntersecCoordinate(&mouse_coord))
         return;
 
-    enum selection_type sel_type;
-    const vec_pentity_t *sel = G_Sel_Get(&sel_type);
-    if(vec_size(sel) > 0 && sel_type == SELECTION_TYPE_PLAYER) {
-
-        for(int i = 0; i < vec_size(sel); i++) {
-
-            const struct entity *curr = vec_AT(sel, i);
-            if(!(curr->flags & ENTITY_FLAG_COMBATABLE))
-                continue;
-
-            if(curr->flags & ENTITY_FLAG_COMBATABLE) {
-                G_Combat_ClearSavedMoveCmd(curr);
-                G_Combat_SetStance(curr, attack ? COMBAT_STANCE_AGGRESSIVE : COMBAT_STANCE_NO_ENGAGEMENT);
-            }
-        }
-
-        move_marker_add(mouse_coord, attack);
-        make_flock_from_selection(sel, (vec2_t){mouse_coord.x, mouse_coord.z}, attack);
-    }
+    G_Cmd_OrderSelection(mouse_coord, attack);
 }
 
 static void on_render_3d(void *user, void *event)
@@ -684,37 +861,44 @@ static vec2_t arrive_force(const struct entity *ent, dest_id_t dest_id, vec2_t t
 
 /* Alignment is a behaviour that causes a particular agent to line up with agents close by.
  */
-static vec2_t alignment_force(const struct entity *ent, const struct flock *flock)
+static vec2_t alignment_force(const struct entity *ent, struct flock *flock)
 {
     vec2_t ret = (vec2_t){0.0f};
     size_t neighbour_count = 0;
 
-    uint32_t key;
-    struct entity *curr;
-    (void)key;
+    const struct flock_grid *grid = flock_grid(flock);
+    if(!grid)
+        return (vec2_t){0.0f};
 
-    kh_foreach(flock->ents, key, curr, {
+    vec2_t ent_xz_pos = G_Pos_GetXZ(ent->uid);
+    int r0, r1, c0, c1;
+    flock_grid_range(grid, ent_xz_pos, ALIGN_NEIGHBOUR_RADIUS, &r0, &r1, &c0, &c1);
 
-        if(curr == ent)
-            continue;
+    for(int r = r0; r <= r1; r++) {
+    for(int c = c0; c <= c1; c++) {
 
-        vec2_t diff;
-        vec2_t ent_xz_pos = G_Pos_GetXZ(ent->uid);
-        vec2_t curr_xz_pos = G_Pos_GetXZ(curr->uid);
+        int cell = r * grid->ncols + c;
+        for(int i = vec_AT(&grid->cell_start, cell); i < vec_AT(&grid->cell_start, cell + 1); i++) {
 
-        PFM_Vec2_Sub(&curr_xz_pos, &ent_xz_pos, &diff);
-        if(PFM_Vec2_Len(&diff) < ALIGN_NEIGHBOUR_RADIUS) {
+            const struct flock_member *curr = &vec_AT(&grid->members, i);
+            if(curr->ent == ent)
+                continue;
 
-            struct movestate *ms = movestate_get(ent);
-            assert(ms);
+            vec2_t diff;
+            vec2_t curr_xz_pos = curr->xz_pos;
+            vec2_t curr_vel = curr->velocity;
+
+            PFM_Vec2_Sub(&curr_xz_pos, &ent_xz_pos, &diff);
+            if(PFM_Vec2_Len(&diff) >= ALIGN_NEIGHBOUR_RADIUS)
+                continue;
 
-            if(PFM_Vec2_Len(&ms->velocity) < EPSILON)
+            if(PFM_Vec2_Len(&curr_vel) < EPSILON)
                 continue; 
 
-            PFM_Vec2_Add(&ret, &ms->velocity, &ret);
+            PFM_Vec2_Add(&ret, &curr_vel, &ret);
             neighbour_count++;
         }
-    });
+    }}
 
     if(0 == neighbour_count)
         return (vec2_t){0.0f};
@@ -730,35 +914,50 @@ static vec2_t alignment_force(const struct entity *ent, const struct flock *floc
 
 /* Cohesion is a behaviour that causes agents to steer towards the center of mass of nearby agents.
  */
-static vec2_t cohesion_force(const struct entity *ent, const struct flock *flock)
+static vec2_t cohesion_force(const struct entity *ent, struct flock *flock)
 {
     vec2_t COM = (vec2_t){0.0f};
-    size_t neighbour_count = 0;
     vec2_t ent_xz_pos = G_Pos_GetXZ(ent->uid);
 
-    uint32_t key;
-    struct entity *curr;
-    (void)key;
+    /* All other flock members count towards the average, but only the 
+     * ones within the cutoff radius have a non-negligible weight. */
+    assert(flock_contains(flock, ent));
+    size_t neighbour_count = kh_size(flock->ents) - 1;
+    if(0 == neighbour_count)
+        return (vec2_t){0.0f};
 
-    kh_foreach(flock->ents, key, curr, {
+    const struct flock_grid *grid = flock_grid(flock);
+    if(!grid)
+        return (vec2_t){0.0f};
 
-        if(curr == ent)
-            continue;
+    int r0, r1, c0, c1;
+    flock_grid_range(grid, ent_xz_pos, COHESION_CUTOFF_RADIUS, &r0, &r1, &c0, &c1);
 
-        vec2_t diff;
-        vec2_t curr_xz_pos = G_Pos_GetXZ(curr->uid);
-        PFM_Vec2_Sub(&curr_xz_pos, &ent_xz_pos, &diff);
+    for(int r = r0; r <= r1; r++) {
+    for(int c = c0; c <= c1; c++) {
 
-        float t = (PFM_Vec2_Len(&diff) - COHESION_NEIGHBOUR_RADIUS*0.75) / COHESION_NEIGHBOUR_RADIUS;
-        float scale = exp(-6.0f * t);
+        int cell = r * grid->ncols + c;
+        for(int i = vec_AT(&grid->cell_start, cell); i < vec_AT(&grid->cell_start, cell + 1); i++) {
 
-        PFM_Vec2_Scale(&curr_xz_pos, scale, &curr_xz_pos);
-        PFM_Vec2_Add(&COM, &curr_xz_pos, &COM);
-        neighbour_count++;
-    });
+            const struct flock_member *curr = &vec_AT(&grid->members, i);
+            if(curr->ent == ent)
+                continue;
 
-    if(0 == neighbour_count)
-        return (vec2_t){0.0f};
+            vec2_t diff;
+            vec2_t curr_xz_pos = curr->xz_pos;
+            PFM_Vec2_Sub(&curr_xz_pos, &ent_xz_pos, &diff);
+
+            float dist = PFM_Vec2_Len(&diff);
+            if(dist > COHESION_CUTOFF_RADIUS)
+                continue;
+
+            float t = (dist - COHESION_NEIGHBOUR_RADIUS*0.75) / COHESION_NEIGHBOUR_RADIUS;
+            float scale = exp(-6.0f * t);
+
+            PFM_Vec2_Scale(&curr_xz_pos, scale, &curr_xz_pos);
+            PFM_Vec2_Add(&COM, &curr_xz_pos, &COM);
+        }
+    }}
 
     vec2_t ret;
     PFM_Vec2_Scale(&COM, 1.0f / neighbour_count, &COM);
@@ -810,7 +1009,7 @@ static vec2_t separation_force(const struct entity *ent, float buffer_dist)
     return ret;
 }
 
-static vec2_t point_seek_total_force(const struct entity *ent, const struct flock *flock)
+static vec2_t point_seek_total_force(const struct entity *ent, struct flock *flock)
 {
     struct movestate *ms = movestate_get(ent);
     assert(ms);
@@ -882,7 +1081,7 @@ static void nullify_impass_components(const struct entity *ent, vec2_t *inout_fo
         inout_force->z = 0.0f;
 }
 
-static vec2_t point_seek_vpref(const struct entity *ent, const struct flock *flock)
+static vec2_t point_seek_vpref(const struct entity *ent, struct flock *flock)
 {
     struct movestate *ms = movestate_get(ent);
     assert(ms);
@@ -1158,22 +1357,41 @@ static void on_20hz_tick(void *user, void *event)
     vec_cp_ent_init(&dyn);
     vec_cp_ent_init(&stat);
 
-    uint32_t key;
-    struct entity *curr;
+    const vec_pentity_t *ents = G_GetDynamicEntsOrdered();
 
     disband_empty_flocks();
 
-    kh_foreach(G_GetDynamicEntsSet(), key, curr, {
+    /* Invalidate the flock grids from the previous tick */
+    if(++s_flock_tick == 0)
+        s_flock_tick = 1;
+    s_flock_grids_used = 0;
+
+    /* Recomputing the steering velocity is the bulk of the work. Cap the number 
+     * of entities that are steered per tick and continue from where we left off 
+     * on the next tick. The rest keep their last computed velocity. 
+     */
+    const size_t nents = vec_size(ents);
+    size_t nsteered = 0;
+
+    for(size_t j = 0; j < nents; j++) {
 
+        const size_t i = (s_steer_cursor + j) % nents;
+        struct entity *curr = vec_AT(ents, i);
         struct movestate *ms = movestate_get(curr);
         assert(ms);
 
         if(ent_still(ms))
             continue;
 
+        ms->vdes = ent_desired_velocity(curr);
+
+        if(nsteered == MAX_STEER_PER_TICK)
+            continue;
+        if(++nsteered == MAX_STEER_PER_TICK)
+            s_steer_cursor = (i + 1) % nents;
+
         struct flock *flock = flock_for_ent(curr);
         vec2_t vpref = (vec2_t){-1,-1};
-        ms->vdes = ent_desired_velocity(curr);
 
         switch(ms->state) {
         case STATE_SEEK_ENEMIES: 
@@ -1196,7 +1414,7 @@ static void on_20hz_tick(void *user, void *event)
         vec_cp_ent_reset(&stat);
         find_neighbours(curr, &dyn, &stat);
 
-        ms->vnew = G_ClearPath_NewVelocity(curr_cp, key, vpref, dyn, stat);
+        ms->vnew = G_ClearPath_NewVelocity(curr_cp, curr->uid, vpref, dyn, stat);
         update_vel_hist(ms, ms->vnew);
 
         vec2_t vel_diff;
@@ -1204,15 +1422,16 @@ static void on_20hz_tick(void *user, void *event)
 
         PFM_Vec2_Add(&ms->velocity, &vel_diff, &ms->vnew);
         vec2_truncate(&ms->vnew, curr->max_speed / MOVE_TICK_RES);
-    });
+    }
 
-    kh_foreach(G_GetDynamicEntsSet(), key, curr, {
+    for(int i = 0; i < vec_size(ents); i++) {
     
+        struct entity *curr = vec_AT(ents, i);
         struct movestate *ms = movestate_get(curr);
         assert(ms);
 
         entity_update(curr, ms->vnew);
-    });
+    }
 
     vec_cp_ent_destroy(&dyn);
     vec_cp_ent_destroy(&stat);
@@ -1232,6 +1451,8 @@ bool G_Move_Init(const struct map *map)
     }
     vec_pentity_init(&s_move_markers);
     vec_flock_init(&s_flocks);
+    vec_fgrid_init(&s_flock_grids);
+    vec_fmember_init(&s_flock_scratch);
 
     E_Global_Register(SDL_MOUSEBUTTONDOWN, on_mousedown, NULL, G_RUNNING);
     E_Global_Register(EVENT_RENDER_3D, on_render_3d, NULL, G_RUNNING | G_PAUSED_FULL | G_PAUSED_UI_RUNNING);
@@ -1255,6 +1476,15 @@ void G_Move_Shutdown(void)
         G_SafeFree(vec_AT(&s_move_markers, i));
     }
 
+    for(int i = 0; i < vec_size(&s_flock_grids); i++) {
+        vec_int_destroy(&vec_AT(&s_flock_grids, i).cell_start);
+        vec_fmember_destroy(&vec_AT(&s_flock_grids, i).members);
+    }
+    vec_fgrid_destroy(&s_flock_grids);
+    vec_fmember_destroy(&s_flock_scratch);
+    s_flock_grids_used = 0;
+    s_steer_cursor = 0;
+
     vec_flock_destroy(&s_flocks);
     vec_pentity_destroy(&s_move_markers);
     kh_destroy(state, s_entity_state_table);
@@ -1355,6 +1585,30 @@ void G_Move_SetDest(const struct entity *ent, vec2_t dest_xz)
     vec_pentity_destroy(&to_add);
 }
 
+void G_Move_OrderSelection(vec3_t target, bool attack)
+{
+    enum selection_type sel_type;
+    const vec_pentity_t *sel = G_Sel_Get(&sel_type);
+
+    if(vec_size(sel) == 0 || sel_type != SELECTION_TYPE_PLAYER)
+        return;
+
+    for(int i = 0; i < vec_size(sel); i++) {
+
+        const struct entity *curr = vec_AT(sel, i);
+        if(!(curr->flags & ENTITY_FLAG_COMBATABLE))
+            continue;
+
+        if(curr->flags & ENTITY_FLAG_COMBATABLE) {
+            G_Combat_ClearSavedMoveCmd(curr);
+            G_Combat_SetStance(curr, attack ? COMBAT_STANCE_AGGRESSIVE : COMBAT_STANCE_NO_ENGAGEMENT);
+        }
+    }
+
+    move_marker_add(target, attack);
+    make_flock_from_selection(sel, (vec2_t){target.x, target.z}, attack);
+}
+
 void G_Move_SetMoveOnLeftClick(void)
 {
     s_attack_on_lclick = false;
@@ -1557,7 +1811,7 @@ bool G_Move_LoadState(struct SDL_RWops *stream)
     assert(vec_size(&s_flocks) == 0);
     for(int i = 0; i < num_flocks; i++) {
 
-        struct flock new_flock;
+        struct flock new_flock = (struct flock){0};
         new_flock.ents = kh_init(entity);
         CHK_TRUE_RET(new_flock.ents);
 
@@ -55,6 +55,8 @@ void G_Move_Stop(const struct entity *ent);
 bool G_Move_GetDest(const struct entity *ent, vec2_t *out_xz);
 
 void G_Move_SetSeekEnemies(const struct entity *ent);
+/* Give a move (or attack-move) order to the player's current selection */
+void G_Move_OrderSelection(vec3_t target, bool attack);
 void G_Move_UpdatePos(const struct entity *ent, vec2_t pos);
 
 bool G_Move_SaveState(struct SDL_RWops *stream);
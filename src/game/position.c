@@ -36,6 +36,7 @@
 #include "game_private.h"
 #include "movement.h"
 #include "fog_of_war.h"
+#include "bvh.h"
 #include "public/game.h"
 #include "../main.h"
 #include "../pf_math.h"
@@ -64,9 +65,10 @@ KHASH_MAP_INIT_INT(pos, vec3_t)
 /* STATIC VARIABLES                                                          */
 /*****************************************************************************/
 
-static khash_t(pos) *s_postable;
+static const struct map *s_map;
+static khash_t(pos)     *s_postable;
 /* The quadtree is always synchronized with the postable, at function call boundaries */
-static qt_ent_t      s_postree;
+static qt_ent_t          s_postree;
 
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
@@ -77,6 +79,23 @@ static bool any_ent(const struct entity *ent, void *arg)
     return true;
 }
 
+/* An entity's vision only depends on the tile it is standing on, so moving
+ * within a tile leaves the fog of war unchanged. */
+static bool same_tile(vec2_t a, vec2_t b)
+{
+    struct map_resolution res;
+    M_GetResolution(s_map, &res);
+    vec3_t map_pos = M_GetPos(s_map);
+
+    struct tile_desc ta, tb;
+    if(!M_Tile_DescForPoint2D(res, map_pos, a, &ta)
+    || !M_Tile_DescForPoint2D(res, map_pos, b, &tb))
+        return false;
+
+    return (ta.chunk_r == tb.chunk_r && ta.chunk_c == tb.chunk_c
+         && ta.tile_r  == tb.tile_r  && ta.tile_c  == tb.tile_c);
+}
+
 /*****************************************************************************/
 /* EXTERN FUNCTIONS                                                          */
 /*****************************************************************************/
@@ -89,31 +108,49 @@ bool G_Pos_Set(const struct entity *ent, vec3_t pos)
     bool overwrite = (k != kh_end(s_postable));
 
     if(overwrite) {
+
         vec3_t old_pos = kh_val(s_postable, k);
-        bool ret = qt_ent_delete(&s_postree, old_pos.x, old_pos.z, ent->uid);
-        assert(ret);
+        vec2_t old_xz = (vec2_t){old_pos.x, old_pos.z};
+        vec2_t new_xz = (vec2_t){pos.x, pos.z};
 
-        G_Fog_RemoveVision((vec2_t){old_pos.x, old_pos.z}, ent->faction_id, ent->vision_range);
-    }
+        /* This is an in-place update when the entity stays within the same leaf */
+        if(!qt_ent_move(&s_postree, old_pos.x, old_pos.z, pos.x, pos.z, ent->uid))
+            return false;
 
-    if(!qt_ent_insert(&s_postree, pos.x, pos.z, ent->uid))
-        return false;
+        kh_val(s_postable, k) = pos;
+        assert(kh_size(s_postable) == s_postree.nrecs);
+
+        if(!same_tile(old_xz, new_xz)) {
+            G_Fog_RemoveVision(old_xz, ent->faction_id, ent->vision_range);
+            G_Fog_AddVision(new_xz, ent->faction_id, ent->vision_range);
+        }
+
+        if(ent->flags & ENTITY_FLAG_COMBATABLE)
+            M_NavCombatableMoved(s_map, old_xz, new_xz);
+    }else{
+
+        if(!qt_ent_insert(&s_postree, pos.x, pos.z, ent->uid))
+            return false;
 
-    if(!overwrite) {
         int ret;
-        kh_put(pos, s_postable, ent->uid, &ret); 
+        k = kh_put(pos, s_postable, ent->uid, &ret); 
         if(ret == -1) {
             qt_ent_delete(&s_postree, pos.x, pos.z, ent->uid);
             return false;
         }
-        k = kh_get(pos, s_postable, ent->uid);
+
+        kh_val(s_postable, k) = pos;
+        assert(kh_size(s_postable) == s_postree.nrecs);
+        G_Fog_AddVision((vec2_t){pos.x, pos.z}, ent->faction_id, ent->vision_range);
+
+        if(ent->flags & ENTITY_FLAG_COMBATABLE)
+            M_NavCombatableTouched(s_map, (vec2_t){pos.x, pos.z});
     }
 
-    kh_val(s_postable, k) = pos;
-    assert(kh_size(s_postable) == s_postree.nrecs);
+    if(ent->flags & ENTITY_FLAG_STATIC)
+        G_Bvh_Update(ent);
 
     G_Move_UpdatePos(ent, (vec2_t){pos.x, pos.z});
-    G_Fog_AddVision((vec2_t){pos.x, pos.z}, ent->faction_id, ent->vision_range);
     return true; 
 }
 
@@ -149,6 +186,9 @@ void G_Pos_Delete(uint32_t uid)
     bool ret = qt_ent_delete(&s_postree, pos.x, pos.z, uid);
     assert(ret);
     assert(kh_size(s_postable) == s_postree.nrecs);
+
+    /* The entity's flags are not known at this point */
+    M_NavCombatableTouched(s_map, (vec2_t){pos.x, pos.z});
 }
 
 bool G_Pos_Init(const struct map *map)
@@ -160,6 +200,8 @@ bool G_Pos_Init(const struct map *map)
     if(kh_resize(pos, s_postable, POSBUF_INIT_SIZE) < 0)
         return false;
 
+    s_map = map;
+
     struct map_resolution res;
     M_GetResolution(map, &res);
 
@@ -185,6 +227,7 @@ void G_Pos_Shutdown(void)
 
     kh_destroy(pos, s_postable);
     qt_ent_destroy(&s_postree);
+    s_map = NULL;
 }
 
 int G_Pos_EntsInRect(vec2_t xz_min, vec2_t xz_max, struct entity **out, size_t maxout)
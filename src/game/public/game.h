@@ -129,6 +129,8 @@ bool   G_AddEntity(struct entity *ent, vec3_t pos);
 bool   G_RemoveEntity(struct entity *ent);
 void   G_StopEntity(const struct entity *ent);
 void   G_SetStatic(struct entity *ent, bool on);
+/* Must be called after modifying the scale or rotation of an entity directly */
+void   G_UpdateBounds(const struct entity *ent);
 
 /* Wrapper around AL_EntityFree to defer the call until the render thread 
  * (which owns some part of entity resources) finishes its' work. */
@@ -157,12 +159,60 @@ void          G_SetLightPos(vec3_t pos);
 
 struct render_workspace *G_GetSimWS(void);
 struct render_workspace *G_GetRenderWS(void);
+const struct map        *G_GetMap(void);
 const struct map        *G_GetPrevTickMap(void);
 
 bool   G_SaveGlobalState(SDL_RWops *stream);
 bool   G_LoadGlobalState(SDL_RWops *stream);
 bool   G_SaveEntityState(SDL_RWops *stream);
 bool   G_LoadEntityState(SDL_RWops *stream);
+/* Fog state must be loaded after the global state (which creates the map) 
+ * but before any entities are added. Movement and combat state must be 
+ * loaded after the entity state. */
+bool   G_SaveFogState(SDL_RWops *stream);
+bool   G_LoadFogState(SDL_RWops *stream);
+bool   G_SaveMovementState(SDL_RWops *stream);
+bool   G_LoadMovementState(SDL_RWops *stream);
+bool   G_SaveCombatState(SDL_RWops *stream);
+bool   G_LoadCombatState(SDL_RWops *stream);
+
+/*###########################################################################*/
+/* GAME TIMER                                                                */
+/*###########################################################################*/
+
+/* The simulation clock. It advances by one for every 60Hz tick during which
+ * the simulation is running. Anything that affects the outcome of the 
+ * simulation must be timed with this clock rather than the wall clock. */
+uint64_t G_Timer_SimTick(void);
+uint32_t G_Timer_SimMillis(void);
+
+/*###########################################################################*/
+/* GAME COMMANDS                                                             */
+/*###########################################################################*/
+
+/* All the orders that the player or the scripts give to the simulation go 
+ * through the command stream. While recording, every command is logged with 
+ * the simulation tick on which it was issued. During playback, the logged 
+ * commands are re-issued on the same ticks and any live commands are dropped, 
+ * so that the simulation follows the recording.
+ */
+void G_Cmd_ClearSelection(void);
+void G_Cmd_Select(struct entity *ent);
+void G_Cmd_Deselect(struct entity *ent);
+void G_Cmd_Move(const struct entity *ent, vec2_t dest_xz);
+void G_Cmd_Stop(const struct entity *ent);
+/* Can only be called with entities that have 'ENTITY_FLAG_COMBATABLE' set */
+void G_Cmd_Attack(const struct entity *ent, vec2_t dest_xz);
+void G_Cmd_HoldPosition(const struct entity *ent);
+
+bool G_Cmd_BeginRecording(void);
+/* Writes out all the commands recorded so far and stops the recording */
+bool G_Cmd_EndRecording(SDL_RWops *stream);
+bool G_Cmd_Recording(void);
+/* The simulation must be in the state in which the recording was begun */
+bool G_Cmd_BeginPlayback(SDL_RWops *stream);
+void G_Cmd_EndPlayback(void);
+bool G_Cmd_Playing(void);
 
 /*###########################################################################*/
 /* GAME SELECTION                                                            */
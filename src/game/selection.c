@@ -35,6 +35,7 @@
 
 #include "selection.h"
 #include "game_private.h"
+#include "command.h"
 #include "public/game.h"
 #include "../pf_math.h"
 #include "../event.h"
@@ -152,16 +153,7 @@ static void on_render_ui(void *user, void *event)
     const float width = 2.0f;
     const vec3_t color = (vec3_t){0.0f, 1.0f, 0.0f};
 
-    R_PushCmd((struct rcmd){
-        .func = R_GL_DrawBox2D,
-        .nargs = 4,
-        .args = {
-            R_PushArg(&s_ctx.mouse_down_coord, sizeof(s_ctx.mouse_down_coord)),
-            R_PushArg(&signed_size, sizeof(signed_size)),
-            R_PushArg(&color, sizeof(color)),
-            R_PushArg(&width, sizeof(width)),
-        }
-    });
+    R_PushBox2D(s_ctx.mouse_down_coord, signed_size, color, width);
 }
 
 static vec3_t sel_unproject_mouse_coords(struct camera *cam, vec2_t mouse_coords, float ndc_z)
@@ -379,6 +371,8 @@ void G_Sel_Update(struct camera *cam, const vec_pentity_t *visible, const vec_ob
         PERF_RETURN_VOID();
     s_ctx.state = STATE_MOUSE_SEL_UP;
 
+    vec_pentity_t picked;
+    vec_pentity_init(&picked);
     bool sel_empty = true;
     if(s_ctx.mouse_down_coord.x == s_ctx.mouse_up_coord.x && s_ctx.mouse_down_coord.y && s_ctx.mouse_up_coord.y) {
 
@@ -407,8 +401,8 @@ void G_Sel_Update(struct camera *cam, const vec_pentity_t *visible, const vec_ob
                 sel_empty = false;
                 if(t < t_min) {
                     t_min = t;
-                    vec_pentity_reset(&s_selected);                
-                    vec_pentity_push(&s_selected, vec_AT(visible, i));
+                    vec_pentity_reset(&picked);                
+                    vec_pentity_push(&picked, vec_AT(visible, i));
                 }
             }
         }
@@ -427,22 +421,30 @@ void G_Sel_Update(struct camera *cam, const vec_pentity_t *visible, const vec_ob
 
             if(C_FrustumOBBIntersectionExact(&frust, &vec_AT(visible_obbs, i))) {
 
-                if(sel_empty) {
-                    vec_pentity_reset(&s_selected);
-                    sel_empty = false;
-                }
-                vec_pentity_push(&s_selected, vec_AT(visible, i));
+                sel_empty = false;
+                vec_pentity_push(&picked, vec_AT(visible, i));
             }
         }
     }
 
+    /* The selection is a player command, so it goes through the command stream */
     if(!sel_empty) {
-        sel_filter_and_set_type();
-        E_Global_Notify(EVENT_UNIT_SELECTION_CHANGED, NULL, ES_ENGINE);
+        G_Cmd_SetSelection(&picked);
     }
+    vec_pentity_destroy(&picked);
     PERF_RETURN_VOID();
 }
 
+void G_Sel_Set(const vec_pentity_t *ents)
+{
+    vec_pentity_reset(&s_selected);
+    for(int i = 0; i < vec_size(ents); i++) {
+        vec_pentity_push(&s_selected, vec_AT(ents, i));
+    }
+    sel_filter_and_set_type();
+    E_Global_Notify(EVENT_UNIT_SELECTION_CHANGED, NULL, ES_ENGINE);
+}
+
 void G_Sel_Clear(void)
 {
     bool installed = s_ctx.installed;
@@ -54,6 +54,8 @@ extern const vec3_t g_seltype_color_map[];
 bool G_Sel_Init(void);
 void G_Sel_Shutdown(void);
 void G_Sel_Update(struct camera *cam, const vec_pentity_t *visible, const vec_obb_t *visible_obbs);
+/* Replace the current selection, as if it was picked with the mouse */
+void G_Sel_Set(const vec_pentity_t *ents);
 bool G_Sel_SaveState(struct SDL_RWops *stream);
 bool G_Sel_LoadState(struct SDL_RWops *stream);
 
@@ -35,6 +35,7 @@
 
 #include "public/game.h"
 #include "timer_events.h"
+#include "command.h"
 #include "../event.h"
 
 #include <math.h>
@@ -42,14 +43,36 @@
 #include <SDL.h>
 
 #define TIMER_INTERVAL  (1000.0f/60.0f)
+#define ARR_SIZE(a)     (sizeof(a)/sizeof(a[0]))
 
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
 /*****************************************************************************/
 
 static unsigned long long s_num_60hz_ticks;
+/* The number of 60Hz ticks during which the simulation was running. This is 
+ * the clock of the simulation. It does not advance while the game is paused 
+ * and does not depend on the wall clock time between ticks. */
+static uint64_t           s_num_sim_ticks;
 static SDL_TimerID        s_60hz_timer;
 
+/* The 30Hz and 20Hz ticks drive the combat and movement simulation. Since
+ * their periods are coprime, they necessarily coincide on every 6th 60Hz 
+ * tick. The remaining ticks are given phase offsets so that they never 
+ * pile on top of both, rather than all firing together on every 60th tick. 
+ */
+static const struct{
+    enum eventtype event;
+    unsigned       period;
+    unsigned       phase;
+}s_tick_events[] = {
+    {EVENT_30HZ_TICK,  2, 0},
+    {EVENT_20HZ_TICK,  3, 0},
+    {EVENT_15HZ_TICK,  4, 3},
+    {EVENT_10HZ_TICK,  6, 1},
+    {EVENT_1HZ_TICK,  60, 5},
+};
+
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
 /*****************************************************************************/
@@ -88,20 +111,15 @@ static void timer_60hz_handler(void *unused1, void *unused2)
 {
     s_num_60hz_ticks++;
 
-    if(s_num_60hz_ticks % 2 == 0)
-        E_Global_Notify(EVENT_30HZ_TICK, NULL, ES_ENGINE);
-
-    if(s_num_60hz_ticks % 3 == 0)
-        E_Global_Notify(EVENT_20HZ_TICK, NULL, ES_ENGINE);
+    if(G_GetSimState() == G_RUNNING) {
+        s_num_sim_ticks++;
+        G_Cmd_OnSimTick(s_num_sim_ticks);
+    }
 
-    if(s_num_60hz_ticks % 4 == 0)
-        E_Global_Notify(EVENT_15HZ_TICK, NULL, ES_ENGINE);
-
-    if(s_num_60hz_ticks % 6 == 0)
-        E_Global_Notify(EVENT_10HZ_TICK, NULL, ES_ENGINE);
-
-    if(s_num_60hz_ticks % 60 == 0)
-        E_Global_Notify(EVENT_1HZ_TICK, NULL, ES_ENGINE);
+    for(int i = 0; i < ARR_SIZE(s_tick_events); i++) {
+        if(s_num_60hz_ticks % s_tick_events[i].period == s_tick_events[i].phase)
+            E_Global_Notify(s_tick_events[i].event, NULL, ES_ENGINE);
+    }
 }
 
 /*****************************************************************************/
@@ -121,6 +139,16 @@ bool G_Timer_Init(void)
     return true;
 }
 
+uint64_t G_Timer_SimTick(void)
+{
+    return s_num_sim_ticks;
+}
+
+uint32_t G_Timer_SimMillis(void)
+{
+    return (uint32_t)((s_num_sim_ticks * 1000) / 60);
+}
+
 void G_Timer_Shutdown(void)
 {
     E_Global_Unregister(EVENT_60HZ_TICK, timer_60hz_handler);
@@ -79,18 +79,26 @@ static size_t rw_vec_write(SDL_RWops *ctx, const void *ptr, size_t size, size_t
 {
     assert(ctx->type == SDL_RWOPS_VEC);
 
-    if(rw_vec_size(ctx) <= SEEK_IDX(ctx) + size * num
-    && !vec_uchar_resize(VEC(ctx), SEEK_IDX(ctx) + size * num)) {
-    
-        SDL_Error(SDL_EFWRITE);
-        return 0;
-    }
+    vec_uchar_t *vec = VEC(ctx);
+    size_t end = SEEK_IDX(ctx) + size * num;
+
+    if(vec->capacity < end) {
 
-    for(int i = 0; i < size * num; i++) {
-        vec_uchar_push(VEC(ctx), *((unsigned char*)ptr++));
+        size_t new_cap = vec->capacity ? vec->capacity : 256;
+        while(new_cap < end)
+            new_cap *= 2;
+
+        if(!vec_uchar_resize(vec, new_cap)) {
+            SDL_Error(SDL_EFWRITE);
+            return 0;
+        }
     }
 
-    ctx->hidden.unknown.data2 = (void*)(SEEK_IDX(ctx) + size * num);
+    memcpy(vec->array + SEEK_IDX(ctx), ptr, size * num);
+    if(end > vec->size)
+        vec->size = end;
+
+    ctx->hidden.unknown.data2 = (void*)end;
     return num;
 }
 
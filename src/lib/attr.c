@@ -43,12 +43,130 @@
 
 #define CHK_TRUE(_pred, _label) do{ if(!(_pred)) goto _label; }while(0)
 
+/* Binary records start with a byte that can never begin a line of a
+ * text record. This allows 'Attr_Parse' to consume both formats from 
+ * the same stream. The layout of a binary record is:
+ *
+ *     [magic:u8][type:u8][keylen:u8][key:keylen][payload]
+ *
+ * All multi-byte values are stored little-endian. Strings are prefixed 
+ * with a u16 length. 
+ */
+#define ATTR_BIN_MAGIC  (0xa7)
+#define ATTR_BIN_MAX    (3 + 64 + 2 + 256)
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static unsigned char *bin_put_f32(unsigned char *out, float val)
+{
+    Uint32 raw;
+    memcpy(&raw, &val, sizeof(raw));
+    raw = SDL_SwapLE32(raw);
+    memcpy(out, &raw, sizeof(raw));
+    return out + sizeof(raw);
+}
+
+static unsigned char *bin_put_i32(unsigned char *out, int val)
+{
+    Uint32 raw = SDL_SwapLE32((Uint32)val);
+    memcpy(out, &raw, sizeof(raw));
+    return out + sizeof(raw);
+}
+
+static bool bin_get_f32(SDL_RWops *stream, float *out)
+{
+    Uint32 raw;
+    if(!SDL_RWread(stream, &raw, sizeof(raw), 1))
+        return false;
+    raw = SDL_SwapLE32(raw);
+    memcpy(out, &raw, sizeof(raw));
+    return true;
+}
+
+static bool bin_get_f32s(SDL_RWops *stream, float *out, size_t n)
+{
+    for(int i = 0; i < n; i++) {
+        if(!bin_get_f32(stream, out + i))
+            return false;
+    }
+    return true;
+}
+
+static bool attr_parse_bin(SDL_RWops *stream, struct attr *out, bool named)
+{
+    Uint8 hdr[2];
+    CHK_TRUE(SDL_RWread(stream, hdr, sizeof(hdr), 1), fail);
+
+    Uint8 type = hdr[0], keylen = hdr[1];
+    CHK_TRUE(keylen < sizeof(out->key), fail);
+
+    if(keylen) {
+        CHK_TRUE(SDL_RWread(stream, out->key, keylen, 1), fail);
+    }
+    CHK_TRUE(!named || keylen > 0, fail);
+    out->key[keylen] = '\0';
+
+    switch(type) {
+    case TYPE_STRING: {
+        Uint16 len;
+        CHK_TRUE(SDL_RWread(stream, &len, sizeof(len), 1), fail);
+        len = SDL_SwapLE16(len);
+        CHK_TRUE(len < sizeof(out->val.as_string), fail);
+        if(len) {
+            CHK_TRUE(SDL_RWread(stream, out->val.as_string, len, 1), fail);
+        }
+        out->val.as_string[len] = '\0';
+        break;
+    }
+    case TYPE_FLOAT:
+        CHK_TRUE(bin_get_f32(stream, &out->val.as_float), fail);
+        break;
+    case TYPE_INT: {
+        Uint32 raw;
+        CHK_TRUE(SDL_RWread(stream, &raw, sizeof(raw), 1), fail);
+        out->val.as_int = (int)SDL_SwapLE32(raw);
+        break;
+    }
+    case TYPE_VEC2:
+        CHK_TRUE(bin_get_f32s(stream, out->val.as_vec2.raw, 2), fail);
+        break;
+    case TYPE_VEC3:
+        CHK_TRUE(bin_get_f32s(stream, out->val.as_vec3.raw, 3), fail);
+        break;
+    case TYPE_QUAT:
+        CHK_TRUE(bin_get_f32s(stream, out->val.as_quat.raw, 4), fail);
+        break;
+    case TYPE_BOOL: {
+        Uint8 raw;
+        CHK_TRUE(SDL_RWread(stream, &raw, sizeof(raw), 1), fail);
+        CHK_TRUE(raw == 0 || raw == 1, fail);
+        out->val.as_bool = raw;
+        break;
+    }
+    default: goto fail;
+    }
+
+    out->type = type;
+    return true;
+
+fail:
+    return false;
+}
+
 /*****************************************************************************/
 /* EXTERN FUNCTIONS                                                          */
 /*****************************************************************************/
 
 bool Attr_Parse(SDL_RWops *stream, struct attr *out, bool named)
 {
+    Uint8 first;
+    CHK_TRUE(SDL_RWread(stream, &first, 1, 1), fail);
+    if(first == ATTR_BIN_MAGIC)
+        return attr_parse_bin(stream, out, named);
+    CHK_TRUE(SDL_RWseek(stream, -1, RW_SEEK_CUR) >= 0, fail);
+
     char line[MAX_LINE_LEN];
     READ_LINE(stream, line, fail);
     char *saveptr;
@@ -139,77 +257,58 @@ fail:
 
 bool Attr_Write(SDL_RWops *stream, const struct attr *in, const char name[static 0])
 {
-    if(name) {
-        CHK_TRUE(SDL_RWwrite(stream, name, strlen(name), 1), fail);
-        CHK_TRUE(SDL_RWwrite(stream, " ", 1, 1), fail);
+    unsigned char buff[ATTR_BIN_MAX];
+    unsigned char *cursor = buff;
+
+    size_t keylen = name ? strlen(name) : 0;
+    CHK_TRUE(keylen < sizeof(in->key), fail);
+
+    *cursor++ = ATTR_BIN_MAGIC;
+    *cursor++ = in->type;
+    *cursor++ = keylen;
+    if(keylen) {
+        memcpy(cursor, name, keylen);
+        cursor += keylen;
     }
 
     switch(in->type) {
-    case TYPE_STRING:
-        CHK_TRUE(SDL_RWwrite(stream, "string ", strlen("string "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, in->val.as_string, strlen(in->val.as_string), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
-        break;
-    case TYPE_FLOAT: {
-        char buff[64];
-        pf_snprintf(buff, sizeof(buff), "%.6f", in->val.as_float);
-
-        CHK_TRUE(SDL_RWwrite(stream, "float ", strlen("float "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, buff, strlen(buff), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
+    case TYPE_STRING: {
+        size_t len = strlen(in->val.as_string);
+        CHK_TRUE(len < sizeof(in->val.as_string), fail);
+        Uint16 rawlen = SDL_SwapLE16((Uint16)len);
+        memcpy(cursor, &rawlen, sizeof(rawlen));
+        cursor += sizeof(rawlen);
+        memcpy(cursor, in->val.as_string, len);
+        cursor += len;
         break;
     }
-    case TYPE_INT: {
-        char buff[64];
-        pf_snprintf(buff, sizeof(buff), "%d", in->val.as_int);
-
-        CHK_TRUE(SDL_RWwrite(stream, "int ", strlen("int "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, buff, strlen(buff), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
+    case TYPE_FLOAT:
+        cursor = bin_put_f32(cursor, in->val.as_float);
         break;
-    }
-    case TYPE_VEC2: {
-        char buff[64];
-        pf_snprintf(buff, sizeof(buff), "%.6f %.6f", 
-            in->val.as_vec2.x, in->val.as_vec2.y);
-
-        CHK_TRUE(SDL_RWwrite(stream, "vec2 ", strlen("vec2 "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, buff, strlen(buff), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
+    case TYPE_INT:
+        cursor = bin_put_i32(cursor, in->val.as_int);
         break;
-    }
-    case TYPE_VEC3: {
-        char buff[64];
-        pf_snprintf(buff, sizeof(buff), "%.6f %.6f %.6f", 
-            in->val.as_vec3.x, in->val.as_vec3.y, in->val.as_vec3.z);
-
-        CHK_TRUE(SDL_RWwrite(stream, "vec3 ", strlen("vec3 "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, buff, strlen(buff), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
+    case TYPE_VEC2:
+        for(int i = 0; i < 2; i++)
+            cursor = bin_put_f32(cursor, in->val.as_vec2.raw[i]);
         break;
-    }
-    case TYPE_QUAT: {
-        char buff[64];
-        pf_snprintf(buff, sizeof(buff), "%.6f %.6f %.6f %.6f", 
-            in->val.as_quat.x, in->val.as_quat.y, in->val.as_quat.z, in->val.as_quat.w);
-
-        CHK_TRUE(SDL_RWwrite(stream, "quat ", strlen("quat "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, buff, strlen(buff), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
+    case TYPE_VEC3:
+        for(int i = 0; i < 3; i++)
+            cursor = bin_put_f32(cursor, in->val.as_vec3.raw[i]);
         break;
-    }
-    case TYPE_BOOL: {
-        char buff[64];
-        pf_snprintf(buff, sizeof(buff), "%d", (int)in->val.as_bool);
-
-        CHK_TRUE(SDL_RWwrite(stream, "bool ", strlen("bool "), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, buff, strlen(buff), 1), fail); 
-        CHK_TRUE(SDL_RWwrite(stream, "\n", 1, 1), fail); 
+    case TYPE_QUAT:
+        for(int i = 0; i < 4; i++)
+            cursor = bin_put_f32(cursor, in->val.as_quat.raw[i]);
+        break;
+    case TYPE_BOOL:
+        *cursor++ = !!in->val.as_bool;
         break;
-    }
     default: assert(0);
     }
 
+    /* Emit the whole record with a single write */
+    assert(cursor - buff <= sizeof(buff));
+    CHK_TRUE(SDL_RWwrite(stream, buff, cursor - buff, 1), fail);
     return true;
 
 fail:
@@ -0,0 +1,238 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#include "public/pf_lz.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+#define HASH_LOG        (14)
+#define MIN_MATCH       (4)
+#define MAX_OFFSET      (65535)
+/* The last bytes of the input are always emitted as literals */
+#define END_LITERALS    (5)
+#define RUN_MASK        (15)
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t ret;
+    memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+static uint32_t hash32(uint32_t seq)
+{
+    return (seq * 2654435761u) >> (32 - HASH_LOG);
+}
+
+static size_t len_bytes(size_t len)
+{
+    return (len >= RUN_MASK) ? ((len - RUN_MASK) / 255 + 1) : 0;
+}
+
+static uint8_t *put_len(uint8_t *op, size_t len)
+{
+    if(len < RUN_MASK)
+        return op;
+
+    len -= RUN_MASK;
+    while(len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static int get_len(const uint8_t **ip, const uint8_t *iend, size_t *inout)
+{
+    if(*inout != RUN_MASK)
+        return 1;
+
+    uint8_t b;
+    do{
+        if(*ip >= iend)
+            return 0;
+        b = *(*ip)++;
+        *inout += b;
+    }while(b == 255);
+    return 1;
+}
+
+static uint8_t *emit_seq(uint8_t *op, const uint8_t *oend, const uint8_t *lit, 
+                         size_t nlit, size_t offset, size_t mlen)
+{
+    size_t need = 1 + len_bytes(nlit) + nlit;
+    if(mlen)
+        need += 2 + len_bytes(mlen - MIN_MATCH);
+    if(need > (size_t)(oend - op))
+        return NULL;
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((nlit < RUN_MASK ? nlit : RUN_MASK) << 4);
+    op = put_len(op, nlit);
+    memcpy(op, lit, nlit);
+    op += nlit;
+
+    if(!mlen)
+        return op;
+
+    *op++ = (uint8_t)(offset & 0xff);
+    *op++ = (uint8_t)(offset >> 8);
+
+    size_t mcode = mlen - MIN_MATCH;
+    *token |= (uint8_t)(mcode < RUN_MASK ? mcode : RUN_MASK);
+    return put_len(op, mcode);
+}
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+size_t pf_lz_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t pf_lz_compress(const void *src, size_t size, void *dst, size_t cap)
+{
+    /* Holds the (1-based) input position of the last occurence of each hashed 
+     * 4-byte sequence. Zero denotes an empty slot. */
+    uint32_t table[1 << HASH_LOG];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t *const in = src;
+    const uint8_t *const end = in + size;
+    const uint8_t *ip = in, *anchor = in;
+    uint8_t *op = dst;
+    const uint8_t *const oend = op + cap;
+
+    if(size > UINT32_MAX - 1)
+        return 0;
+
+    if(size > MIN_MATCH + END_LITERALS) {
+
+        const uint8_t *const mflimit = end - END_LITERALS;
+        while(ip + MIN_MATCH <= mflimit) {
+
+            uint32_t seq = read32(ip);
+            uint32_t h = hash32(seq);
+            uint32_t ref_pos = table[h];
+            table[h] = (uint32_t)(ip - in) + 1;
+
+            const uint8_t *ref = in + ref_pos - 1;
+            if(!ref_pos || (ip - ref) > MAX_OFFSET || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            const uint8_t *mp = ip + MIN_MATCH, *rp = ref + MIN_MATCH;
+            while(mp < mflimit && *mp == *rp) {
+                mp++; 
+                rp++;
+            }
+
+            op = emit_seq(op, oend, anchor, ip - anchor, ip - ref, mp - ip);
+            if(!op)
+                return 0;
+            ip = anchor = mp;
+        }
+    }
+
+    op = emit_seq(op, oend, anchor, end - anchor, 0, 0);
+    if(!op)
+        return 0;
+    return op - (uint8_t*)dst;
+}
+
+size_t pf_lz_decompress(const void *src, size_t size, void *dst, size_t cap)
+{
+    const uint8_t *ip = src;
+    const uint8_t *const iend = ip + size;
+    uint8_t *const out = dst;
+    uint8_t *op = out;
+    const uint8_t *const oend = out + cap;
+
+    while(ip < iend) {
+
+        uint8_t token = *ip++;
+
+        size_t nlit = token >> 4;
+        if(!get_len(&ip, iend, &nlit))
+            return 0;
+        if(nlit > (size_t)(iend - ip) || nlit > (size_t)(oend - op))
+            return 0;
+
+        memcpy(op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+
+        /* The last sequence only holds literals */
+        if(ip == iend)
+            break;
+
+        if(iend - ip < 2)
+            return 0;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if(offset == 0 || offset > (size_t)(op - out))
+            return 0;
+
+        size_t mlen = token & RUN_MASK;
+        if(!get_len(&ip, iend, &mlen))
+            return 0;
+        mlen += MIN_MATCH;
+        if(mlen > (size_t)(oend - op))
+            return 0;
+
+        const uint8_t *match = op - offset;
+        if(offset >= mlen) {
+            memcpy(op, match, mlen);
+            op += mlen;
+        }else{
+            /* Overlapping copy: replicates the last 'offset' bytes */
+            while(mlen--)
+                *op++ = *match++;
+        }
+    }
+
+    return op - out;
+}
+
@@ -63,8 +63,11 @@ struct attr{
     }val;
 };
 
-/* 'named' attributes start with a single token for the name */
+/* 'named' attributes start with a single token for the name. Both the 
+ * text records (used by asset files) and the binary records produced by 
+ * 'Attr_Write' are accepted. */
 bool Attr_Parse(SDL_RWops *stream, struct attr *out, bool named);
+/* Writes a compact binary record. */
 bool Attr_Write(SDL_RWops *stream, const struct attr *in, const char name[static 0]);
 
 #endif
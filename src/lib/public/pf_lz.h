@@ -0,0 +1,59 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#ifndef PF_LZ_H
+#define PF_LZ_H
+
+#include <stddef.h>
+
+/* A small and fast LZ77-family block codec. The encoded stream is a sequence 
+ * of (literal run, back-reference) pairs, in the spirit of LZ4. It trades 
+ * compression ratio for speed and is meant for the (highly redundant) engine 
+ * session state. The functions are re-entrant and may be called from any thread.
+ */
+
+/* The worst-case size of the encoded output for an input of 'size' bytes */
+size_t pf_lz_bound(size_t size);
+
+/* Returns the number of bytes written to 'dst' or 0 on failure (when 'cap' 
+ * is not large enough to hold the output) */
+size_t pf_lz_compress(const void *src, size_t size, void *dst, size_t cap);
+
+/* Returns the number of bytes written to 'dst' or 0 if the input is malformed 
+ * or does not fit in 'cap' bytes */
+size_t pf_lz_decompress(const void *src, size_t size, void *dst, size_t cap);
+
+#endif
+
@@ -110,6 +110,8 @@
     scope void qt_##name##_clear(qt(name) *qt);                                                 \
     scope bool qt_##name##_insert(qt(name) *qt, float x, float y, type record);                 \
     scope bool qt_##name##_delete(qt(name) *qt, float x, float y, type record);                 \
+    scope bool qt_##name##_move(qt(name) *qt, float oldx, float oldy,                           \
+                                float newx, float newy, type record);                           \
     scope bool qt_##name##_delete_all(qt(name) *qt, float x, float y);                          \
     scope bool qt_##name##_find(qt(name) *qt, float x, float y, type *out, int maxout);         \
     scope bool qt_##name##_contains(qt(name) *qt, float x, float y);                            \
@@ -774,6 +776,32 @@
         return true;                                                                            \
     }                                                                                           \
                                                                                                 \
+    /* Move a record to a new position. When the new position lies in the region of */          \
+    /* the leaf node holding the record, the record is updated in place without */              \
+    /* having to restructure the tree. */                                                       \
+    scope bool qt_##name##_move(qt(name) *qt, float oldx, float oldy,                           \
+                                float newx, float newy, type record)                            \
+    {                                                                                           \
+        mp_ref_t curr_ref = _qt_##name##_find_leaf(qt, oldx, oldy);                             \
+        if(!curr_ref)                                                                           \
+            return false;                                                                       \
+                                                                                                \
+        qt_node(name) *curr_node = mp_##name##_entry(&qt->node_pool, curr_ref);                 \
+        if(curr_node->has_record                                                                \
+        && !curr_node->sibling_next                                                             \
+        && QT_EQ(curr_node->x, oldx) && QT_EQ(curr_node->y, oldy)                               \
+        && 0 == memcmp(&record, &curr_node->record, sizeof(record))                             \
+        && curr_ref == _qt_##name##_find_leaf(qt, newx, newy)) {                                \
+                                                                                                \
+            curr_node->x = newx;                                                                \
+            curr_node->y = newy;                                                                \
+            return true;                                                                        \
+        }                                                                                       \
+                                                                                                \
+        _CHK_TRUE_RET(qt_##name##_delete(qt, oldx, oldy, record), false);                       \
+        return qt_##name##_insert(qt, newx, newy, record);                                      \
+    }                                                                                           \
+                                                                                                \
     scope bool qt_##name##_delete_all(qt(name) *qt, float x, float y)                           \
     {                                                                                           \
         mp_ref_t curr_ref = _qt_##name##_find_leaf(qt, x, y);                                   \
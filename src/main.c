@@ -50,6 +50,7 @@
 #include "settings.h"
 #include "session.h"
 #include "perf.h"
+#include "worker.h"
 
 #include <stdbool.h>
 #include <assert.h>
@@ -296,9 +297,32 @@ fail_load_image:
     SDL_DestroyRenderer(sw_renderer);
 }
 
+static bool perf_enabled_validate(const struct sval *new_val)
+{
+    return (new_val->type == ST_TYPE_BOOL);
+}
+
+static void perf_enabled_commit(const struct sval *new_val)
+{
+    Perf_SetEnabled(new_val->as_bool);
+}
+
+static bool spike_threshold_validate(const struct sval *new_val)
+{
+    return (new_val->type == ST_TYPE_INT && new_val->as_int >= 0);
+}
+
+static void spike_threshold_commit(const struct sval *new_val)
+{
+    Perf_SetSpikeThreshold(new_val->as_int);
+}
+
 static void engine_create_settings(void)
 {
-    ss_e status = Settings_Create((struct setting){
+    ss_e status;
+    (void)status;
+
+    status = Settings_Create((struct setting){
         .name = "pf.debug.paused_frame_step_enabled",
         .val = (struct sval) {
             .type = ST_TYPE_BOOL,
@@ -309,6 +333,32 @@ static void engine_create_settings(void)
         .commit = frame_step_commit,
     });
     assert(status == SS_OKAY);
+
+    status = Settings_Create((struct setting){
+        .name = "pf.debug.profiling_enabled",
+        .val = (struct sval) {
+            .type = ST_TYPE_BOOL,
+            .as_bool = Perf_Enabled()
+        },
+        .prio = 0,
+        .validate = perf_enabled_validate,
+        .commit = perf_enabled_commit,
+    });
+    assert(status == SS_OKAY);
+
+    /* Frames taking longer than this many milliseconds will have their 
+     * perf trees saved. A value of 0 disables the spike capture. */
+    status = Settings_Create((struct setting){
+        .name = "pf.debug.perf_spike_threshold_ms",
+        .val = (struct sval) {
+            .type = ST_TYPE_INT,
+            .as_int = 0
+        },
+        .prio = 0,
+        .validate = spike_threshold_validate,
+        .commit = spike_threshold_commit,
+    });
+    assert(status == SS_OKAY);
 }
 
 static bool engine_init(char **argv)
@@ -361,13 +411,17 @@ static bool engine_init(char **argv)
         extra_flags = setting.as_bool ? SDL_WINDOW_ALWAYS_ON_TOP : 0;
     }
 
+#if !defined(PF_NULL_RENDER)
+    extra_flags |= SDL_WINDOW_OPENGL;
+#endif
+
     s_window = SDL_CreateWindow(
         "Permafrost Engine",
         SDL_WINDOWPOS_UNDEFINED, 
         SDL_WINDOWPOS_UNDEFINED,
         res[0], 
         res[1], 
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | wf | extra_flags);
+        SDL_WINDOW_SHOWN | wf | extra_flags);
 
     early_loading_screen();
     stbi_set_flip_vertically_on_load(true);
@@ -401,6 +455,11 @@ static bool engine_init(char **argv)
     Perf_RegisterThread(g_main_thread_id, "main");
     Perf_RegisterThread(g_render_thread_id, "render");
 
+    if(!Worker_Init()) {
+        fprintf(stderr, "Failed to initialize worker threads.\n");
+        goto fail_worker;
+    }
+
     if(!AL_Init()) {
         fprintf(stderr, "Failed to initialize asset-loading module.\n");
         goto fail_al;
@@ -464,6 +523,8 @@ fail_render:
 fail_cursor:
     AL_Shutdown();
 fail_al:
+    Worker_Shutdown();
+fail_worker:
 fail_render_init:
     render_thread_quit();
 fail_rthread:
@@ -481,6 +542,7 @@ fail_perf:
 
 static void engine_shutdown(void)
 {
+    Session_Shutdown();
     S_Shutdown();
     UI_Shutdown();
 
@@ -502,6 +564,7 @@ static void engine_shutdown(void)
     Cursor_FreeAll();
     AL_Shutdown();
     E_Shutdown();
+    Worker_Shutdown();
     Perf_Shutdown();
 
     vec_event_destroy(&s_prev_tick_events);
@@ -541,12 +604,17 @@ void Engine_SetDispMode(enum pf_window_flags wf)
 
 void Engine_WinDrawableSize(int *out_w, int *out_h)
 {
+#if defined(PF_NULL_RENDER)
+    SDL_GetWindowSize(s_window, out_w, out_h);
+#else
     SDL_GL_GetDrawableSize(s_window, out_w, out_h);
+#endif
 }
 
 void Engine_FlushRenderWorkQueue(void)
 {
     assert(g_frame_idx == 0);
+    R_EndFrameCmds();
     G_SwapBuffers();
 
     render_thread_start_work();
@@ -562,6 +630,13 @@ void Engine_WaitRenderWorkDone(void)
         PERF_RETURN_VOID();
     }
 
+    /* In the pipelined mode, the render thread only signals 'done' at the end of 
+     * the frame. Wait for it to catch up with the commands issued so far instead. */
+    if(R_Pipelined()) {
+        R_WaitCmdsDrained();
+        PERF_RETURN_VOID();
+    }
+
     /* Wait for the render thread to finish, but don't yet clear/ack the 'done' flag */
     SDL_LockMutex(s_rstate.done_lock);
     while(!s_rstate.done) {
@@ -622,11 +697,13 @@ int main(int argc, char **argv)
     G_Update();
     G_Render();
     UI_Render();
+    R_EndFrameCmds();
     G_SwapBuffers();
     Perf_FinishTick();
 
     while(!s_quit) {
 
+        R_SyncFrameMode();
         Perf_BeginTick();
         enum simstate curr_ss = G_GetSimState();
         bool prev_step_frame = s_step_frame;
@@ -637,6 +714,7 @@ int main(int argc, char **argv)
         }
 
         render_thread_start_work();
+        uint64_t sim_begin = SDL_GetPerformanceCounter();
 
         process_sdl_events();
         E_ServiceQueue();
@@ -645,6 +723,10 @@ int main(int argc, char **argv)
         G_Render();
         UI_Render();
 
+        uint64_t sim_end = SDL_GetPerformanceCounter();
+        Perf_RecordTime(PERF_HIST_SIM, (sim_end - sim_begin) * 1000000 / SDL_GetPerformanceFrequency());
+
+        R_EndFrameCmds();
         wait_render_work_done();
 
         G_SwapBuffers();
@@ -657,6 +739,7 @@ int main(int argc, char **argv)
 
         ++g_frame_idx;
     }
+    R_DisablePipelining();
 
     ss_e status;
     if((status = Settings_SaveToFile()) != SS_OKAY) {
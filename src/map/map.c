@@ -131,14 +131,7 @@ void M_RenderEntireMap(const struct map *map, bool shadows, enum render_pass pas
             });
             break;
         case RENDER_PASS_REGULAR:
-            R_PushCmd((struct rcmd){
-                .func = R_GL_Draw,
-                .nargs = 2,
-                .args = {
-                    chunk->render_private,
-                    R_PushArg(&chunk_model, sizeof(chunk_model)),
-                },
-            });
+            R_PushDraw(chunk->render_private, &chunk_model);
             break;
         default: assert(0);
         }
@@ -193,14 +186,7 @@ void M_RenderVisibleMap(const struct map *map, const struct camera *cam,
             });
             break;
         case RENDER_PASS_REGULAR:
-            R_PushCmd((struct rcmd){
-                .func = R_GL_Draw,
-                .nargs = 2,
-                .args = {
-                    chunk->render_private,
-                    R_PushArg(&chunk_model, sizeof(chunk_model)),
-                },
-            });
+            R_PushDraw(chunk->render_private, &chunk_model);
             break;
         default: assert(0);
         }
@@ -356,33 +342,46 @@ vec2_t M_ClampedMapCoordinate(const struct map *map, vec2_t xz)
     return (vec2_t){x, z};
 }
 
+float M_HeightsAtPos(const struct tile_heights *th, float frac_width, float frac_height)
+{
+    switch(th->kind) {
+    case HEIGHT_FLAT:
+        return th->nw;
+    case HEIGHT_BILINEAR:
+        return PFM_BilinearInterp(th->nw, th->sw, th->ne, th->se, 
+            0.0f, 1.0f, 0.0f, 1.0f, frac_width, frac_height);
+    case HEIGHT_SPLIT_NW_SE:
+        if(frac_width >= frac_height)
+            return th->nw + (th->ne - th->nw) * frac_width + (th->se - th->ne) * frac_height;
+        return th->nw + (th->sw - th->nw) * frac_height + (th->se - th->sw) * frac_width;
+    case HEIGHT_SPLIT_NE_SW:
+        if(frac_width + frac_height <= 1.0f)
+            return th->nw + (th->ne - th->nw) * frac_width + (th->sw - th->nw) * frac_height;
+        return th->se + (th->se - th->sw) * (frac_width - 1.0f) + (th->se - th->ne) * (frac_height - 1.0f);
+    default: 
+        assert(0);
+        return 0.0f;
+    }
+}
+
 float M_HeightAtPoint(const struct map *map, vec2_t xz)
 {
     assert(M_PointInsideMap(map, xz));
 
-    float x = xz.raw[0];
-    float z = xz.raw[1];
+    const int nrows = map->height * TILES_PER_CHUNK_HEIGHT;
+    const int ncols = map->width * TILES_PER_CHUNK_WIDTH;
 
-    int chunk_r, chunk_c;
-    chunk_r = CLAMP( (z - map->pos.z) / (TILES_PER_CHUNK_HEIGHT * Z_COORDS_PER_TILE), 0, map->height-1);
-    chunk_c = CLAMP(-(x - map->pos.x) / (TILES_PER_CHUNK_WIDTH  * X_COORDS_PER_TILE), 0, map->width-1);
+    /* Recall X increases to the left in our engine */
+    float fr =  (xz.raw[1] - map->pos.z) / Z_COORDS_PER_TILE;
+    float fc = -(xz.raw[0] - map->pos.x) / X_COORDS_PER_TILE;
 
-    float chunk_off_r = fmod(z - map->pos.z, TILES_PER_CHUNK_HEIGHT * Z_COORDS_PER_TILE);
-    float chunk_off_c = fmod(-(x - map->pos.x), TILES_PER_CHUNK_WIDTH  * X_COORDS_PER_TILE);
-    assert(chunk_off_r >= 0 && chunk_off_c >= 0);
+    int r = CLAMP((int)fr, 0, nrows-1);
+    int c = CLAMP((int)fc, 0, ncols-1);
 
-    int tile_r, tile_c;    
-    tile_r = CLAMP(chunk_off_r / Z_COORDS_PER_TILE, 0, TILES_PER_CHUNK_HEIGHT-1);
-    tile_c = CLAMP(chunk_off_c / X_COORDS_PER_TILE, 0, TILES_PER_CHUNK_WIDTH-1);
-    
-    float tile_frac_width, tile_frac_height;
-    tile_frac_width =  fmod(chunk_off_c, X_COORDS_PER_TILE) / X_COORDS_PER_TILE;
-    tile_frac_height = fmod(chunk_off_r, Z_COORDS_PER_TILE) / Z_COORDS_PER_TILE;
-    assert(tile_frac_width >= 0.0f && tile_frac_width <= 1.0f);
-    assert(tile_frac_height >= 0.0f && tile_frac_height <= 1.0f);
+    float x = CLAMP(fc - c, 0.0f, 1.0f);
+    float z = CLAMP(fr - r, 0.0f, 1.0f);
 
-    const struct tile *tile = &map->chunks[chunk_r * map->width + chunk_c].tiles[tile_r * TILES_PER_CHUNK_WIDTH + tile_c];
-    return M_Tile_HeightAtPos(tile, tile_frac_width, tile_frac_height);
+    return M_HeightsAtPos(&map->heights[r * ncols + c], x, z);
 }
 
 bool M_DescForPoint2D(const struct map *map, vec2_t point_xz, struct tile_desc *out)
@@ -544,6 +543,16 @@ void M_NavBlockersDecref(vec2_t xz_pos, float range, const struct map *map)
     N_BlockersDecref(xz_pos, range, map->pos, map->nav_private);
 }
 
+void M_NavCombatableTouched(const struct map *map, vec2_t xz_pos)
+{
+    N_CombatableTouched(xz_pos, map->pos, map->nav_private);
+}
+
+void M_NavCombatableMoved(const struct map *map, vec2_t xz_old, vec2_t xz_new)
+{
+    N_CombatableMoved(xz_old, xz_new, map->pos, map->nav_private);
+}
+
 bool M_TileForDesc(const struct map *map, struct tile_desc desc, struct tile **out)
 {
     if(desc.chunk_r < 0 || desc.chunk_r >= map->height)
@@ -568,6 +577,13 @@ void M_GetResolution(const struct map *map, struct map_resolution *out)
     out->tile_h = TILES_PER_CHUNK_HEIGHT;
 }
 
+const void *M_GetChunkRenderPrivate(const struct map *map, int chunk_r, int chunk_c)
+{
+    assert(chunk_r >= 0 && chunk_r < map->height);
+    assert(chunk_c >= 0 && chunk_c < map->width);
+    return map->chunks[chunk_r * map->width + chunk_c].render_private;
+}
+
 void M_SetShadowsEnabled(struct map *map, bool on)
 {
     for(int r = 0; r < map->height; r++) {
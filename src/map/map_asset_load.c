@@ -46,6 +46,7 @@
 #include "../ui.h"
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <assert.h>
 #include <string.h>
 
@@ -54,6 +55,7 @@
 #define MINIMAP_DFLT_SZ (256)
 #define PFMAP_VER       (1.0f)
 #define CHK_TRUE(_pred, _label) do{ if(!(_pred)) goto _label; }while(0)
+#define MAX(a, b)       ((a) > (b) ? (a) : (b))
 
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
@@ -194,6 +196,120 @@ static void m_al_patch_adjacency_info(struct map *map)
     }}
 }
 
+static size_t m_al_heights_size(size_t nrows, size_t ncols)
+{
+    const int tile_rows = nrows * TILES_PER_CHUNK_HEIGHT;
+    const int tile_cols = ncols * TILES_PER_CHUNK_WIDTH;
+    size_t ret = sizeof(struct tile_heights) * tile_rows * tile_cols;
+
+    for(int lvl = 0; lvl < MAX_HEIGHT_MIPS; lvl++) {
+
+        ret += sizeof(float) * HEIGHT_MIP_DIM(tile_rows, lvl) * HEIGHT_MIP_DIM(tile_cols, lvl);
+        if(HEIGHT_MIP_DIM(tile_rows, lvl) == 1 && HEIGHT_MIP_DIM(tile_cols, lvl) == 1)
+            break;
+    }
+    return ret;
+}
+
+static void m_al_update_height_mips(struct map *map, int r, int c)
+{
+    const int tile_rows = map->height * TILES_PER_CHUNK_HEIGHT;
+    const int tile_cols = map->width * TILES_PER_CHUNK_WIDTH;
+
+    const struct tile_heights *th = &map->heights[r * tile_cols + c];
+    map->height_mips[0][r * tile_cols + c] = MAX(MAX(th->nw, th->ne), MAX(th->sw, th->se));
+
+    for(int lvl = 1; lvl < map->num_height_mips; lvl++) {
+
+        const int src_rows = HEIGHT_MIP_DIM(tile_rows, lvl - 1);
+        const int src_cols = HEIGHT_MIP_DIM(tile_cols, lvl - 1);
+        const float *src = map->height_mips[lvl - 1];
+
+        r /= 2;
+        c /= 2;
+
+        float max = src[(2 * r) * src_cols + (2 * c)];
+        if(2 * c + 1 < src_cols)
+            max = MAX(max, src[(2 * r) * src_cols + (2 * c + 1)]);
+        if(2 * r + 1 < src_rows)
+            max = MAX(max, src[(2 * r + 1) * src_cols + (2 * c)]);
+        if(2 * r + 1 < src_rows && 2 * c + 1 < src_cols)
+            max = MAX(max, src[(2 * r + 1) * src_cols + (2 * c + 1)]);
+
+        map->height_mips[lvl][r * HEIGHT_MIP_DIM(tile_cols, lvl) + c] = max;
+    }
+}
+
+static void m_al_update_heights(struct map *map, const struct tile_desc *desc)
+{
+    const struct tile *tile = &map->chunks[desc->chunk_r * map->width + desc->chunk_c]
+        .tiles[desc->tile_r * TILES_PER_CHUNK_WIDTH + desc->tile_c];
+    int r = desc->chunk_r * TILES_PER_CHUNK_HEIGHT + desc->tile_r;
+    int c = desc->chunk_c * TILES_PER_CHUNK_WIDTH + desc->tile_c;
+
+    struct tile_heights *out = &map->heights[r * (map->width * TILES_PER_CHUNK_WIDTH) + c];
+    out->nw = M_Tile_NWHeight(tile) * Y_COORDS_PER_TILE;
+    out->ne = M_Tile_NEHeight(tile) * Y_COORDS_PER_TILE;
+    out->sw = M_Tile_SWHeight(tile) * Y_COORDS_PER_TILE;
+    out->se = M_Tile_SEHeight(tile) * Y_COORDS_PER_TILE;
+
+    switch(tile->type) {
+    case TILETYPE_FLAT:
+        out->kind = HEIGHT_FLAT;
+        break;
+    case TILETYPE_CORNER_CONVEX_NE:
+    case TILETYPE_CORNER_CONCAVE_NE:
+    case TILETYPE_CORNER_CONVEX_SW:
+    case TILETYPE_CORNER_CONCAVE_SW: 
+        out->kind = HEIGHT_SPLIT_NW_SE;
+        break;
+    case TILETYPE_CORNER_CONVEX_NW:
+    case TILETYPE_CORNER_CONCAVE_NW:
+    case TILETYPE_CORNER_CONVEX_SE:
+    case TILETYPE_CORNER_CONCAVE_SE:
+        out->kind = HEIGHT_SPLIT_NE_SW;
+        break;
+    default:
+        assert(TILETYPE_IS_RAMP(tile->type));
+        out->kind = HEIGHT_BILINEAR;
+    }
+}
+
+static void m_al_init_heights(struct map *map, void *buff)
+{
+    const int tile_rows = map->height * TILES_PER_CHUNK_HEIGHT;
+    const int tile_cols = map->width * TILES_PER_CHUNK_WIDTH;
+    char *base = buff;
+
+    map->heights = (void*)base;
+    base += sizeof(struct tile_heights) * tile_rows * tile_cols;
+
+    map->num_height_mips = 0;
+    for(int lvl = 0; lvl < MAX_HEIGHT_MIPS; lvl++) {
+
+        map->height_mips[lvl] = (void*)base;
+        map->num_height_mips++;
+        base += sizeof(float) * HEIGHT_MIP_DIM(tile_rows, lvl) * HEIGHT_MIP_DIM(tile_cols, lvl);
+
+        if(HEIGHT_MIP_DIM(tile_rows, lvl) == 1 && HEIGHT_MIP_DIM(tile_cols, lvl) == 1)
+            break;
+    }
+    assert(base == (char*)buff + m_al_heights_size(map->height, map->width));
+
+    for(int r = 0; r < map->height; r++) {
+    for(int c = 0; c < map->width;  c++) {
+
+        for(int tile_r = 0; tile_r < TILES_PER_CHUNK_HEIGHT; tile_r++) {
+        for(int tile_c = 0; tile_c < TILES_PER_CHUNK_WIDTH;  tile_c++) {
+
+            struct tile_desc desc = (struct tile_desc){r, c, tile_r, tile_c};
+            m_al_update_heights(map, &desc);
+            m_al_update_height_mips(map, r * TILES_PER_CHUNK_HEIGHT + tile_r,
+                                    c * TILES_PER_CHUNK_WIDTH + tile_c);
+        }}
+    }}
+}
+
 static void set_minimap_defaults(struct map *map)
 {
     map->minimap_vres = (vec2_t){1920, 1080};
@@ -273,6 +389,9 @@ bool M_AL_InitMapFromStream(const struct pfmap_hdr *header, const char *basedir,
 
     m_al_patch_adjacency_info(map);
 
+    m_al_init_heights(map, unused_base);
+    unused_base += m_al_heights_size(map->height, map->width);
+
     /* Build navigation grid */
     const struct tile *chunk_tiles[map->width * map->height];
 
@@ -295,7 +414,8 @@ size_t M_AL_BuffSizeFromHeader(const struct pfmap_hdr *header)
 
     return sizeof(struct map) + num_chunks * 
            (sizeof(struct pfchunk) + R_AL_PrivBuffSizeForChunk(
-                                     TILES_PER_CHUNK_WIDTH, TILES_PER_CHUNK_HEIGHT, 0));
+                                     TILES_PER_CHUNK_WIDTH, TILES_PER_CHUNK_HEIGHT, 0))
+         + m_al_heights_size(header->num_rows, header->num_cols);
 }
 
 bool M_AL_UpdateTile(struct map *map, const struct tile_desc *desc, const struct tile *tile)
@@ -305,6 +425,9 @@ bool M_AL_UpdateTile(struct map *map, const struct tile_desc *desc, const struct
 
     struct pfchunk *chunk = &map->chunks[desc->chunk_r * map->width + desc->chunk_c];
     chunk->tiles[desc->tile_r * TILES_PER_CHUNK_WIDTH + desc->tile_c] = *tile;
+    m_al_update_heights(map, desc);
+    m_al_update_height_mips(map, desc->chunk_r * TILES_PER_CHUNK_HEIGHT + desc->tile_r,
+                            desc->chunk_c * TILES_PER_CHUNK_WIDTH + desc->tile_c);
 
     struct map_resolution res;
     M_GetResolution(map, &res);
@@ -342,12 +465,26 @@ void M_AL_FreePrivate(struct map *map)
 size_t M_AL_ShallowCopySize(size_t nrows, size_t ncols)
 {
 	size_t nchunks = nrows * ncols;
-    return sizeof(struct map) + nchunks * sizeof(struct pfchunk);
+    return sizeof(struct map) + nchunks * sizeof(struct pfchunk)
+         + m_al_heights_size(nrows, ncols);
 }
 
 void M_AL_ShallowCopy(struct map *dst, const struct map *src)
 {
-    memcpy(dst, src, M_AL_ShallowCopySize(src->width, src->height));
+    size_t nchunks = src->height * src->width;
+    memcpy(dst, src, sizeof(struct map) + nchunks * sizeof(struct pfchunk));
+
+    /* The heights and their mip levels are read by the render thread, so 
+     * they have to be copied into the destination buffer, right after the 
+     * chunks. The mip levels follow the heights in one contiguous block. */
+    char *heights = (char*)(dst->chunks + nchunks);
+    memcpy(heights, src->heights, m_al_heights_size(src->height, src->width));
+    dst->heights = (void*)heights;
+
+    for(int lvl = 0; lvl < src->num_height_mips; lvl++) {
+        ptrdiff_t off = (char*)src->height_mips[lvl] - (char*)src->heights;
+        dst->height_mips[lvl] = (void*)(heights + off);
+    }
 }
 
 bool M_AL_WritePFMap(const struct map *map, SDL_RWops *stream)
@@ -42,6 +42,24 @@
 #define MAX_NUM_MATS (256)
 
 
+#define MAX_HEIGHT_MIPS        (16)
+#define HEIGHT_MIP_DIM(n, lvl) (((n) + (1 << (lvl)) - 1) >> (lvl))
+
+enum height_kind{
+    HEIGHT_FLAT,
+    HEIGHT_BILINEAR,
+    /* Corner tiles are made up of two triangles. The split is along the
+     * diagonal between the named corners. */
+    HEIGHT_SPLIT_NW_SE,
+    HEIGHT_SPLIT_NE_SW,
+};
+
+/* The worldspace corner heights of a single tile's top face */
+struct tile_heights{
+    float   nw, ne, sw, se;
+    uint8_t kind;
+};
+
 struct map{
     /* ------------------------------------------------------------------------
      * Map dimensions in numbers of chunks.
@@ -80,6 +98,23 @@ struct map{
      * ------------------------------------------------------------------------
      */
     void *nav_private;
+    /* ------------------------------------------------------------------------
+     * The corner heights of every tile on the map, stored in row-major order 
+     * with (width * TILES_PER_CHUNK_WIDTH) tiles per row. These are derived 
+     * from the tiles and allow answering height queries without the 
+     * per-tile slope math. Lives in the same buffer as the map.
+     * ------------------------------------------------------------------------
+     */
+    struct tile_heights *heights;
+    /* ------------------------------------------------------------------------
+     * Max-height mip pyramid over 'heights'. Level 0 holds the highest point
+     * of every tile and each following level holds the maximum of 2x2 
+     * blocks of the level below, down to a single value. Used for skipping
+     * over large areas of the map when raycasting against the terrain.
+     * ------------------------------------------------------------------------
+     */
+    int                  num_height_mips;
+    float               *height_mips[MAX_HEIGHT_MIPS];
     /* ------------------------------------------------------------------------
      * Save the materials information read from the source PFMap file. This is 
      * used when saving to a new PFMAp file.
@@ -99,6 +134,7 @@ struct chunkpos{
     int r, c;
 };
 
-void M_ModelMatrixForChunk(const struct map *map, struct chunkpos p, mat4x4_t *out);
+void  M_ModelMatrixForChunk(const struct map *map, struct chunkpos p, mat4x4_t *out);
+float M_HeightsAtPos(const struct tile_heights *th, float frac_width, float frac_height);
 
 #endif
@@ -294,6 +294,15 @@ vec2_t M_NavClosestReachableDest(const struct map *map, vec2_t xz_src, vec2_t xz
 void   M_NavBlockersIncref(vec2_t xz_pos, float range, const struct map *map);
 void   M_NavBlockersDecref(vec2_t xz_pos, float range, const struct map *map);
 
+/* ------------------------------------------------------------------------
+ * Notify the navigation subsystem that a combatable entity has been added
+ * to or removed from the map (Touched), or that it has changed position 
+ * (Moved). This is used for keeping the enemy seek fields up to date.
+ * ------------------------------------------------------------------------
+ */
+void   M_NavCombatableTouched(const struct map *map, vec2_t xz_pos);
+void   M_NavCombatableMoved(const struct map *map, vec2_t xz_old, vec2_t xz_new);
+
 /* ------------------------------------------------------------------------
  * Wrapper around navigation APIs.
  * ------------------------------------------------------------------------
@@ -315,6 +324,12 @@ bool   M_TileForDesc(const struct map *map, struct tile_desc desc, struct tile *
  */
 void   M_GetResolution(const struct map *map, struct map_resolution *out);
 
+/* ------------------------------------------------------------------------
+ * Get the render-private data of the chunk at the specified coordinates.
+ * ------------------------------------------------------------------------
+ */
+const void *M_GetChunkRenderPrivate(const struct map *map, int chunk_r, int chunk_c);
+
 /* ------------------------------------------------------------------------
  * Enable or disable rendering shadows on the map.
  * ------------------------------------------------------------------------
@@ -40,7 +40,6 @@
 #include "../pf_math.h"
 #include "../camera.h"
 #include "../config.h"
-#include "../collision.h"
 #include "../main.h"
 
 #include "../render/public/render.h"
@@ -50,13 +49,18 @@
 #include <SDL.h>
 #include <assert.h>
 #include <string.h>
+#include <float.h>
 
 
-#define MAX_CANDIDATE_TILES 256
+#define MIN(a, b)           ((a) < (b) ? (a) : (b))
+#define MAX(a, b)           ((a) > (b) ? (a) : (b))
+#define CLAMP(a, min, max)  (MIN(MAX((a), (min)), (max)))
+#define EPSILON             (1.0f / 1024)
+#define HEIGHT_EPSILON      (1.0f / 64)
 
-struct ray{
-    vec3_t origin;
-    vec3_t dir;
+/* y = a + b * frac_width + c * frac_height */
+struct plane_eq{
+    float a, b, c;
 };
 
 struct rc_ctx{
@@ -81,31 +85,168 @@ static struct rc_ctx s_ctx;
 /* STATIC FUNCTIONS                                                          */
 /*****************************************************************************/
 
-struct aabb aabb_for_tile(struct tile_desc desc, const struct map *map)
+static int rc_tile_planes(const struct tile_heights *th, struct plane_eq out[2])
 {
-    assert(map);
-    assert(desc.chunk_r >= 0 && desc.chunk_r < map->height);
-    assert(desc.chunk_c >= 0 && desc.chunk_c < map->width);
-    assert(desc.tile_r >= 0  && desc.tile_r < TILES_PER_CHUNK_HEIGHT);
-    assert(desc.tile_c >= 0  && desc.tile_c < TILES_PER_CHUNK_HEIGHT);
-
-    const struct pfchunk *chunk = &map->chunks[desc.chunk_r * map->width + desc.chunk_c];
-    const struct tile *tile = &chunk->tiles[desc.tile_r * TILES_PER_CHUNK_WIDTH + desc.tile_c];
-
-    struct map_resolution res = {
-        map->width, map->height,
-        TILES_PER_CHUNK_WIDTH, TILES_PER_CHUNK_HEIGHT
-    };
-    struct box tile_bounds = M_Tile_Bounds(res, map->pos, desc);
-
-    return (struct aabb) {
-        .x_min = tile_bounds.x - tile_bounds.width,
-        .x_max = tile_bounds.x,
-        .y_min = -TILE_DEPTH * Y_COORDS_PER_TILE,
-        .y_max = (tile->base_height + (tile->type == TILETYPE_FLAT ? 0 : tile->ramp_height)) * Y_COORDS_PER_TILE,
-        .z_min = tile_bounds.z,
-        .z_max = tile_bounds.z + tile_bounds.height,
+    switch(th->kind) {
+    case HEIGHT_FLAT:
+        out[0] = (struct plane_eq){th->nw, 0.0f, 0.0f};
+        return 1;
+    case HEIGHT_BILINEAR:
+        /* Ramps are planar */
+        out[0] = (struct plane_eq){th->nw, th->ne - th->nw, th->sw - th->nw};
+        return 1;
+    case HEIGHT_SPLIT_NW_SE:
+        out[0] = (struct plane_eq){th->nw, th->ne - th->nw, th->se - th->ne};
+        out[1] = (struct plane_eq){th->nw, th->se - th->sw, th->sw - th->nw};
+        return 2;
+    case HEIGHT_SPLIT_NE_SW:
+        out[0] = (struct plane_eq){th->nw, th->ne - th->nw, th->sw - th->nw};
+        out[1] = (struct plane_eq){th->ne + th->sw - th->se, th->se - th->sw, th->se - th->ne};
+        return 2;
+    default: 
+        assert(0);
+        return 0;
+    }
+}
+
+/* Narrow the [tmin, tmax] range to the part where 'p0 + dp * t' is within [lo, hi] */
+static bool rc_clip_slab(float p0, float dp, float lo, float hi, 
+                         float *inout_tmin, float *inout_tmax)
+{
+    if(dp == 0.0f)
+        return (p0 >= lo && p0 <= hi);
+
+    float t1 = (lo - p0) / dp;
+    float t2 = (hi - p0) / dp;
+
+    *inout_tmin = MAX(*inout_tmin, MIN(t1, t2));
+    *inout_tmax = MIN(*inout_tmax, MAX(t1, t2));
+    return (*inout_tmin <= *inout_tmax);
+}
+
+/* Intersect the ray with the column of terrain under a single tile. The top 
+ * face is made up of at most two planar triangles, so the intersection can be
+ * found analytically rather than by testing against the tile's render mesh. 
+ */
+static bool rc_intersect_tile(const struct map *map, int r, int c, 
+                              vec3_t origin, vec3_t dir, float *out_t)
+{
+    const int tile_cols = map->width * TILES_PER_CHUNK_WIDTH;
+    const struct tile_heights *th = &map->heights[r * tile_cols + c];
+
+    /* Work in the tile's local coordinates, where the top face spans [0, 1] 
+     * in both dimensions. */
+    float u0 =  (map->pos.x - origin.x) / X_COORDS_PER_TILE - c;
+    float v0 =  (origin.z - map->pos.z) / Z_COORDS_PER_TILE - r;
+    float du = -dir.x / X_COORDS_PER_TILE;
+    float dv =  dir.z / Z_COORDS_PER_TILE;
+
+    float t_in = 0.0f, t_out = FLT_MAX;
+    if(!rc_clip_slab(u0, du, 0.0f, 1.0f, &t_in, &t_out)
+    || !rc_clip_slab(v0, dv, 0.0f, 1.0f, &t_in, &t_out))
+        return false;
+
+    /* A ray entering the column below the top face hits one of the side faces */
+    float y_in = origin.y + dir.y * t_in;
+    float u_in = CLAMP(u0 + du * t_in, 0.0f, 1.0f);
+    float v_in = CLAMP(v0 + dv * t_in, 0.0f, 1.0f);
+
+    if(y_in <= M_HeightsAtPos(th, u_in, v_in)) {
+
+        if(y_in < -TILE_DEPTH * Y_COORDS_PER_TILE)
+            return false;
+        *out_t = t_in;
+        return true;
+    }
+
+    struct plane_eq planes[2];
+    int nplanes = rc_tile_planes(th, planes);
+    bool hit = false;
+
+    for(int i = 0; i < nplanes; i++) {
+
+        const struct plane_eq *p = &planes[i];
+        float denom = dir.y - p->b * du - p->c * dv;
+        if(fabsf(denom) < EPSILON)
+            continue;
+
+        float t = (p->a + p->b * u0 + p->c * v0 - origin.y) / denom;
+        if(t < t_in || t > t_out)
+            continue;
+
+        /* Make sure the point is on the part of the top face that this 
+         * plane is actually the surface of */
+        float u = CLAMP(u0 + du * t, 0.0f, 1.0f);
+        float v = CLAMP(v0 + dv * t, 0.0f, 1.0f);
+        if(fabsf(M_HeightsAtPos(th, u, v) - (origin.y + dir.y * t)) > HEIGHT_EPSILON)
+            continue;
+
+        t_out = t;
+        hit = true;
+    }
+
+    *out_t = t_out;
+    return hit;
+}
+
+/* Walk the height mip pyramid, only descending into the blocks whose bounds 
+ * (from the bottom of the terrain up to their maximum height) are hit by 
+ * the ray before the closest intersection found so far ('inout_t').
+ */
+static bool rc_intersect_node(const struct map *map, int lvl, int r, int c, 
+                              vec3_t origin, vec3_t dir, float *inout_t, int *out_r, int *out_c)
+{
+    const int tile_rows = map->height * TILES_PER_CHUNK_HEIGHT;
+    const int tile_cols = map->width * TILES_PER_CHUNK_WIDTH;
+
+    if(r >= HEIGHT_MIP_DIM(tile_rows, lvl) || c >= HEIGHT_MIP_DIM(tile_cols, lvl))
+        return false;
+
+    float y_max = map->height_mips[lvl][r * HEIGHT_MIP_DIM(tile_cols, lvl) + c];
+    int r0 = r << lvl, r1 = MIN((r + 1) << lvl, tile_rows);
+    int c0 = c << lvl, c1 = MIN((c + 1) << lvl, tile_cols);
+
+    /* Test the ray against the bounds of the block, from the bottom of the 
+     * terrain up to its highest point, in tile coordinates. Recall X 
+     * increases to the left in our engine. */
+    float t_in = 0.0f, t_out = *inout_t;
+    if(!rc_clip_slab((map->pos.x - origin.x) / X_COORDS_PER_TILE, -dir.x / X_COORDS_PER_TILE, 
+                     c0, c1, &t_in, &t_out)
+    || !rc_clip_slab((origin.z - map->pos.z) / Z_COORDS_PER_TILE, dir.z / Z_COORDS_PER_TILE, 
+                     r0, r1, &t_in, &t_out)
+    || !rc_clip_slab(origin.y, dir.y, -TILE_DEPTH * Y_COORDS_PER_TILE, y_max, &t_in, &t_out))
+        return false;
+
+    if(lvl == 0) {
+
+        float t;
+        if(!rc_intersect_tile(map, r, c, origin, dir, &t) || t >= *inout_t)
+            return false;
+        *inout_t = t;
+        *out_r = r;
+        *out_c = c;
+        return true;
+    }
+
+    /* Visit the quadrants front-to-back so that the blocks behind an early 
+     * hit get culled by the shrinking range. A ray running exactly along a 
+     * boundary can touch two quadrants at once, so all of them still get 
+     * tested against the range. */
+    int near_r = (dir.z >= 0.0f) ? 0 : 1;
+    int near_c = (dir.x <= 0.0f) ? 0 : 1;
+    const int order[4][2] = {
+        {near_r,  near_c}, 
+        {near_r, !near_c}, 
+        {!near_r, near_c}, 
+        {!near_r, !near_c}
     };
+
+    bool hit = false;
+    for(int i = 0; i < 4; i++) {
+        hit |= rc_intersect_node(map, lvl - 1, 2 * r + order[i][0], 2 * c + order[i][1], 
+                                 origin, dir, inout_t, out_r, out_c);
+    }
+    return hit;
 }
 
 static vec3_t rc_unproject_mouse_coords(void)
@@ -145,51 +286,20 @@ static void rc_find_intersection(void)
 
     s_ctx.tile_active = false;
 
-    struct map_resolution res = {
-        s_ctx.map->width, s_ctx.map->height,
-        TILES_PER_CHUNK_WIDTH, TILES_PER_CHUNK_HEIGHT
-    };
-
-    /* Project the ray on the Y=(-TILE_DEPTH*Y_COORDS_PER_TILE) plane between the camera position and where the 
-     * ray intersects the Y=(-TILE_DEPTH*Y_COORDS_PER_TILE) plane. */
-    float t = fabs((ray_origin.y + TILE_DEPTH*Y_COORDS_PER_TILE) / ray_dir.y);
-    struct line_seg_2d y_eq_0_seg = {
-        ray_origin.x, 
-        ray_origin.z,
-        ray_origin.x + t * ray_dir.x, 
-        ray_origin.z + t * ray_dir.z,
-    };
-
-    struct tile_desc cts[MAX_CANDIDATE_TILES];
-    int len = M_Tile_LineSupercoverTilesSorted(res, s_ctx.map->pos, y_eq_0_seg, cts, MAX_CANDIDATE_TILES);
-
-    for(int i = 0; i < len; i++) {
-    
-        struct aabb tile_aabb = aabb_for_tile(cts[i], s_ctx.map);
-        float t;
-
-        /* The first level check is to see if the ray intersects the AABB */
-        if(C_RayIntersectsAABB(ray_origin, ray_dir, tile_aabb, &t)) {
-
-            /* If the ray hits the AABB, perform the second level check:
-             * Check if it intersects the exact triangle mesh of the tile. */
-            vec3_t tile_mesh[VERTS_PER_TILE];
-            mat4x4_t model;
-
-            M_ModelMatrixForChunk(s_ctx.map, (struct chunkpos){cts[i].chunk_r, cts[i].chunk_c}, &model);
-            int num_verts = R_TileGetTriMesh(s_ctx.map, &cts[i], &model, tile_mesh);
-
-            if(C_RayIntersectsTriMesh(ray_origin, ray_dir, tile_mesh, num_verts, &t)) {
+    float t = FLT_MAX;
+    int r, c;
+    if(!rc_intersect_node(s_ctx.map, s_ctx.map->num_height_mips - 1, 0, 0, 
+                          ray_origin, ray_dir, &t, &r, &c))
+        return;
 
-                PFM_Vec3_Scale(&ray_dir, t, &ray_dir);
-                PFM_Vec3_Add(&ray_origin, &ray_dir, &s_ctx.intersec_pos);
+    PFM_Vec3_Scale(&ray_dir, t, &ray_dir);
+    PFM_Vec3_Add(&ray_origin, &ray_dir, &s_ctx.intersec_pos);
 
-                s_ctx.intersec_tile = cts[i]; 
-                s_ctx.tile_active = true;
-                break;
-            }
-        }
-    }
+    s_ctx.intersec_tile = (struct tile_desc){
+        r / TILES_PER_CHUNK_HEIGHT, c / TILES_PER_CHUNK_WIDTH,
+        r % TILES_PER_CHUNK_HEIGHT, c % TILES_PER_CHUNK_WIDTH
+    };
+    s_ctx.tile_active = true;
 }
 
 static void on_mousemove(void *user, void *event)
@@ -47,9 +47,15 @@ LRU_CACHE_TYPE(los, struct LOS_field)
 LRU_CACHE_PROTOTYPES(static, los, struct LOS_field)
 LRU_CACHE_IMPL(static, los, struct LOS_field)
 
-LRU_CACHE_TYPE(flow, struct flow_field)
-LRU_CACHE_PROTOTYPES(static, flow, struct flow_field)
-LRU_CACHE_IMPL(static, flow, struct flow_field)
+struct flow_entry{
+    struct flow_field      ff;
+    bool                   enemy_seek;
+    struct enemy_seek_desc seek;
+};
+
+LRU_CACHE_TYPE(flow, struct flow_entry)
+LRU_CACHE_PROTOTYPES(static, flow, struct flow_entry)
+LRU_CACHE_IMPL(static, flow, struct flow_entry)
 
 LRU_CACHE_TYPE(ffid, ff_id_t)
 LRU_CACHE_PROTOTYPES(static, ffid, ff_id_t)
@@ -169,6 +175,18 @@ static void field_map_add(khash_t(idvec) *hash, uint64_t key, uint64_t id)
     }
 }
 
+static void flow_put(ff_id_t ffid, const struct flow_entry *entry, bool exists)
+{
+    lru_flow_put(&s_flow_cache, ffid, entry);
+
+    /* Fields that are refreshed in-place are already in the chunk:field map */
+    if(exists)
+        return;
+
+    struct coord chunk = (struct coord){(ffid >> 8) & 0xff, ffid & 0xff};
+    field_map_add(s_chunk_ffield_map, key_for_chunk(chunk), ffid);
+}
+
 static bool dest_array_contains(dest_id_t *array, size_t size, dest_id_t item)
 {
     for(int i = 0; i < size; i++) {
@@ -310,15 +328,41 @@ bool N_FC_ContainsFlowField(ff_id_t ffid)
 
 const struct flow_field *N_FC_FlowFieldAt(ff_id_t ffid)
 {
-    return lru_flow_at(&s_flow_cache, ffid);
+    const struct flow_entry *entry = lru_flow_at(&s_flow_cache, ffid);
+    return entry ? &entry->ff : NULL;
 }
 
 void N_FC_PutFlowField(ff_id_t ffid, const struct flow_field *ff)
 {
-    lru_flow_put(&s_flow_cache, ffid, ff);
+    struct flow_entry entry = (struct flow_entry){ .ff = *ff };
 
-    struct coord chunk = (struct coord){(ffid >> 8) & 0xff, ffid & 0xff};
-    field_map_add(s_chunk_ffield_map, key_for_chunk(chunk), ffid);
+    const struct flow_entry *exist = lru_flow_at(&s_flow_cache, ffid);
+    if(exist) {
+        entry.enemy_seek = exist->enemy_seek;
+        entry.seek = exist->seek;
+    }
+    flow_put(ffid, &entry, !!exist);
+}
+
+void N_FC_PutEnemySeekField(ff_id_t ffid, const struct flow_field *ff, 
+                            const struct enemy_seek_desc *desc)
+{
+    struct flow_entry entry = (struct flow_entry){
+        .ff = *ff,
+        .enemy_seek = true,
+        .seek = *desc
+    };
+    flow_put(ffid, &entry, lru_flow_contains(&s_flow_cache, ffid));
+}
+
+bool N_FC_GetEnemySeekDesc(ff_id_t ffid, struct enemy_seek_desc *out)
+{
+    const struct flow_entry *entry = lru_flow_at(&s_flow_cache, ffid);
+    if(!entry || !entry->enemy_seek)
+        return false;
+
+    *out = entry->seek;
+    return true;
 }
 
 bool N_FC_GetDestFFMapping(dest_id_t id, struct coord chunk_coord, ff_id_t *out_ff)
@@ -355,7 +399,7 @@ void N_FC_PutGridPath(struct coord local_start, struct coord local_dest,
     lru_grid_path_put(&s_grid_path_cache, key, in);
 }
 
-void N_FC_InvalidateAllAtChunk(struct coord chunk)
+void N_FC_InvalidateAllAtChunk(struct coord chunk, uint64_t curr_tick)
 {
     /* Note that chunk:field maps simply maintain a list of cache keys for 
      * which entries were set. The entries for these keys may have already 
@@ -381,12 +425,34 @@ void N_FC_InvalidateAllAtChunk(struct coord chunk)
     if(k != kh_end(s_chunk_ffield_map)) {
 
         vec_id_t *keys = &kh_val(s_chunk_ffield_map, k);
+        vec_id_t kept;
+        vec_id_init(&kept);
+
         for(int i = 0; i < vec_size(keys); i++) {
-            bool found = lru_flow_remove(&s_flow_cache, vec_AT(keys, i));
+
+            uint64_t curr = vec_AT(keys, i);
+            const struct flow_entry *entry = lru_flow_at(&s_flow_cache, curr);
+
+            if(entry && entry->enemy_seek && entry->seek.keep_until > curr_tick) {
+
+                struct flow_entry stale = *entry;
+                stale.seek.stale = true;
+                lru_flow_put(&s_flow_cache, curr, &stale);
+                vec_id_push(&kept, curr);
+                continue;
+            }
+
+            bool found = lru_flow_remove(&s_flow_cache, curr);
             s_perfstats.flow_invalidated += !!found;
         }
         vec_id_destroy(keys);
-        kh_del(idvec, s_chunk_ffield_map, k);
+
+        if(vec_size(&kept)) {
+            kh_val(s_chunk_ffield_map, k) = kept;
+        }else{
+            vec_id_destroy(&kept);
+            kh_del(idvec, s_chunk_ffield_map, k);
+        }
     }
 }
 
@@ -415,7 +481,7 @@ void N_FC_InvalidateAllThroughChunk(struct coord chunk)
 
     /* Now that we know all the paths, find and remove all the flow 
      * fields belonging to them */
-    struct flow_field ff_val;
+    struct flow_entry ff_val;
     LRU_FOREACH_SAFE_REMOVE(flow, &s_flow_cache, key, ff_val, {
     
         (void)ff_val;
@@ -51,9 +51,11 @@
 bool N_FC_Init(void);
 void N_FC_Shutdown(void);
 
-/* Invalidate all LOS and Flow fields for a particular chunk 
+/* Invalidate all LOS and Flow fields for a particular chunk. Enemy seek 
+ * fields that are to be kept until a later tick than 'curr_tick' are only 
+ * marked as stale.
  */
-void N_FC_InvalidateAllAtChunk(struct coord chunk);
+void N_FC_InvalidateAllAtChunk(struct coord chunk, uint64_t curr_tick);
 
 /* Invalidate all LOS and Flow fields for paths (identified by the dest_id) which 
  * have at least one field at the specified chunk
@@ -83,6 +85,31 @@ const struct flow_field *N_FC_FlowFieldAt(ff_id_t ffid);
 bool N_FC_ContainsFlowField(ff_id_t ffid);
 void N_FC_PutFlowField(ff_id_t ffid, const struct flow_field *ff);
 
+/* Enemy seek fields are not rebuilt every time that the navigation data of
+ * their chunk changes. Instead, they carry a descriptor of what they were 
+ * built from, which is used to decide when they should be refreshed. The 
+ * descriptor lives and dies with the cached field. Overwriting an existing
+ * field with N_FC_PutFlowField keeps its descriptor.
+ */
+struct enemy_seek_desc{
+    uint64_t     built_tick;
+    /* The field is not invalidated by changes to its chunk before this tick */
+    uint64_t     keep_until;
+    uint32_t     epoch;
+    /* Set when the field was derived only from the enemies on this and
+     * the cardinally adjacent chunks, as opposed to a path towards the 
+     * closest enemy anywhere on the map. */
+    bool         local;
+    /* The chunk of the closest enemy, for fields that are not local */
+    struct coord enemy_chunk;
+    /* Set when the chunk changed while the field was being kept */
+    bool         stale;
+};
+
+void N_FC_PutEnemySeekField(ff_id_t ffid, const struct flow_field *ff, 
+                            const struct enemy_seek_desc *desc);
+bool N_FC_GetEnemySeekDesc(ff_id_t ffid, struct enemy_seek_desc *out);
+
 bool N_FC_GetDestFFMapping(dest_id_t id, struct coord chunk_coord, ff_id_t *out_ff);
 void N_FC_PutDestFFMapping(dest_id_t dest_id, struct coord chunk_coord, ff_id_t ffid);
 
@@ -67,6 +67,19 @@
 
 #define EPSILON                  (1.0f / 1024)
 
+#define NAV_TILE_X_DIM           ((float)(TILES_PER_CHUNK_WIDTH  * X_COORDS_PER_TILE) / FIELD_RES_C)
+#define NAV_TILE_Z_DIM           ((float)(TILES_PER_CHUNK_HEIGHT * Z_COORDS_PER_TILE) / FIELD_RES_R)
+
+/* Enemy seek fields are shared by all the units of a faction within a chunk.
+ * A cached field is kept for at least ENEMY_SEEK_REFRESH_TICKS simulation
+ * ticks, even if the blockers of its chunk change in the meantime. After
+ * that it is only rebuilt if its chunk has changed or if the combatable 
+ * entities it was derived from have moved. ENEMY_SEEK_MAX_AGE_TICKS bounds
+ * how long a field can live, which takes care of diplomacy and flag changes.
+ */
+#define ENEMY_SEEK_REFRESH_TICKS (12)
+#define ENEMY_SEEK_MAX_AGE_TICKS (120)
+
 #define FOREACH_PORTAL(_priv, _local, ...)                                                      \
     do{                                                                                         \
         for(int chunk_r = 0; chunk_r < (_priv)->height; chunk_r++) {                            \
@@ -992,6 +1005,60 @@ static void chunk_bounds(vec3_t map_pos, struct coord chunk,
     out_xz_max->z = map_pos.z + (chunk.r + 1) * Z_COORDS_PER_TILE * TILES_PER_CHUNK_HEIGHT;
 }
 
+static uint32_t n_enemy_seek_epoch(const struct nav_private *priv, struct coord chunk, 
+                                   bool local, struct coord enemy_chunk)
+{
+    /* The epochs only ever increase, so the sum changes whenever any of them does */
+    uint32_t ret = priv->chunks[IDX(chunk.r, priv->width, chunk.c)].occupancy_epoch;
+    if(chunk.r > 0)
+        ret += priv->chunks[IDX(chunk.r - 1, priv->width, chunk.c)].occupancy_epoch;
+    if(chunk.r < priv->height-1)
+        ret += priv->chunks[IDX(chunk.r + 1, priv->width, chunk.c)].occupancy_epoch;
+    if(chunk.c > 0)
+        ret += priv->chunks[IDX(chunk.r, priv->width, chunk.c - 1)].occupancy_epoch;
+    if(chunk.c < priv->width-1)
+        ret += priv->chunks[IDX(chunk.r, priv->width, chunk.c + 1)].occupancy_epoch;
+    if(!local)
+        ret += priv->chunks[IDX(enemy_chunk.r, priv->width, enemy_chunk.c)].occupancy_epoch;
+    return ret;
+}
+
+/* Returns false if the cached field does not exist or should be rebuilt */
+static bool n_enemy_seek_fresh(const struct nav_private *priv, ff_id_t ffid, struct coord chunk)
+{
+    struct enemy_seek_desc desc;
+    if(!N_FC_GetEnemySeekDesc(ffid, &desc))
+        return false;
+
+    uint64_t age = G_Timer_SimTick() - desc.built_tick;
+
+    if(age < ENEMY_SEEK_REFRESH_TICKS)
+        return true;
+    if(desc.stale || age >= ENEMY_SEEK_MAX_AGE_TICKS)
+        return false;
+    return (desc.epoch == n_enemy_seek_epoch(priv, chunk, desc.local, desc.enemy_chunk));
+}
+
+static void n_enemy_seek_put(const struct nav_private *priv, ff_id_t ffid, struct coord chunk, 
+                             const struct flow_field *ff, bool local, struct coord enemy_chunk)
+{
+    uint64_t tick = G_Timer_SimTick();
+    struct enemy_seek_desc desc = (struct enemy_seek_desc){
+        .built_tick = tick,
+        .keep_until = tick + ENEMY_SEEK_REFRESH_TICKS,
+        .epoch = n_enemy_seek_epoch(priv, chunk, local, enemy_chunk),
+        .local = local,
+        .enemy_chunk = enemy_chunk,
+        .stale = false
+    };
+    N_FC_PutEnemySeekField(ffid, ff, &desc);
+}
+
+static void n_touch_chunk(struct nav_private *priv, struct tile_desc td)
+{
+    priv->chunks[IDX(td.chunk_r, priv->width, td.chunk_c)].occupancy_epoch++;
+}
+
 /* Every set bit in the returned value represents the index of a portal 
  * in the chunk that we can path to to find enemies on the other side. 
  */
@@ -1109,7 +1176,7 @@ void N_Update(void *nav_private)
 
         uint32_t key = kh_key(s_dirty_chunks, i);
         struct coord curr = (struct coord){ key >> 16, key & 0xffff };
-        N_FC_InvalidateAllAtChunk(curr);
+        N_FC_InvalidateAllAtChunk(curr, G_Timer_SimTick());
 
         struct nav_chunk *chunk = &priv->chunks[IDX(curr.r, priv->width, curr.c)];
         int nflipped = n_update_edge_states(chunk);
@@ -1169,6 +1236,7 @@ void *N_BuildForMapData(size_t w, size_t h, size_t chunk_w, size_t chunk_h,
             }
         }}
         memset(curr_chunk->blockers, 0, sizeof(curr_chunk->blockers));
+        curr_chunk->occupancy_epoch = 0;
     }}
 
     n_make_cliff_edges(ret, chunk_tiles, chunk_w, chunk_h);
@@ -1936,7 +2004,7 @@ vec2_t N_DesiredEnemySeekVelocity(vec2_t curr_pos, void *nav_private, vec3_t map
     ff_id_t ffid = N_FlowField_ID(chunk, target);
     struct flow_field ff;
 
-    if(!N_FC_ContainsFlowField(ffid)) {
+    if(!N_FC_ContainsFlowField(ffid) || !n_enemy_seek_fresh(priv, ffid, chunk)) {
 
         vec2_t chunk_center = (vec2_t){
             map_pos.x - (chunk.c + 0.5f) * X_COORDS_PER_TILE * TILES_PER_CHUNK_WIDTH,
@@ -1959,7 +2027,7 @@ vec2_t N_DesiredEnemySeekVelocity(vec2_t curr_pos, void *nav_private, vec3_t map
         
             N_FlowFieldInit(chunk, priv, &ff);
             N_FlowFieldUpdate(chunk, priv, target, &ff);
-            N_FC_PutFlowField(ffid, &ff);
+            n_enemy_seek_put(priv, ffid, chunk, &ff, true, chunk);
             done = true;
         }
 
@@ -1976,7 +2044,7 @@ vec2_t N_DesiredEnemySeekVelocity(vec2_t curr_pos, void *nav_private, vec3_t map
 
             N_FlowFieldInit(chunk, priv, &ff);
             N_FlowFieldUpdate(chunk, priv, pm_target, &ff);
-            N_FC_PutFlowField(ffid, &ff);
+            n_enemy_seek_put(priv, ffid, chunk, &ff, true, chunk);
             done = true;
         }
 
@@ -2015,7 +2083,8 @@ vec2_t N_DesiredEnemySeekVelocity(vec2_t curr_pos, void *nav_private, vec3_t map
 
             N_FlowFieldInit(chunk, priv, &ff);
             N_FlowFieldUpdate(chunk, priv, portal_target, &ff);
-            N_FC_PutFlowField(ffid, &ff);
+            n_enemy_seek_put(priv, ffid, chunk, &ff, false, 
+                (struct coord){target_tile.chunk_r, target_tile.chunk_c});
 
             vec_portal_destroy(&path);
         }
@@ -2064,18 +2133,22 @@ bool N_HasDestLOS(dest_id_t id, vec2_t curr_pos, void *nav_private, vec3_t map_p
 
 bool N_PositionPathable(vec2_t xz_pos, void *nav_private, vec3_t map_pos)
 {
-    struct nav_private *priv = nav_private;
-    struct map_resolution res = {
-        priv->width, priv->height,
-        FIELD_RES_C, FIELD_RES_R
-    };
+    const struct nav_private *priv = nav_private;
+    const int nrows = priv->height * FIELD_RES_R;
+    const int ncols = priv->width * FIELD_RES_C;
 
-    struct tile_desc tile;
-    bool result = M_Tile_DescForPoint2D(res, map_pos, xz_pos, &tile);
-    assert(result);
+    /* This is called for every moving entity on every tick, so index the 
+     * navigation grid directly instead of going through a tile descriptor. 
+     * Recall X increases to the left in our engine. */
+    int r =  (xz_pos.z - map_pos.z) / NAV_TILE_Z_DIM;
+    int c = -(xz_pos.x - map_pos.x) / NAV_TILE_X_DIM;
+    assert(r >= -1 && r <= nrows && c >= -1 && c <= ncols);
 
-    const struct nav_chunk *chunk = &priv->chunks[IDX(tile.chunk_r, priv->width, tile.chunk_c)];
-    return chunk->cost_base[tile.tile_r][tile.tile_c] != COST_IMPASSABLE;
+    r = CLAMP(r, 0, nrows-1);
+    c = CLAMP(c, 0, ncols-1);
+
+    const struct nav_chunk *chunk = &priv->chunks[IDX(r / FIELD_RES_R, priv->width, c / FIELD_RES_C)];
+    return chunk->cost_base[r % FIELD_RES_R][c % FIELD_RES_C] != COST_IMPASSABLE;
 }
 
 bool N_PositionBlocked(vec2_t xz_pos, void *nav_private, vec3_t map_pos)
@@ -2154,6 +2227,42 @@ void N_BlockersDecref(vec2_t xz_pos, float range, vec3_t map_pos, void *nav_priv
     n_update_blockers(nav_private, xz_pos, range, map_pos, -1);
 }
 
+void N_CombatableTouched(vec2_t xz_pos, vec3_t map_pos, void *nav_private)
+{
+    struct nav_private *priv = nav_private;
+    struct map_resolution res = {
+        priv->width, priv->height,
+        FIELD_RES_C, FIELD_RES_R
+    };
+
+    struct tile_desc td;
+    if(!M_Tile_DescForPoint2D(res, map_pos, xz_pos, &td))
+        return;
+    n_touch_chunk(priv, td);
+}
+
+void N_CombatableMoved(vec2_t xz_old, vec2_t xz_new, vec3_t map_pos, void *nav_private)
+{
+    struct nav_private *priv = nav_private;
+    struct map_resolution res = {
+        priv->width, priv->height,
+        FIELD_RES_C, FIELD_RES_R
+    };
+
+    struct tile_desc old_td, new_td;
+    bool old_valid = M_Tile_DescForPoint2D(res, map_pos, xz_old, &old_td);
+    bool new_valid = M_Tile_DescForPoint2D(res, map_pos, xz_new, &new_td);
+
+    if(old_valid && new_valid && 0 == memcmp(&old_td, &new_td, sizeof(old_td)))
+        return;
+
+    if(old_valid)
+        n_touch_chunk(priv, old_td);
+    if(new_valid && !(old_valid 
+        && old_td.chunk_r == new_td.chunk_r && old_td.chunk_c == new_td.chunk_c))
+        n_touch_chunk(priv, new_td);
+}
+
 bool N_IsMaximallyClose(void *nav_private, vec3_t map_pos, 
                         vec2_t xz_pos, vec2_t xz_dest, float tolerance)
 {
@@ -109,6 +109,11 @@ struct nav_chunk{
      * stationary entities, for example.
      */
     uint16_t        local_islands[FIELD_RES_R][FIELD_RES_C];
+    /* Incremented every time a combatable entity is added to, removed 
+     * from, or moves between the tiles of this chunk. Used to tell when 
+     * the cached enemy seek fields have gone stale.
+     */
+    uint32_t        occupancy_epoch;
 };
 
 #endif
@@ -250,6 +250,16 @@ vec2_t    N_ClosestReachableDest(void *nav_private, vec3_t map_pos, vec2_t xz_sr
 void      N_BlockersIncref(vec2_t xz_pos, float range, vec3_t map_pos, void *nav_private);
 void      N_BlockersDecref(vec2_t xz_pos, float range, vec3_t map_pos, void *nav_private);
 
+/* ------------------------------------------------------------------------
+ * Record that a combatable entity has been added to or removed from the 
+ * map at the specified position (N_CombatableTouched), or that it has 
+ * moved (N_CombatableMoved). Cached enemy seek fields are refreshed when
+ * the entities they were derived from have moved.
+ * ------------------------------------------------------------------------
+ */
+void      N_CombatableTouched(vec2_t xz_pos, vec3_t map_pos, void *nav_private);
+void      N_CombatableMoved(vec2_t xz_old, vec2_t xz_new, vec3_t map_pos, void *nav_private);
+
 /* ------------------------------------------------------------------------
  * Returns true if the entity position (xz_pos) is within a 'tolerance' 
  * range of the closest non-blocked tile that is reachable from the
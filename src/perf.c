@@ -43,12 +43,33 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PERF_HAVE_TSC
+#endif
 
 
 #define PARENT_NONE     ~((uint32_t)0)
+#define IDX_NONE        ~((uint32_t)0)
 #define GPU_STATE_NAME  "GPU"
-#define GPU_STATE_KEY   UINT64_MAX
 #define GPU_TIMER_HZ    (1 * 1000 * 1000 * 1000)
+#define MAX_THREADS     (64)
+#define MAX_ENTRIES     (32768)
+#define MAX_DEPTH       (4096)
+#define MAX_SPIKES      (8)
+/* Timings are bucketed into a log-linear histogram: the first HIST_LINEAR 
+ * microseconds get a bucket each, after which every power of two is split 
+ * into HIST_SUB buckets. This gives a relative error of at most 1/HIST_SUB 
+ * over the full range of a 32-bit microsecond count. */
+#define HIST_SUB_BITS   (4)
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_LINEAR     (2 * HIST_SUB)
+#define HIST_NBUCKETS   (HIST_LINEAR + (32 - (HIST_SUB_BITS + 1)) * HIST_SUB)
+/* The percentiles are over the last 1-2 windows of samples */
+#define HIST_WINDOW     (3600)
 
 struct perf_entry{
     union{
@@ -60,168 +81,482 @@ struct perf_entry{
             }begin, end;
         };
     };
+    uint64_t start;
     uint32_t parent_idx;
     uint32_t name_id;
 };
 
-KHASH_MAP_INIT_STR(name_id, uint32_t)
-KHASH_MAP_INIT_INT(id_name, const char *)
+/* An open zone. The start time is kept here rather than in the tree so that
+ * a zone that is still open when its' frame is recycled never leaves a stale 
+ * timestamp in the reported data. */
+struct perf_frame{
+    uint32_t idx;
+    uint32_t slot;
+    uint64_t start;
+};
+
+struct perf_histogram{
+    uint64_t total;
+    uint64_t max_us;
+    uint32_t counts[HIST_NBUCKETS];
+};
+
+/* The histogram is rolled by alternating between two halves. Samples go to 
+ * the current half, and the older half is cleared once the current one fills 
+ * up, so the statistics always cover between 1 and 2 windows' worth. */
+struct perf_rolling_hist{
+    int              curr;
+    struct perf_histogram halves[2];
+};
 
-VEC_TYPE(perf, struct perf_entry)
-VEC_IMPL(static inline, perf, struct perf_entry)
+KHASH_MAP_INIT_STR(name_id, uint32_t)
 
-VEC_TYPE(idx, uint32_t)
-VEC_IMPL(static inline, idx, uint32_t)
+VEC_TYPE(name, const char*)
+VEC_IMPL(static inline, name, const char*)
 
+/* The state is only ever written by the thread that owns it. The main thread 
+ * reads the trees of frames that have been retired, which none of the threads
+ * are writing to anymore, so no locking is needed on the hot path. 
+ */
 struct perf_state{
     char              name[64];
-    /* The next name ID to hand out 
-     */
-    uint32_t          next_id;
-    /* Keep a mapping of function_name: unique_ID and a reverse-mapping. 
-     * These should (mostly) get populated during the first frame.
-     */
-    khash_t(name_id) *name_id_table;
-    khash_t(id_name) *id_name_table;
+    SDL_threadID      tid;
     /* The callstack of profiled functions. As enties are popped, the
      * entries for the corresponding index are updated in the perf tree. 
      */
-    vec_idx_t         perf_stack;
+    size_t            depth;
+    struct perf_frame stack[MAX_DEPTH];
     /* The perf tree gets a new entry for each profiled function call.
-     * As such, the function calls are added in depth-first fashion.
+     * As such, the function calls are added in depth-first fashion. The 
+     * trees form a ring of fixed-size buffers, one for each logged frame.
      */
-    int               perf_tree_idx;
-    vec_perf_t        perf_trees[NFRAMES_LOGGED];
+    size_t            nentries[NFRAMES_LOGGED];
+    struct perf_entry trees[NFRAMES_LOGGED][MAX_ENTRIES];
 };
 
-KHASH_MAP_INIT_INT64(pstate, struct perf_state)
-
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
 /*****************************************************************************/
 
-static khash_t(pstate) *s_thread_state_table;
+/* Zone names are interned once and shared by all threads. The ID of a 
+ * zone is its' index in the name table. Index 0 is never handed out so 
+ * that a zero-initialized static can mean 'not yet interned'. 
+ */
+static SDL_mutex          *s_zone_lock;
+static khash_t(name_id)   *s_zone_ids;
+static vec_name_t          s_zone_names;
+
+static SDL_mutex          *s_state_lock;
+static struct perf_state  *s_states[MAX_THREADS];
+static size_t              s_nstates;
+static SDL_atomic_t        s_states_gen;
+static struct perf_state  *s_gpu_state;
+
+/* The index of the ring slot that is currently being written */
+static SDL_atomic_t        s_slot;
+static SDL_atomic_t        s_enabled;
 
-static int              s_last_idx = 0;
-static unsigned         s_last_frames_ms[NFRAMES_LOGGED];
+static uint64_t            s_ts_base;
+static uint64_t            s_pc_base;
+
+static __thread struct perf_state *t_state;
+static __thread int                t_state_gen;
+
+static int                 s_last_idx = 0;
+static unsigned            s_last_frames_ms[NFRAMES_LOGGED];
+
+/* The number of frames that have been finished */
+static uint64_t            s_frame;
+static uint64_t            s_frame_begin_pc;
+
+static SDL_mutex          *s_hist_lock;
+static struct perf_rolling_hist s_hists[PERF_HIST_COUNT];
+
+/* When a frame takes longer than the threshold, the perf trees of that frame 
+ * and all the preceding logged frames are kept for later inspection. */
+static uint32_t            s_spike_threshold_ms;
+static size_t              s_nspikes;
+static struct perf_spike  *s_spikes[MAX_SPIKES];
+
+/* Streams the zones of each retired frame to a file in the Chrome Trace 
+ * Event format, which can be opened with chrome://tracing or Perfetto. 
+ */
+static struct{
+    SDL_RWops *stream;
+    char       path[512];
+    uint64_t   first_frame;
+    uint64_t   end_frame;
+    bool       first_event;
+    bool       have_gpu_offset;
+    double     gpu_offset_us;
+}s_capture;
 
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
 /*****************************************************************************/
 
-static uint64_t tid_to_key(SDL_threadID tid)
+static inline uint64_t perf_now(void)
 {
-    union{
-        SDL_threadID as_tid;
-        uint64_t     as_u64;
-    }ret = {0};
-    ret.as_tid = tid;
-    return ret.as_u64;
+#ifdef PERF_HAVE_TSC
+    return __rdtsc();
+#else
+    return SDL_GetPerformanceCounter();
+#endif
 }
 
-static uint32_t name_id_get(const char *name, struct perf_state *ps)
+/* The TSC frequency is derived from the performance counter over the whole 
+ * lifetime of the profiler, so it only gets more accurate the longer we run. */
+static double perf_now_hz(void)
 {
-    khiter_t k = kh_get(name_id, ps->name_id_table, name);
-    if(k != kh_end(ps->name_id_table))
-        return kh_val(ps->name_id_table, k);
+    double pc_hz = SDL_GetPerformanceFrequency();
+#ifdef PERF_HAVE_TSC
+    uint64_t pc_delta = SDL_GetPerformanceCounter() - s_pc_base;
+    uint64_t ts_delta = perf_now() - s_ts_base;
+    if(pc_delta > 0 && ts_delta > 0)
+        return ts_delta * (pc_hz / pc_delta);
+#endif
+    return pc_hz;
+}
 
-    int status;
-    uint32_t new_id = ps->next_id++;
-    const char *copy = pf_strdup(name);
-    assert(copy);
+static struct perf_state *perf_state_get(void)
+{
+    if(t_state)
+        return t_state;
+
+    /* Only look again once some new thread has been registered */
+    int gen = SDL_AtomicGet(&s_states_gen);
+    if(t_state_gen == gen)
+        return NULL;
+
+    SDL_threadID tid = SDL_ThreadID();
+    SDL_LockMutex(s_state_lock);
+    for(int i = 0; i < s_nstates; i++) {
+        if(s_states[i]->tid == tid) {
+            t_state = s_states[i];
+            break;
+        }
+    }
+    SDL_UnlockMutex(s_state_lock);
 
-    kh_put(id_name, ps->id_name_table, new_id, &status);
-    assert(status != -1);
-    k = kh_get(id_name, ps->id_name_table, new_id);
-    kh_val(ps->id_name_table, k) = copy;
+    t_state_gen = gen;
+    return t_state;
+}
 
-    kh_put(name_id, ps->name_id_table, copy, &status);
-    assert(status != -1);
-    k = kh_get(name_id, ps->name_id_table, copy);
-    kh_val(ps->name_id_table, k) = new_id;
+static struct perf_state *pstate_create(const char *name, SDL_threadID tid)
+{
+    struct perf_state *ret = calloc(1, sizeof(struct perf_state));
+    if(!ret)
+        return NULL;
 
-    return new_id;
+    pf_strlcpy(ret->name, name, sizeof(ret->name));
+    ret->tid = tid;
+    return ret;
 }
 
-const char *name_for_id(struct perf_state *ps, uint32_t id)
+static void perf_push(struct perf_state *ps, uint32_t name_id, uint64_t start)
 {
-    khiter_t k = kh_get(id_name, ps->id_name_table, id);
-    if(k != kh_end(ps->id_name_table))
-        return kh_val(ps->id_name_table, k);
-    return NULL;
+    if(ps->depth == MAX_DEPTH)
+        return;
+
+    struct perf_frame *top = &ps->stack[ps->depth++];
+    *top = (struct perf_frame){ .idx = IDX_NONE, .slot = 0, .start = start };
+
+    if(!SDL_AtomicGet(&s_enabled))
+        return;
+
+    int slot = SDL_AtomicGet(&s_slot);
+    size_t n = ps->nentries[slot];
+    if(n == MAX_ENTRIES)
+        return;
+
+    uint32_t parent_idx = PARENT_NONE;
+    if(ps->depth > 1 && ps->stack[ps->depth-2].slot == slot)
+        parent_idx = ps->stack[ps->depth-2].idx;
+
+    ps->trees[slot][n] = (struct perf_entry){
+        .pc_delta = 0,
+        .start = start,
+        .parent_idx = parent_idx,
+        .name_id = name_id
+    };
+    ps->nentries[slot] = n + 1;
+
+    top->idx = n;
+    top->slot = slot;
 }
 
-static bool pstate_init(struct perf_state *out, const char *name)
+static struct perf_entry *perf_pop(struct perf_state *ps, uint64_t *out_start)
 {
-    out->next_id = 0;
-    out->name_id_table = kh_init(name_id);
-    if(!out->name_id_table)
-        goto fail_name_id;
-    out->id_name_table = kh_init(id_name);
-    if(!out->id_name_table)
-        goto fail_id_name;
-    vec_idx_init(&out->perf_stack);
-    if(!vec_idx_resize(&out->perf_stack, 4096))
-        goto fail_perf_stack;
+    if(ps->depth == 0)
+        return NULL;
 
-    for(int i = 0; i < NFRAMES_LOGGED; i++) {
-    
-        vec_perf_init(&out->perf_trees[i]);
-        if(!vec_perf_resize(&out->perf_trees[i], 32768))
-            goto fail_perf_trees;
-    }
+    struct perf_frame *top = &ps->stack[--ps->depth];
+    if(top->idx == IDX_NONE)
+        return NULL;
 
-    pf_strlcpy(out->name, name, sizeof(out->name));
-    out->perf_tree_idx = 0;
-    return true;
+    /* The frame has since been retired */
+    if(top->slot != SDL_AtomicGet(&s_slot))
+        return NULL;
+
+    *out_start = top->start;
+    return &ps->trees[top->slot][top->idx];
+}
+
+static const char *name_for_id(uint32_t id)
+{
+    if(id == 0 || id >= vec_size(&s_zone_names))
+        return "(unknown)";
+    return vec_AT(&s_zone_names, id);
+}
 
-fail_perf_trees:
-    for(int i = 0; i < NFRAMES_LOGGED; i++) {
+/* The zone lock must be held by the caller */
+static struct perf_info *perf_info_create(const struct perf_state *ps, int slot, double ts_hz)
+{
+    size_t nentries = ps->nentries[slot];
+    struct perf_info *info = malloc(sizeof(struct perf_info) + nentries * sizeof(info->entries[0]));
+    if(!info)
+        return NULL;
+
+    pf_strlcpy(info->threadname, ps->name, sizeof(info->threadname));
+    info->nentries = nentries;
+
+    for(int j = 0; j < nentries; j++) {
+
+        const struct perf_entry *entry = &ps->trees[slot][j];
+
+        if(ps == s_gpu_state) {
+            uint64_t hz = GPU_TIMER_HZ;
+            uint64_t delta = entry->end.gpu_ts > entry->begin.gpu_ts 
+                           ? entry->end.gpu_ts - entry->begin.gpu_ts : 0;
+            info->entries[j].pc_delta = delta;
+            info->entries[j].ms_delta = (delta * 1000.0 / hz);
+        }else{
+            info->entries[j].pc_delta = entry->pc_delta;
+            info->entries[j].ms_delta = (entry->pc_delta * 1000.0 / ts_hz);
+        }
 
-        if(!out->perf_trees[i].array)
-            continue;
-        vec_perf_destroy(&out->perf_trees[i]);
+        info->entries[j].funcname = name_for_id(entry->name_id);
+        info->entries[j].parent_idx = entry->parent_idx;
     }
-    vec_idx_destroy(&out->perf_stack);
-fail_perf_stack:
-    kh_destroy(id_name, out->id_name_table);
-fail_id_name:
-    kh_destroy(name_id, out->name_id_table);
-fail_name_id:
-    return false;
+    return info;
+}
+
+static int hist_bucket(uint64_t us)
+{
+    if(us < HIST_LINEAR)
+        return us;
+    if(us > UINT32_MAX)
+        us = UINT32_MAX;
+
+    int msb = 31 - __builtin_clz((uint32_t)us);
+    int sub = (us >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1);
+    return HIST_LINEAR + (msb - (HIST_SUB_BITS + 1)) * HIST_SUB + sub;
+}
+
+/* Returns the midpoint of the range of values of the bucket */
+static double hist_bucket_value(int idx)
+{
+    if(idx < HIST_LINEAR)
+        return idx;
+
+    int msb = (idx - HIST_LINEAR) / HIST_SUB + (HIST_SUB_BITS + 1);
+    int sub = (idx - HIST_LINEAR) % HIST_SUB;
+    double width = (double)(1ull << (msb - HIST_SUB_BITS));
+    return (1ull << msb) + sub * width + width / 2.0;
 }
 
-static void pstate_destroy(struct perf_state *in)
+static void hist_add(struct perf_rolling_hist *hist, uint64_t us)
 {
-    for(int i = 0; i < NFRAMES_LOGGED; i++) {
-        vec_perf_destroy(&in->perf_trees[i]);
+    struct perf_histogram *curr = &hist->halves[hist->curr];
+    if(curr->total == HIST_WINDOW) {
+        hist->curr = !hist->curr;
+        curr = &hist->halves[hist->curr];
+        memset(curr, 0, sizeof(*curr));
     }
-    vec_idx_destroy(&in->perf_stack);
 
-    uint32_t key;
-    const char *curr;
-    (void)key;
+    curr->counts[hist_bucket(us)]++;
+    curr->total++;
+    if(us > curr->max_us)
+        curr->max_us = us;
+}
 
-    kh_foreach(in->id_name_table, key, curr, {
-        free((char*)curr);
-    });
+static double hist_percentile(const struct perf_rolling_hist *hist, double pct)
+{
+    const struct perf_histogram *a = &hist->halves[0], *b = &hist->halves[1];
+    uint64_t total = a->total + b->total;
+    if(total == 0)
+        return 0.0;
+
+    uint64_t rank = (uint64_t)(total * pct);
+    rank = (rank < total) ? rank : total - 1;
+
+    uint64_t seen = 0;
+    for(int i = 0; i < HIST_NBUCKETS; i++) {
+        seen += a->counts[i] + b->counts[i];
+        if(seen > rank)
+            return hist_bucket_value(i);
+    }
+    return (a->max_us > b->max_us) ? a->max_us : b->max_us;
+}
 
-    kh_destroy(id_name, in->id_name_table);
-    kh_destroy(name_id, in->name_id_table);
+static void spike_free(struct perf_spike *spike)
+{
+    for(int i = 0; i < spike->nframes; i++) {
+        for(int j = 0; j < spike->nthreads[i]; j++) {
+            free(spike->frames[i][j]);
+        }
+    }
+    free(spike);
 }
 
-static bool register_gpu_state(void)
+/* Called once all the threads are done with the current frame, but 
+ * before its' slot is retired. */
+static void spike_capture(double frame_ms)
 {
-    khiter_t k = kh_get(pstate, s_thread_state_table, GPU_STATE_KEY);
-    assert(k == kh_end(s_thread_state_table));
+    struct perf_spike *spike = calloc(1, sizeof(struct perf_spike));
+    if(!spike)
+        return;
 
-    int status;
-    k = kh_put(pstate, s_thread_state_table, GPU_STATE_KEY, &status);
-    assert(status != -1 && status != 0);
+    spike->frame = s_frame;
+    spike->frame_ms = frame_ms;
+
+    const double ts_hz = perf_now_hz();
+    const int curr = SDL_AtomicGet(&s_slot);
 
-    if(!pstate_init(&kh_val(s_thread_state_table, k), GPU_STATE_NAME))
+    SDL_LockMutex(s_state_lock);
+    SDL_LockMutex(s_zone_lock);
+
+    /* From the oldest frame still in the ring to the current one */
+    size_t nframes = (s_frame + 1 < NFRAMES_LOGGED) ? s_frame + 1 : NFRAMES_LOGGED;
+    for(int i = nframes - 1; i >= 0; i--) {
+
+        int slot = (curr + NFRAMES_LOGGED - i) % NFRAMES_LOGGED;
+        size_t fidx = spike->nframes++;
+
+        for(int j = 0; j < s_nstates && j < PERF_MAX_THREADS; j++) {
+            struct perf_info *info = perf_info_create(s_states[j], slot, ts_hz);
+            if(!info)
+                break;
+            spike->frames[fidx][spike->nthreads[fidx]++] = info;
+        }
+    }
+
+    SDL_UnlockMutex(s_zone_lock);
+    SDL_UnlockMutex(s_state_lock);
+
+    if(s_nspikes == MAX_SPIKES) {
+        spike_free(s_spikes[0]);
+        memmove(s_spikes, s_spikes + 1, sizeof(s_spikes[0]) * (MAX_SPIKES - 1));
+        s_nspikes--;
+    }
+    s_spikes[s_nspikes++] = spike;
+}
+
+static bool capture_printf(const char *fmt, ...)
+{
+    char buff[1024];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buff, sizeof(buff), fmt, args);
+    va_end(args);
+
+    if(len < 0)
         return false;
-    return true;
+    len = (len < sizeof(buff)) ? len : sizeof(buff) - 1;
+    return (SDL_RWwrite(s_capture.stream, buff, len, 1) == 1);
+}
+
+static bool capture_event(const char *name, int tid, double ts_us, double dur_us)
+{
+    char escaped[256];
+    size_t n = 0;
+
+    for(const char *c = name; *c && n < sizeof(escaped) - 2; c++) {
+        if(*c == '"' || *c == '\\')
+            escaped[n++] = '\\';
+        escaped[n++] = (*c < 0x20) ? ' ' : *c;
+    }
+    escaped[n] = '\0';
+
+    bool ret = capture_printf("%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+        "\"ts\":%.3f,\"dur\":%.3f}", s_capture.first_event ? "" : ",", escaped, tid, ts_us, dur_us);
+    s_capture.first_event = false;
+    return ret;
+}
+
+static bool capture_thread_name(const char *name, int tid)
+{
+    bool ret = capture_printf("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+        "\"args\":{\"name\":\"%s\"}}", s_capture.first_event ? "" : ",", tid, name);
+    s_capture.first_event = false;
+    return ret;
+}
+
+static void capture_end(void)
+{
+    if(!s_capture.stream)
+        return;
+
+    capture_printf("\n]}\n");
+    SDL_RWclose(s_capture.stream);
+    s_capture.stream = NULL;
+}
+
+static bool capture_frame(int slot)
+{
+    const double ts_hz = perf_now_hz();
+    uint64_t cpu_begin = UINT64_MAX;
+
+    SDL_LockMutex(s_state_lock);
+    SDL_LockMutex(s_zone_lock);
+
+    bool ret = true;
+    for(int i = 0; i < s_nstates && ret; i++) {
+
+        const struct perf_state *ps = s_states[i];
+        for(int j = 0; j < ps->nentries[slot] && ret; j++) {
+
+            const struct perf_entry *pe = &ps->trees[slot][j];
+            if(pe->start < cpu_begin)
+                cpu_begin = pe->start;
+
+            double ts = (pe->start - s_ts_base) * (1000.0 * 1000.0 / ts_hz);
+            double dur = pe->pc_delta * (1000.0 * 1000.0 / ts_hz);
+            ret = capture_event(name_for_id(pe->name_id), i + 1, ts, dur);
+        }
+    }
+
+    /* The GPU clock has a different origin from the CPU clock. The GPU work
+     * is placed so that the first GPU zone of the capture starts with the 
+     * first CPU zone of the same frame. The relative timings of all the GPU 
+     * zones are exact, but the offset against the CPU is approximate. */
+    const struct perf_state *gps = s_gpu_state;
+    if(gps->nentries[slot] && !s_capture.have_gpu_offset && cpu_begin != UINT64_MAX) {
+
+        uint64_t gpu_begin = UINT64_MAX;
+        for(int j = 0; j < gps->nentries[slot]; j++) {
+            if(gps->trees[slot][j].begin.gpu_ts < gpu_begin)
+                gpu_begin = gps->trees[slot][j].begin.gpu_ts;
+        }
+        double cpu_us = (cpu_begin - s_ts_base) * (1000.0 * 1000.0 / ts_hz);
+        double gpu_us = gpu_begin * (1000.0 * 1000.0 / GPU_TIMER_HZ);
+        s_capture.gpu_offset_us = cpu_us - gpu_us;
+        s_capture.have_gpu_offset = true;
+    }
+
+    for(int j = 0; j < gps->nentries[slot] && ret; j++) {
+
+        const struct perf_entry *pe = &gps->trees[slot][j];
+        uint64_t delta = pe->end.gpu_ts > pe->begin.gpu_ts ? pe->end.gpu_ts - pe->begin.gpu_ts : 0;
+
+        double ts = pe->begin.gpu_ts * (1000.0 * 1000.0 / GPU_TIMER_HZ) + s_capture.gpu_offset_us;
+        double dur = delta * (1000.0 * 1000.0 / GPU_TIMER_HZ);
+        ret = capture_event(name_for_id(pe->name_id), 0, ts, dur);
+    }
+
+    SDL_UnlockMutex(s_zone_lock);
+    SDL_UnlockMutex(s_state_lock);
+    return ret;
 }
 
 /*****************************************************************************/
@@ -230,116 +565,201 @@ static bool register_gpu_state(void)
 
 bool Perf_Init(void)
 {
-    s_thread_state_table = kh_init(pstate);
-    if(!s_thread_state_table)
-        return false;
-    if(!register_gpu_state()) {
-        kh_destroy(pstate, s_thread_state_table);
-        return false;
-    }
+    s_zone_lock = SDL_CreateMutex();
+    if(!s_zone_lock)
+        goto fail_zone_lock;
+
+    s_state_lock = SDL_CreateMutex();
+    if(!s_state_lock)
+        goto fail_state_lock;
+
+    s_hist_lock = SDL_CreateMutex();
+    if(!s_hist_lock)
+        goto fail_hist_lock;
+
+    s_zone_ids = kh_init(name_id);
+    if(!s_zone_ids)
+        goto fail_zone_ids;
+
+    vec_name_init(&s_zone_names);
+    if(!vec_name_push(&s_zone_names, NULL))
+        goto fail_zone_names;
+
+    s_gpu_state = pstate_create(GPU_STATE_NAME, 0);
+    if(!s_gpu_state)
+        goto fail_gpu_state;
+
+    s_ts_base = perf_now();
+    s_pc_base = SDL_GetPerformanceCounter();
+
+    SDL_AtomicSet(&s_slot, 0);
+    SDL_AtomicSet(&s_states_gen, 1);
+#ifndef NDEBUG
+    SDL_AtomicSet(&s_enabled, 1);
+#else
+    SDL_AtomicSet(&s_enabled, 0);
+#endif
+
     assert(NFRAMES_LOGGED >= 3);
     return true;
+
+fail_gpu_state:
+    vec_name_destroy(&s_zone_names);
+fail_zone_names:
+    kh_destroy(name_id, s_zone_ids);
+fail_zone_ids:
+    SDL_DestroyMutex(s_hist_lock);
+fail_hist_lock:
+    SDL_DestroyMutex(s_state_lock);
+fail_state_lock:
+    SDL_DestroyMutex(s_zone_lock);
+fail_zone_lock:
+    return false;
 }
 
 void Perf_Shutdown(void)
 {
-    uint64_t key;
-    struct perf_state curr;
-    (void)key;
+    capture_end();
+    Perf_ClearSpikes();
 
-    kh_foreach(s_thread_state_table, key, curr, {
-        pstate_destroy(&curr);
-    });
-    kh_destroy(pstate, s_thread_state_table);
+    for(int i = 0; i < s_nstates; i++) {
+        free(s_states[i]);
+    }
+    s_nstates = 0;
+    free(s_gpu_state);
+
+    for(int i = 1; i < vec_size(&s_zone_names); i++) {
+        free((char*)vec_AT(&s_zone_names, i));
+    }
+    vec_name_destroy(&s_zone_names);
+    kh_destroy(name_id, s_zone_ids);
+
+    SDL_DestroyMutex(s_hist_lock);
+    SDL_DestroyMutex(s_state_lock);
+    SDL_DestroyMutex(s_zone_lock);
 }
 
 bool Perf_RegisterThread(SDL_threadID tid, const char *name)
 {
     ASSERT_IN_MAIN_THREAD();
+    bool ret = false;
 
-    khiter_t k = kh_get(pstate, s_thread_state_table, tid_to_key(tid));
-    if(k != kh_end(s_thread_state_table))
-        return false;
+    SDL_LockMutex(s_state_lock);
+
+    for(int i = 0; i < s_nstates; i++) {
+        if(s_states[i]->tid == tid)
+            goto out;
+    }
+
+    if(s_nstates == MAX_THREADS)
+        goto out;
+
+    struct perf_state *ps = pstate_create(name, tid);
+    if(!ps)
+        goto out;
+
+    s_states[s_nstates++] = ps;
+    SDL_AtomicIncRef(&s_states_gen);
+    ret = true;
+
+out:
+    SDL_UnlockMutex(s_state_lock);
+    return ret;
+}
+
+uint32_t Perf_InternZone(const char *name)
+{
+    uint32_t ret = 0;
+    SDL_LockMutex(s_zone_lock);
+
+    khiter_t k = kh_get(name_id, s_zone_ids, name);
+    if(k != kh_end(s_zone_ids)) {
+        ret = kh_val(s_zone_ids, k);
+        goto out;
+    }
+
+    char *copy = pf_strdup(name);
+    if(!copy)
+        goto out;
+
+    if(!vec_name_push(&s_zone_names, copy)) {
+        free(copy);
+        goto out;
+    }
 
     int status;
-    kh_put(pstate, s_thread_state_table, tid_to_key(tid), &status);
-    if(status == -1)
-        return false;
+    k = kh_put(name_id, s_zone_ids, copy, &status);
+    if(status == -1) {
+        vec_name_pop(&s_zone_names);
+        free(copy);
+        goto out;
+    }
 
-    k = kh_get(pstate, s_thread_state_table, tid_to_key(tid));
-    if(!pstate_init(&kh_val(s_thread_state_table, k), name))
-        return false;
+    ret = vec_size(&s_zone_names) - 1;
+    kh_val(s_zone_ids, k) = ret;
 
-    return true;
+out:
+    SDL_UnlockMutex(s_zone_lock);
+    return ret;
 }
 
-void Perf_Push(const char *name)
+void Perf_SetEnabled(bool on)
 {
-    SDL_threadID tid = SDL_ThreadID();
-    khiter_t k = kh_get(pstate, s_thread_state_table, tid_to_key(tid));
-    if(k == kh_end(s_thread_state_table))
-        return;
+    SDL_AtomicSet(&s_enabled, on);
+}
 
-    struct perf_state *ps = &kh_val(s_thread_state_table, k);
-    const size_t ssize = vec_size(&ps->perf_stack);
-    uint32_t parent_idx = ssize > 0 ? vec_AT(&ps->perf_stack, ssize-1) : PARENT_NONE;
+bool Perf_Enabled(void)
+{
+    return SDL_AtomicGet(&s_enabled);
+}
 
-    vec_perf_push(&ps->perf_trees[ps->perf_tree_idx], (struct perf_entry){
-        .pc_delta = SDL_GetPerformanceCounter(),
-        .parent_idx = parent_idx,
-        .name_id = name_id_get(name, ps)
-    });
+void Perf_PushZone(uint32_t zone_id)
+{
+    struct perf_state *ps = perf_state_get();
+    if(!ps)
+        return;
+    perf_push(ps, zone_id, perf_now());
+}
 
-    uint32_t new_idx = vec_size(&ps->perf_trees[ps->perf_tree_idx])-1;
-    vec_idx_push(&ps->perf_stack, new_idx);
+void Perf_Push(const char *name)
+{
+    struct perf_state *ps = perf_state_get();
+    if(!ps)
+        return;
+    uint32_t id = SDL_AtomicGet(&s_enabled) ? Perf_InternZone(name) : 0;
+    perf_push(ps, id, perf_now());
 }
 
 void Perf_Pop(void)
 {
-    SDL_threadID tid = SDL_ThreadID();
-    khiter_t k = kh_get(pstate, s_thread_state_table, tid_to_key(tid));
-    if(k == kh_end(s_thread_state_table))
+    struct perf_state *ps = perf_state_get();
+    if(!ps)
         return;
 
-    struct perf_state *ps = &kh_val(s_thread_state_table, k);
-    assert(vec_size(&ps->perf_stack) > 0);
-
-    uint32_t idx = vec_idx_pop(&ps->perf_stack);
-    assert(idx < vec_size(&ps->perf_trees[ps->perf_tree_idx]));
-    struct perf_entry *pe = &vec_AT(&ps->perf_trees[ps->perf_tree_idx], idx);
-    pe->pc_delta = abs(SDL_GetPerformanceCounter() - pe->pc_delta);
+    uint64_t start;
+    struct perf_entry *pe = perf_pop(ps, &start);
+    if(!pe)
+        return;
+    pe->pc_delta = perf_now() - start;
 }
 
 void Perf_PushGPU(const char *name, uint32_t cookie)
 {
-    khiter_t k = kh_get(pstate, s_thread_state_table, GPU_STATE_KEY);
-    assert(k != kh_end(s_thread_state_table));
-
-    struct perf_state *ps = &kh_val(s_thread_state_table, k);
-    const size_t ssize = vec_size(&ps->perf_stack);
-    uint32_t parent_idx = ssize > 0 ? vec_AT(&ps->perf_stack, ssize-1) : PARENT_NONE;
+    struct perf_state *ps = s_gpu_state;
+    perf_push(ps, Perf_InternZone(name), 0);
 
-    vec_perf_push(&ps->perf_trees[ps->perf_tree_idx], (struct perf_entry){
-        .begin.gpu_cookie = cookie,
-        .parent_idx = parent_idx,
-        .name_id = name_id_get(name, ps)
-    });
-
-    uint32_t new_idx = vec_size(&ps->perf_trees[ps->perf_tree_idx])-1;
-    vec_idx_push(&ps->perf_stack, new_idx);
+    const struct perf_frame *top = &ps->stack[ps->depth-1];
+    if(top->idx == IDX_NONE)
+        return;
+    ps->trees[top->slot][top->idx].begin.gpu_cookie = cookie;
 }
 
 void Perf_PopGPU(uint32_t cookie)
 {
-    khiter_t k = kh_get(pstate, s_thread_state_table, GPU_STATE_KEY);
-    if(k != kh_end(s_thread_state_table));
-
-    struct perf_state *ps = &kh_val(s_thread_state_table, k);
-    assert(vec_size(&ps->perf_stack) > 0);
-
-    uint32_t idx = vec_idx_pop(&ps->perf_stack);
-    assert(idx < vec_size(&ps->perf_trees[ps->perf_tree_idx]));
-    struct perf_entry *pe = &vec_AT(&ps->perf_trees[ps->perf_tree_idx], idx);
+    uint64_t start;
+    struct perf_entry *pe = perf_pop(s_gpu_state, &start);
+    if(!pe)
+        return;
     pe->end.gpu_cookie = cookie;
 }
 
@@ -347,18 +767,16 @@ void Perf_BeginTick(void)
 {
     ASSERT_IN_MAIN_THREAD();
     s_last_frames_ms[s_last_idx] = SDL_GetTicks();
-
-    khiter_t k = kh_get(pstate, s_thread_state_table, GPU_STATE_KEY);
-    if(k != kh_end(s_thread_state_table));
+    s_frame_begin_pc = SDL_GetPerformanceCounter();
 
     /* commands are just queued now, to be executed next tick when the 
-     * perf_tree_idx moves forward by 1 */
-    struct perf_state *gpu_ps = &kh_val(s_thread_state_table, k);
-    int write_idx = (gpu_ps->perf_tree_idx + 3) % NFRAMES_LOGGED;
+     * slot moves forward by 1 */
+    struct perf_state *gpu_ps = s_gpu_state;
+    int write_idx = (SDL_AtomicGet(&s_slot) + 3) % NFRAMES_LOGGED;
 
-    for(int i = 0; i < vec_size(&gpu_ps->perf_trees[write_idx]); i++) {
+    for(int i = 0; i < gpu_ps->nentries[write_idx]; i++) {
     
-        struct perf_entry *pe = &vec_AT(&gpu_ps->perf_trees[write_idx], i);
+        struct perf_entry *pe = &gpu_ps->trees[write_idx][i];
 
         R_PushCmd((struct rcmd){
             .func = R_GL_TimestampForCookie,
@@ -383,18 +801,44 @@ void Perf_FinishTick(void)
 {
     ASSERT_IN_MAIN_THREAD();
 
-    for(khiter_t k = kh_begin(s_thread_state_table); k != kh_end(s_thread_state_table); k++) {
+    int next = (SDL_AtomicGet(&s_slot) + 1) % NFRAMES_LOGGED;
 
-        if(!kh_exist(s_thread_state_table, k))
-            continue;
+    if(s_frame_begin_pc) {
 
-        struct perf_state *curr = &kh_val(s_thread_state_table, k);
-        assert(vec_size(&curr->perf_stack) == 0);
+        uint64_t pc_delta = SDL_GetPerformanceCounter() - s_frame_begin_pc;
+        uint64_t us = pc_delta * 1000000 / SDL_GetPerformanceFrequency();
+        Perf_RecordTime(PERF_HIST_FRAME, us);
 
-        curr->perf_tree_idx = (curr->perf_tree_idx + 1) % NFRAMES_LOGGED;
-        vec_perf_reset(&curr->perf_trees[curr->perf_tree_idx]);
+        if(s_spike_threshold_ms && us > s_spike_threshold_ms * 1000ull)
+            spike_capture(us / 1000.0);
     }
 
+    /* The slot about to be recycled holds the frame that is being retired. 
+     * It is the same frame that 'Perf_Report' would return now. */
+    uint64_t retired = s_frame - (NFRAMES_LOGGED - 1);
+    if(s_capture.stream && s_frame >= NFRAMES_LOGGED - 1 && retired >= s_capture.first_frame) {
+
+        if(!capture_frame(next)) {
+            fprintf(stderr, "Failed to write perf trace: %s\n", s_capture.path);
+            fflush(stderr);
+            capture_end();
+        }else if(retired + 1 == s_capture.end_frame) {
+            capture_end();
+        }
+    }
+    s_frame++;
+
+    SDL_LockMutex(s_state_lock);
+    for(int i = 0; i < s_nstates; i++) {
+        s_states[i]->nentries[next] = 0;
+    }
+    SDL_UnlockMutex(s_state_lock);
+    s_gpu_state->nentries[next] = 0;
+
+    /* Publish the new slot only after it's been cleared */
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&s_slot, next);
+
     uint32_t curr_time = SDL_GetTicks();
     uint32_t last_ts = s_last_frames_ms[s_last_idx];
     s_last_frames_ms[s_last_idx] = curr_time - last_ts;
@@ -405,45 +849,129 @@ size_t Perf_Report(size_t maxout, struct perf_info **out)
 {
     PERF_ENTER();
 
+    struct perf_state *states[MAX_THREADS + 1];
+    size_t nstates = 0;
+
+    SDL_LockMutex(s_state_lock);
+    for(int i = 0; i < s_nstates; i++) {
+        states[nstates++] = s_states[i];
+    }
+    SDL_UnlockMutex(s_state_lock);
+    states[nstates++] = s_gpu_state;
+
+    double ts_hz = perf_now_hz();
+    int read_idx = (SDL_AtomicGet(&s_slot) + 1) % NFRAMES_LOGGED;
     size_t ret = 0;
-    for(khiter_t k = kh_begin(s_thread_state_table); k != kh_end(s_thread_state_table); k++) {
+
+    SDL_LockMutex(s_zone_lock);
+    for(int i = 0; i < nstates; i++) {
     
-        if(!kh_exist(s_thread_state_table, k))
-            continue;
         if(ret == maxout)
             break;
 
-        struct perf_state *ps = &kh_val(s_thread_state_table, k);
-        int read_idx = (ps->perf_tree_idx + 1) % NFRAMES_LOGGED;
-        struct perf_info *info = malloc(sizeof(struct perf_info) + vec_size(&ps->perf_trees[read_idx]) * sizeof(info->entries[0]));
+        struct perf_info *info = perf_info_create(states[i], read_idx, ts_hz);
         if(!info)
             break;
+        out[ret++] = info;
+    }
+    SDL_UnlockMutex(s_zone_lock);
 
-        pf_strlcpy(info->threadname, ps->name, sizeof(info->threadname));
-        info->nentries = vec_size(&ps->perf_trees[read_idx]);
+    PERF_RETURN(ret);
+}
 
-        for(int i = 0; i < vec_size(&ps->perf_trees[read_idx]); i++) {
+bool Perf_CaptureTrace(const char *path, size_t nframes)
+{
+    ASSERT_IN_MAIN_THREAD();
 
-            const struct perf_entry *entry = &vec_AT(&ps->perf_trees[read_idx], i);
+    if(s_capture.stream || nframes == 0)
+        return false;
 
-            if(k == kh_get(pstate, s_thread_state_table, GPU_STATE_KEY)) {
-                uint64_t hz = GPU_TIMER_HZ;
-                uint64_t delta = abs(entry->end.gpu_ts - entry->begin.gpu_ts);
-                info->entries[i].pc_delta = delta;
-                info->entries[i].ms_delta = (delta * 1000.0 / hz);
-            }else{
-                uint64_t hz = SDL_GetPerformanceFrequency();
-                info->entries[i].pc_delta = entry->pc_delta;
-                info->entries[i].ms_delta = (entry->pc_delta * 1000.0 / hz);
-            }
+    s_capture.stream = SDL_RWFromFile(path, "w");
+    if(!s_capture.stream)
+        return false;
 
-            info->entries[i].funcname = name_for_id(ps, entry->name_id);
-            info->entries[i].parent_idx = entry->parent_idx;
-        }
-        out[ret++] = info;
+    pf_strlcpy(s_capture.path, path, sizeof(s_capture.path));
+    s_capture.first_frame = s_frame;
+    s_capture.end_frame = s_frame + nframes;
+    s_capture.first_event = true;
+    s_capture.have_gpu_offset = false;
+
+    bool ret = capture_printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    SDL_LockMutex(s_state_lock);
+    for(int i = 0; i < s_nstates && ret; i++) {
+        ret = capture_thread_name(s_states[i]->name, i + 1);
     }
+    SDL_UnlockMutex(s_state_lock);
 
-    PERF_RETURN(ret);
+    ret = ret && capture_thread_name(GPU_STATE_NAME, 0);
+    if(!ret) {
+        SDL_RWclose(s_capture.stream);
+        s_capture.stream = NULL;
+    }
+    return ret;
+}
+
+bool Perf_CapturingTrace(void)
+{
+    return (s_capture.stream != NULL);
+}
+
+void Perf_RecordTime(enum perf_hist hist, uint64_t us)
+{
+    assert(hist >= 0 && hist < PERF_HIST_COUNT);
+
+    SDL_LockMutex(s_hist_lock);
+    hist_add(&s_hists[hist], us);
+    SDL_UnlockMutex(s_hist_lock);
+}
+
+void Perf_GetPercentiles(enum perf_hist hist, struct perf_percentiles *out)
+{
+    assert(hist >= 0 && hist < PERF_HIST_COUNT);
+    const struct perf_rolling_hist *rh = &s_hists[hist];
+
+    SDL_LockMutex(s_hist_lock);
+
+    uint64_t max_us = rh->halves[0].max_us > rh->halves[1].max_us 
+                    ? rh->halves[0].max_us : rh->halves[1].max_us;
+    *out = (struct perf_percentiles){
+        .nsamples = rh->halves[0].total + rh->halves[1].total,
+        .p50_ms = hist_percentile(rh, 0.50) / 1000.0,
+        .p95_ms = hist_percentile(rh, 0.95) / 1000.0,
+        .p99_ms = hist_percentile(rh, 0.99) / 1000.0,
+        .max_ms = max_us / 1000.0,
+    };
+
+    SDL_UnlockMutex(s_hist_lock);
+}
+
+void Perf_SetSpikeThreshold(uint32_t ms)
+{
+    ASSERT_IN_MAIN_THREAD();
+    s_spike_threshold_ms = ms;
+}
+
+size_t Perf_NumSpikes(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+    return s_nspikes;
+}
+
+const struct perf_spike *Perf_GetSpike(size_t idx)
+{
+    ASSERT_IN_MAIN_THREAD();
+    if(idx >= s_nspikes)
+        return NULL;
+    return s_spikes[idx];
+}
+
+void Perf_ClearSpikes(void)
+{
+    for(int i = 0; i < s_nspikes; i++) {
+        spike_free(s_spikes[i]);
+    }
+    s_nspikes = 0;
 }
 
 uint32_t Perf_LastFrameMS(void)
@@ -451,4 +979,3 @@ uint32_t Perf_LastFrameMS(void)
     int read_idx = (s_last_idx + 1) % NFRAMES_LOGGED;
     return s_last_frames_ms[read_idx];
 }
-
@@ -38,13 +38,22 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <SDL_thread.h>
 
-#ifndef NDEBUG
-
-#define PERF_ENTER()            \
-    do{                         \
-        Perf_Push(__func__);    \
+/* The profiler is compiled into all builds, so that it's possible to profile the 
+ * binaries that we ship. Whether the zones are recorded is toggled at runtime. The 
+ * name of every zone is interned the first time it is entered, so each later entry 
+ * is just a thread-local push of the cached ID and a timestamp. Define PF_NO_PERF
+ * to compile out all the zones. */
+#ifndef PF_NO_PERF
+
+#define PERF_ENTER()                                    \
+    do{                                                 \
+        static uint32_t s_perf_zone_id;                 \
+        if(!s_perf_zone_id)                             \
+            s_perf_zone_id = Perf_InternZone(__func__); \
+        Perf_PushZone(s_perf_zone_id);                  \
     }while(0)
 
 #define PERF_RETURN(...)        \
@@ -68,7 +77,8 @@
 #endif
 
 
-#define NFRAMES_LOGGED  (5)
+#define NFRAMES_LOGGED      (5)
+#define PERF_MAX_THREADS    (16)
 
 
 struct perf_info{
@@ -82,6 +92,36 @@ struct perf_info{
     }entries[];
 };
 
+enum perf_hist{
+    PERF_HIST_FRAME,    /* Full frame, from the start of one to the next */
+    PERF_HIST_SIM,      /* Main thread work of the frame (events, simulation, render submission) */
+    PERF_HIST_RENDER,   /* Render thread work of the frame */
+    PERF_HIST_COUNT
+};
+
+struct perf_percentiles{
+    uint64_t nsamples;
+    double   p50_ms;
+    double   p95_ms;
+    double   p99_ms;
+    double   max_ms;
+};
+
+/* The perf trees of a frame that exceeded the spike threshold, as well as of 
+ * the frames preceding it. GPU timings are not included, as they are not yet 
+ * available for the most recent frames. */
+struct perf_spike{
+    uint64_t          frame;
+    double            frame_ms;
+    size_t            nframes;  /* Ordered from oldest to the spike frame */
+    size_t            nthreads[NFRAMES_LOGGED];
+    struct perf_info *frames[NFRAMES_LOGGED][PERF_MAX_THREADS];
+};
+
+/* Returns a non-zero ID that is unique to the name. Safe to call from any thread. */
+uint32_t Perf_InternZone(const char *name);
+void     Perf_PushZone(uint32_t zone_id);
+/* Slower variant for zones with names that are only known at runtime */
 void     Perf_Push(const char *name);
 void     Perf_Pop(void);
 
@@ -101,6 +141,30 @@ void     Perf_PopGPU(uint32_t cookie);
 size_t   Perf_Report(size_t maxout, struct perf_info **out);
 uint32_t Perf_LastFrameMS(void);
 
+/* Stream all the zones (CPU and GPU) of the next 'nframes' frames to a file in the
+ * Chrome Trace Event JSON format. Like the reports, the frames are written once 
+ * they are NFRAMES_LOGGED old. Returns false if a capture is already in progress. */
+bool     Perf_CaptureTrace(const char *path, size_t nframes);
+bool     Perf_CapturingTrace(void);
+
+/* Frame timings are kept in rolling histograms regardless of whether profiling
+ * is enabled. Recording a time is safe from any thread. */
+void     Perf_RecordTime(enum perf_hist hist, uint64_t us);
+void     Perf_GetPercentiles(enum perf_hist hist, struct perf_percentiles *out);
+
+/* A threshold of 0 disables the capture of spikes. Only the most recent spikes
+ * are kept. The returned spikes are owned by the Perf_ module and remain valid 
+ * until the next call to 'Perf_ClearSpikes' or 'Perf_FinishTick'. */
+void     Perf_SetSpikeThreshold(uint32_t ms);
+size_t   Perf_NumSpikes(void);
+const struct perf_spike *Perf_GetSpike(size_t idx);
+void     Perf_ClearSpikes(void);
+
+/* Zones are only recorded while profiling is enabled. By default, it is 
+ * enabled in debug builds and disabled in release builds. */
+void     Perf_SetEnabled(bool on);
+bool     Perf_Enabled(void);
+
 /* The following can only be called from the main thread, making sure that 
  * none of the other threads are touching the Perf_ API concurrently */
 bool     Perf_Init(void);
@@ -0,0 +1,747 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+/* The null render backend replaces OpenGL and GLEW with stubs that keep just 
+ * enough state for the engine-side rendering code to run as usual (object 
+ * names, buffer contents and mappings, texture dimensions, a few queries). 
+ * Nothing is drawn. It is selected at build time with 'make RENDER=NULL', in 
+ * which case neither OpenGL nor GLEW are linked and a GL context is never 
+ * created. Together with a headless window (ex. 'SDL_VIDEODRIVER=dummy'), 
+ * this allows profiling the CPU side of rendering on machines without a GPU.
+ */
+
+#if defined(PF_NULL_RENDER)
+
+#include "gl_null.h"
+#include "../lib/public/khash.h"
+
+#include <GL/glew.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+
+#define ARR_SIZE(a)     (sizeof(a)/sizeof(a[0]))
+#define MAX_TEX_UNITS   (32)
+#define MAX_TEX_LEVEL   (1000)
+
+struct null_buffer{
+    GLsizeiptr     size;
+    /* NULL until the contents are specified or the buffer is mapped */
+    unsigned char *data;
+};
+
+struct null_texture{
+    GLint width;
+    GLint height;
+    GLint depth;
+    GLint max_level;
+};
+
+enum buffer_target{
+    BUFF_ARRAY,
+    BUFF_ELEMENT_ARRAY,
+    BUFF_TEXTURE,
+    BUFF_COPY_READ,
+    BUFF_COPY_WRITE,
+    BUFF_DRAW_INDIRECT,
+    BUFF_UNIFORM,
+    BUFF_PIXEL_PACK,
+    BUFF_PIXEL_UNPACK,
+    BUFF_OTHER,
+    BUFF_NUM_TARGETS
+};
+
+enum texture_target{
+    TEX_2D,
+    TEX_2D_ARRAY,
+    TEX_BUFFER,
+    TEX_CUBE_MAP,
+    TEX_OTHER,
+    TEX_NUM_TARGETS
+};
+
+KHASH_MAP_INIT_INT(buff, struct null_buffer)
+KHASH_MAP_INIT_INT(tex, struct null_texture)
+
+/*****************************************************************************/
+/* GLOBAL VARIABLES                                                          */
+/*****************************************************************************/
+
+GLboolean glewExperimental;
+
+GLboolean __GLEW_VERSION_3_3 = GL_TRUE;
+/* Take the simplest code paths */
+GLboolean __GLEW_KHR_debug = GL_FALSE;
+GLboolean __GLEW_ARB_buffer_storage = GL_FALSE;
+GLboolean __GLEW_ARB_copy_image = GL_FALSE;
+
+/*****************************************************************************/
+/* STATIC VARIABLES                                                          */
+/*****************************************************************************/
+
+static khash_t(buff) *s_buffers;
+static khash_t(tex)  *s_textures;
+
+static GLuint         s_next_name = 1;
+static uintptr_t      s_next_sync = 1;
+
+static GLuint         s_bound_buffers[BUFF_NUM_TARGETS];
+static GLuint         s_bound_textures[MAX_TEX_UNITS][TEX_NUM_TARGETS];
+static int            s_active_unit;
+static GLint          s_viewport[4];
+static GLint          s_draw_fb;
+static GLfloat        s_line_width = 1.0f;
+static GLfloat        s_clear_color[4];
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static void gen_names(GLsizei n, GLuint *out)
+{
+    for(int i = 0; i < n; i++) {
+        out[i] = s_next_name++;
+    }
+}
+
+static enum buffer_target buffer_target(GLenum target)
+{
+    switch(target) {
+    case GL_ARRAY_BUFFER:           return BUFF_ARRAY;
+    case GL_ELEMENT_ARRAY_BUFFER:   return BUFF_ELEMENT_ARRAY;
+    case GL_TEXTURE_BUFFER:         return BUFF_TEXTURE;
+    case GL_COPY_READ_BUFFER:       return BUFF_COPY_READ;
+    case GL_COPY_WRITE_BUFFER:      return BUFF_COPY_WRITE;
+    case GL_DRAW_INDIRECT_BUFFER:   return BUFF_DRAW_INDIRECT;
+    case GL_UNIFORM_BUFFER:         return BUFF_UNIFORM;
+    case GL_PIXEL_PACK_BUFFER:      return BUFF_PIXEL_PACK;
+    case GL_PIXEL_UNPACK_BUFFER:    return BUFF_PIXEL_UNPACK;
+    default:                        return BUFF_OTHER;
+    }
+}
+
+static enum texture_target texture_target(GLenum target)
+{
+    switch(target) {
+    case GL_TEXTURE_2D:             return TEX_2D;
+    case GL_TEXTURE_2D_ARRAY:       return TEX_2D_ARRAY;
+    case GL_TEXTURE_BUFFER:         return TEX_BUFFER;
+    case GL_TEXTURE_CUBE_MAP:       return TEX_CUBE_MAP;
+    default:                        return TEX_OTHER;
+    }
+}
+
+static struct null_buffer *bound_buffer(GLenum target)
+{
+    GLuint name = s_bound_buffers[buffer_target(target)];
+    if(name == 0)
+        return NULL;
+
+    khiter_t k = kh_get(buff, s_buffers, name);
+    if(k == kh_end(s_buffers))
+        return NULL;
+    return &kh_value(s_buffers, k);
+}
+
+static struct null_texture *bound_texture(GLenum target)
+{
+    GLuint name = s_bound_textures[s_active_unit][texture_target(target)];
+    if(name == 0)
+        return NULL;
+
+    khiter_t k = kh_get(tex, s_textures, name);
+    if(k == kh_end(s_textures))
+        return NULL;
+    return &kh_value(s_textures, k);
+}
+
+static bool buffer_ensure_storage(struct null_buffer *buff)
+{
+    if(buff->data)
+        return true;
+    buff->data = calloc(buff->size ? buff->size : 1, 1);
+    return (buff->data != NULL);
+}
+
+static void buffer_specify(GLenum target, GLsizeiptr size, const void *data)
+{
+    struct null_buffer *buff = bound_buffer(target);
+    if(!buff)
+        return;
+
+    free(buff->data);
+    buff->data = NULL;
+    buff->size = size;
+
+    if(data && buffer_ensure_storage(buff)) {
+        memcpy(buff->data, data, size);
+    }
+}
+
+static size_t pixel_size(GLenum format, GLenum type)
+{
+    size_t ncomps;
+    switch(format) {
+    case GL_RED: 
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:      ncomps = 1; break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+    case GL_DEPTH_STENCIL:      ncomps = 2; break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:        ncomps = 3; break;
+    default:                    ncomps = 4; break;
+    }
+
+    switch(type) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:               return ncomps;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:         return ncomps * 2;
+    default:                    return ncomps * 4;
+    }
+}
+
+static void texture_specify(GLenum target, GLint level, GLsizei width, GLsizei height, GLsizei depth)
+{
+    struct null_texture *tex = bound_texture(target);
+    if(!tex || level != 0)
+        return;
+
+    tex->width = width;
+    tex->height = height;
+    tex->depth = depth;
+}
+
+/* Buffers */
+
+static void GLAPIENTRY null_GenBuffers(GLsizei n, GLuint *buffers)
+{
+    gen_names(n, buffers);
+    for(int i = 0; i < n; i++) {
+        int status;
+        khiter_t k = kh_put(buff, s_buffers, buffers[i], &status);
+        if(status == -1)
+            continue;
+        kh_value(s_buffers, k) = (struct null_buffer){0};
+    }
+}
+
+static void GLAPIENTRY null_DeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+    for(int i = 0; i < n; i++) {
+        khiter_t k = kh_get(buff, s_buffers, buffers[i]);
+        if(k == kh_end(s_buffers))
+            continue;
+        free(kh_value(s_buffers, k).data);
+        kh_del(buff, s_buffers, k);
+
+        for(int j = 0; j < BUFF_NUM_TARGETS; j++) {
+            if(s_bound_buffers[j] == buffers[i])
+                s_bound_buffers[j] = 0;
+        }
+    }
+}
+
+static void GLAPIENTRY null_BindBuffer(GLenum target, GLuint buffer)
+{
+    s_bound_buffers[buffer_target(target)] = buffer;
+}
+
+static void GLAPIENTRY null_BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    buffer_specify(target, size, data);
+}
+
+static void GLAPIENTRY null_BufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+    buffer_specify(target, size, data);
+}
+
+static void *GLAPIENTRY null_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    struct null_buffer *buff = bound_buffer(target);
+    if(!buff || offset + length > buff->size)
+        return NULL;
+    if(!buffer_ensure_storage(buff))
+        return NULL;
+    return buff->data + offset;
+}
+
+static void *GLAPIENTRY null_MapBuffer(GLenum target, GLenum access)
+{
+    struct null_buffer *buff = bound_buffer(target);
+    if(!buff)
+        return NULL;
+    return null_MapBufferRange(target, 0, buff->size, 0);
+}
+
+static GLboolean GLAPIENTRY null_UnmapBuffer(GLenum target)
+{
+    return GL_TRUE;
+}
+
+static void GLAPIENTRY null_CopyBufferSubData(GLenum readtarget, GLenum writetarget, 
+                                              GLintptr readoffset, GLintptr writeoffset, GLsizeiptr size)
+{
+    struct null_buffer *src = bound_buffer(readtarget);
+    struct null_buffer *dst = bound_buffer(writetarget);
+    if(!src || !dst || !src->data)
+        return;
+    if(readoffset + size > src->size || writeoffset + size > dst->size)
+        return;
+    if(!buffer_ensure_storage(dst))
+        return;
+    memmove(dst->data + writeoffset, src->data + readoffset, size);
+}
+
+static void GLAPIENTRY null_GetBufferParameteriv(GLenum target, GLenum pname, GLint *params)
+{
+    struct null_buffer *buff = bound_buffer(target);
+    *params = (buff && pname == GL_BUFFER_SIZE) ? buff->size : 0;
+}
+
+/* Textures */
+
+static void GLAPIENTRY null_ActiveTexture(GLenum texture)
+{
+    int unit = texture - GL_TEXTURE0;
+    assert(unit >= 0 && unit < MAX_TEX_UNITS);
+    s_active_unit = unit;
+}
+
+static void GLAPIENTRY null_TexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, 
+                                       GLsizei height, GLsizei depth, GLint border, GLenum format, 
+                                       GLenum type, const void *pixels)
+{
+    texture_specify(target, level, width, height, depth);
+}
+
+/* Shaders */
+
+static GLuint GLAPIENTRY null_CreateShader(GLenum type)
+{
+    return s_next_name++;
+}
+
+static GLuint GLAPIENTRY null_CreateProgram(void)
+{
+    return s_next_name++;
+}
+
+static void GLAPIENTRY null_GetShaderiv(GLuint shader, GLenum pname, GLint *param)
+{
+    *param = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+static void GLAPIENTRY null_GetProgramiv(GLuint program, GLenum pname, GLint *param)
+{
+    *param = (pname == GL_LINK_STATUS || pname == GL_VALIDATE_STATUS) ? GL_TRUE : 0;
+}
+
+static void GLAPIENTRY null_GetInfoLog(GLuint obj, GLsizei bufsize, GLsizei *length, GLchar *log)
+{
+    if(length)
+        *length = 0;
+    if(bufsize > 0)
+        log[0] = '\0';
+}
+
+static GLint GLAPIENTRY null_GetUniformLocation(GLuint program, const GLchar *name)
+{
+    return 0;
+}
+
+/* Framebuffers, queries and syncs */
+
+static void GLAPIENTRY null_BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if(target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+        s_draw_fb = framebuffer;
+}
+
+static GLenum GLAPIENTRY null_CheckFramebufferStatus(GLenum target)
+{
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void GLAPIENTRY null_GetQueryObjectiv(GLuint id, GLenum pname, GLint *params)
+{
+    *params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static void GLAPIENTRY null_GetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params)
+{
+    *params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static GLsync GLAPIENTRY null_FenceSync(GLenum condition, GLbitfield flags)
+{
+    return (GLsync)s_next_sync++;
+}
+
+static GLenum GLAPIENTRY null_ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    return GL_ALREADY_SIGNALED;
+}
+
+/* Everything else only affects what gets drawn */
+
+static void GLAPIENTRY null_AttachShader(GLuint program, GLuint shader) {}
+static void GLAPIENTRY null_BindRenderbuffer(GLenum target, GLuint renderbuffer) {}
+static void GLAPIENTRY null_BindVertexArray(GLuint array) {}
+static void GLAPIENTRY null_BlendEquation(GLenum mode) {}
+static void GLAPIENTRY null_BlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, 
+                                            GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, 
+                                            GLenum filter) {}
+static void GLAPIENTRY null_CompileShader(GLuint shader) {}
+static void GLAPIENTRY null_CopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, 
+                                             GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, 
+                                             GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, 
+                                             GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth) {}
+static void GLAPIENTRY null_DebugMessageCallback(GLDEBUGPROC callback, const void *userParam) {}
+static void GLAPIENTRY null_DebugMessageControl(GLenum source, GLenum type, GLenum severity, GLsizei count, 
+                                                const GLuint *ids, GLboolean enabled) {}
+static void GLAPIENTRY null_DeleteNames(GLsizei n, const GLuint *names) {}
+static void GLAPIENTRY null_DeleteObject(GLuint obj) {}
+static void GLAPIENTRY null_DeleteSync(GLsync sync) {}
+static void GLAPIENTRY null_DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei primcount) {}
+static void GLAPIENTRY null_DrawBuffers(GLsizei n, const GLenum *bufs) {}
+static void GLAPIENTRY null_EnableVertexAttribArray(GLuint index) {}
+static void GLAPIENTRY null_FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum rbtarget, 
+                                                    GLuint renderbuffer) {}
+static void GLAPIENTRY null_FramebufferTexture(GLenum target, GLenum attachment, GLuint texture, GLint level) {}
+static void GLAPIENTRY null_FramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, 
+                                                    GLint level, GLint layer) {}
+static void GLAPIENTRY null_GenerateMipmap(GLenum target) {}
+static void GLAPIENTRY null_MultiDrawArraysIndirect(GLenum mode, const void *indirect, GLsizei primcount, 
+                                                    GLsizei stride) {}
+static void GLAPIENTRY null_ProvokingVertex(GLenum mode) {}
+static void GLAPIENTRY null_QueryCounter(GLuint id, GLenum target) {}
+static void GLAPIENTRY null_RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, 
+                                                GLsizei height) {}
+static void GLAPIENTRY null_ShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, 
+                                         const GLint *length) {}
+static void GLAPIENTRY null_TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) {}
+static void GLAPIENTRY null_TexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, 
+                                          GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, 
+                                          GLenum format, GLenum type, const void *pixels) {}
+static void GLAPIENTRY null_Uniformfv(GLint location, GLsizei count, const GLfloat *value) {}
+static void GLAPIENTRY null_Uniformiv(GLint location, GLsizei count, const GLint *value) {}
+static void GLAPIENTRY null_UniformMatrixfv(GLint location, GLsizei count, GLboolean transpose, 
+                                            const GLfloat *value) {}
+static void GLAPIENTRY null_UseProgram(GLuint program) {}
+static void GLAPIENTRY null_VertexAttribDivisor(GLuint index, GLuint divisor) {}
+static void GLAPIENTRY null_VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, 
+                                                 const void *pointer) {}
+static void GLAPIENTRY null_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, 
+                                                GLsizei stride, const void *pointer) {}
+
+/*****************************************************************************/
+/* GLEW ENTRY POINTS                                                         */
+/*****************************************************************************/
+
+PFNGLACTIVETEXTUREPROC              __glewActiveTexture = null_ActiveTexture;
+PFNGLATTACHSHADERPROC               __glewAttachShader = null_AttachShader;
+PFNGLBINDBUFFERPROC                 __glewBindBuffer = null_BindBuffer;
+PFNGLBINDFRAMEBUFFERPROC            __glewBindFramebuffer = null_BindFramebuffer;
+PFNGLBINDRENDERBUFFERPROC           __glewBindRenderbuffer = null_BindRenderbuffer;
+PFNGLBINDVERTEXARRAYPROC            __glewBindVertexArray = null_BindVertexArray;
+PFNGLBLENDEQUATIONPROC              __glewBlendEquation = null_BlendEquation;
+PFNGLBLITFRAMEBUFFERPROC            __glewBlitFramebuffer = null_BlitFramebuffer;
+PFNGLBUFFERDATAPROC                 __glewBufferData = null_BufferData;
+PFNGLBUFFERSTORAGEPROC              __glewBufferStorage = null_BufferStorage;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC     __glewCheckFramebufferStatus = null_CheckFramebufferStatus;
+PFNGLCLIENTWAITSYNCPROC             __glewClientWaitSync = null_ClientWaitSync;
+PFNGLCOMPILESHADERPROC              __glewCompileShader = null_CompileShader;
+PFNGLCOPYBUFFERSUBDATAPROC          __glewCopyBufferSubData = null_CopyBufferSubData;
+PFNGLCOPYIMAGESUBDATAPROC           __glewCopyImageSubData = null_CopyImageSubData;
+PFNGLCREATEPROGRAMPROC              __glewCreateProgram = null_CreateProgram;
+PFNGLCREATESHADERPROC               __glewCreateShader = null_CreateShader;
+PFNGLDEBUGMESSAGECALLBACKPROC       __glewDebugMessageCallback = null_DebugMessageCallback;
+PFNGLDEBUGMESSAGECONTROLPROC        __glewDebugMessageControl = null_DebugMessageControl;
+PFNGLDELETEBUFFERSPROC              __glewDeleteBuffers = null_DeleteBuffers;
+PFNGLDELETEFRAMEBUFFERSPROC         __glewDeleteFramebuffers = null_DeleteNames;
+PFNGLDELETEQUERIESPROC              __glewDeleteQueries = null_DeleteNames;
+PFNGLDELETERENDERBUFFERSPROC        __glewDeleteRenderbuffers = null_DeleteNames;
+PFNGLDELETESHADERPROC               __glewDeleteShader = null_DeleteObject;
+PFNGLDELETESYNCPROC                 __glewDeleteSync = null_DeleteSync;
+PFNGLDELETEVERTEXARRAYSPROC         __glewDeleteVertexArrays = null_DeleteNames;
+PFNGLDRAWARRAYSINSTANCEDPROC        __glewDrawArraysInstanced = null_DrawArraysInstanced;
+PFNGLDRAWBUFFERSPROC                __glewDrawBuffers = null_DrawBuffers;
+PFNGLENABLEVERTEXATTRIBARRAYPROC    __glewEnableVertexAttribArray = null_EnableVertexAttribArray;
+PFNGLFENCESYNCPROC                  __glewFenceSync = null_FenceSync;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC    __glewFramebufferRenderbuffer = null_FramebufferRenderbuffer;
+PFNGLFRAMEBUFFERTEXTUREPROC         __glewFramebufferTexture = null_FramebufferTexture;
+PFNGLFRAMEBUFFERTEXTURELAYERPROC    __glewFramebufferTextureLayer = null_FramebufferTextureLayer;
+PFNGLGENBUFFERSPROC                 __glewGenBuffers = null_GenBuffers;
+PFNGLGENFRAMEBUFFERSPROC            __glewGenFramebuffers = gen_names;
+PFNGLGENQUERIESPROC                 __glewGenQueries = gen_names;
+PFNGLGENRENDERBUFFERSPROC           __glewGenRenderbuffers = gen_names;
+PFNGLGENVERTEXARRAYSPROC            __glewGenVertexArrays = gen_names;
+PFNGLGENERATEMIPMAPPROC             __glewGenerateMipmap = null_GenerateMipmap;
+PFNGLGETBUFFERPARAMETERIVPROC       __glewGetBufferParameteriv = null_GetBufferParameteriv;
+PFNGLGETPROGRAMINFOLOGPROC          __glewGetProgramInfoLog = null_GetInfoLog;
+PFNGLGETPROGRAMIVPROC               __glewGetProgramiv = null_GetProgramiv;
+PFNGLGETQUERYOBJECTIVPROC           __glewGetQueryObjectiv = null_GetQueryObjectiv;
+PFNGLGETQUERYOBJECTUI64VPROC        __glewGetQueryObjectui64v = null_GetQueryObjectui64v;
+PFNGLGETSHADERINFOLOGPROC           __glewGetShaderInfoLog = null_GetInfoLog;
+PFNGLGETSHADERIVPROC                __glewGetShaderiv = null_GetShaderiv;
+PFNGLGETUNIFORMLOCATIONPROC         __glewGetUniformLocation = null_GetUniformLocation;
+PFNGLLINKPROGRAMPROC                __glewLinkProgram = null_DeleteObject;
+PFNGLMAPBUFFERPROC                  __glewMapBuffer = null_MapBuffer;
+PFNGLMAPBUFFERRANGEPROC             __glewMapBufferRange = null_MapBufferRange;
+PFNGLMULTIDRAWARRAYSINDIRECTPROC    __glewMultiDrawArraysIndirect = null_MultiDrawArraysIndirect;
+PFNGLPROVOKINGVERTEXPROC            __glewProvokingVertex = null_ProvokingVertex;
+PFNGLQUERYCOUNTERPROC               __glewQueryCounter = null_QueryCounter;
+PFNGLRENDERBUFFERSTORAGEPROC        __glewRenderbufferStorage = null_RenderbufferStorage;
+PFNGLSHADERSOURCEPROC               __glewShaderSource = null_ShaderSource;
+PFNGLTEXBUFFERPROC                  __glewTexBuffer = null_TexBuffer;
+PFNGLTEXIMAGE3DPROC                 __glewTexImage3D = null_TexImage3D;
+PFNGLTEXSUBIMAGE3DPROC              __glewTexSubImage3D = null_TexSubImage3D;
+PFNGLUNIFORM1FVPROC                 __glewUniform1fv = null_Uniformfv;
+PFNGLUNIFORM1IVPROC                 __glewUniform1iv = null_Uniformiv;
+PFNGLUNIFORM2FVPROC                 __glewUniform2fv = null_Uniformfv;
+PFNGLUNIFORM2IVPROC                 __glewUniform2iv = null_Uniformiv;
+PFNGLUNIFORM3FVPROC                 __glewUniform3fv = null_Uniformfv;
+PFNGLUNIFORM3IVPROC                 __glewUniform3iv = null_Uniformiv;
+PFNGLUNIFORM4FVPROC                 __glewUniform4fv = null_Uniformfv;
+PFNGLUNIFORM4IVPROC                 __glewUniform4iv = null_Uniformiv;
+PFNGLUNIFORMMATRIX3FVPROC           __glewUniformMatrix3fv = null_UniformMatrixfv;
+PFNGLUNIFORMMATRIX4FVPROC           __glewUniformMatrix4fv = null_UniformMatrixfv;
+PFNGLUNMAPBUFFERPROC                __glewUnmapBuffer = null_UnmapBuffer;
+PFNGLUSEPROGRAMPROC                 __glewUseProgram = null_UseProgram;
+PFNGLVERTEXATTRIBDIVISORPROC        __glewVertexAttribDivisor = null_VertexAttribDivisor;
+PFNGLVERTEXATTRIBIPOINTERPROC       __glewVertexAttribIPointer = null_VertexAttribIPointer;
+PFNGLVERTEXATTRIBPOINTERPROC        __glewVertexAttribPointer = null_VertexAttribPointer;
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+GLenum GLEWAPIENTRY glewInit(void)
+{
+    s_buffers = kh_init(buff);
+    s_textures = kh_init(tex);
+    if(!s_buffers || !s_textures)
+        return GLEW_ERROR_NO_GL_VERSION;
+    return GLEW_OK;
+}
+
+void R_GL_NullShutdown(void)
+{
+    struct null_buffer buff;
+    kh_foreach_value(s_buffers, buff, {
+        free(buff.data);
+    });
+    kh_destroy(buff, s_buffers);
+    kh_destroy(tex, s_textures);
+}
+
+/* OpenGL 1.1 */
+
+void GLAPIENTRY glBindTexture(GLenum target, GLuint texture)
+{
+    s_bound_textures[s_active_unit][texture_target(target)] = texture;
+}
+
+void GLAPIENTRY glGenTextures(GLsizei n, GLuint *textures)
+{
+    gen_names(n, textures);
+    for(int i = 0; i < n; i++) {
+        int status;
+        khiter_t k = kh_put(tex, s_textures, textures[i], &status);
+        if(status == -1)
+            continue;
+        kh_value(s_textures, k) = (struct null_texture){.max_level = MAX_TEX_LEVEL};
+    }
+}
+
+void GLAPIENTRY glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+    for(int i = 0; i < n; i++) {
+        khiter_t k = kh_get(tex, s_textures, textures[i]);
+        if(k != kh_end(s_textures))
+            kh_del(tex, s_textures, k);
+    }
+}
+
+void GLAPIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, 
+                             GLint border, GLenum format, GLenum type, const void *pixels)
+{
+    texture_specify(target, level, width, height, 1);
+}
+
+void GLAPIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    struct null_texture *tex = bound_texture(target);
+    if(tex && pname == GL_TEXTURE_MAX_LEVEL)
+        tex->max_level = param;
+}
+
+void GLAPIENTRY glTexParameterf(GLenum target, GLenum pname, GLfloat param)
+{
+    glTexParameteri(target, pname, param);
+}
+
+void GLAPIENTRY glGetTexParameteriv(GLenum target, GLenum pname, GLint *params)
+{
+    struct null_texture *tex = bound_texture(target);
+    *params = (tex && pname == GL_TEXTURE_MAX_LEVEL) ? tex->max_level : 0;
+}
+
+void GLAPIENTRY glGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint *params)
+{
+    struct null_texture *tex = bound_texture(target);
+    if(!tex) {
+        *params = 0;
+        return;
+    }
+
+    switch(pname) {
+    case GL_TEXTURE_WIDTH:  *params = tex->width  >> level; break;
+    case GL_TEXTURE_HEIGHT: *params = tex->height >> level; break;
+    case GL_TEXTURE_DEPTH:  *params = tex->depth; break;
+    default:                *params = 0;
+    }
+}
+
+void GLAPIENTRY glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void *pixels)
+{
+    struct null_texture *tex = bound_texture(target);
+    if(!tex)
+        return;
+    size_t npixels = (size_t)(tex->width >> level) * (tex->height >> level) * tex->depth;
+    memset(pixels, 0, npixels * pixel_size(format, type));
+}
+
+void GLAPIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, 
+                             GLenum type, void *pixels)
+{
+    memset(pixels, 0, (size_t)width * height * pixel_size(format, type));
+}
+
+void GLAPIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    s_viewport[0] = x;
+    s_viewport[1] = y;
+    s_viewport[2] = width;
+    s_viewport[3] = height;
+}
+
+void GLAPIENTRY glLineWidth(GLfloat width)
+{
+    s_line_width = width;
+}
+
+void GLAPIENTRY glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
+{
+    s_clear_color[0] = red;
+    s_clear_color[1] = green;
+    s_clear_color[2] = blue;
+    s_clear_color[3] = alpha;
+}
+
+void GLAPIENTRY glGetIntegerv(GLenum pname, GLint *params)
+{
+    switch(pname) {
+    case GL_VIEWPORT:
+        memcpy(params, s_viewport, sizeof(s_viewport));
+        break;
+    case GL_FRAMEBUFFER_BINDING:
+        *params = s_draw_fb;
+        break;
+    default:
+        *params = 0;
+    }
+}
+
+void GLAPIENTRY glGetFloatv(GLenum pname, GLfloat *params)
+{
+    switch(pname) {
+    case GL_LINE_WIDTH:
+        *params = s_line_width;
+        break;
+    case GL_COLOR_CLEAR_VALUE:
+        memcpy(params, s_clear_color, sizeof(s_clear_color));
+        break;
+    default:
+        *params = 0.0f;
+    }
+}
+
+const GLubyte *GLAPIENTRY glGetString(GLenum name)
+{
+    switch(name) {
+    case GL_VENDOR:                     return (const GLubyte*)"Permafrost Engine";
+    case GL_RENDERER:                   return (const GLubyte*)"Null Renderer";
+    case GL_VERSION:                    return (const GLubyte*)"3.3";
+    case GL_SHADING_LANGUAGE_VERSION:   return (const GLubyte*)"3.30";
+    default:                            return (const GLubyte*)"";
+    }
+}
+
+GLenum GLAPIENTRY glGetError(void)
+{
+    return GL_NO_ERROR;
+}
+
+void GLAPIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) {}
+void GLAPIENTRY glClear(GLbitfield mask) {}
+void GLAPIENTRY glCullFace(GLenum mode) {}
+void GLAPIENTRY glDepthMask(GLboolean flag) {}
+void GLAPIENTRY glDisable(GLenum cap) {}
+void GLAPIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) {}
+void GLAPIENTRY glDrawBuffer(GLenum mode) {}
+void GLAPIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {}
+void GLAPIENTRY glEnable(GLenum cap) {}
+void GLAPIENTRY glFinish(void) {}
+void GLAPIENTRY glFrontFace(GLenum mode) {}
+void GLAPIENTRY glPixelStorei(GLenum pname, GLint param) {}
+void GLAPIENTRY glPointSize(GLfloat size) {}
+void GLAPIENTRY glReadBuffer(GLenum mode) {}
+void GLAPIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {}
+void GLAPIENTRY glStencilFunc(GLenum func, GLint ref, GLuint mask) {}
+void GLAPIENTRY glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {}
+
+#endif //PF_NULL_RENDER
+
@@ -41,7 +41,7 @@
 
 #include "gl_assert.h"
 
-#ifndef NDEBUG
+#ifndef PF_NO_PERF
 
 extern bool g_trace_gpu;
 
@@ -69,7 +69,7 @@ extern bool g_trace_gpu;
 
 #define GL_PERF_ENTER()                         \
     do{                                         \
-        Perf_Push(__func__);                    \
+        PERF_ENTER();                           \
         GL_GPU_PERF_PUSH(__func__);             \
     }while(0)
 
@@ -96,7 +96,7 @@ extern bool g_trace_gpu;
 #define GL_PERF_RETURN(...) do {return (__VA_ARGS__); } while(0)
 #define GL_PERF_RETURN_VOID(...) do { return; } while(0)
 
-#endif //NDEBUG
+#endif //PF_NO_PERF
 
 #endif
 
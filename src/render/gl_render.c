@@ -644,18 +644,40 @@ void R_GL_DrawOBB(const struct entity *ent)
 
 void R_GL_DrawBox2D(const vec2_t *screen_pos, const vec2_t *signed_size, 
                     const vec3_t *color, const float *width)
+{
+    struct box2d box = (struct box2d){
+        .screen_pos = *screen_pos,
+        .signed_size = *signed_size,
+        .color = *color,
+        .width = *width,
+    };
+    R_GL_DrawBox2Ds(&box, &(size_t){1});
+}
+
+void R_GL_DrawBox2Ds(const struct box2d *boxes, const size_t *nboxes)
 {
     GL_PERF_ENTER();
     ASSERT_IN_RENDER_THREAD();
 
+    if(*nboxes == 0)
+        GL_PERF_RETURN_VOID();
+
     GLuint VAO, VBO;
 
-    vec3_t vbuff[4] = {
-        (vec3_t){screen_pos->x,                  screen_pos->y,                  0.0f},
-        (vec3_t){screen_pos->x + signed_size->x, screen_pos->y,                  0.0f},
-        (vec3_t){screen_pos->x + signed_size->x, screen_pos->y + signed_size->y, 0.0f},
-        (vec3_t){screen_pos->x,                  screen_pos->y + signed_size->y, 0.0f},
-    };
+    vec3_t *vbuff = malloc(*nboxes * 4 * sizeof(vec3_t));
+    if(!vbuff)
+        GL_PERF_RETURN_VOID();
+
+    for(int i = 0; i < *nboxes; i++) {
+
+        const vec2_t *screen_pos = &boxes[i].screen_pos;
+        const vec2_t *signed_size = &boxes[i].signed_size;
+
+        vbuff[i * 4 + 0] = (vec3_t){screen_pos->x,                  screen_pos->y,                  0.0f};
+        vbuff[i * 4 + 1] = (vec3_t){screen_pos->x + signed_size->x, screen_pos->y,                  0.0f};
+        vbuff[i * 4 + 2] = (vec3_t){screen_pos->x + signed_size->x, screen_pos->y + signed_size->y, 0.0f};
+        vbuff[i * 4 + 3] = (vec3_t){screen_pos->x,                  screen_pos->y + signed_size->y, 0.0f};
+    }
 
     int win_width, win_height;
     Engine_WinDrawableSize(&win_width, &win_height);
@@ -686,27 +708,32 @@ void R_GL_DrawBox2D(const vec2_t *screen_pos, const vec2_t *signed_size,
         .val.as_mat4 = identity
     });
 
-    vec4_t color4 = (vec4_t){color->x, color->y, color->z, 1.0f};
-    R_GL_StateSet(GL_U_COLOR, (struct uval){
-        .type = UTYPE_VEC4,
-        .val.as_vec4 = color4
-    });
-
-    R_GL_Shader_Install("mesh.static.colored");
-
     float old_width;
     glGetFloatv(GL_LINE_WIDTH, &old_width);
-    glLineWidth(*width);
 
     /* buffer & render */
-    glBufferData(GL_ARRAY_BUFFER, ARR_SIZE(vbuff) * sizeof(vec3_t), vbuff, GL_STATIC_DRAW);
-    glDrawArrays(GL_LINE_LOOP, 0, ARR_SIZE(vbuff));
+    glBufferData(GL_ARRAY_BUFFER, *nboxes * 4 * sizeof(vec3_t), vbuff, GL_STREAM_DRAW);
+
+    for(int i = 0; i < *nboxes; i++) {
+
+        const vec3_t *color = &boxes[i].color;
+        vec4_t color4 = (vec4_t){color->x, color->y, color->z, 1.0f};
+        R_GL_StateSet(GL_U_COLOR, (struct uval){
+            .type = UTYPE_VEC4,
+            .val.as_vec4 = color4
+        });
+        R_GL_Shader_Install("mesh.static.colored");
+
+        glLineWidth(boxes[i].width);
+        glDrawArrays(GL_LINE_LOOP, i * 4, 4);
+    }
 
     glLineWidth(old_width);
 
     /* cleanup */
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    free(vbuff);
 
     GL_ASSERT_OK();
     GL_PERF_RETURN_VOID();
@@ -825,33 +852,62 @@ void R_GL_DumpFBDepth_PPM(const char *filename, const int *width, const int *hei
 
 void R_GL_DrawSelectionCircle(const vec2_t *xz, const float *radius, const float *width, 
                               const vec3_t *color, const struct map *map)
+{
+    struct selection_circle circle = (struct selection_circle){
+        .xz = *xz,
+        .radius = *radius,
+        .width = *width,
+        .color = *color,
+    };
+    R_GL_DrawSelectionCircles(&circle, &(size_t){1}, map);
+}
+
+void R_GL_DrawSelectionCircles(const struct selection_circle *circles, const size_t *ncircles,
+                               const struct map *map)
 {
     GL_PERF_ENTER();
     ASSERT_IN_RENDER_THREAD();
 
+    if(*ncircles == 0)
+        GL_PERF_RETURN_VOID();
+
     GLuint VAO, VBO;
 
-    const int NUM_SAMPLES = 48;
-    vec3_t vbuff[NUM_SAMPLES * 2 + 2];
+    enum{
+        NUM_SAMPLES = 48,
+        VERTS_PER_CIRCLE = NUM_SAMPLES * 2 + 2,
+    };
 
-    for(int i = 0; i < NUM_SAMPLES * 2; i += 2) {
+    vec3_t *vbuff = malloc(*ncircles * VERTS_PER_CIRCLE * sizeof(vec3_t));
+    if(!vbuff)
+        GL_PERF_RETURN_VOID();
 
-        float theta = (2.0f * M_PI) * ((float)i/NUM_SAMPLES);
+    for(int c = 0; c < *ncircles; c++) {
 
-        float x_near = xz->x + (*radius) * cos(theta);
-        float z_near = xz->z - (*radius) * sin(theta);
+        const vec2_t *xz = &circles[c].xz;
+        const float radius = circles[c].radius;
+        const float width = circles[c].width;
+        vec3_t *verts = vbuff + c * VERTS_PER_CIRCLE;
 
-        float x_far = xz->x + (*radius + *width) * cos(theta);
-        float z_far = xz->z - (*radius + *width) * sin(theta);
-    
-        float height_near = M_HeightAtPoint(map, M_ClampedMapCoordinate(map, (vec2_t){x_near, z_near}));
-        float height_far  = M_HeightAtPoint(map, M_ClampedMapCoordinate(map, (vec2_t){x_far,  z_far }));
+        for(int i = 0; i < NUM_SAMPLES * 2; i += 2) {
+
+            float theta = (2.0f * M_PI) * ((float)i/NUM_SAMPLES);
+
+            float x_near = xz->x + radius * cos(theta);
+            float z_near = xz->z - radius * sin(theta);
 
-        vbuff[i]     = (vec3_t){x_near, height_near + 0.1f, z_near};
-        vbuff[i + 1] = (vec3_t){x_far,  height_far + 0.1f,   z_far };
+            float x_far = xz->x + (radius + width) * cos(theta);
+            float z_far = xz->z - (radius + width) * sin(theta);
+        
+            float height_near = M_HeightAtPoint(map, M_ClampedMapCoordinate(map, (vec2_t){x_near, z_near}));
+            float height_far  = M_HeightAtPoint(map, M_ClampedMapCoordinate(map, (vec2_t){x_far,  z_far }));
+
+            verts[i]     = (vec3_t){x_near, height_near + 0.1f, z_near};
+            verts[i + 1] = (vec3_t){x_far,  height_far + 0.1f,   z_far };
+        }
+        verts[NUM_SAMPLES * 2]     = verts[0];
+        verts[NUM_SAMPLES * 2 + 1] = verts[1];
     }
-    vbuff[NUM_SAMPLES * 2]     = vbuff[0];
-    vbuff[NUM_SAMPLES * 2 + 1] = vbuff[1];
 
     mat4x4_t identity;
     PFM_Mat4x4_Identity(&identity);
@@ -872,27 +928,26 @@ void R_GL_DrawSelectionCircle(const vec2_t *xz, const float *radius, const float
         .val.as_mat4 = identity
     });
 
-    vec4_t color4 = (vec4_t){color->x, color->y, color->z, 1.0f};
-    R_GL_StateSet(GL_U_COLOR, (struct uval){
-        .type = UTYPE_VEC4,
-        .val.as_vec4 = color4
-    });
+    /* buffer & render */
+    glBufferData(GL_ARRAY_BUFFER, *ncircles * VERTS_PER_CIRCLE * sizeof(vec3_t), vbuff, GL_STREAM_DRAW);
 
-    R_GL_Shader_Install("mesh.static.colored");
+    for(int c = 0; c < *ncircles; c++) {
 
-    float old_width;
-    glGetFloatv(GL_LINE_WIDTH, &old_width);
-    glLineWidth(*width);
+        const vec3_t *color = &circles[c].color;
+        vec4_t color4 = (vec4_t){color->x, color->y, color->z, 1.0f};
+        R_GL_StateSet(GL_U_COLOR, (struct uval){
+            .type = UTYPE_VEC4,
+            .val.as_vec4 = color4
+        });
+        R_GL_Shader_Install("mesh.static.colored");
 
-    /* buffer & render */
-    glBufferData(GL_ARRAY_BUFFER, ARR_SIZE(vbuff) * sizeof(vec3_t), vbuff, GL_STATIC_DRAW);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, ARR_SIZE(vbuff));
-
-    glLineWidth(old_width);
+        glDrawArrays(GL_TRIANGLE_STRIP, c * VERTS_PER_CIRCLE, VERTS_PER_CIRCLE);
+    }
 
     /* cleanup */
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    free(vbuff);
 
     GL_ASSERT_OK();
     GL_PERF_RETURN_VOID();
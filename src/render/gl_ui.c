@@ -101,8 +101,6 @@ static void exec_draw_commands(const struct nk_draw_list *dl, GLuint shader_prog
                     .val.as_mat4 = ortho
                 });
                 R_GL_StateInstall(GL_U_PROJECTION, R_GL_Shader_GetCurrActive());
-
-                free(ud);
                 continue;
             }
             case NK_COMMAND_IMAGE_TEXPATH: {
@@ -114,8 +112,6 @@ static void exec_draw_commands(const struct nk_draw_list *dl, GLuint shader_prog
             }
             default: assert(0);
             }
-
-            free(ud);
         }
 
         if(!cmd->elem_count) 
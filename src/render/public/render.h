@@ -67,6 +67,20 @@ struct ui_vert{
     uint8_t color[4];
 };
 
+struct selection_circle{
+    vec2_t xz;
+    float  radius;
+    float  width;
+    vec3_t color;
+};
+
+struct box2d{
+    vec2_t screen_pos;
+    vec2_t signed_size;
+    vec3_t color;
+    float  width;
+};
+
 #define VERTS_PER_SIDE_FACE (6)
 #define VERTS_PER_TOP_FACE  (24)
 #define VERTS_PER_TILE      (4 * VERTS_PER_SIDE_FACE + VERTS_PER_TOP_FACE)
@@ -176,6 +190,12 @@ void   R_GL_DrawOBB(const struct entity *ent);
 void   R_GL_DrawBox2D(const vec2_t *screen_pos, const vec2_t *signed_size, 
                       const vec3_t *color, const float *width);
 
+/* ---------------------------------------------------------------------------
+ * Render a number of 2D boxes using a single vertex buffer.
+ * ---------------------------------------------------------------------------
+ */
+void   R_GL_DrawBox2Ds(const struct box2d *boxes, const size_t *nboxes);
+
 /* ---------------------------------------------------------------------------
  * Writes the framebuffer color region (0, 0, width, height) to a PPM file.
  * ---------------------------------------------------------------------------
@@ -200,6 +220,14 @@ void   R_GL_DumpFBDepth_PPM(const char *filename, const int *width, const int *h
 void   R_GL_DrawSelectionCircle(const vec2_t *xz, const float *radius, const float *width, 
                                 const vec3_t *color, const struct map *map);
 
+/* ---------------------------------------------------------------------------
+ * Render a number of selection circles over the map surface using a single 
+ * vertex buffer.
+ * ---------------------------------------------------------------------------
+ */
+void   R_GL_DrawSelectionCircles(const struct selection_circle *circles, const size_t *ncircles,
+                                 const struct map *map);
+
 /* ---------------------------------------------------------------------------
  * Render a line over the map surface.
  * ---------------------------------------------------------------------------
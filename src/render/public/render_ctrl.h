@@ -36,6 +36,7 @@
 #ifndef RENDER_CTRL_H
 #define RENDER_CTRL_H
 
+#include "../../pf_math.h"
 #include "../../lib/public/queue.h"
 #include "../../lib/public/stalloc.h"
 
@@ -43,6 +44,7 @@
 
 #include <SDL_mutex.h>
 #include <SDL_thread.h>
+#include <SDL_video.h>
 
 
 struct frustum;
@@ -101,15 +103,63 @@ struct render_workspace{
      * with the commands */
     struct memstack   args;
     queue_rcmd_t      commands;
+    /* Scratch buffer that the compactly encoded commands are appended to. 
+     * When closed, the batch is copied into 'args' at its exact size and 
+     * handed over as a single command. The buffer is kept between frames. */
+    void             *batch;
+    size_t            batch_cap;
+    /* Set when the commands of this workspace are being captured */
+    void             *capture;
 };
 
 
 bool        R_Init(const char *base_path);
 SDL_Thread *R_Run(struct render_sync_state *rstate);
 
+/* Uninitialized storage for a command argument */
+void       *R_AllocArg(size_t size);
 void       *R_PushArg(const void *src, size_t size);
 void        R_PushCmd(struct rcmd cmd);
 
+/* Compact encoders for the most frequent commands. Consecutive commands of 
+ * the same kind are executed as a single batch on the render thread. They are 
+ * equivalent to pushing the matching 'R_GL_*' call. */
+void        R_PushDraw(const void *render_private, const mat4x4_t *model);
+void        R_PushAnimDraw(const void *render_private, const mat4x4_t *model, 
+                           const mat4x4_t *inv_bind_poses, const mat4x4_t *curr_poses, 
+                           size_t njoints);
+void        R_PushSelectionCircle(vec2_t xz, float radius, float width, vec3_t color, 
+                                  const struct map *map);
+void        R_PushBox2D(vec2_t screen_pos, vec2_t signed_size, vec3_t color, float width);
+
+/* In the pipelined mode ('pf.video.pipelined_render'), the render thread executes 
+ * the commands of a frame while the main thread is still producing them. Commands
+ * are handed over whenever 'R_FlushCmds' is called (at the end of each pass) and 
+ * the frame is closed with 'R_EndFrameCmds'. Otherwise, the render thread executes 
+ * the commands of the previous frame's workspace. All of these are no-ops in the 
+ * double-buffered mode. */
+void        R_FlushCmds(void);
+void        R_EndFrameCmds(void);
+/* Block until the render thread has executed all the commands pushed so far */
+void        R_WaitCmdsDrained(void);
+bool        R_Pipelined(void);
+/* Must only be called between frames, when the render thread is idle */
+void        R_SyncFrameMode(void);
+void        R_DisablePipelining(void);
+
+/* Record the commands of the next 'nframes' frames to a file, along with their 
+ * arguments and the time each one took to execute. Only one capture can be in
+ * progress at a time. The captured frames are never pipelined. */
+bool        R_CaptureCmds(const char *path, int nframes);
+bool        R_CapturingCmds(void);
+/* Execute the commands of a capture 'nloops' times on the render thread and write 
+ * the per-command timings to 'report_path'. The models referenced by the capture 
+ * are loaded from the base directory and its map is bound to the one currently 
+ * loaded, which must have the same dimensions. 'R_ReplayNewGame' starts a game 
+ * on the captured map. */
+bool        R_ReplayCmds(const char *path, int nloops, const char *report_path);
+bool        R_ReplayNewGame(const char *path);
+
 bool        R_InitWS(struct render_workspace *ws);
 void        R_DestroyWS(struct render_workspace *ws);
 void        R_ClearWS(struct render_workspace *ws);
@@ -41,9 +41,14 @@
 #include "gl_assert.h"
 #include "gl_state.h"
 #include "gl_batch.h"
+#include "render_capture.h"
+#include "render_private.h"
+#include "gl_null.h"
 #include "../settings.h"
 #include "../main.h"
 #include "../ui.h"
+#include "../perf.h"
+#include "../pf_math.h"
 #include "../game/public/game.h"
 
 #include <assert.h>
@@ -57,6 +62,78 @@
 #define EPSILON     (1.0f/1024)
 #define ARR_SIZE(a) (sizeof(a)/sizeof(a[0]))
 
+#define RING_SIZE   (16384) /* Must be a power of 2 */
+#define RING_MASK   (RING_SIZE - 1)
+#define RING_CHUNK  (1024)
+
+#define BATCH_INIT_SIZE (16 * 1024)
+#define BATCH_MAX_SIZE  (1024 * 1024)
+#define BATCH_ALIGN(x)  (((x) + 7) & ~((size_t)7))
+#define NO_RECORD   (~((size_t)0))
+
+/* In the pipelined mode, the commands of a frame are handed over to the render 
+ * thread via a single-producer single-consumer ring, as soon as each pass has been 
+ * closed. This allows the render thread to start executing the commands while the 
+ * main thread is still producing the rest of the frame. The main thread publishes 
+ * the commands it has written in chunks, and the render thread consumes up to the 
+ * last published command. Neither side takes a lock unless it has to wait.
+ */
+struct cmd_ring{
+    struct rcmd   cmds[RING_SIZE];
+    /* Only touched by the producer */
+    uint32_t      write;
+    uint32_t      published_local;
+    /* Shared between the threads */
+    SDL_atomic_t  published;
+    SDL_atomic_t  consumed;
+    SDL_atomic_t  consumer_waiting;
+    SDL_atomic_t  producer_waiting;
+    SDL_sem      *cmds_avail;
+    SDL_sem      *space_avail;
+};
+
+/* The most frequently pushed commands are encoded compactly into batches instead 
+ * of being pushed as individual 'rcmd's with each argument copied separately. 
+ * A batch is a sequence of records, each of which holds a header followed by 
+ * 'count' fixed-size items of the same opcode. Consecutive commands of the same 
+ * kind are appended to the last record, so that they can be executed together. 
+ * A whole batch is executed by a single 'rcmd'.
+ */
+enum batch_op{
+    BATCH_OP_DRAW,
+    BATCH_OP_ANIM_DRAW,
+    BATCH_OP_SELECTION_CIRCLE,
+    BATCH_OP_BOX2D,
+};
+
+struct batch_record{
+    uint32_t    op;
+    uint32_t    count;
+    /* Shared by all the items of the record */
+    const void *ctx;
+};
+
+struct batch_draw{
+    const void *render_private;
+    mat4x4_t    model;
+};
+
+/* Sets the animation uniforms before drawing */
+struct batch_anim_draw{
+    const void     *render_private;
+    const mat4x4_t *inv_bind_poses;
+    const mat4x4_t *curr_poses;
+    size_t          njoints;
+    mat4x4_t        model;
+    mat4x4_t        normal;
+};
+
+struct cmd_batch{
+    size_t        used;
+    size_t        last;
+    unsigned char data[];
+};
+
 /*****************************************************************************/
 /* GLOBAL VARIABLES                                                          */
 /*****************************************************************************/
@@ -69,6 +146,13 @@ bool g_trace_gpu;
 
 static SDL_GLContext s_context;
 
+static struct cmd_ring s_ring;
+/* The mode of the current frame. It only changes between frames, when the 
+ * render thread is not processing any commands. */
+static bool            s_pipelined = false;
+static bool            s_pipelined_setting = false;
+static bool            s_skip_swap = false;
+
 /* write-once strings. Set by render thread at initialization */
 char                 s_info_vendor[128];
 char                 s_info_renderer[128];
@@ -188,7 +272,9 @@ static bool bool_val_validate(const struct sval *new_val)
 
 static void render_set_swap(const bool *on)
 {
+#if !defined(PF_NULL_RENDER)
     SDL_GL_SetSwapInterval(*on);
+#endif
 }
 
 static void vsync_commit(const struct sval *new_val)
@@ -200,6 +286,186 @@ static void vsync_commit(const struct sval *new_val)
     });
 }
 
+static void pipelined_commit(const struct sval *new_val)
+{
+    s_pipelined_setting = new_val->as_bool;
+}
+
+/* Used as a marker for the end of the frame in the command ring. It is never called. */
+static void render_frame_end(void)
+{
+    assert(0);
+}
+
+static void ring_publish(void)
+{
+    if(s_ring.write == s_ring.published_local)
+        return;
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&s_ring.published, s_ring.write);
+    s_ring.published_local = s_ring.write;
+
+    if(SDL_AtomicCAS(&s_ring.consumer_waiting, 1, 0))
+        SDL_SemPost(s_ring.cmds_avail);
+}
+
+/* Block the producer until the consumer has made progress past 'target' 
+ * commands behind the write position */
+static void ring_wait_consumed(uint32_t max_pending)
+{
+    while(s_ring.write - (uint32_t)SDL_AtomicGet(&s_ring.consumed) > max_pending) {
+
+        SDL_AtomicSet(&s_ring.producer_waiting, 1);
+        if(s_ring.write - (uint32_t)SDL_AtomicGet(&s_ring.consumed) <= max_pending) {
+            SDL_AtomicSet(&s_ring.producer_waiting, 0);
+            break;
+        }
+        SDL_SemWait(s_ring.space_avail);
+    }
+}
+
+static void ring_push(const struct rcmd *cmd)
+{
+    if(s_ring.write - (uint32_t)SDL_AtomicGet(&s_ring.consumed) == RING_SIZE) {
+        ring_publish();
+        ring_wait_consumed(RING_SIZE - RING_CHUNK);
+    }
+
+    s_ring.cmds[s_ring.write & RING_MASK] = *cmd;
+    s_ring.write++;
+
+    /* Keep the render thread fed during long passes */
+    if(s_ring.write - s_ring.published_local >= RING_CHUNK)
+        ring_publish();
+}
+
+static void ring_set_consumed(uint32_t read)
+{
+    SDL_AtomicSet(&s_ring.consumed, read);
+    if(SDL_AtomicCAS(&s_ring.producer_waiting, 1, 0))
+        SDL_SemPost(s_ring.space_avail);
+}
+
+static void render_push(struct rcmd *cmd)
+{
+    if(s_pipelined) {
+        ring_push(cmd);
+        return;
+    }
+
+    struct render_workspace *ws = G_GetSimWS();
+    queue_rcmd_push(&ws->commands, cmd);
+}
+
+static size_t batch_item_size(enum batch_op op)
+{
+    switch(op) {
+    case BATCH_OP_DRAW:             return sizeof(struct batch_draw);
+    case BATCH_OP_ANIM_DRAW:        return sizeof(struct batch_anim_draw);
+    case BATCH_OP_SELECTION_CIRCLE: return sizeof(struct selection_circle);
+    case BATCH_OP_BOX2D:            return sizeof(struct box2d);
+    default: assert(0); return 0;
+    }
+}
+
+/* Hand over the open batch to the render thread. No more commands can be 
+ * appended to it afterwards. */
+static void batch_close(struct render_workspace *ws)
+{
+    struct cmd_batch *open = ws->batch;
+    if(!open || open->used == 0)
+        return;
+
+    size_t size = offsetof(struct cmd_batch, data) + open->used;
+    struct cmd_batch *batch = stalloc(&ws->args, size);
+    if(batch) {
+        memcpy(batch, open, size);
+    }
+    open->used = 0;
+    open->last = NO_RECORD;
+    if(!batch)
+        return;
+
+    struct rcmd cmd = (struct rcmd){
+        .func = R_ExecBatch,
+        .nargs = 1,
+        .args = { batch },
+    };
+    if(ws->capture) {
+        R_Capture_NoteArg(ws, batch, size);
+    }
+    render_push(&cmd);
+}
+
+static bool batch_reserve(struct render_workspace *ws, size_t size)
+{
+    if(ws->batch && ws->batch_cap >= size)
+        return true;
+
+    size_t new_cap = ws->batch_cap ? ws->batch_cap : BATCH_INIT_SIZE;
+    while(new_cap < size)
+        new_cap *= 2;
+
+    struct cmd_batch *batch = realloc(ws->batch, offsetof(struct cmd_batch, data) + new_cap);
+    if(!batch)
+        return false;
+
+    if(!ws->batch) {
+        batch->used = 0;
+        batch->last = NO_RECORD;
+    }
+    ws->batch = batch;
+    ws->batch_cap = new_cap;
+    return true;
+}
+
+/* Returns storage for a single item of the specified opcode in the open batch 
+ * of the simulation workspace. The storage is only valid until the next call. 
+ * Any previously pushed 'rcmd's must be executed before the batch, so they 
+ * close it. */
+static void *batch_alloc(enum batch_op op, const void *ctx)
+{
+    struct render_workspace *ws = G_GetSimWS();
+    struct cmd_batch *batch = ws->batch;
+    size_t item_size = batch_item_size(op);
+
+    if(batch && batch->used + sizeof(struct batch_record) + item_size > BATCH_MAX_SIZE) {
+        batch_close(ws);
+    }
+
+    if(batch && batch->last != NO_RECORD) {
+
+        struct batch_record *rec = (void*)(batch->data + batch->last);
+        if(rec->op == op && rec->ctx == ctx) {
+
+            if(!batch_reserve(ws, batch->used + item_size))
+                return NULL;
+            batch = ws->batch;
+            rec = (void*)(batch->data + batch->last);
+
+            void *ret = batch->data + batch->used;
+            batch->used += item_size;
+            rec->count++;
+            return ret;
+        }
+    }
+
+    size_t off = batch ? BATCH_ALIGN(batch->used) : 0;
+    if(!batch_reserve(ws, off + sizeof(struct batch_record) + item_size))
+        return NULL;
+    batch = ws->batch;
+
+    struct batch_record *rec = (void*)(batch->data + off);
+    rec->op = op;
+    rec->count = 1;
+    rec->ctx = ctx;
+
+    batch->last = off;
+    batch->used = off + sizeof(*rec) + item_size;
+    return rec + 1;
+}
+
 static bool int_val_validate(const struct sval *new_val)
 {
     return (new_val->type == ST_TYPE_INT);
@@ -320,6 +586,7 @@ void debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
 
 static void render_init_ctx(struct render_init_arg *arg)
 {
+#if !defined(PF_NULL_RENDER)
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
@@ -339,6 +606,7 @@ static void render_init_ctx(struct render_init_arg *arg)
 
     s_context = SDL_GL_CreateContext(arg->in_window);
     SDL_GL_MakeCurrent(arg->in_window, s_context);
+#endif
 
     glewExperimental = GL_TRUE;
     if(glewInit() != GLEW_OK) {
@@ -384,13 +652,18 @@ static void render_init_ctx(struct render_init_arg *arg)
 
 static void render_destroy_ctx(void)
 {
+    R_Capture_Shutdown();
     R_GL_Batch_Shutdown();
     R_GL_StateShutdown();
     R_GL_Texture_Shutdown();
+#if defined(PF_NULL_RENDER)
+    R_GL_NullShutdown();
+#else
     SDL_GL_DeleteContext(s_context);
+#endif
 }
 
-static void render_dispatch_cmd(struct rcmd cmd)
+void R_DispatchCmd(struct rcmd cmd)
 {
     switch(cmd.nargs) {
     case 0:
@@ -486,11 +759,51 @@ static void render_process_cmds(queue_rcmd_t *cmds)
 
         struct rcmd curr;
         queue_rcmd_pop(cmds, &curr);
-        render_dispatch_cmd(curr);
+        R_DispatchCmd(curr);
         GL_ASSERT_OK();
     }
 }
 
+/* Execute the commands of the current frame, as they are published */
+static void render_drain_ring(void)
+{
+    uint32_t read = SDL_AtomicGet(&s_ring.consumed);
+
+    while(true) {
+
+        uint32_t avail = SDL_AtomicGet(&s_ring.published);
+        if(read == avail) {
+
+            ring_set_consumed(read);
+            SDL_AtomicSet(&s_ring.consumer_waiting, 1);
+            if((uint32_t)SDL_AtomicGet(&s_ring.published) != read) {
+                SDL_AtomicSet(&s_ring.consumer_waiting, 0);
+                continue;
+            }
+            SDL_SemWait(s_ring.cmds_avail);
+            continue;
+        }
+        SDL_MemoryBarrierAcquire();
+
+        while(read != avail) {
+
+            struct rcmd curr = s_ring.cmds[read & RING_MASK];
+            read++;
+
+            if(curr.func == (void(*)())render_frame_end) {
+                ring_set_consumed(read);
+                return;
+            }
+
+            R_DispatchCmd(curr);
+            GL_ASSERT_OK();
+
+            if(read % RING_CHUNK == 0)
+                ring_set_consumed(read);
+        }
+    }
+}
+
 static int render(void *data)
 {
     struct render_sync_state *rstate = data; 
@@ -508,10 +821,27 @@ static int render(void *data)
         if(quit)
             break;
 
-        render_process_cmds(&G_GetRenderWS()->commands);
-        if(rstate->swap_buffers)
+        uint64_t begin = SDL_GetPerformanceCounter();
+
+        /* When switching to the pipelined mode, there are still the queued 
+         * commands of the previous frame to get through first. */
+        struct render_workspace *ws = G_GetRenderWS();
+        if(ws->capture) {
+            R_Capture_ProcessCmds(ws);
+        }else{
+            render_process_cmds(&ws->commands);
+        }
+        if(s_pipelined)
+            render_drain_ring();
+
+#if !defined(PF_NULL_RENDER)
+        if(rstate->swap_buffers && !s_skip_swap)
             SDL_GL_SwapWindow(window);
+#endif
+        s_skip_swap = false;
 
+        uint64_t end = SDL_GetPerformanceCounter();
+        Perf_RecordTime(PERF_HIST_RENDER, (end - begin) * 1000000 / SDL_GetPerformanceFrequency());
         render_signal_done(rstate);
     }
 
@@ -523,6 +853,43 @@ static int render(void *data)
 /* EXTERN FUNCTIONS                                                          */
 /*****************************************************************************/
 
+void R_ExecBatch(const struct cmd_batch *batch)
+{
+    size_t off = 0;
+    while(off < batch->used) {
+
+        const struct batch_record *rec = (const void*)(batch->data + off);
+        const void *items = rec + 1;
+
+        switch(rec->op) {
+        case BATCH_OP_DRAW: {
+            const struct batch_draw *draws = items;
+            for(int i = 0; i < rec->count; i++) {
+                R_GL_Draw(draws[i].render_private, (mat4x4_t*)&draws[i].model);
+            }
+            break;
+        }
+        case BATCH_OP_ANIM_DRAW: {
+            const struct batch_anim_draw *draws = items;
+            for(int i = 0; i < rec->count; i++) {
+                R_GL_SetAnimUniforms((mat4x4_t*)draws[i].inv_bind_poses, (mat4x4_t*)draws[i].curr_poses,
+                    (mat4x4_t*)&draws[i].normal, &draws[i].njoints);
+                R_GL_Draw(draws[i].render_private, (mat4x4_t*)&draws[i].model);
+            }
+            break;
+        }
+        case BATCH_OP_SELECTION_CIRCLE:
+            R_GL_DrawSelectionCircles(items, &(size_t){rec->count}, rec->ctx);
+            break;
+        case BATCH_OP_BOX2D:
+            R_GL_DrawBox2Ds(items, &(size_t){rec->count});
+            break;
+        default: assert(0);
+        }
+        off = BATCH_ALIGN(off + sizeof(*rec) + rec->count * batch_item_size(rec->op));
+    }
+}
+
 bool R_Init(const char *base_path)
 {
     ss_e status;
@@ -531,6 +898,14 @@ bool R_Init(const char *base_path)
     SDL_DisplayMode dm;
     SDL_GetDesktopDisplayMode(0, &dm);
 
+    s_ring.cmds_avail = SDL_CreateSemaphore(0);
+    s_ring.space_avail = SDL_CreateSemaphore(0);
+    if(!s_ring.cmds_avail || !s_ring.space_avail)
+        return false;
+
+    if(!R_Capture_Init())
+        return false;
+
     status = Settings_Create((struct setting){
         .name = "pf.video.aspect_ratio",
         .val = (struct sval) {
@@ -603,6 +978,18 @@ bool R_Init(const char *base_path)
     });
     assert(status == SS_OKAY);
 
+    status = Settings_Create((struct setting){
+        .name = "pf.video.pipelined_render",
+        .val = (struct sval) {
+            .type = ST_TYPE_BOOL,
+            .as_bool = false 
+        },
+        .prio = 0,
+        .validate = bool_val_validate,
+        .commit = pipelined_commit,
+    });
+    assert(status == SS_OKAY);
+
     status = Settings_Create((struct setting){
         .name = "pf.video.water_reflection",
         .val = (struct sval) {
@@ -659,11 +1046,22 @@ SDL_Thread *R_Run(struct render_sync_state *rstate)
     return SDL_CreateThread(render, "render", rstate);
 }
 
-void *R_PushArg(const void *src, size_t size)
+void *R_AllocArg(size_t size)
 {
-    struct render_workspace *ws = (SDL_ThreadID() == g_render_thread_id) ? G_GetRenderWS() 
-                                                                         : G_GetSimWS();
+    if(SDL_ThreadID() == g_render_thread_id)
+        return stalloc(&G_GetRenderWS()->args, size);
+
+    struct render_workspace *ws = G_GetSimWS();
     void *ret = stalloc(&ws->args, size);
+    if(ret && ws->capture) {
+        R_Capture_NoteArg(ws, ret, size);
+    }
+    return ret;
+}
+
+void *R_PushArg(const void *src, size_t size)
+{
+    void *ret = R_AllocArg(size);
     if(!ret)
         return ret;
 
@@ -677,12 +1075,174 @@ void R_PushCmd(struct rcmd cmd)
      * as if it were a function call */
     if(SDL_ThreadID() == g_render_thread_id) {
 
-        render_dispatch_cmd(cmd);
+        R_DispatchCmd(cmd);
+        return;
+    }
+
+    batch_close(G_GetSimWS());
+    render_push(&cmd);
+}
+
+void R_PushDraw(const void *render_private, const mat4x4_t *model)
+{
+    if(SDL_ThreadID() == g_render_thread_id) {
+        R_GL_Draw(render_private, (mat4x4_t*)model);
+        return;
+    }
+
+    struct batch_draw *draw = batch_alloc(BATCH_OP_DRAW, NULL);
+    if(!draw)
+        return;
+    draw->render_private = render_private;
+    draw->model = *model;
+}
+
+void R_PushAnimDraw(const void *render_private, const mat4x4_t *model, 
+                    const mat4x4_t *inv_bind_poses, const mat4x4_t *curr_poses, 
+                    size_t njoints)
+{
+    mat4x4_t inv_model, normal;
+    PFM_Mat4x4_Inverse((mat4x4_t*)model, &inv_model);
+    PFM_Mat4x4_Transpose(&inv_model, &normal);
+
+    if(SDL_ThreadID() == g_render_thread_id) {
+        R_GL_SetAnimUniforms((mat4x4_t*)inv_bind_poses, (mat4x4_t*)curr_poses, &normal, &njoints);
+        R_GL_Draw(render_private, (mat4x4_t*)model);
+        return;
+    }
+
+    /* Only the poses of the joints that are actually used get copied */
+    const mat4x4_t *poses = R_PushArg(curr_poses, njoints * sizeof(mat4x4_t));
+    if(!poses)
+        return;
+
+    struct batch_anim_draw *draw = batch_alloc(BATCH_OP_ANIM_DRAW, NULL);
+    if(!draw)
+        return;
+    draw->render_private = render_private;
+    draw->inv_bind_poses = inv_bind_poses;
+    draw->curr_poses = poses;
+    draw->njoints = njoints;
+    draw->model = *model;
+    draw->normal = normal;
+}
+
+void R_PushSelectionCircle(vec2_t xz, float radius, float width, vec3_t color, 
+                           const struct map *map)
+{
+    struct selection_circle circle = (struct selection_circle){
+        .xz = xz,
+        .radius = radius,
+        .width = width,
+        .color = color,
+    };
+
+    if(SDL_ThreadID() == g_render_thread_id) {
+        R_GL_DrawSelectionCircles(&circle, &(size_t){1}, map);
+        return;
+    }
+
+    struct selection_circle *out = batch_alloc(BATCH_OP_SELECTION_CIRCLE, map);
+    if(!out)
+        return;
+    *out = circle;
+}
+
+void R_PushBox2D(vec2_t screen_pos, vec2_t signed_size, vec3_t color, float width)
+{
+    struct box2d box = (struct box2d){
+        .screen_pos = screen_pos,
+        .signed_size = signed_size,
+        .color = color,
+        .width = width,
+    };
+
+    if(SDL_ThreadID() == g_render_thread_id) {
+        R_GL_DrawBox2Ds(&box, &(size_t){1});
         return;
     }
 
+    struct box2d *out = batch_alloc(BATCH_OP_BOX2D, NULL);
+    if(!out)
+        return;
+    *out = box;
+}
+
+void R_SyncFrameMode(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    /* Captured frames are executed from the workspace, so that all of their 
+     * arguments are in place before the first command is executed. */
+    bool capture = R_Capture_BeginFrame(G_GetSimWS());
+    bool pipelined = s_pipelined_setting && !capture;
+
+    if(s_pipelined == pipelined)
+        return;
+
+    /* All of the previous frame's commands went through the ring, so the 
+     * render thread will have nothing to draw on the next frame. Keep showing 
+     * the previous frame instead of presenting an empty framebuffer. */
+    if(s_pipelined)
+        s_skip_swap = true;
+
+    assert(s_ring.write == (uint32_t)SDL_AtomicGet(&s_ring.consumed));
+    s_pipelined = pipelined;
+}
+
+void R_DisablePipelining(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    assert(s_ring.write == (uint32_t)SDL_AtomicGet(&s_ring.consumed));
+    s_pipelined = false;
+}
+
+bool R_Pipelined(void)
+{
+    return s_pipelined;
+}
+
+void R_FlushCmds(void)
+{
+    /* Scene passes issued by the render thread itself (ex. the water 
+     * reflections) execute their commands immediately */
+    if(SDL_ThreadID() == g_render_thread_id)
+        return;
+    ASSERT_IN_MAIN_THREAD();
+
+    batch_close(G_GetSimWS());
+    if(!s_pipelined)
+        return;
+    ring_publish();
+}
+
+void R_EndFrameCmds(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
     struct render_workspace *ws = G_GetSimWS();
-    queue_rcmd_push(&ws->commands, &cmd);
+    batch_close(ws);
+    if(ws->capture) {
+        R_Capture_EndFrame(ws);
+    }
+    if(!s_pipelined)
+        return;
+
+    ring_push(&(struct rcmd){ .func = render_frame_end });
+    ring_publish();
+}
+
+void R_WaitCmdsDrained(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    batch_close(G_GetSimWS());
+    if(!s_pipelined)
+        return;
+
+    ring_publish();
+    ring_wait_consumed(0);
 }
 
 bool R_InitWS(struct render_workspace *ws)
@@ -693,6 +1253,9 @@ bool R_InitWS(struct render_workspace *ws)
     if(!queue_rcmd_init(&ws->commands, 2048))
         goto fail_queue;
 
+    ws->batch = NULL;
+    ws->batch_cap = 0;
+    ws->capture = NULL;
     return true;
 
 fail_queue:
@@ -703,14 +1266,22 @@ fail_args:
 
 void R_DestroyWS(struct render_workspace *ws)
 {
+    R_Capture_ReleaseWS(ws);
     queue_rcmd_destroy(&ws->commands);
     stalloc_destroy(&ws->args);
+    free(ws->batch);
 }
 
 void R_ClearWS(struct render_workspace *ws)
 {
     queue_rcmd_clear(&ws->commands);
     stalloc_clear(&ws->args);
+    if(ws->batch) {
+        struct cmd_batch *batch = ws->batch;
+        batch->used = 0;
+        batch->last = NO_RECORD;
+    }
+    R_Capture_ReleaseWS(ws);
 }
 
 const char *R_GetInfo(enum render_info attr)
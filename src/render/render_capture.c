@@ -0,0 +1,1450 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#include "render_capture.h"
+#include "render_private.h"
+#include "gl_render.h"
+#include "gl_texture.h"
+#include "gl_assert.h"
+#include "public/render.h"
+#include "public/render_ctrl.h"
+#include "../main.h"
+#include "../entity.h"
+#include "../asset_load.h"
+#include "../anim/public/anim.h"
+#include "../map/public/map.h"
+#include "../game/public/game.h"
+#include "../lib/public/vec.h"
+#include "../lib/public/khash.h"
+#include "../lib/public/stalloc.h"
+#include "../lib/public/pf_string.h"
+#include "../lib/public/SDL_vec_rwops.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <SDL.h>
+#include <GL/glew.h>
+
+
+#define FOURCC(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/* A capture file consists of a header, followed by a number of frames, followed 
+ * by a table mapping the function addresses in the commands to their names. 
+ *
+ *     header:   [magic:u32] [version:u32]
+ *     resource: [RSRC:u32] [kind:u32] [id:u32] [pad:u32] [size:u64] [payload, padded to 8]
+ *     frame:    [FRME:u32] [nblobs:u32] [ncmds:u32] [nfixups:u32] 
+ *               nblobs  * ([addr:u64] [size:u64] [bytes, padded to 8])
+ *               ncmds   * ([func:u64] [ns:u64] [nargs:u32] [pad:u32] [arg:u64] * nargs)
+ *               nfixups * ([res:u32] [blob:u32] [offset:u64])
+ *     syms:     [SYMS:u32] [nsyms:u32] nsyms * ([func:u64] [len:u32] [pad:u32] [name, padded to 8])
+ *     end:      [CEND:u32] [pad:u32]
+ *
+ * The blobs are the arguments pushed with 'R_PushArg' and friends, as they were 
+ * right before the frame's commands got executed. The raw argument values are saved,
+ * and pointers into the blobs (including ones stored inside other blobs) are 
+ * relocated on replay. 
+ *
+ * The objects that outlive a frame (model data, the map) are written out as 
+ * resources ahead of the first frame referencing them. Every pointer to one of 
+ * them, be it a command argument or a word of a blob, is listed in the frame's 
+ * fixups, which are patched with the address of the matching object in the 
+ * replaying process. For fixups of command arguments, 'blob' is FIXUP_ARG and 
+ * 'offset' is the command index times MAX_ARGS plus the argument index. The
+ * resource payloads are:
+ *
+ *     RES_MODEL, RES_BIND_POSES: [basedir:char[64]] [pfobj name:char[64]]
+ *     RES_MAP:                   the map in PF Map format
+ *     RES_CHUNK:                 [map resource:u32] [chunk_r:u32] [chunk_c:u32] [pad:u32]
+ *
+ * All values are in the native byte order.
+ */
+#define CAPTURE_MAGIC   FOURCC('P','F','R','C')
+#define CAPTURE_VERSION (2)
+#define RSRC_TAG        FOURCC('R','S','R','C')
+#define FRAME_TAG       FOURCC('F','R','M','E')
+#define SYMS_TAG        FOURCC('S','Y','M','S')
+#define END_TAG         FOURCC('C','E','N','D')
+
+#define ALIGN8(x)       (((x) + 7) & ~((uint64_t)7))
+#define ARR_SIZE(a)     (sizeof(a)/sizeof(a[0]))
+#define MAX_SYM_LEN     (256)
+#define MAX_PATH_LEN    (64)
+#define FIXUP_ARG       (UINT32_MAX)
+
+enum res_kind{
+    RES_MODEL,      /* render-private data of a model */
+    RES_BIND_POSES, /* inverse bind poses of an animated model */
+    RES_MAP,
+    RES_CHUNK,      /* render-private data of a map chunk */
+};
+
+struct arg_extent{
+    const void *addr;
+    size_t      size;
+};
+
+/* An object which the commands of a frame may point to */
+struct live_ref{
+    enum res_kind kind;
+    /* Identifies the resource. The map and its copy from the previous 
+     * tick share the key, as they're the same resource. */
+    uint64_t      key;
+    char          basedir[MAX_PATH_LEN];
+    char          pfobj_name[MAX_PATH_LEN];
+    int           chunk_r, chunk_c;
+};
+
+struct fixup{
+    uint32_t res;
+    uint32_t blob;
+    uint64_t offset;
+};
+
+VEC_TYPE(extent, struct arg_extent)
+VEC_IMPL(static inline, extent, struct arg_extent)
+
+VEC_TYPE(rcmd, struct rcmd)
+VEC_IMPL(static inline, rcmd, struct rcmd)
+
+VEC_TYPE(fixup, struct fixup)
+VEC_IMPL(static inline, fixup, struct fixup)
+
+KHASH_SET_INIT_INT64(func)
+KHASH_MAP_INIT_INT64(live, struct live_ref)
+KHASH_MAP_INIT_INT64(res, uint32_t)
+
+struct ws_capture{
+    bool              last;
+    vec_extent_t      args;
+    /* Filled in by the main thread once all the commands have been pushed */
+    khash_t(live)    *live;
+    const struct map *map;
+};
+
+struct cmd_func{
+    const char  *name;
+    void       (*func)();
+    /* The commands which create or destroy state are not replayed */
+    bool         replay;
+};
+
+struct replay_blob{
+    uint64_t       addr;
+    uint64_t       size;
+    uint32_t       index;   /* in the order of the file */
+    unsigned char *data;    /* relocated contents */
+    unsigned char *work;    /* copy handed to the commands */
+};
+
+struct replay_cmd{
+    uint64_t  func;
+    void    (*resolved)();  /* NULL if the command is skipped */
+    uint64_t  captured_ns;
+    uint32_t  nargs;
+    uint64_t  args[MAX_ARGS];
+    /* accumulated over all the loops */
+    uint64_t  total_ns;
+    uint64_t  min_ns;
+    uint64_t  max_ns;
+};
+
+struct replay_frame{
+    size_t              nblobs;
+    struct replay_blob *blobs; /* sorted by 'addr' */
+    size_t              ncmds;
+    struct replay_cmd  *cmds;
+    size_t              nfixups;
+    struct fixup       *fixups;
+    uint64_t            total_ns;
+};
+
+struct replay_sym{
+    uint64_t func;
+    char     name[MAX_SYM_LEN];
+};
+
+struct replay_res{
+    uint32_t       kind;
+    uint64_t       size;
+    unsigned char *data; /* NULL-terminated */
+    const void    *bound;
+};
+
+VEC_TYPE(frame, struct replay_frame)
+VEC_IMPL(static inline, frame, struct replay_frame)
+
+VEC_TYPE(sym, struct replay_sym)
+VEC_IMPL(static inline, sym, struct replay_sym)
+
+VEC_TYPE(res, struct replay_res)
+VEC_IMPL(static inline, res, struct replay_res)
+
+struct replay{
+    vec_frame_t frames;
+    vec_sym_t   syms;
+    vec_res_t   res;
+    int         nloops;
+    char        report_path[512];
+};
+
+/*****************************************************************************/
+/* STATIC VARIABLES                                                          */
+/*****************************************************************************/
+
+#define CMD(f, replay) { #f, (void(*)())f, replay }
+
+static const struct cmd_func s_cmd_funcs[] = {
+    CMD(R_ExecBatch,                  true),
+    CMD(R_GL_BeginFrame,              true),
+    CMD(R_GL_SetViewMatAndPos,        true),
+    CMD(R_GL_SetProj,                 true),
+    CMD(R_GL_SetViewport,             true),
+    CMD(R_GL_SetScreenspaceDrawMode,  true),
+    CMD(R_GL_SetLightPos,             true),
+    CMD(R_GL_SetLightEmitColor,       true),
+    CMD(R_GL_SetAmbientLightColor,    true),
+    CMD(R_GL_SetShadowsEnabled,       true),
+    CMD(R_GL_SetAnimUniforms,         true),
+    CMD(R_GL_DepthPassBegin,          true),
+    CMD(R_GL_DepthPassEnd,            true),
+    CMD(R_GL_RenderDepthMap,          true),
+    CMD(R_GL_MapBegin,                true),
+    CMD(R_GL_MapEnd,                  true),
+    CMD(R_GL_MapUpdateFog,            true),
+    CMD(R_GL_MapInvalidate,           true),
+    CMD(R_GL_Batch_Draw,              true),
+    CMD(R_GL_Batch_RenderDepthMap,    true),
+    CMD(R_GL_Batch_Reset,             true),
+    CMD(R_GL_DrawWater,               true),
+    CMD(R_GL_DrawHealthbars,          true),
+    CMD(R_GL_DrawQuad,                true),
+    CMD(R_GL_DrawRay,                 true),
+    CMD(R_GL_DrawMapOverlayQuads,     true),
+    CMD(R_GL_DrawFlowField,           true),
+    CMD(R_GL_DrawCombinedHRVO,        true),
+    CMD(R_GL_TileDrawSelected,        true),
+    CMD(R_GL_TileUpdate,              true),
+    CMD(R_GL_TilePatchVertsBlend,     true),
+    CMD(R_GL_TilePatchVertsSmooth,    true),
+    CMD(R_GL_MinimapRender,           true),
+    CMD(R_GL_MinimapUpdateChunk,      true),
+    CMD(R_GL_UI_Render,               true),
+    CMD(R_GL_Init,                    false),
+    CMD(R_GL_Texture_GetOrLoad,       false),
+    CMD(R_GL_MapInit,                 false),
+    CMD(R_GL_MapShutdown,             false),
+    CMD(R_GL_MinimapBake,             false),
+    CMD(R_GL_MinimapFree,             false),
+    CMD(R_GL_Batch_AllocChunks,       false),
+    CMD(R_GL_WaterInit,               false),
+    CMD(R_GL_WaterShutdown,           false),
+    CMD(R_GL_UI_Init,                 false),
+    CMD(R_GL_UI_Shutdown,             false),
+    CMD(R_GL_UI_UploadFontAtlas,      false),
+};
+
+#undef CMD
+
+/* Set by the main thread when a capture is started. Cleared by the render 
+ * thread once the last frame has been written out. */
+static SDL_atomic_t    s_active;
+/* Only touched by the main thread */
+static int             s_frames_left;
+/* Handed over to the render thread along with the first captured frame */
+static FILE           *s_file;
+static bool            s_ok;
+static khash_t(func)  *s_funcs;
+/* Maps the keys of the resources written out so far to their ids */
+static khash_t(res)   *s_resources;
+static vec_rcmd_t      s_cmds;
+static vec_fixup_t     s_fixups;
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static uint64_t ticks_to_ns(uint64_t ticks)
+{
+    return (uint64_t)((double)ticks * 1e9 / SDL_GetPerformanceFrequency());
+}
+
+static bool write_u32(FILE *stream, uint32_t val)
+{
+    return (fwrite(&val, sizeof(val), 1, stream) == 1);
+}
+
+static bool write_u64(FILE *stream, uint64_t val)
+{
+    return (fwrite(&val, sizeof(val), 1, stream) == 1);
+}
+
+static bool write_padded(FILE *stream, const void *data, size_t size)
+{
+    static const unsigned char zeros[8] = {0};
+    if(size && fwrite(data, size, 1, stream) != 1)
+        return false;
+    size_t pad = ALIGN8(size) - size;
+    return (pad == 0 || fwrite(zeros, pad, 1, stream) == 1);
+}
+
+static bool read_u32(FILE *stream, uint32_t *out)
+{
+    return (fread(out, sizeof(*out), 1, stream) == 1);
+}
+
+static bool read_u64(FILE *stream, uint64_t *out)
+{
+    return (fread(out, sizeof(*out), 1, stream) == 1);
+}
+
+static bool read_padded(FILE *stream, void *out, size_t size)
+{
+    unsigned char pad[8];
+    if(size && fread(out, size, 1, stream) != 1)
+        return false;
+    size_t npad = ALIGN8(size) - size;
+    return (npad == 0 || fread(pad, npad, 1, stream) == 1);
+}
+
+static const struct cmd_func *cmd_func_for_addr(uint64_t func)
+{
+    for(int i = 0; i < ARR_SIZE(s_cmd_funcs); i++) {
+        if((uintptr_t)s_cmd_funcs[i].func == func)
+            return &s_cmd_funcs[i];
+    }
+    return NULL;
+}
+
+static const struct cmd_func *cmd_func_for_name(const char *name)
+{
+    for(int i = 0; i < ARR_SIZE(s_cmd_funcs); i++) {
+        if(!strcmp(s_cmd_funcs[i].name, name))
+            return &s_cmd_funcs[i];
+    }
+    return NULL;
+}
+
+static void sym_name(uint64_t func, char out[static MAX_SYM_LEN])
+{
+    const struct cmd_func *cf = cmd_func_for_addr(func);
+    if(cf) {
+        pf_strlcpy(out, cf->name, MAX_SYM_LEN);
+        return;
+    }
+    pf_snprintf(out, MAX_SYM_LEN, "0x%016llx", (unsigned long long)func);
+}
+
+/* The timestamps of the profiler's cookies refer to its state, which is not 
+ * a part of the capture */
+static bool capture_recorded(const struct rcmd *cmd)
+{
+    return (cmd->func != (void(*)())R_GL_TimestampForCookie);
+}
+
+static bool capture_write_syms(FILE *stream)
+{
+    if(!write_u32(stream, SYMS_TAG))
+        return false;
+    if(!write_u32(stream, kh_size(s_funcs)))
+        return false;
+
+    for(khiter_t k = kh_begin(s_funcs); k != kh_end(s_funcs); k++) {
+
+        if(!kh_exist(s_funcs, k))
+            continue;
+
+        uint64_t func = kh_key(s_funcs, k);
+        char name[MAX_SYM_LEN];
+        sym_name(func, name);
+        size_t len = strlen(name);
+
+        if(!write_u64(stream, func)
+        || !write_u32(stream, len)
+        || !write_u32(stream, 0)
+        || !write_padded(stream, name, len))
+            return false;
+    }
+    return true;
+}
+
+static void capture_finish(void)
+{
+    ASSERT_IN_RENDER_THREAD();
+
+    s_ok = s_ok
+        && capture_write_syms(s_file)
+        && write_u32(s_file, END_TAG)
+        && write_u32(s_file, 0);
+    if(!s_ok) {
+        fprintf(stderr, "Failed to write the render command capture.\n");
+    }
+
+    fclose(s_file);
+    s_file = NULL;
+    kh_clear(func, s_funcs);
+    kh_clear(res, s_resources);
+    SDL_AtomicSet(&s_active, 0);
+}
+
+static void capture_note(struct ws_capture *cap, const void *addr, struct live_ref ref)
+{
+    if(!addr)
+        return;
+
+    int status;
+    khiter_t k = kh_put(live, cap->live, (uintptr_t)addr, &status);
+    if(status == -1)
+        return;
+    kh_value(cap->live, k) = ref;
+}
+
+static void capture_note_model(const struct al_model *model, void *arg)
+{
+    struct ws_capture *cap = arg;
+    struct live_ref ref = (struct live_ref){
+        .kind = RES_MODEL,
+        .key = (uintptr_t)model->render_private,
+    };
+    pf_strlcpy(ref.basedir, model->basedir, sizeof(ref.basedir));
+    pf_strlcpy(ref.pfobj_name, model->pfobj_name, sizeof(ref.pfobj_name));
+    capture_note(cap, model->render_private, ref);
+
+    if(!model->animated)
+        return;
+
+    const mat4x4_t *inv_bind_poses = A_AL_InvBindPoses(model->anim_private);
+    ref.kind = RES_BIND_POSES;
+    ref.key = (uintptr_t)inv_bind_poses;
+    capture_note(cap, inv_bind_poses, ref);
+}
+
+static bool capture_write_resource(enum res_kind kind, uint32_t id, const void *data, size_t size)
+{
+    return write_u32(s_file, RSRC_TAG)
+        && write_u32(s_file, kind)
+        && write_u32(s_file, id)
+        && write_u32(s_file, 0)
+        && write_u64(s_file, size)
+        && write_padded(s_file, data, size);
+}
+
+static bool capture_write_map(const struct map *map, uint32_t id)
+{
+    SDL_RWops *stream = PFSDL_VectorRWOps();
+    if(!stream)
+        return false;
+
+    bool ret = M_AL_WritePFMap(map, stream)
+            && capture_write_resource(RES_MAP, id, PFSDL_VectorRWOpsRaw(stream), SDL_RWsize(stream));
+    SDL_RWclose(stream);
+    return ret;
+}
+
+/* Get the id of a resource, writing it out the first time it's referenced */
+static bool capture_resource(const struct ws_capture *cap, const struct live_ref *ref, uint32_t *out)
+{
+    khiter_t k = kh_get(res, s_resources, ref->key);
+    if(k != kh_end(s_resources)) {
+        *out = kh_value(s_resources, k);
+        return true;
+    }
+
+    /* The map must be written out before its chunks */
+    uint32_t map_id = 0;
+    if(ref->kind == RES_CHUNK) {
+        khiter_t mk = kh_get(live, cap->live, (uintptr_t)cap->map);
+        assert(mk != kh_end(cap->live));
+        if(!capture_resource(cap, &kh_value(cap->live, mk), &map_id))
+            return false;
+    }
+
+    uint32_t id = kh_size(s_resources);
+    bool ok = false;
+
+    switch(ref->kind) {
+    case RES_MODEL:
+    case RES_BIND_POSES: {
+        char payload[2 * MAX_PATH_LEN];
+        memcpy(payload, ref->basedir, MAX_PATH_LEN);
+        memcpy(payload + MAX_PATH_LEN, ref->pfobj_name, MAX_PATH_LEN);
+        ok = capture_write_resource(ref->kind, id, payload, sizeof(payload));
+        break;
+    }
+    case RES_MAP:
+        ok = capture_write_map(cap->map, id);
+        break;
+    case RES_CHUNK: {
+        uint32_t payload[4] = {map_id, ref->chunk_r, ref->chunk_c, 0};
+        ok = capture_write_resource(RES_CHUNK, id, payload, sizeof(payload));
+        break;
+    }
+    default: assert(0);
+    }
+
+    if(!ok)
+        return false;
+
+    int status;
+    k = kh_put(res, s_resources, ref->key, &status);
+    if(status == -1)
+        return false;
+
+    kh_value(s_resources, k) = id;
+    *out = id;
+    return true;
+}
+
+static bool capture_fixup(const struct ws_capture *cap, uint64_t val, uint32_t blob, uint64_t offset)
+{
+    khiter_t k = kh_get(live, cap->live, val);
+    if(k == kh_end(cap->live))
+        return true;
+
+    uint32_t id;
+    if(!capture_resource(cap, &kh_value(cap->live, k), &id))
+        return false;
+    return vec_fixup_push(&s_fixups, (struct fixup){id, blob, offset});
+}
+
+/* Pointers into blobs are only ever stored at 8-byte aligned offsets, 
+ * as the blobs are allocated with the alignment of the largest type. */
+static bool capture_collect_fixups(const struct ws_capture *cap)
+{
+    vec_fixup_reset(&s_fixups);
+    if(!cap->live)
+        return true;
+
+    uint32_t ncmds = 0;
+    for(int i = 0; i < vec_size(&s_cmds); i++) {
+
+        const struct rcmd *cmd = &vec_AT(&s_cmds, i);
+        if(!capture_recorded(cmd))
+            continue;
+
+        for(int j = 0; j < cmd->nargs; j++) {
+            if(!capture_fixup(cap, (uintptr_t)cmd->args[j], FIXUP_ARG, ncmds * MAX_ARGS + j))
+                return false;
+        }
+        ncmds++;
+    }
+
+    for(int i = 0; i < vec_size(&cap->args); i++) {
+
+        const struct arg_extent *curr = &vec_AT(&cap->args, i);
+        for(size_t off = 0; off + sizeof(uint64_t) <= curr->size; off += sizeof(uint64_t)) {
+
+            uint64_t val;
+            memcpy(&val, (const unsigned char*)curr->addr + off, sizeof(val));
+            if(!capture_fixup(cap, val, i, off))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool capture_write_blobs(FILE *stream, const vec_extent_t *args)
+{
+    for(int i = 0; i < vec_size(args); i++) {
+    
+        const struct arg_extent *curr = &vec_AT(args, i);
+        if(!write_u64(stream, (uintptr_t)curr->addr)
+        || !write_u64(stream, curr->size)
+        || !write_padded(stream, curr->addr, curr->size))
+            return false;
+    }
+    return true;
+}
+
+static bool capture_write_cmd(FILE *stream, const struct rcmd *cmd, uint64_t ns)
+{
+    uint64_t func = (uintptr_t)cmd->func;
+    int status;
+    kh_put(func, s_funcs, func, &status);
+
+    if(!write_u64(stream, func)
+    || !write_u64(stream, ns)
+    || !write_u32(stream, cmd->nargs)
+    || !write_u32(stream, 0))
+        return false;
+
+    for(int i = 0; i < cmd->nargs; i++) {
+        if(!write_u64(stream, (uintptr_t)cmd->args[i]))
+            return false;
+    }
+    return true;
+}
+
+static bool capture_write_fixups(FILE *stream)
+{
+    for(int i = 0; i < vec_size(&s_fixups); i++) {
+
+        const struct fixup *curr = &vec_AT(&s_fixups, i);
+        if(!write_u32(stream, curr->res)
+        || !write_u32(stream, curr->blob)
+        || !write_u64(stream, curr->offset))
+            return false;
+    }
+    return true;
+}
+
+static int compare_blobs(const void *a, const void *b)
+{
+    const struct replay_blob *ba = a, *bb = b;
+    if(ba->addr < bb->addr) return -1;
+    if(ba->addr > bb->addr) return  1;
+    return 0;
+}
+
+static const struct replay_blob *replay_find_blob(const struct replay_frame *frame, uint64_t addr)
+{
+    size_t lo = 0, hi = frame->nblobs;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct replay_blob *curr = &frame->blobs[mid];
+        if(addr < curr->addr)
+            hi = mid;
+        else if(addr >= curr->addr + curr->size)
+            lo = mid + 1;
+        else
+            return curr;
+    }
+    return NULL;
+}
+
+static uint64_t replay_relocate(const struct replay_frame *frame, uint64_t val)
+{
+    const struct replay_blob *blob = replay_find_blob(frame, val);
+    if(!blob)
+        return val;
+    return (uintptr_t)blob->work + (val - blob->addr);
+}
+
+static void replay_relocate_frame(struct replay_frame *frame)
+{
+    for(int i = 0; i < frame->nblobs; i++) {
+    
+        struct replay_blob *blob = &frame->blobs[i];
+        for(size_t off = 0; off + sizeof(uint64_t) <= blob->size; off += sizeof(uint64_t)) {
+
+            uint64_t val;
+            memcpy(&val, blob->data + off, sizeof(val));
+            val = replay_relocate(frame, val);
+            memcpy(blob->data + off, &val, sizeof(val));
+        }
+    }
+
+    for(int i = 0; i < frame->ncmds; i++) {
+    
+        struct replay_cmd *cmd = &frame->cmds[i];
+        for(int j = 0; j < cmd->nargs; j++) {
+            cmd->args[j] = replay_relocate(frame, cmd->args[j]);
+        }
+    }
+}
+
+static void replay_frame_destroy(struct replay_frame *frame)
+{
+    for(int i = 0; i < frame->nblobs; i++) {
+        free(frame->blobs[i].data);
+        free(frame->blobs[i].work);
+    }
+    free(frame->blobs);
+    free(frame->cmds);
+    free(frame->fixups);
+}
+
+static bool replay_read_frame(FILE *stream, struct replay_frame *out)
+{
+    uint32_t nblobs, ncmds, nfixups, pad;
+    if(!read_u32(stream, &nblobs) 
+    || !read_u32(stream, &ncmds)
+    || !read_u32(stream, &nfixups))
+        return false;
+
+    out->nblobs = 0;
+    out->ncmds = 0;
+    out->nfixups = 0;
+    out->total_ns = 0;
+    out->blobs = calloc(nblobs ? nblobs : 1, sizeof(struct replay_blob));
+    out->cmds = calloc(ncmds ? ncmds : 1, sizeof(struct replay_cmd));
+    out->fixups = calloc(nfixups ? nfixups : 1, sizeof(struct fixup));
+    if(!out->blobs || !out->cmds || !out->fixups)
+        goto fail;
+
+    for(; out->nblobs < nblobs; out->nblobs++) {
+
+        struct replay_blob *blob = &out->blobs[out->nblobs];
+        blob->index = out->nblobs;
+        if(!read_u64(stream, &blob->addr)
+        || !read_u64(stream, &blob->size))
+            goto fail;
+
+        blob->data = malloc(blob->size ? blob->size : 1);
+        blob->work = malloc(blob->size ? blob->size : 1);
+        if(!blob->data || !blob->work) {
+            out->nblobs++;
+            goto fail;
+        }
+        if(!read_padded(stream, blob->data, blob->size)) {
+            out->nblobs++;
+            goto fail;
+        }
+    }
+    qsort(out->blobs, out->nblobs, sizeof(struct replay_blob), compare_blobs);
+
+    for(; out->ncmds < ncmds; out->ncmds++) {
+
+        struct replay_cmd *cmd = &out->cmds[out->ncmds];
+        if(!read_u64(stream, &cmd->func)
+        || !read_u64(stream, &cmd->captured_ns)
+        || !read_u32(stream, &cmd->nargs)
+        || !read_u32(stream, &pad))
+            goto fail;
+
+        if(cmd->nargs > MAX_ARGS)
+            goto fail;
+
+        for(int i = 0; i < cmd->nargs; i++) {
+            if(!read_u64(stream, &cmd->args[i]))
+                goto fail;
+        }
+        cmd->min_ns = UINT64_MAX;
+    }
+
+    for(; out->nfixups < nfixups; out->nfixups++) {
+
+        struct fixup *curr = &out->fixups[out->nfixups];
+        if(!read_u32(stream, &curr->res)
+        || !read_u32(stream, &curr->blob)
+        || !read_u64(stream, &curr->offset))
+            goto fail;
+    }
+
+    replay_relocate_frame(out);
+    return true;
+
+fail:
+    replay_frame_destroy(out);
+    return false;
+}
+
+static bool replay_read_syms(FILE *stream, vec_sym_t *out)
+{
+    uint32_t nsyms;
+    if(!read_u32(stream, &nsyms))
+        return false;
+
+    for(int i = 0; i < nsyms; i++) {
+
+        struct replay_sym sym;
+        uint32_t len, pad;
+        if(!read_u64(stream, &sym.func)
+        || !read_u32(stream, &len)
+        || !read_u32(stream, &pad))
+            return false;
+        if(len >= MAX_SYM_LEN)
+            return false;
+        if(!read_padded(stream, sym.name, len))
+            return false;
+        sym.name[len] = '\0';
+        if(!vec_sym_push(out, sym))
+            return false;
+    }
+    return true;
+}
+
+/* The resource ids are assigned in the order that they are written in */
+static bool replay_read_res(FILE *stream, vec_res_t *out)
+{
+    uint32_t id, pad;
+    struct replay_res res = {0};
+
+    if(!read_u32(stream, &res.kind)
+    || !read_u32(stream, &id)
+    || !read_u32(stream, &pad)
+    || !read_u64(stream, &res.size))
+        return false;
+
+    if(id != vec_size(out) || res.kind > RES_CHUNK)
+        return false;
+
+    res.data = malloc(res.size + 1);
+    if(!res.data)
+        return false;
+
+    if(!read_padded(stream, res.data, res.size)
+    || !vec_res_push(out, res)) {
+        free(res.data);
+        return false;
+    }
+    res.data[res.size] = '\0';
+    return true;
+}
+
+static void replay_destroy(struct replay *replay)
+{
+    for(int i = 0; i < vec_size(&replay->frames); i++) {
+        replay_frame_destroy(&vec_AT(&replay->frames, i));
+    }
+    for(int i = 0; i < vec_size(&replay->res); i++) {
+        free(vec_AT(&replay->res, i).data);
+    }
+    vec_frame_destroy(&replay->frames);
+    vec_sym_destroy(&replay->syms);
+    vec_res_destroy(&replay->res);
+    free(replay);
+}
+
+static bool replay_read(FILE *stream, struct replay *out)
+{
+    uint32_t magic, version;
+
+    if(!read_u32(stream, &magic)
+    || !read_u32(stream, &version))
+        return false;
+
+    if(magic != CAPTURE_MAGIC || version != CAPTURE_VERSION) {
+        fprintf(stderr, "Replay: not a render command capture file.\n");
+        return false;
+    }
+
+    while(true) {
+
+        uint32_t tag;
+        if(!read_u32(stream, &tag))
+            return false;
+
+        switch(tag) {
+        case RSRC_TAG:
+            if(!replay_read_res(stream, &out->res))
+                return false;
+            break;
+        case FRAME_TAG: {
+            struct replay_frame frame;
+            if(!replay_read_frame(stream, &frame))
+                return false;
+            if(!vec_frame_push(&out->frames, frame)) {
+                replay_frame_destroy(&frame);
+                return false;
+            }
+            break;
+        }
+        case SYMS_TAG:
+            if(!replay_read_syms(stream, &out->syms))
+                return false;
+            break;
+        case END_TAG:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+static struct replay *replay_load(const char *path)
+{
+    struct replay *ret = malloc(sizeof(struct replay));
+    if(!ret)
+        return NULL;
+
+    vec_frame_init(&ret->frames);
+    vec_sym_init(&ret->syms);
+    vec_res_init(&ret->res);
+
+    FILE *stream = fopen(path, "rb");
+    if(!stream) {
+        fprintf(stderr, "Replay: unable to open file (%s) for reading.\n", path);
+        goto fail;
+    }
+
+    bool loaded = replay_read(stream, ret);
+    fclose(stream);
+
+    if(!loaded) {
+        fprintf(stderr, "Replay: failed to load the render command capture (%s).\n", path);
+        goto fail;
+    }
+    return ret;
+
+fail:
+    replay_destroy(ret);
+    return NULL;
+}
+
+static const char *replay_sym_name(const vec_sym_t *syms, uint64_t func)
+{
+    for(int i = 0; i < vec_size(syms); i++) {
+        if(vec_AT(syms, i).func == func)
+            return vec_AT(syms, i).name;
+    }
+    return "<unknown>";
+}
+
+static bool replay_bind_model(struct replay_res *res)
+{
+    char basedir[MAX_PATH_LEN], pfobj_name[MAX_PATH_LEN];
+    if(res->size != sizeof(basedir) + sizeof(pfobj_name))
+        return false;
+
+    memcpy(basedir, res->data, sizeof(basedir));
+    memcpy(pfobj_name, res->data + sizeof(basedir), sizeof(pfobj_name));
+    basedir[sizeof(basedir) - 1] = '\0';
+    pfobj_name[sizeof(pfobj_name) - 1] = '\0';
+
+    /* The model data is shared with all the other entities loaded from the 
+     * same file and outlives the entity. */
+    struct entity *ent = AL_EntityFromPFObj(basedir, pfobj_name, pfobj_name, 0);
+    if(!ent) {
+        fprintf(stderr, "Replay: unable to load the model (%s/%s).\n", basedir, pfobj_name);
+        return false;
+    }
+
+    if(res->kind == RES_MODEL) {
+        res->bound = ent->render_private;
+    }else if(ent->flags & ENTITY_FLAG_ANIMATED) {
+        res->bound = A_AL_InvBindPoses(ent->anim_private);
+    }
+    AL_EntityFree(ent);
+    return (res->bound != NULL);
+}
+
+static bool replay_bind_map(struct replay_res *res)
+{
+    const struct map *map = G_GetMap();
+    if(!map) {
+        fprintf(stderr, "Replay: the capture references a map, but none is loaded.\n");
+        return false;
+    }
+
+    int nrows, ncols;
+    if(sscanf((const char*)res->data, "version %*f num_materials %*d num_rows %d num_cols %d", 
+        &nrows, &ncols) != 2)
+        return false;
+
+    struct map_resolution mres;
+    M_GetResolution(map, &mres);
+    if(nrows != mres.chunk_h || ncols != mres.chunk_w) {
+        fprintf(stderr, "Replay: the captured map (%dx%d chunks) does not match the loaded one.\n", 
+            nrows, ncols);
+        return false;
+    }
+
+    /* The render commands get the copy of the map from the previous tick */
+    res->bound = G_GetPrevTickMap();
+    return true;
+}
+
+static bool replay_bind_chunk(struct replay_res *res, const vec_res_t *all)
+{
+    uint32_t payload[4];
+    if(res->size != sizeof(payload))
+        return false;
+    memcpy(payload, res->data, sizeof(payload));
+
+    uint32_t map_id = payload[0];
+    if(map_id >= vec_size(all) || vec_AT(all, map_id).kind != RES_MAP)
+        return false;
+
+    const struct map *map = G_GetMap();
+    struct map_resolution mres;
+    M_GetResolution(map, &mres);
+
+    if(payload[1] >= mres.chunk_h || payload[2] >= mres.chunk_w)
+        return false;
+
+    res->bound = M_GetChunkRenderPrivate(map, payload[1], payload[2]);
+    return true;
+}
+
+static bool replay_fixup_frame(struct replay_frame *frame, const vec_res_t *res)
+{
+    bool ret = false;
+    struct replay_blob **by_index = malloc((frame->nblobs ? frame->nblobs : 1) * sizeof(struct replay_blob*));
+    if(!by_index)
+        return false;
+
+    for(int i = 0; i < frame->nblobs; i++) {
+        by_index[frame->blobs[i].index] = &frame->blobs[i];
+    }
+
+    for(int i = 0; i < frame->nfixups; i++) {
+
+        const struct fixup *curr = &frame->fixups[i];
+        if(curr->res >= vec_size(res))
+            goto out;
+        uint64_t val = (uintptr_t)vec_AT(res, curr->res).bound;
+
+        if(curr->blob == FIXUP_ARG) {
+
+            uint64_t cmd = curr->offset / MAX_ARGS, arg = curr->offset % MAX_ARGS;
+            if(cmd >= frame->ncmds || arg >= frame->cmds[cmd].nargs)
+                goto out;
+            frame->cmds[cmd].args[arg] = val;
+        }else{
+
+            if(curr->blob >= frame->nblobs)
+                goto out;
+            struct replay_blob *blob = by_index[curr->blob];
+            if(curr->offset + sizeof(val) > blob->size)
+                goto out;
+            memcpy(blob->data + curr->offset, &val, sizeof(val));
+        }
+    }
+    ret = true;
+
+out:
+    free(by_index);
+    return ret;
+}
+
+/* Point the commands at the objects of this process */
+static bool replay_bind(struct replay *replay)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    for(int i = 0; i < vec_size(&replay->res); i++) {
+
+        struct replay_res *curr = &vec_AT(&replay->res, i);
+        bool ok = false;
+
+        switch(curr->kind) {
+        case RES_MODEL:
+        case RES_BIND_POSES:
+            ok = replay_bind_model(curr);
+            break;
+        case RES_MAP:
+            ok = replay_bind_map(curr);
+            break;
+        case RES_CHUNK:
+            ok = replay_bind_chunk(curr, &replay->res);
+            break;
+        }
+        if(!ok) {
+            fprintf(stderr, "Replay: unable to bind resource %d of the capture.\n", i);
+            return false;
+        }
+    }
+
+    for(int i = 0; i < vec_size(&replay->frames); i++) {
+
+        struct replay_frame *frame = &vec_AT(&replay->frames, i);
+        if(!replay_fixup_frame(frame, &replay->res)) {
+            fprintf(stderr, "Replay: invalid fixups in frame %d of the capture.\n", i);
+            return false;
+        }
+
+        for(int j = 0; j < frame->ncmds; j++) {
+
+            struct replay_cmd *cmd = &frame->cmds[j];
+            const struct cmd_func *cf = cmd_func_for_name(replay_sym_name(&replay->syms, cmd->func));
+            cmd->resolved = (cf && cf->replay) ? cf->func : NULL;
+        }
+    }
+    return true;
+}
+
+static void replay_run_frame(struct replay_frame *frame)
+{
+    for(int i = 0; i < frame->nblobs; i++) {
+        memcpy(frame->blobs[i].work, frame->blobs[i].data, frame->blobs[i].size);
+    }
+
+    uint64_t frame_begin = SDL_GetPerformanceCounter();
+    for(int i = 0; i < frame->ncmds; i++) {
+
+        struct replay_cmd *cmd = &frame->cmds[i];
+        if(!cmd->resolved)
+            continue;
+
+        struct rcmd rcmd = (struct rcmd){
+            .func = cmd->resolved,
+            .nargs = cmd->nargs,
+        };
+        for(int j = 0; j < cmd->nargs; j++) {
+            rcmd.args[j] = (void*)(uintptr_t)cmd->args[j];
+        }
+
+        uint64_t begin = SDL_GetPerformanceCounter();
+        R_DispatchCmd(rcmd);
+        uint64_t end = SDL_GetPerformanceCounter();
+        GL_ASSERT_OK();
+
+        uint64_t ns = ticks_to_ns(end - begin);
+        cmd->total_ns += ns;
+        cmd->min_ns = ns < cmd->min_ns ? ns : cmd->min_ns;
+        cmd->max_ns = ns > cmd->max_ns ? ns : cmd->max_ns;
+    }
+
+    /* Include the time the GPU took to get through the frame */
+    glFinish();
+    frame->total_ns += ticks_to_ns(SDL_GetPerformanceCounter() - frame_begin);
+}
+
+static bool replay_write_report(FILE *stream, const struct replay *replay)
+{
+    fprintf(stream, "# frame, command, function, captured_us, avg_us, min_us, max_us\n");
+
+    for(int i = 0; i < vec_size(&replay->frames); i++) {
+
+        const struct replay_frame *frame = &vec_AT(&replay->frames, i);
+        uint64_t captured_ns = 0;
+        size_t nskipped = 0;
+
+        for(int j = 0; j < frame->ncmds; j++) {
+
+            const struct replay_cmd *cmd = &frame->cmds[j];
+            captured_ns += cmd->captured_ns;
+
+            if(!cmd->resolved) {
+                fprintf(stream, "%d, %d, %s, %.3f, skipped\n", i, j, 
+                    replay_sym_name(&replay->syms, cmd->func), 
+                    cmd->captured_ns / 1000.0);
+                nskipped++;
+                continue;
+            }
+
+            fprintf(stream, "%d, %d, %s, %.3f, %.3f, %.3f, %.3f\n", i, j, 
+                replay_sym_name(&replay->syms, cmd->func),
+                cmd->captured_ns / 1000.0, 
+                cmd->total_ns / 1000.0 / replay->nloops,
+                cmd->min_ns / 1000.0,
+                cmd->max_ns / 1000.0);
+        }
+
+        fprintf(stream, "# frame %d: %zu commands (%zu skipped), captured %.3f ms, "
+            "replayed %.3f ms (average, including glFinish)\n",
+            i, frame->ncmds, nskipped, captured_ns / 1e6, frame->total_ns / 1e6 / replay->nloops);
+    }
+    return !ferror(stream);
+}
+
+static void render_replay(struct replay **arg)
+{
+    ASSERT_IN_RENDER_THREAD();
+    struct replay *replay = *arg;
+
+    for(int i = 0; i < replay->nloops; i++) {
+        for(int j = 0; j < vec_size(&replay->frames); j++) {
+            replay_run_frame(&vec_AT(&replay->frames, j));
+        }
+    }
+
+    FILE *report = fopen(replay->report_path, "w");
+    if(!report) {
+        fprintf(stderr, "Replay: unable to open file (%s) for writing.\n", replay->report_path);
+        goto out;
+    }
+    if(!replay_write_report(report, replay)) {
+        fprintf(stderr, "Replay: failed to write the report (%s).\n", replay->report_path);
+    }
+    fclose(report);
+
+out:
+    replay_destroy(replay);
+}
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+bool R_Capture_Init(void)
+{
+    s_funcs = kh_init(func);
+    if(!s_funcs)
+        goto fail_funcs;
+
+    s_resources = kh_init(res);
+    if(!s_resources)
+        goto fail_resources;
+
+    vec_rcmd_init(&s_cmds);
+    vec_fixup_init(&s_fixups);
+    SDL_AtomicSet(&s_active, 0);
+    return true;
+
+fail_resources:
+    kh_destroy(func, s_funcs);
+fail_funcs:
+    return false;
+}
+
+void R_Capture_Shutdown(void)
+{
+    /* A capture was cut short by exiting */
+    if(s_file) {
+        fclose(s_file);
+        s_file = NULL;
+    }
+    vec_fixup_destroy(&s_fixups);
+    vec_rcmd_destroy(&s_cmds);
+    kh_destroy(res, s_resources);
+    kh_destroy(func, s_funcs);
+}
+
+bool R_Capture_BeginFrame(struct render_workspace *ws)
+{
+    ASSERT_IN_MAIN_THREAD();
+    assert(!ws->capture);
+
+    if(s_frames_left == 0)
+        return false;
+
+    struct ws_capture *cap = malloc(sizeof(struct ws_capture));
+    if(!cap)
+        return false;
+
+    cap->last = (--s_frames_left == 0);
+    cap->live = NULL;
+    cap->map = NULL;
+    vec_extent_init(&cap->args);
+    ws->capture = cap;
+    return true;
+}
+
+void R_Capture_NoteArg(struct render_workspace *ws, const void *arg, size_t size)
+{
+    struct ws_capture *cap = ws->capture;
+    assert(cap);
+    vec_extent_push(&cap->args, (struct arg_extent){arg, size});
+}
+
+void R_Capture_EndFrame(struct render_workspace *ws)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    struct ws_capture *cap = ws->capture;
+    assert(cap);
+
+    if(!cap->live && !(cap->live = kh_init(live)))
+        return;
+    kh_clear(live, cap->live);
+
+    AL_ForEachModel(capture_note_model, cap);
+
+    const struct map *map = G_GetMap();
+    if(!map)
+        return;
+
+    cap->map = G_GetPrevTickMap();
+    struct live_ref ref = (struct live_ref){
+        .kind = RES_MAP,
+        .key = (uintptr_t)cap->map,
+    };
+    capture_note(cap, cap->map, ref);
+    capture_note(cap, map, ref);
+
+    struct map_resolution res;
+    M_GetResolution(map, &res);
+
+    for(int r = 0; r < res.chunk_h; r++) {
+    for(int c = 0; c < res.chunk_w; c++) {
+
+        const void *priv = M_GetChunkRenderPrivate(map, r, c);
+        capture_note(cap, priv, (struct live_ref){
+            .kind = RES_CHUNK,
+            .key = (uintptr_t)priv,
+            .chunk_r = r,
+            .chunk_c = c,
+        });
+    }}
+}
+
+void R_Capture_ReleaseWS(struct render_workspace *ws)
+{
+    struct ws_capture *cap = ws->capture;
+    if(!cap)
+        return;
+
+    if(cap->live) {
+        kh_destroy(live, cap->live);
+    }
+    vec_extent_destroy(&cap->args);
+    free(cap);
+    ws->capture = NULL;
+}
+
+void R_Capture_ProcessCmds(struct render_workspace *ws)
+{
+    ASSERT_IN_RENDER_THREAD();
+
+    struct ws_capture *cap = ws->capture;
+    assert(cap);
+    assert(s_file);
+
+    /* The commands are taken out of the queue first, so that the resources 
+     * that they reference can be written out ahead of the frame */
+    vec_rcmd_reset(&s_cmds);
+    if(!vec_rcmd_resize(&s_cmds, queue_size(ws->commands))) {
+
+        s_ok = false;
+        while(queue_size(ws->commands) > 0) {
+            struct rcmd curr;
+            queue_rcmd_pop(&ws->commands, &curr);
+            R_DispatchCmd(curr);
+            GL_ASSERT_OK();
+        }
+        goto out;
+    }
+
+    uint32_t ncmds = 0;
+    while(queue_size(ws->commands) > 0) {
+
+        struct rcmd curr;
+        queue_rcmd_pop(&ws->commands, &curr);
+        vec_rcmd_push(&s_cmds, curr);
+        ncmds += capture_recorded(&curr);
+    }
+
+    s_ok = s_ok 
+        && capture_collect_fixups(cap)
+        && write_u32(s_file, FRAME_TAG)
+        && write_u32(s_file, vec_size(&cap->args))
+        && write_u32(s_file, ncmds)
+        && write_u32(s_file, vec_size(&s_fixups))
+        && capture_write_blobs(s_file, &cap->args);
+
+    for(int i = 0; i < vec_size(&s_cmds); i++) {
+
+        const struct rcmd *curr = &vec_AT(&s_cmds, i);
+
+        uint64_t begin = SDL_GetPerformanceCounter();
+        R_DispatchCmd(*curr);
+        uint64_t end = SDL_GetPerformanceCounter();
+        GL_ASSERT_OK();
+
+        if(capture_recorded(curr)) {
+            s_ok = s_ok && capture_write_cmd(s_file, curr, ticks_to_ns(end - begin));
+        }
+    }
+    s_ok = s_ok && capture_write_fixups(s_file);
+
+out:
+    if(cap->last) {
+        capture_finish();
+    }
+}
+
+bool R_CaptureCmds(const char *path, int nframes)
+{
+    ASSERT_IN_MAIN_THREAD();
+    assert(nframes > 0);
+
+    if(SDL_AtomicGet(&s_active))
+        return false;
+
+    FILE *stream = fopen(path, "wb");
+    if(!stream)
+        return false;
+
+    if(!write_u32(stream, CAPTURE_MAGIC)
+    || !write_u32(stream, CAPTURE_VERSION)) {
+        fclose(stream);
+        return false;
+    }
+
+    s_file = stream;
+    s_ok = true;
+    s_frames_left = nframes;
+    SDL_AtomicSet(&s_active, 1);
+    return true;
+}
+
+bool R_CapturingCmds(void)
+{
+    return SDL_AtomicGet(&s_active);
+}
+
+bool R_ReplayCmds(const char *path, int nloops, const char *report_path)
+{
+    ASSERT_IN_MAIN_THREAD();
+    assert(nloops > 0);
+
+    struct replay *replay = replay_load(path);
+    if(!replay)
+        return false;
+
+    if(!replay_bind(replay)) {
+        replay_destroy(replay);
+        return false;
+    }
+
+    replay->nloops = nloops;
+    pf_strlcpy(replay->report_path, report_path, sizeof(replay->report_path));
+
+    R_PushCmd((struct rcmd){
+        .func = render_replay,
+        .nargs = 1,
+        .args = {
+            R_PushArg(&replay, sizeof(replay)),
+        },
+    });
+    return true;
+}
+
+bool R_ReplayNewGame(const char *path)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    struct replay *replay = replay_load(path);
+    if(!replay)
+        return false;
+
+    bool ret = false;
+    for(int i = 0; i < vec_size(&replay->res); i++) {
+
+        const struct replay_res *curr = &vec_AT(&replay->res, i);
+        if(curr->kind != RES_MAP)
+            continue;
+
+        SDL_RWops *stream = SDL_RWFromConstMem(curr->data, curr->size);
+        if(stream) {
+            ret = G_NewGameWithMap(stream, true);
+            SDL_RWclose(stream);
+        }
+        goto out;
+    }
+    fprintf(stderr, "Replay: the capture (%s) does not reference a map.\n", path);
+
+out:
+    replay_destroy(replay);
+    return ret;
+}
+
@@ -0,0 +1,65 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#ifndef RENDER_CAPTURE_H
+#define RENDER_CAPTURE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct render_workspace;
+
+bool R_Capture_Init(void);
+void R_Capture_Shutdown(void);
+
+/* Called by the main thread at the start of each frame, before any 
+ * commands have been pushed. Marks the simulation workspace for capture
+ * while there are frames left to capture. Returns true if the frame's 
+ * commands are to be captured. */
+bool R_Capture_BeginFrame(struct render_workspace *ws);
+/* Remember the extent of an argument pushed to a workspace which is 
+ * being captured */
+void R_Capture_NoteArg(struct render_workspace *ws, const void *arg, size_t size);
+/* Called by the main thread once all the commands of a captured frame have 
+ * been pushed. Takes note of the objects that the commands may reference. */
+void R_Capture_EndFrame(struct render_workspace *ws);
+void R_Capture_ReleaseWS(struct render_workspace *ws);
+
+/* Called by the render thread in place of regular command execution for 
+ * the workspaces marked for capture */
+void R_Capture_ProcessCmds(struct render_workspace *ws);
+
+#endif
+
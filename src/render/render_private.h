@@ -42,6 +42,8 @@
 
 struct terrain_vert;
 struct map;
+struct rcmd;
+struct cmd_batch;
 
 struct render_private{
     struct mesh         mesh;
@@ -53,6 +55,11 @@ struct render_private{
     GLuint              vertex_stride;
 };
 
+/* Execute a command on the render thread */
+void R_DispatchCmd(struct rcmd cmd);
+/* Execute the compactly encoded commands of a closed batch */
+void R_ExecBatch(const struct cmd_batch *batch);
+
 /* Tile */
 void R_TileGetVertices(const struct map *map, struct tile_desc td, struct terrain_vert *out);
 
@@ -552,6 +552,7 @@ static int PyEntity_set_scale(PyEntityObject *self, PyObject *value, void *closu
         &self->ent->scale.raw[0], &self->ent->scale.raw[1], &self->ent->scale.raw[2]))
         return -1;
 
+    G_UpdateBounds(self->ent);
     return 0;
 }
 
@@ -573,6 +574,7 @@ static int PyEntity_set_rotation(PyEntityObject *self, PyObject *value, void *cl
         &self->ent->rotation.raw[2], &self->ent->rotation.raw[3]))
         return -1;
 
+    G_UpdateBounds(self->ent);
     return 0;
 }
 
@@ -745,21 +747,21 @@ static PyObject *PyEntity_notify(PyEntityObject *self, PyObject *args)
 static PyObject *PyEntity_select(PyEntityObject *self)
 {
     assert(self->ent);
-    G_Sel_Add(self->ent);
+    G_Cmd_Select(self->ent);
     Py_RETURN_NONE;
 }
 
 static PyObject *PyEntity_deselect(PyEntityObject *self)
 {
     assert(self->ent);
-    G_Sel_Remove(self->ent);
+    G_Cmd_Deselect(self->ent);
     Py_RETURN_NONE;
 }
 
 static PyObject *PyEntity_stop(PyEntityObject *self)
 {
     assert(self->ent);
-    G_StopEntity(self->ent);
+    G_Cmd_Stop(self->ent);
     Py_RETURN_NONE;
 }
 
@@ -777,7 +779,7 @@ static PyObject *PyEntity_move(PyEntityObject *self, PyObject *args)
         return NULL;
     }
 
-    G_Move_SetDest(self->ent, xz_pos);
+    G_Cmd_Move(self->ent, xz_pos);
     Py_RETURN_NONE;
 }
 
@@ -964,6 +966,7 @@ static PyObject *PyEntity_unpickle(PyObject *cls, PyObject *args)
     CHK_TRUE((-1 != (rawflags = PyInt_AsLong(flags))), fail_unpickle_atts);
     G_SetStatic(ent, rawflags & ENTITY_FLAG_STATIC);
     ent->flags = rawflags;
+    G_UpdateBounds(ent);
 
     status = PyObject_SetAttrString(entobj, "selection_radius", sel_radius);
     CHK_TRUE(0 == status, fail_unpickle_atts);
@@ -1003,12 +1006,8 @@ fail_args:
 static PyObject *PyCombatableEntity_hold_position(PyCombatableEntityObject *self)
 {
     assert(self->super.ent);
-
-    if(!(self->super.ent->flags & ENTITY_FLAG_STATIC))
-        G_StopEntity(self->super.ent);
-
     assert(self->super.ent->flags & ENTITY_FLAG_COMBATABLE);
-    G_Combat_SetStance(self->super.ent, COMBAT_STANCE_HOLD_POSITION);
+    G_Cmd_HoldPosition(self->super.ent);
     Py_RETURN_NONE;
 }
 
@@ -1027,11 +1026,7 @@ static PyObject *PyCombatableEntity_attack(PyCombatableEntityObject *self, PyObj
     }
 
     assert(self->super.ent->flags & ENTITY_FLAG_COMBATABLE);
-    G_Combat_SetStance(self->super.ent, COMBAT_STANCE_AGGRESSIVE);
-
-    if(!(self->super.ent->flags & ENTITY_FLAG_STATIC))
-        G_Move_SetDest(self->super.ent, xz_pos);
-
+    G_Cmd_Attack(self->super.ent, xz_pos);
     Py_RETURN_NONE;
 }
 
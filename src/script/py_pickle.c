@@ -58,6 +58,8 @@ typedef void *mod_ty; //symtable.h wants this
 #define CHK_TRUE(_pred, _label) do{ if(!(_pred)) goto _label; }while(0)
 #define MIN(a, b)   ((a) < (b) ? (a) : (b))
 #define TP(_p)      ((PyTypeObject*)_p)
+#define WBUFF_SIZE  (64 * 1024)
+#define SDL_RWOPS_PICKLE_WBUFF (0xfffe)
 
 #define SET_EXC(_type, ...)                                                     \
     do {                                                                        \
@@ -247,6 +249,15 @@ struct pickle_ctx{
     vec_pobj_t     to_free;
 };
 
+/* Pickling emits a very large number of tiny writes. They are gathered 
+ * here and forwarded to the destination stream in large blocks. */
+struct pickle_wbuff{
+    SDL_RWops     *dst;
+    size_t         size;
+    bool           error;
+    char           data[WBUFF_SIZE];
+};
+
 struct unpickle_ctx{
     vec_pobj_t     stack;
     vec_pobj_t     memo;
@@ -265,11 +276,11 @@ struct pickle_entry{
 
 static bool pickle_obj(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *stream);
 static bool pickle_attrs(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw);
-static void memoize(struct pickle_ctx *ctx, PyObject *obj);
+static int memoize(struct pickle_ctx *ctx, PyObject *obj);
 static bool memo_contains(const struct pickle_ctx *ctx, PyObject *obj);
 static int memo_idx(const struct pickle_ctx *ctx, PyObject *obj);
-static bool emit_get(const struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw);
-static bool emit_put(const struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw);
+static bool emit_get(int idx, SDL_RWops *rw);
+static bool emit_put(int idx, SDL_RWops *rw);
 
 /* Pickling functions */
 static int type_pickle        (struct pickle_ctx *, PyObject *, SDL_RWops *);
@@ -1662,12 +1673,13 @@ static int custom_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
     assert(!memo_contains(ctx, obj));
     CHK_TRUE(pickle_obj(ctx, (PyObject*)obj->ob_type, rw), fail);
 
-    if(memo_contains(ctx, obj)) {
+    int idx = memo_idx(ctx, obj);
+    if(idx >= 0) {
         /* Pop the type we just pushed */
         const char pop[] = {POP};
         CHK_TRUE(rw->write(rw, pop, ARR_SIZE(pop), 1), fail);
         /* fetch from memo */
-        CHK_TRUE(emit_get(ctx, obj, rw), fail);
+        CHK_TRUE(emit_get(idx, rw), fail);
         return 0;
     }
 
@@ -1801,12 +1813,13 @@ static int type_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
      * In that case, pop the things we were going to use to construct
      * the type, and fetch it from the memo instead.
      */
-    if(memo_contains(ctx, obj)) {
+    int idx = memo_idx(ctx, obj);
+    if(idx >= 0) {
         /* Pop the stuff we just pushed */
         const char pops[] = {POP, POP, POP, POP};
         CHK_TRUE(rw->write(rw, pops, ARR_SIZE(pops), 1), fail);
         /* Get the type from the memo */
-        CHK_TRUE(emit_get(ctx, obj, rw), fail);
+        CHK_TRUE(emit_get(idx, rw), fail);
         return 0;
     }
 
@@ -1914,8 +1927,7 @@ static int list_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
     /* Memoize the empty list before pickling the elements. The elements may 
      * reference the list itself. */
     assert(!memo_contains(ctx, obj));
-    memoize(ctx, obj);
-    CHK_TRUE(emit_put(ctx, obj, rw), fail);
+    CHK_TRUE(emit_put(memoize(ctx, obj), rw), fail);
 
     CHK_TRUE(rw->write(rw, &mark, 1, 1), fail);
 
@@ -2018,8 +2030,7 @@ static int dict_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
     /* Memoize the empty dict before pickling the elements. The elements may 
      * reference the list itself. */
     assert(!memo_contains(ctx, obj));
-    memoize(ctx, obj);
-    CHK_TRUE(emit_put(ctx, obj, rw), fail);
+    CHK_TRUE(emit_put(memoize(ctx, obj), rw), fail);
     CHK_TRUE(rw->write(rw, &mark, 1, 1), fail);
 
     PyObject *key, *value;
@@ -2421,12 +2432,13 @@ static int tuple_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
         }
     }
 
-    if(memo_contains(ctx, obj)) {
+    int idx = memo_idx(ctx, obj);
+    if(idx >= 0) {
     
         /* pop the stack stuff we pushed */
         CHK_TRUE(rw->write(rw, &pmark, 1, 1), fail);
         /* fetch from memo */
-        CHK_TRUE(emit_get(ctx, obj, rw), fail);
+        CHK_TRUE(emit_get(idx, rw), fail);
         return 0;
     }
 
@@ -2539,8 +2551,7 @@ static int function_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
      * first create a 'dummy' function object and set its' 'code' and 
      * 'dict' attributes after. */
     assert(!memo_contains(ctx, obj));
-    memoize(ctx, obj);
-    CHK_TRUE(emit_put(ctx, obj, rw), fail);
+    CHK_TRUE(emit_put(memoize(ctx, obj), rw), fail);
 
     CHK_TRUE(pickle_obj(ctx, func->func_code, rw), fail);
     CHK_TRUE(pickle_obj(ctx, func->func_globals, rw), fail);
@@ -2697,8 +2708,7 @@ static int module_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
     CHK_TRUE(rw->write(rw, emptymod, ARR_SIZE(emptymod), 1), fail);
 
     assert(!memo_contains(ctx, obj));
-    memoize(ctx, obj);
-    CHK_TRUE(emit_put(ctx, obj, rw), fail);
+    CHK_TRUE(emit_put(memoize(ctx, obj), rw), fail);
 
     PyModuleObject *mod = (PyModuleObject*)obj;
     CHK_TRUE(pickle_obj(ctx, mod->md_dict, rw), fail);
@@ -2951,8 +2961,7 @@ static int frame_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
     CHK_TRUE(rw->write(rw, emptyframe, ARR_SIZE(emptyframe), 1), fail);
 
     assert(!memo_contains(ctx, obj));
-    memoize(ctx, obj);
-    CHK_TRUE(emit_put(ctx, obj, rw), fail);
+    CHK_TRUE(emit_put(memoize(ctx, obj), rw), fail);
 
     const char pop[] = {POP};
     CHK_TRUE(rw->write(rw, pop, ARR_SIZE(pop), 1), fail);
@@ -3044,7 +3053,7 @@ static int frame_pickle(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
 
     /* Push the dummy frame object */
     assert(memo_contains(ctx, obj));
-    CHK_TRUE(emit_get(ctx, obj, rw), fail);
+    CHK_TRUE(emit_get(memo_idx(ctx, obj), rw), fail);
 
     const char ops[] = {PF_EXTEND, PF_FRAME};
     CHK_TRUE(rw->write(rw, ops, ARR_SIZE(ops), 1), fail);
@@ -7165,6 +7174,100 @@ static void pickle_ctx_destroy(struct pickle_ctx *ctx)
     kh_destroy(memo, ctx->memo);
 }
 
+static bool wbuff_flush(struct pickle_wbuff *wb)
+{
+    if(wb->error)
+        return false;
+    if(wb->size == 0)
+        return true;
+
+    if(1 != SDL_RWwrite(wb->dst, wb->data, wb->size, 1)) {
+        wb->error = true;
+        return false;
+    }
+    wb->size = 0;
+    return true;
+}
+
+static size_t rw_wbuff_write(SDL_RWops *rw, const void *ptr, size_t size, size_t num)
+{
+    assert(rw->type == SDL_RWOPS_PICKLE_WBUFF);
+    struct pickle_wbuff *wb = rw->hidden.unknown.data1;
+    size_t nbytes = size * num;
+
+    if(wb->size + nbytes > WBUFF_SIZE) {
+        if(!wbuff_flush(wb))
+            return 0;
+    }
+
+    if(nbytes > WBUFF_SIZE) {
+        if(1 != SDL_RWwrite(wb->dst, ptr, nbytes, 1)) {
+            wb->error = true;
+            return 0;
+        }
+        return num;
+    }
+
+    memcpy(wb->data + wb->size, ptr, nbytes);
+    wb->size += nbytes;
+    return num;
+}
+
+static size_t rw_wbuff_read(SDL_RWops *rw, void *ptr, size_t size, size_t num)
+{
+    SDL_SetError("Pickle write buffer cannot be read from");
+    return 0;
+}
+
+static Sint64 rw_wbuff_size(SDL_RWops *rw)
+{
+    struct pickle_wbuff *wb = rw->hidden.unknown.data1;
+    if(!wbuff_flush(wb))
+        return -1;
+    return SDL_RWsize(wb->dst);
+}
+
+static Sint64 rw_wbuff_seek(SDL_RWops *rw, Sint64 offset, int whence)
+{
+    struct pickle_wbuff *wb = rw->hidden.unknown.data1;
+    if(!wbuff_flush(wb))
+        return -1;
+    return SDL_RWseek(wb->dst, offset, whence);
+}
+
+static int rw_wbuff_close(SDL_RWops *rw)
+{
+    assert(rw->type == SDL_RWOPS_PICKLE_WBUFF);
+    struct pickle_wbuff *wb = rw->hidden.unknown.data1;
+    int ret = wbuff_flush(wb) ? 0 : -1;
+    free(rw);
+    return ret;
+}
+
+/* The returned stream must be closed to flush any remaining buffered data 
+ * to 'dst'. Closing it does not close 'dst'. */
+static SDL_RWops *wbuff_rwops(SDL_RWops *dst)
+{
+    SDL_RWops *ret = malloc(sizeof(SDL_RWops) + sizeof(struct pickle_wbuff));
+    if(!ret)
+        return NULL;
+
+    ret->size = rw_wbuff_size;
+    ret->seek = rw_wbuff_seek;
+    ret->read = rw_wbuff_read;
+    ret->write = rw_wbuff_write;
+    ret->close = rw_wbuff_close;
+    ret->type = SDL_RWOPS_PICKLE_WBUFF;
+
+    struct pickle_wbuff *wb = (struct pickle_wbuff*)(ret + 1);
+    wb->dst = dst;
+    wb->size = 0;
+    wb->error = false;
+    ret->hidden.unknown.data1 = wb;
+
+    return ret;
+}
+
 static bool unpickle_ctx_init(struct unpickle_ctx *ctx)
 {
     vec_pobj_init(&ctx->stack);
@@ -7185,24 +7288,21 @@ static void unpickle_ctx_destroy(struct unpickle_ctx *ctx)
     vec_pobj_destroy(&ctx->stack);
 }
 
-static bool memo_contains(const struct pickle_ctx *ctx, PyObject *obj)
+static int memo_idx(const struct pickle_ctx *ctx, PyObject *obj)
 {
     uintptr_t id = (uintptr_t)obj;
     khiter_t k = kh_get(memo, ctx->memo, id);
-    if(k != kh_end(ctx->memo))
-        return true;
-    return false;
+    if(k == kh_end(ctx->memo))
+        return -1;
+    return kh_value(ctx->memo, k).idx;
 }
 
-static int memo_idx(const struct pickle_ctx *ctx, PyObject *obj)
+static bool memo_contains(const struct pickle_ctx *ctx, PyObject *obj)
 {
-    uintptr_t id = (uintptr_t)obj;
-    khiter_t k = kh_get(memo, ctx->memo, id);
-    assert(kh_exist(ctx->memo, k));
-    return kh_value(ctx->memo, k).idx;
+    return (memo_idx(ctx, obj) >= 0);
 }
 
-static void memoize(struct pickle_ctx *ctx, PyObject *obj)
+static int memoize(struct pickle_ctx *ctx, PyObject *obj)
 {
     int ret;
     int idx = kh_size(ctx->memo);
@@ -7210,22 +7310,53 @@ static void memoize(struct pickle_ctx *ctx, PyObject *obj)
     khiter_t k = kh_put(memo, ctx->memo, (uintptr_t)obj, &ret);
     assert(ret != -1 && ret != 0);
     kh_value(ctx->memo, k) = (struct memo_entry){idx, obj};
+    return idx;
 }
 
-static bool emit_get(const struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
+/* Memoize the object unless it's already in the memo, and emit a PUT for it
+ * if it was newly added. The memo is probed only once. */
+static bool memoize_put(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
 {
-    char str[32];
-    pf_snprintf(str, ARR_SIZE(str), "%c%d\n", GET, memo_idx(ctx, obj));
-    str[ARR_SIZE(str)-1] = '\0';
-    return rw->write(rw, str, 1, strlen(str));
+    int ret;
+    int idx = kh_size(ctx->memo);
+
+    khiter_t k = kh_put(memo, ctx->memo, (uintptr_t)obj, &ret);
+    if(ret == -1) {
+        PyErr_NoMemory();
+        return false;
+    }
+    if(ret == 0)
+        return true;
+
+    kh_value(ctx->memo, k) = (struct memo_entry){idx, obj};
+    return emit_put(idx, rw);
 }
 
-static bool emit_put(const struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
+static bool emit_memo_op(char op, int idx, SDL_RWops *rw)
 {
-    char str[32];
-    pf_snprintf(str, ARR_SIZE(str), "%c%d\n", PUT, memo_idx(ctx, obj));
-    str[ARR_SIZE(str)-1] = '\0';
-    return rw->write(rw, str, 1, strlen(str));
+    char str[16];
+    char *end = str + ARR_SIZE(str);
+    char *cursor = end;
+
+    assert(idx >= 0);
+    *--cursor = '\n';
+    do {
+        *--cursor = '0' + (idx % 10);
+        idx /= 10;
+    }while(idx);
+    *--cursor = op;
+
+    return rw->write(rw, cursor, end - cursor, 1);
+}
+
+static bool emit_get(int idx, SDL_RWops *rw)
+{
+    return emit_memo_op(GET, idx, rw);
+}
+
+static bool emit_put(int idx, SDL_RWops *rw)
+{
+    return emit_memo_op(PUT, idx, rw);
 }
 
 static bool pickle_attrs(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *rw)
@@ -7276,17 +7407,76 @@ fail:
     return -1;
 }
 
+/* Exact instances of the primitive types have no writable attributes and
+ * don't reference any other objects besides their type. They can skip the
+ * general dispatch and attribute traversal. Returns NULL for all other objects.
+ */
+static pickle_func_t primitive_picklefunc(PyObject *obj, bool *out_memoize)
+{
+    PyTypeObject *type = obj->ob_type;
+
+    /* Emitting these directly is never larger than a memo GET */
+    *out_memoize = false;
+    if(type == &PyInt_Type)
+        return int_pickle;
+    if(type == &PyBool_Type)
+        return bool_pickle;
+    if(obj == Py_None)
+        return none_pickle;
+
+    /* Memoize variable-length values so that repeated strings (ex. attribute 
+     * names) are only written once and are shared again after unpickling. */
+    *out_memoize = true;
+    if(type == &PyString_Type)
+        return string_pickle;
+    if(type == &PyFloat_Type)
+        return float_pickle;
+    if(type == &PyLong_Type)
+        return long_pickle;
+#ifdef Py_USING_UNICODE
+    if(type == &PyUnicode_Type)
+        return unicode_pickle;
+#endif
+    return NULL;
+}
+
+static bool pickle_primitive(struct pickle_ctx *ctx, PyObject *obj, pickle_func_t pf, 
+                             bool memoize_obj, SDL_RWops *stream)
+{
+    if(memoize_obj) {
+        int idx = memo_idx(ctx, obj);
+        if(idx >= 0)
+            return emit_get(idx, stream);
+    }
+
+    if(0 != pf(ctx, obj, stream)) {
+        assert(PyErr_Occurred());
+        return false;
+    }
+
+    if(memoize_obj && !emit_put(memoize(ctx, obj), stream)) {
+        DEFAULT_ERR(PyExc_IOError, "Error writing to pickle stream");
+        return false;
+    }
+    return true;
+}
+
 static bool pickle_obj(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *stream)
 {
     pickle_func_t pf;
+    bool memoize_obj;
+
+    if((pf = primitive_picklefunc(obj, &memoize_obj)))
+        return pickle_primitive(ctx, obj, pf, memoize_obj, stream);
 
     if(0 != Py_EnterRecursiveCall("pickle_obj")) {
         PyErr_SetObject(PyExc_RuntimeError, PyExc_RecursionErrorInst);
         goto fail;
     }
 
-    if(memo_contains(ctx, obj)) {
-        CHK_TRUE(emit_get(ctx, obj, stream), fail);
+    int idx = memo_idx(ctx, obj);
+    if(idx >= 0) {
+        CHK_TRUE(emit_get(idx, stream), fail);
         goto out;
     }
 
@@ -7309,10 +7499,7 @@ static bool pickle_obj(struct pickle_ctx *ctx, PyObject *obj, SDL_RWops *stream)
     }
 
     /* Some objects (eg. lists) may already be memoized */
-    if(!memo_contains(ctx, obj)) {
-        memoize(ctx, obj);
-        CHK_TRUE(emit_put(ctx, obj, stream), fail);
-    }
+    CHK_TRUE(memoize_put(ctx, obj, stream), fail);
 
     if(pickle_attrs(ctx, obj, stream)) {
         assert(PyErr_Occurred());
@@ -7409,20 +7596,34 @@ bool S_PickleObjgraph(PyObject *obj, SDL_RWops *stream)
     if(!ret) 
         goto err;
 
-    if(!pickle_obj(&ctx, obj, stream))
-        goto err;
+    SDL_RWops *buffered = wbuff_rwops(stream);
+    if(!buffered) {
+        SET_EXC(PyExc_MemoryError, "Pickle write buffer allocation");
+        goto err_buff;
+    }
+
+    if(!pickle_obj(&ctx, obj, buffered))
+        goto err_pickle;
 
     char term[] = {STOP, '\0'};
-    CHK_TRUE(stream->write(stream, term, 1, ARR_SIZE(term)), err_write);
+    CHK_TRUE(buffered->write(buffered, term, 1, ARR_SIZE(term)), err_write);
+
+    if(0 != SDL_RWclose(buffered)) {
+        DEFAULT_ERR(PyExc_IOError, "Error writing to pickle stream");
+        goto err_buff;
+    }
 
     pickle_ctx_destroy(&ctx);
     return true;
 
 err_write:
     DEFAULT_ERR(PyExc_IOError, "Error writing to pickle stream");
+err_pickle:
+    SDL_RWclose(buffered);
+err_buff:
+    pickle_ctx_destroy(&ctx);
 err:
     assert(PyErr_Occurred());
-    pickle_ctx_destroy(&ctx);
     return false;
 }
 
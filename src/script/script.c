@@ -81,6 +81,12 @@ static PyObject *PyPf_global_event(PyObject *self, PyObject *args);
 static PyObject *PyPf_activate_camera(PyObject *self, PyObject *args);
 static PyObject *PyPf_prev_frame_ms(PyObject *self);
 static PyObject *PyPf_prev_frame_perfstats(PyObject *self);
+static PyObject *PyPf_capture_perf_trace(PyObject *self, PyObject *args);
+static PyObject *PyPf_get_perf_percentiles(PyObject *self);
+static PyObject *PyPf_capture_render_cmds(PyObject *self, PyObject *args);
+static PyObject *PyPf_replay_render_cmds(PyObject *self, PyObject *args);
+static PyObject *PyPf_get_perf_spikes(PyObject *self);
+static PyObject *PyPf_clear_perf_spikes(PyObject *self);
 static PyObject *PyPf_get_resolution(PyObject *self);
 static PyObject *PyPf_get_native_resolution(PyObject *self);
 static PyObject *PyPf_get_basedir(PyObject *self);
@@ -131,8 +137,12 @@ static PyObject *PyPf_rand(PyObject *self, PyObject *args);
 static PyObject *PyPf_pickle_object(PyObject *self, PyObject *args);
 static PyObject *PyPf_unpickle_object(PyObject *self, PyObject *args);
 
-static PyObject *PyPf_save_session(PyObject *self, PyObject *args);
+static PyObject *PyPf_save_session(PyObject *self, PyObject *args, PyObject *kwargs);
 static PyObject *PyPf_load_session(PyObject *self, PyObject *args);
+static PyObject *PyPf_start_recording(PyObject *self, PyObject *args);
+static PyObject *PyPf_stop_recording(PyObject *self);
+static PyObject *PyPf_play_replay(PyObject *self, PyObject *args);
+static PyObject *PyPf_stop_replay(PyObject *self);
 
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
@@ -204,6 +214,41 @@ static PyMethodDef pf_module_methods[] = {
     (PyCFunction)PyPf_prev_frame_perfstats, METH_NOARGS,
     "Get a dictionary of the performance data for the previous frame."},
 
+    {"capture_perf_trace", 
+    (PyCFunction)PyPf_capture_perf_trace, METH_VARARGS,
+    "Write the performance data (CPU and GPU) of the specified number of frames (60 by default) to "
+    "a file in the Chrome Trace Event format. It can be viewed with chrome://tracing or Perfetto. "
+    "Profiling must be enabled via the 'pf.debug.profiling_enabled' setting for any data to be "
+    "captured."},
+
+    {"get_perf_percentiles", 
+    (PyCFunction)PyPf_get_perf_percentiles, METH_NOARGS,
+    "Get a dictionary of the 'frame', 'sim' (main thread) and 'render' (render thread) times over "
+    "the recent frames. For each, the number of samples and the 50th, 95th and 99th percentile and "
+    "maximum times (in milliseconds) are given."},
+
+    {"get_perf_spikes", 
+    (PyCFunction)PyPf_get_perf_spikes, METH_NOARGS,
+    "Get a list of the most recent frames that took longer than the 'pf.debug.perf_spike_threshold_ms' "
+    "setting. Each item holds the frame index, the frame time and a list of the performance data "
+    "(in the same format as 'prev_frame_perfstats') of the spike frame and the frames preceding it."},
+
+    {"clear_perf_spikes", 
+    (PyCFunction)PyPf_clear_perf_spikes, METH_NOARGS,
+    "Discard all the saved frame spikes."},
+
+    {"capture_render_cmds", 
+    (PyCFunction)PyPf_capture_render_cmds, METH_VARARGS,
+    "Write the render commands of the specified number of frames (1 by default) to a file, along "
+    "with their arguments and the time each one took to execute on the render thread."},
+
+    {"replay_render_cmds", 
+    (PyCFunction)PyPf_replay_render_cmds, METH_VARARGS,
+    "Execute the render commands from a file written by 'capture_render_cmds' the specified "
+    "number of times (10 by default) and write the per-command timings to the report file. The "
+    "captured models are loaded from the base directory and the captured map is bound to the "
+    "current one, which must have the same dimensions."},
+
     {"get_resolution", 
     (PyCFunction)PyPf_get_resolution, METH_NOARGS,
     "Get the currently set resolution of the game window."},
@@ -388,14 +433,35 @@ static PyMethodDef pf_module_methods[] = {
     "an earlier return value of 'pf.pickle_object'."},
 
     {"save_session",
-    (PyCFunction)PyPf_save_session, METH_VARARGS,
+    (PyCFunction)PyPf_save_session, METH_VARARGS | METH_KEYWORDS,
     "Save the current state of the engine to the specified file. The session can then be loaded "
-    "from the file with the 'load_session' call."},
+    "from the file with the 'load_session' call. If 'background' is True, a snapshot of the "
+    "session is captured at the start of the next tick and it is written to the file on a "
+    "background thread, without stalling the simulation."},
 
     {"load_session",
     (PyCFunction)PyPf_load_session, METH_VARARGS,
     "Load a session previously saved with the 'save_session' call."},
 
+    {"start_recording",
+    (PyCFunction)PyPf_start_recording, METH_VARARGS,
+    "Capture a snapshot of the session at the start of the next tick and begin logging all the "
+    "unit commands issued from that point on. The recording is written to the specified file "
+    "when 'stop_recording' is called."},
+
+    {"stop_recording",
+    (PyCFunction)PyPf_stop_recording, METH_NOARGS,
+    "Stop the current recording and write it to its' file in the background."},
+
+    {"play_replay",
+    (PyCFunction)PyPf_play_replay, METH_VARARGS,
+    "Load a recording made with 'start_recording' and play back all of its' commands. Commands "
+    "issued by the player or by scripts are ignored while the replay is playing."},
+
+    {"stop_replay",
+    (PyCFunction)PyPf_stop_replay, METH_NOARGS,
+    "Stop playing back the commands of the current replay, returning control to the player."},
+
     {NULL}  /* Sentinel */
 };
 
@@ -630,10 +696,37 @@ static PyObject *PyPf_prev_frame_ms(PyObject *self)
     return Py_BuildValue("i", Perf_LastFrameMS());
 }
 
-static PyObject *PyPf_prev_frame_perfstats(PyObject *self)
+static PyObject *PyPf_capture_perf_trace(PyObject *self, PyObject *args)
+{
+    const char *path;
+    int nframes = 60;
+
+    if(!PyArg_ParseTuple(args, "s|i", &path, &nframes)) {
+        PyErr_SetString(PyExc_TypeError, "Arguments must be a string (path of the file) and an optional integer (number of frames).");
+        return NULL;
+    }
+
+    if(nframes <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Number of frames must be positive.");
+        return NULL;
+    }
+
+    if(Perf_CapturingTrace()) {
+        PyErr_SetString(PyExc_RuntimeError, "A perf trace capture is already in progress.");
+        return NULL;
+    }
+
+    if(!Perf_CaptureTrace(path, nframes)) {
+        char buff[256];
+        pf_snprintf(buff, sizeof(buff), "Unable to open file (%s) for writing.\n", path);
+        PyErr_SetString(PyExc_RuntimeError, buff);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *perfstats_dict(struct perf_info *const *infos, size_t nthreads)
 {
-    struct perf_info *infos[16];
-    size_t nthreads = Perf_Report(ARR_SIZE(infos), (struct perf_info **)&infos);
     int status;
 
     PyObject *ret = PyDict_New();
@@ -710,19 +803,164 @@ static PyObject *PyPf_prev_frame_perfstats(PyObject *self)
         }
     }
 
-    for(int i = 0; i < nthreads; i++) {
-        free(infos[i]);
-    }
     return ret;
 
 fail:
     Py_XDECREF(ret);
+    return NULL;
+}
+
+static PyObject *PyPf_prev_frame_perfstats(PyObject *self)
+{
+    struct perf_info *infos[16];
+    size_t nthreads = Perf_Report(ARR_SIZE(infos), (struct perf_info **)&infos);
+
+    PyObject *ret = perfstats_dict(infos, nthreads);
     for(int i = 0; i < nthreads; i++) {
         free(infos[i]);
     }
+    return ret;
+}
+
+static PyObject *PyPf_capture_render_cmds(PyObject *self, PyObject *args)
+{
+    const char *path;
+    int nframes = 1;
+
+    if(!PyArg_ParseTuple(args, "s|i", &path, &nframes)) {
+        PyErr_SetString(PyExc_TypeError, "Arguments must be a string (path of the file) and an optional integer (number of frames).");
+        return NULL;
+    }
+
+    if(nframes <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Number of frames must be positive.");
+        return NULL;
+    }
+
+    if(R_CapturingCmds()) {
+        PyErr_SetString(PyExc_RuntimeError, "A render command capture is already in progress.");
+        return NULL;
+    }
+
+    if(!R_CaptureCmds(path, nframes)) {
+        char buff[256];
+        pf_snprintf(buff, sizeof(buff), "Unable to open file (%s) for writing.\n", path);
+        PyErr_SetString(PyExc_RuntimeError, buff);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyPf_replay_render_cmds(PyObject *self, PyObject *args)
+{
+    const char *path, *report_path;
+    int nloops = 10;
+
+    if(!PyArg_ParseTuple(args, "ss|i", &path, &report_path, &nloops)) {
+        PyErr_SetString(PyExc_TypeError, "Arguments must be two strings (path of the capture and of the report) "
+            "and an optional integer (number of loops).");
+        return NULL;
+    }
+
+    if(nloops <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Number of loops must be positive.");
+        return NULL;
+    }
+
+    if(!R_ReplayCmds(path, nloops, report_path)) {
+        PyErr_SetString(PyExc_RuntimeError, "Unable to load the render command capture.");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyPf_get_perf_percentiles(PyObject *self)
+{
+    const char *names[PERF_HIST_COUNT] = {
+        [PERF_HIST_FRAME]  = "frame",
+        [PERF_HIST_SIM]    = "sim",
+        [PERF_HIST_RENDER] = "render",
+    };
+
+    PyObject *ret = PyDict_New();
+    if(!ret)
+        return NULL;
+
+    for(int i = 0; i < PERF_HIST_COUNT; i++) {
+
+        struct perf_percentiles pct;
+        Perf_GetPercentiles(i, &pct);
+
+        PyObject *stats = Py_BuildValue("{s:K,s:d,s:d,s:d,s:d}",
+            "samples", (unsigned long long)pct.nsamples,
+            "p50", pct.p50_ms,
+            "p95", pct.p95_ms,
+            "p99", pct.p99_ms,
+            "max", pct.max_ms);
+        if(!stats)
+            goto fail;
+
+        int status = PyDict_SetItemString(ret, names[i], stats);
+        Py_DECREF(stats);
+        if(0 != status)
+            goto fail;
+    }
+    return ret;
+
+fail:
+    Py_DECREF(ret);
     return NULL;
 }
 
+static PyObject *PyPf_get_perf_spikes(PyObject *self)
+{
+    PyObject *ret = PyList_New(0);
+    if(!ret)
+        return NULL;
+
+    for(int i = 0; i < Perf_NumSpikes(); i++) {
+
+        const struct perf_spike *spike = Perf_GetSpike(i);
+        PyObject *frames = PyList_New(0);
+        if(!frames)
+            goto fail;
+
+        for(int j = 0; j < spike->nframes; j++) {
+
+            PyObject *frame = perfstats_dict(spike->frames[j], spike->nthreads[j]);
+            if(!frame || 0 != PyList_Append(frames, frame)) {
+                Py_XDECREF(frame);
+                Py_DECREF(frames);
+                goto fail;
+            }
+            Py_DECREF(frame);
+        }
+
+        PyObject *entry = Py_BuildValue("{s:K,s:d,s:N}", 
+            "frame", (unsigned long long)spike->frame,
+            "frame_ms", spike->frame_ms,
+            "perfstats", frames);
+        if(!entry)
+            goto fail;
+
+        int status = PyList_Append(ret, entry);
+        Py_DECREF(entry);
+        if(0 != status)
+            goto fail;
+    }
+    return ret;
+
+fail:
+    Py_DECREF(ret);
+    return NULL;
+}
+
+static PyObject *PyPf_clear_perf_spikes(PyObject *self)
+{
+    Perf_ClearSpikes();
+    Py_RETURN_NONE;
+}
+
 static PyObject *PyPf_get_resolution(PyObject *self)
 {
     struct sval res;
@@ -849,7 +1087,7 @@ static PyObject *PyPf_disable_unit_selection(PyObject *self)
 
 static PyObject *PyPf_clear_unit_selection(PyObject *self)
 {
-    G_Sel_Clear();
+    G_Cmd_ClearSelection();
     Py_RETURN_NONE;
 }
 
@@ -1459,15 +1697,23 @@ static PyObject *PyPf_unpickle_object(PyObject *self, PyObject *args)
     return ret;
 }
 
-static PyObject *PyPf_save_session(PyObject *self, PyObject *args)
+static PyObject *PyPf_save_session(PyObject *self, PyObject *args, PyObject *kwargs)
 {
+    static char *kwlist[] = {"path", "background", NULL};
     const char *str;
-    if(!PyArg_ParseTuple(args, "s", &str)) {
+    int background = false;
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "s|i", kwlist, &str, &background)) {
         PyErr_SetString(PyExc_TypeError, "Argument must be a string (path of the file to save the session to).");
         return NULL;
     }
 
-    FILE *file = fopen(str, "w");
+    if(background) {
+        Session_RequestSave(str);
+        Py_RETURN_NONE;
+    }
+
+    FILE *file = fopen(str, "wb");
     if(!file) {
         char buff[256];
         pf_snprintf(buff, sizeof(buff), "Unable to open file (%s) for writing.\n", str);
@@ -1501,6 +1747,42 @@ static PyObject *PyPf_load_session(PyObject *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+static PyObject *PyPf_start_recording(PyObject *self, PyObject *args)
+{
+    const char *str;
+    if(!PyArg_ParseTuple(args, "s", &str)) {
+        PyErr_SetString(PyExc_TypeError, "Argument must be a string (path of the file to save the recording to).");
+        return NULL;
+    }
+
+    Session_RequestStartRecording(str);
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyPf_stop_recording(PyObject *self)
+{
+    Session_RequestStopRecording();
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyPf_play_replay(PyObject *self, PyObject *args)
+{
+    const char *str;
+    if(!PyArg_ParseTuple(args, "s", &str)) {
+        PyErr_SetString(PyExc_TypeError, "Argument must be a string (path of the file to load the recording from).");
+        return NULL;
+    }
+
+    Session_RequestReplay(str);
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyPf_stop_replay(PyObject *self)
+{
+    G_Cmd_EndPlayback();
+    Py_RETURN_NONE;
+}
+
 static bool s_sys_path_add_dir(const char *filename)
 {
     if(strlen(filename) >= 512)
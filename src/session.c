@@ -37,13 +37,69 @@
 #include "event.h"
 #include "main.h"
 #include "ui.h"
+#include "perf.h"
 #include "lib/public/attr.h"
 #include "lib/public/pf_string.h"
+#include "lib/public/pf_lz.h"
+#include "lib/public/SDL_vec_rwops.h"
 #include "game/public/game.h"
 #include "script/public/script.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
 
-#define PFSAVE_VERSION  (1.0f)
+#if defined(_WIN32)
+    #include <windows.h>
+#endif
+
+
+#define PFSAVE_VERSION  (2.1f)
+#define ARR_SIZE(a)     (sizeof(a)/sizeof(a[0]))
+#define FOURCC(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+/* The optional command log of a replay. It is not part of the session state 
+ * and is only consumed when the file is loaded as a replay. */
+#define REPLAY_TAG      FOURCC('R','P','L','Y')
+
+/* A session file is the version attribute followed by a sequence of sections. 
+ * Every section starts with a header giving the size of the payload that follows. 
+ * This allows each section to be read (or skipped) without parsing any of the 
+ * others. The sections are written in the order in which they must be loaded. 
+ */
+struct section_hdr{
+    uint32_t tag;
+    uint32_t flags;
+    uint64_t size;      /* The number of payload bytes in the file */
+    uint64_t raw_size;  /* The number of payload bytes after decompression */
+};
+
+enum{
+    SECTION_COMPRESSED = (1 << 0),
+};
+
+struct section_desc{
+    uint32_t    tag;
+    const char *name;
+    bool      (*save)(SDL_RWops *stream);
+    bool      (*load)(SDL_RWops *stream);
+};
+
+struct section{
+    bool     present;
+    uint32_t flags;
+    void    *data;
+    size_t   size;
+    size_t   raw_size;
+    bool     inflated;
+};
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS (FORWARD DECLARATIONS)                                   */
+/*****************************************************************************/
+
+static bool session_save_entities(SDL_RWops *stream);
+static bool session_load_entities(SDL_RWops *stream);
 
 /*****************************************************************************/
 /* STATIC VARIABLES                                                          */
@@ -53,6 +109,48 @@ static bool s_load_requested = false;
 static char s_load_path[512];
 static char s_errstr[512];
 
+static bool s_load_replay = false;
+
+static bool s_save_requested = false;
+static char s_save_path[512];
+
+/* A recording is the session snapshot at the point the recording was started, 
+ * followed by the log of all commands issued from that point on. */
+static bool s_record_requested = false;
+static bool s_record_stop_requested = false;
+static char s_record_path[512];
+static struct snapshot *s_record_snap = NULL;
+
+/* At most a single background save is in flight at a time */
+static SDL_Thread *s_save_thread = NULL;
+static SDL_atomic_t s_save_done;
+
+static const struct section_desc s_sections[] = {
+    /* First save the state of the map, lighting, camera, etc. (everything that 
+     * isn't entities). Loading this state initalizes the session. */
+    {FOURCC('G','L','O','B'), "global",   G_SaveGlobalState,     G_LoadGlobalState    },
+    /* The fog state must be in place before the entities add their vision */
+    {FOURCC('F','O','G','_'), "fog",      G_SaveFogState,        G_LoadFogState       },
+    /* All live entities have a scripting object associated with them. Loading the
+     * scripting state will re-create all the entities. */
+    {FOURCC('S','C','R','P'), "script",   S_SaveState,           S_LoadState          },
+    /* After the entities are loaded, populate all the auxiliary entity state that
+     * isn't visible via the scripting API. (animation context, pricise movement 
+     * state, etc) */
+    {FOURCC('E','N','T','S'), "entity",   session_save_entities, session_load_entities},
+    {FOURCC('M','O','V','E'), "movement", G_SaveMovementState,   G_LoadMovementState  },
+    {FOURCC('C','M','B','T'), "combat",   G_SaveCombatState,     G_LoadCombatState    },
+};
+
+/* The fully serialized state of the session, captured at a tick boundary. 
+ * Once captured, it does not reference any engine state and can be 
+ * compressed and written out from any thread. */
+struct snapshot{
+    char       path[512];
+    SDL_RWops *sections[ARR_SIZE(s_sections)];
+    SDL_RWops *replay;
+};
+
 /*****************************************************************************/
 /* STATIC FUNCTIONS                                                          */
 /*****************************************************************************/
@@ -62,11 +160,114 @@ static void session_print_message(void *user, void *event)
     UI_DrawText(s_errstr, (struct rect){5,5,600,50}, (struct rgba){255,255,255,255});
 }
 
-/*****************************************************************************/
-/* EXTERN FUNCTIONS                                                          */
-/*****************************************************************************/
+static bool session_save_entities(SDL_RWops *stream)
+{
+    if(!G_SaveEntityState(stream))
+        return false;
 
-bool Session_Save(SDL_RWops *stream)
+    /* Roll forward the 'next_uid' so there's no collision with already loaded 
+     * entities (which preserve their UIDs from the old session) */
+    struct attr next_uid = (struct attr){
+        .type = TYPE_INT,
+        .val.as_int = Entity_NewUID()
+    };
+    return Attr_Write(stream, &next_uid, "next_uid");
+}
+
+static bool session_load_entities(SDL_RWops *stream)
+{
+    struct attr attr;
+
+    if(!G_LoadEntityState(stream))
+        return false;
+
+    if(!Attr_Parse(stream, &attr, true) || attr.type != TYPE_INT)
+        return false;
+
+    Entity_SetNextUID(attr.val.as_int);
+    return true;
+}
+
+static int section_idx(uint32_t tag)
+{
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+        if(s_sections[i].tag == tag)
+            return i;
+    }
+    return -1;
+}
+
+static void snapshot_free(struct snapshot *snap)
+{
+    for(int i = 0; i < ARR_SIZE(snap->sections); i++) {
+        if(snap->sections[i])
+            SDL_RWclose(snap->sections[i]);
+    }
+    if(snap->replay)
+        SDL_RWclose(snap->replay);
+    free(snap);
+}
+
+static struct snapshot *snapshot_capture(void)
+{
+    PERF_ENTER();
+
+    struct snapshot *ret = calloc(1, sizeof(struct snapshot));
+    if(!ret)
+        PERF_RETURN(NULL);
+
+    /* Every section is serialized to memory first. This gives us the 
+     * size for the header and lets the file be written in large blocks 
+     * instead of one small write per record. */
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+
+        ret->sections[i] = PFSDL_VectorRWOps();
+        if(!ret->sections[i])
+            goto fail;
+
+        if(!s_sections[i].save(ret->sections[i]))
+            goto fail;
+    }
+    PERF_RETURN(ret);
+
+fail:
+    snapshot_free(ret);
+    PERF_RETURN(NULL);
+}
+
+static bool section_write(SDL_RWops *stream, uint32_t tag, SDL_RWops *buff)
+{
+    const void *raw = PFSDL_VectorRWOpsRaw(buff);
+    size_t raw_size = SDL_RWsize(buff);
+
+    const void *payload = raw;
+    size_t size = raw_size;
+    uint32_t flags = 0;
+
+    void *lz = NULL;
+    size_t lz_cap = pf_lz_bound(raw_size);
+
+    if(raw_size && (lz = malloc(lz_cap))) {
+
+        size_t lz_size = pf_lz_compress(raw, raw_size, lz, lz_cap);
+        if(lz_size && lz_size < raw_size) {
+            payload = lz;
+            size = lz_size;
+            flags |= SECTION_COMPRESSED;
+        }
+    }
+
+    bool ret = SDL_WriteLE32(stream, tag)
+            && SDL_WriteLE32(stream, flags)
+            && SDL_WriteLE64(stream, size)
+            && SDL_WriteLE64(stream, raw_size)
+            && (!size || SDL_RWwrite(stream, payload, size, 1));
+
+    free(lz);
+    return ret;
+}
+
+static bool snapshot_write(const struct snapshot *snap, SDL_RWops *stream)
 {
     struct attr version = (struct attr){
         .type = TYPE_FLOAT,
@@ -75,54 +276,305 @@ bool Session_Save(SDL_RWops *stream)
     if(!Attr_Write(stream, &version, "version"))
         return false;
 
-    /* First save the state of the map, lighting, camera, etc. (everything that 
-     * isn't entities). Loading this state initalizes the session. */
-    if(!G_SaveGlobalState(stream))
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+        if(!section_write(stream, s_sections[i].tag, snap->sections[i]))
+            return false;
+    }
+
+    if(snap->replay && !section_write(stream, REPLAY_TAG, snap->replay))
         return false;
+    return true;
+}
 
-    /* All live entities have a scripting object associated with them. Loading the
-     * scripting state will re-create all the entities. */
-    if(!S_SaveState(stream))
+/* Replace the file at 'path' with the one at 'tmp_path' in a single step, so 
+ * that there is always either the old or the new file at 'path'. */
+static bool replace_file(const char *tmp_path, const char *path)
+{
+#if defined(_WIN32)
+    return MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    return (rename(tmp_path, path) == 0);
+#endif
+}
+
+static int save_thread_func(void *arg)
+{
+    struct snapshot *snap = arg;
+    bool success = false;
+
+    /* Write to a temporary file first, so that a previous save at the 
+     * same path is never left half-overwritten. */
+    char tmp_path[sizeof(snap->path) + 8];
+    pf_snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", snap->path);
+
+    SDL_RWops *stream = SDL_RWFromFile(tmp_path, "wb");
+    if(!stream)
+        goto out;
+
+    success = snapshot_write(snap, stream);
+    SDL_RWclose(stream);
+
+    if(success) {
+        success = replace_file(tmp_path, snap->path);
+    }
+    if(!success) {
+        remove(tmp_path);
+    }
+
+out:
+    if(!success) {
+        fprintf(stderr, "Failed to write session file: %s\n", snap->path);
+        fflush(stderr);
+    }
+    snapshot_free(snap);
+    SDL_AtomicSet(&s_save_done, 1);
+    return success;
+}
+
+static bool save_thread_busy(void)
+{
+    if(!s_save_thread)
         return false;
 
-    /* After the entities are loaded, populate all the auxiliary entity state that
-     * isn't visible via the scripting API. (animation context, pricise movement 
-     * state, etc) */
-    if(!G_SaveEntityState(stream))
+    if(!SDL_AtomicGet(&s_save_done))
+        return true;
+
+    SDL_WaitThread(s_save_thread, NULL);
+    s_save_thread = NULL;
+    return false;
+}
+
+static void save_dispatch(struct snapshot *snap)
+{
+    assert(!s_save_thread);
+
+    SDL_AtomicSet(&s_save_done, 0);
+    s_save_thread = SDL_CreateThread(save_thread_func, "autosave", snap);
+    if(!s_save_thread) {
+        /* Fall back to writing on this thread */
+        save_thread_func(snap);
+    }
+}
+
+static void service_save_request(void)
+{
+    if(!s_save_requested)
+        return;
+
+    /* Keep the request pending until the previous save has been flushed */
+    if(save_thread_busy())
+        return;
+    s_save_requested = false;
+
+    struct snapshot *snap = snapshot_capture();
+    if(!snap) {
+        fprintf(stderr, "Failed to capture session snapshot for: %s\n", s_save_path);
+        fflush(stderr);
+        return;
+    }
+    pf_snprintf(snap->path, sizeof(snap->path), "%s", s_save_path);
+    save_dispatch(snap);
+}
+
+static void service_record_request(void)
+{
+    if(!s_record_requested)
+        return;
+    s_record_requested = false;
+
+    if(s_record_snap) {
+        snapshot_free(s_record_snap);
+        s_record_snap = NULL;
+    }
+
+    struct snapshot *snap = snapshot_capture();
+    if(!snap || !G_Cmd_BeginRecording()) {
+        fprintf(stderr, "Failed to start recording to: %s\n", s_record_path);
+        fflush(stderr);
+        if(snap)
+            snapshot_free(snap);
+        return;
+    }
+    pf_snprintf(snap->path, sizeof(snap->path), "%s", s_record_path);
+    s_record_snap = snap;
+}
+
+static void service_record_stop_request(void)
+{
+    if(!s_record_stop_requested)
+        return;
+
+    if(!s_record_snap) {
+        s_record_stop_requested = false;
+        return;
+    }
+
+    /* The command log was dropped (ex. due to an error) - nothing to write */
+    if(!G_Cmd_Recording()) {
+        s_record_stop_requested = false;
+        snapshot_free(s_record_snap);
+        s_record_snap = NULL;
+        return;
+    }
+
+    if(save_thread_busy())
+        return;
+    s_record_stop_requested = false;
+
+    struct snapshot *snap = s_record_snap;
+    s_record_snap = NULL;
+
+    snap->replay = PFSDL_VectorRWOps();
+    if(!snap->replay || !G_Cmd_EndRecording(snap->replay)) {
+        fprintf(stderr, "Failed to write the command log for: %s\n", snap->path);
+        fflush(stderr);
+        snapshot_free(snap);
+        return;
+    }
+    save_dispatch(snap);
+}
+
+static bool section_read(SDL_RWops *stream, const struct section_hdr *hdr, struct section *out)
+{
+    void *data = malloc(hdr->size ? hdr->size : 1);
+    if(!data)
         return false;
 
-    /* Roll forward the 'next_uid' so there's no collision with already loaded 
-     * entities (which preserve their UIDs from the old session) */
-    struct attr next_uid = (struct attr){
-        .type = TYPE_INT,
-        .val.as_int = Entity_NewUID()
+    if(hdr->size && !SDL_RWread(stream, data, hdr->size, 1)) {
+        free(data);
+        return false;
+    }
+
+    *out = (struct section){
+        .present = true,
+        .flags = hdr->flags,
+        .data = data,
+        .size = hdr->size,
+        .raw_size = hdr->raw_size,
+        .inflated = !(hdr->flags & SECTION_COMPRESSED)
     };
-    if(!Attr_Write(stream, &next_uid, "next_uid"))
+    return true;
+}
+
+static bool sections_read_all(SDL_RWops *stream, struct section *out, struct section *replay)
+{
+    Sint64 total = SDL_RWsize(stream);
+    if(total < 0)
         return false;
 
+    while(SDL_RWtell(stream) < total) {
+
+        struct section_hdr hdr;
+        hdr.tag = SDL_ReadLE32(stream);
+        hdr.flags = SDL_ReadLE32(stream);
+        hdr.size = SDL_ReadLE64(stream);
+        hdr.raw_size = SDL_ReadLE64(stream);
+
+        Sint64 pos = SDL_RWtell(stream);
+        if(pos < 0 || pos > total || hdr.size > total - pos)
+            return false;
+
+        if(!(hdr.flags & SECTION_COMPRESSED) && hdr.size != hdr.raw_size)
+            return false;
+
+        if(hdr.tag == REPLAY_TAG && replay && !replay->present) {
+            if(!section_read(stream, &hdr, replay))
+                return false;
+            continue;
+        }
+
+        int idx = section_idx(hdr.tag);
+        if(idx < 0 || out[idx].present) {
+            /* Skip sections that we don't know about */
+            if(SDL_RWseek(stream, hdr.size, RW_SEEK_CUR) < 0)
+                return false;
+            continue;
+        }
+
+        if(!section_read(stream, &hdr, &out[idx]))
+            return false;
+    }
     return true;
 }
 
-void Session_RequestLoad(const char *path)
+static int section_inflate(void *arg)
 {
-    s_load_requested = true;
-    pf_snprintf(s_load_path, sizeof(s_load_path), "%s", path);
+    struct section *sec = arg;
+    assert(sec->flags & SECTION_COMPRESSED);
+
+    void *raw = malloc(sec->raw_size ? sec->raw_size : 1);
+    if(!raw)
+        return 0;
+
+    if(pf_lz_decompress(sec->data, sec->size, raw, sec->raw_size) != sec->raw_size) {
+        free(raw);
+        return 0;
+    }
+
+    free(sec->data);
+    sec->data = raw;
+    sec->size = sec->raw_size;
+    sec->inflated = true;
+    return 1;
 }
 
-void Session_ServiceRequests(void)
+static bool sections_inflate_all(struct section *sections)
+{
+    SDL_Thread *threads[ARR_SIZE(s_sections)] = {0};
+
+    /* The sections are independent of each other, so they are all
+     * decompressed in parallel. */
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+
+        if(!sections[i].present || sections[i].inflated)
+            continue;
+
+        threads[i] = SDL_CreateThread(section_inflate, "inflate", &sections[i]);
+        if(!threads[i]) {
+            section_inflate(&sections[i]);
+        }
+    }
+
+    bool ret = true;
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+
+        if(threads[i])
+            SDL_WaitThread(threads[i], NULL);
+        if(sections[i].present && !sections[i].inflated)
+            ret = false;
+    }
+    return ret;
+}
+
+static void sections_free_all(struct section *sections)
+{
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+        free(sections[i].data);
+    }
+}
+
+static void service_load_request(void)
 {
     struct attr attr;
+    struct section sections[ARR_SIZE(s_sections)] = {0};
+    struct section replay = {0};
 
     if(!s_load_requested)
         return;
     s_load_requested = false;
     E_Global_Unregister(EVENT_UPDATE_START, session_print_message);
 
+    /* Any recording in progress belongs to the session being torn down */
+    if(s_record_snap) {
+        snapshot_free(s_record_snap);
+        s_record_snap = NULL;
+    }
+
     E_DeleteScriptHandlers();
     S_ClearState();
     Engine_ClearPendingEvents();
 
-    SDL_RWops *stream = SDL_RWFromFile(s_load_path, "r"); /* file will be closed when stream is */
+    SDL_RWops *stream = SDL_RWFromFile(s_load_path, "rb"); /* file will be closed when stream is */
     if(!stream) {
         pf_snprintf(s_errstr, sizeof(s_errstr), "Could not open session file: %s", s_load_path);
         goto fail_file;
@@ -133,41 +585,83 @@ void Session_ServiceRequests(void)
         goto fail_load;
     }
 
-    if(attr.val.as_float > PFSAVE_VERSION) {
+    if(attr.val.as_float != PFSAVE_VERSION) {
         pf_snprintf(s_errstr, sizeof(s_errstr), 
-            "Incompatible save version: %.01f [Expecting %.01f or less]", attr.val.as_float, PFSAVE_VERSION);
+            "Incompatible save version: %.01f [Expecting %.01f]", attr.val.as_float, PFSAVE_VERSION);
         goto fail_load;
     }
 
-    if(!G_LoadGlobalState(stream)) {
-        pf_snprintf(s_errstr, sizeof(s_errstr), 
-            "Could not de-serialize map and globals state from session file: %s", s_load_path);
+    /* Pull in all the sections up-front so that they can be loaded in 
+     * dependency order, regardless of the order they appear in the file. */
+    if(!sections_read_all(stream, sections, s_load_replay ? &replay : NULL)) {
+        pf_snprintf(s_errstr, sizeof(s_errstr), "Malformed section in session file: %s", s_load_path);
         goto fail_load;
     }
 
-    if(!S_LoadState(stream)) {
-        pf_snprintf(s_errstr, sizeof(s_errstr), 
-            "Could not de-serialize script-defined state from session file: %s", s_load_path);
+    if(!sections_inflate_all(sections)) {
+        pf_snprintf(s_errstr, sizeof(s_errstr), "Could not decompress session file: %s", s_load_path);
         goto fail_load;
     }
 
-    if(!G_LoadEntityState(stream)) {
-        pf_snprintf(s_errstr, sizeof(s_errstr), 
-            "Could not de-serialize addional entity state from session file: %s", s_load_path);
-        goto fail_load;
+    if(s_load_replay) {
+    
+        if(!replay.present) {
+            pf_snprintf(s_errstr, sizeof(s_errstr), "No command log in replay file: %s", s_load_path);
+            goto fail_load;
+        }
+        if(!replay.inflated && !section_inflate(&replay)) {
+            pf_snprintf(s_errstr, sizeof(s_errstr), "Could not decompress session file: %s", s_load_path);
+            goto fail_load;
+        }
     }
 
-    if(!Attr_Parse(stream, &attr, true) || attr.type != TYPE_INT) {
-        pf_snprintf(s_errstr, sizeof(s_errstr), 
-            "Could not read version next_uid attribute from session file: %s", s_load_path);
-        goto fail_load;
+    for(int i = 0; i < ARR_SIZE(s_sections); i++) {
+
+        if(!sections[i].present) {
+            pf_snprintf(s_errstr, sizeof(s_errstr), 
+                "Missing %s state section in session file: %s", s_sections[i].name, s_load_path);
+            goto fail_load;
+        }
+
+        SDL_RWops *sstream = SDL_RWFromConstMem(sections[i].data, sections[i].size);
+        if(!sstream) {
+            pf_snprintf(s_errstr, sizeof(s_errstr), "Could not allocate section stream");
+            goto fail_load;
+        }
+
+        bool success = s_sections[i].load(sstream);
+        SDL_RWclose(sstream);
+
+        if(!success) {
+            pf_snprintf(s_errstr, sizeof(s_errstr), 
+                "Could not de-serialize %s state from session file: %s", s_sections[i].name, s_load_path);
+            goto fail_load;
+        }
     }
-    Entity_SetNextUID(attr.val.as_int);
 
+    /* The commands are applied relative to the tick at which the playback starts, 
+     * which is the same point relative to the snapshot as when it was recorded. */
+    if(s_load_replay) {
+
+        SDL_RWops *rstream = SDL_RWFromConstMem(replay.data, replay.size);
+        bool success = rstream && G_Cmd_BeginPlayback(rstream);
+        if(rstream)
+            SDL_RWclose(rstream);
+
+        if(!success) {
+            pf_snprintf(s_errstr, sizeof(s_errstr), "Malformed command log in replay file: %s", s_load_path);
+            goto fail_load;
+        }
+    }
+
+    free(replay.data);
+    sections_free_all(sections);
     SDL_RWclose(stream);
     return;
 
 fail_load:
+    free(replay.data);
+    sections_free_all(sections);
     SDL_RWclose(stream);
 fail_file:
     /* We've torn down the old session, but screwed up somewhere along the way
@@ -185,3 +679,81 @@ fail_file:
     fflush(stderr);
 }
 
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+bool Session_Save(SDL_RWops *stream)
+{
+    struct snapshot *snap = snapshot_capture();
+    if(!snap)
+        return false;
+
+    bool ret = snapshot_write(snap, stream);
+    snapshot_free(snap);
+    return ret;
+}
+
+void Session_RequestSave(const char *path)
+{
+    s_save_requested = true;
+    pf_snprintf(s_save_path, sizeof(s_save_path), "%s", path);
+}
+
+void Session_RequestLoad(const char *path)
+{
+    s_load_requested = true;
+    s_load_replay = false;
+    pf_snprintf(s_load_path, sizeof(s_load_path), "%s", path);
+}
+
+void Session_RequestStartRecording(const char *path)
+{
+    s_record_requested = true;
+    s_record_stop_requested = false;
+    pf_snprintf(s_record_path, sizeof(s_record_path), "%s", path);
+}
+
+void Session_RequestStopRecording(void)
+{
+    s_record_stop_requested = true;
+}
+
+void Session_RequestReplay(const char *path)
+{
+    s_load_requested = true;
+    s_load_replay = true;
+    pf_snprintf(s_load_path, sizeof(s_load_path), "%s", path);
+}
+
+void Session_ServiceRequests(void)
+{
+    /* Service the save first, so that a save and load requested on the 
+     * same tick will capture the session that is being replaced. A new 
+     * recording is started last so that it captures the loaded session. */
+    service_save_request();
+    service_record_stop_request();
+
+    /* The save or the end of the recording is still waiting on the previous 
+     * background save. Hold off on the load until they have been written, 
+     * or they would capture the loaded session instead. */
+    if(s_save_requested || s_record_stop_requested)
+        return;
+
+    service_load_request();
+    service_record_request();
+}
+
+void Session_Shutdown(void)
+{
+    if(s_record_snap) {
+        snapshot_free(s_record_snap);
+        s_record_snap = NULL;
+    }
+
+    if(s_save_thread) {
+        SDL_WaitThread(s_save_thread, NULL);
+        s_save_thread = NULL;
+    }
+}
+
@@ -40,8 +40,20 @@
 #include <SDL.h> /* for SDL_RWops */
 
 bool Session_Save(SDL_RWops *stream);
+/* Capture a snapshot of the session at the next tick boundary. The snapshot 
+ * is compressed and written to the file on a background thread. */
+void Session_RequestSave(const char *path);
 void Session_RequestLoad(const char *path);
+/* A recording is a session file holding a snapshot taken at the next tick boundary,
+ * followed by the log of all commands issued until the recording is stopped. The 
+ * file is written out in the background when the recording is stopped. */
+void Session_RequestStartRecording(const char *path);
+void Session_RequestStopRecording(void);
+/* Load the session of a recording and play back its commands from the start */
+void Session_RequestReplay(const char *path);
 void Session_ServiceRequests(void);
+/* Blocks until any in-flight background save has been flushed to disk */
+void Session_Shutdown(void);
 
 #endif
 
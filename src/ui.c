@@ -229,6 +229,18 @@ static void *push_draw_list(const struct nk_draw_list *dl)
     st_dl->elements = R_PushArg(dl->elements, sizeof(struct nk_buffer));
     st_dl->elements->memory.ptr = st_ebuff;
 
+    /* The userdata of the draw commands is handed over along with the rest
+     * of the arguments, leaving nothing for the render thread to free */
+    for(const struct nk_draw_command *cmd = nk__draw_list_begin(st_dl, st_dl->buffer); cmd;
+        cmd = nk__draw_list_next(cmd, st_dl->buffer, st_dl)) {
+
+        void *ud = cmd->userdata.ptr;
+        if(!ud)
+            continue;
+        ((struct nk_draw_command*)cmd)->userdata.ptr = R_PushArg(ud, sizeof(struct nk_command_userdata));
+        free(ud);
+    }
+
     return st_dl;
 }
 
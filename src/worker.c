@@ -0,0 +1,197 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#include "worker.h"
+#include "main.h"
+#include "perf.h"
+#include "lib/public/pf_string.h"
+
+#include <SDL.h>
+#include <assert.h>
+
+
+#define MAX_WORKERS     (8)
+#define MIN(a, b)       ((a) < (b) ? (a) : (b))
+#define MAX(a, b)       ((a) > (b) ? (a) : (b))
+
+struct job{
+    worker_func_t func;
+    void         *arg;
+    size_t        nitems;
+    size_t        grain;
+    size_t        nchunks;
+    SDL_atomic_t  next_chunk;
+};
+
+/*****************************************************************************/
+/* STATIC VARIABLES                                                          */
+/*****************************************************************************/
+
+static SDL_Thread  *s_threads[MAX_WORKERS];
+static size_t       s_nworkers;
+/* Every job posts 'work_avail' once for each worker it wakes. A woken worker 
+ * posts 'work_done' when it can't claim any more chunks. */
+static SDL_sem     *s_work_avail;
+static SDL_sem     *s_work_done;
+static SDL_atomic_t s_quit;
+static struct job   s_job;
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static void run_chunks(struct job *job)
+{
+    size_t chunk;
+    while((chunk = SDL_AtomicAdd(&job->next_chunk, 1)) < job->nchunks) {
+
+        size_t begin = chunk * job->grain;
+        size_t end = MIN(begin + job->grain, job->nitems);
+        job->func(begin, end, job->arg);
+    }
+}
+
+static int worker_thread_func(void *arg)
+{
+    while(true) {
+
+        SDL_SemWait(s_work_avail);
+        if(SDL_AtomicGet(&s_quit))
+            break;
+
+        run_chunks(&s_job);
+        SDL_SemPost(s_work_done);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+bool Worker_Init(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    /* Leave a core each for the main and render threads */
+    int ncpus = SDL_GetCPUCount();
+    size_t nworkers = MIN(MAX(ncpus - 2, 0), MAX_WORKERS);
+
+    s_work_avail = SDL_CreateSemaphore(0);
+    if(!s_work_avail)
+        goto fail_avail;
+
+    s_work_done = SDL_CreateSemaphore(0);
+    if(!s_work_done)
+        goto fail_done;
+
+    SDL_AtomicSet(&s_quit, 0);
+    s_nworkers = 0;
+
+    for(int i = 0; i < nworkers; i++) {
+
+        s_threads[i] = SDL_CreateThread(worker_thread_func, "worker", NULL);
+        if(!s_threads[i])
+            break;
+        s_nworkers++;
+
+        char name[64];
+        pf_snprintf(name, sizeof(name), "worker %d", i);
+        Perf_RegisterThread(SDL_GetThreadID(s_threads[i]), name);
+    }
+    return true;
+
+fail_done:
+    SDL_DestroySemaphore(s_work_avail);
+fail_avail:
+    return false;
+}
+
+void Worker_Shutdown(void)
+{
+    ASSERT_IN_MAIN_THREAD();
+
+    SDL_AtomicSet(&s_quit, 1);
+    for(int i = 0; i < s_nworkers; i++) {
+        SDL_SemPost(s_work_avail);
+    }
+    for(int i = 0; i < s_nworkers; i++) {
+        SDL_WaitThread(s_threads[i], NULL);
+    }
+    s_nworkers = 0;
+
+    SDL_DestroySemaphore(s_work_done);
+    SDL_DestroySemaphore(s_work_avail);
+}
+
+size_t Worker_Count(void)
+{
+    return s_nworkers;
+}
+
+void Worker_ParallelFor(size_t nitems, size_t grain, worker_func_t func, void *arg)
+{
+    ASSERT_IN_MAIN_THREAD();
+    assert(grain > 0);
+
+    if(nitems == 0)
+        return;
+
+    if(nitems < grain || s_nworkers == 0) {
+        func(0, nitems, arg);
+        return;
+    }
+
+    s_job = (struct job){
+        .func = func,
+        .arg = arg,
+        .nitems = nitems,
+        .grain = grain,
+        .nchunks = (nitems + grain - 1) / grain,
+    };
+    SDL_AtomicSet(&s_job.next_chunk, 0);
+
+    size_t nwake = MIN(s_nworkers, s_job.nchunks - 1);
+    for(int i = 0; i < nwake; i++) {
+        SDL_SemPost(s_work_avail);
+    }
+
+    run_chunks(&s_job);
+
+    for(int i = 0; i < nwake; i++) {
+        SDL_SemWait(s_work_done);
+    }
+}
+
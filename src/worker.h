@@ -0,0 +1,58 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* A small pool of threads for splitting up data-parallel work of the main 
+ * thread. The work function is invoked with disjoint [begin, end) ranges of 
+ * the items and may be invoked from any of the worker threads as well as 
+ * from the calling thread. 'Worker_ParallelFor' returns once all the items 
+ * have been processed. It must only be called from the main thread, and the 
+ * work must not touch any state that is not safe to read concurrently. 
+ */
+typedef void (*worker_func_t)(size_t begin, size_t end, void *arg);
+
+bool   Worker_Init(void);
+void   Worker_Shutdown(void);
+size_t Worker_Count(void);
+/* When there are fewer than 'grain' items, all of them are processed serially */
+void   Worker_ParallelFor(size_t nitems, size_t grain, worker_func_t func, void *arg);
+
+#endif
+
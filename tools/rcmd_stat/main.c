@@ -0,0 +1,746 @@
+/*
+ *  This file is part of Permafrost Engine. 
+ *  Copyright (C) 2020 Eduard Permyakov 
+ *
+ *  Permafrost Engine is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Permafrost Engine is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  Linking this software statically or dynamically with other modules is making 
+ *  a combined work based on this software. Thus, the terms and conditions of 
+ *  the GNU General Public License cover the whole combination. 
+ *  
+ *  As a special exception, the copyright holders of Permafrost Engine give 
+ *  you permission to link Permafrost Engine with independent modules to produce 
+ *  an executable, regardless of the license terms of these independent 
+ *  modules, and to copy and distribute the resulting executable under 
+ *  terms of your choice, provided that you also meet, for each linked 
+ *  independent module, the terms and conditions of the license of that 
+ *  module. An independent module is a module which is not derived from 
+ *  or based on Permafrost Engine. If you modify Permafrost Engine, you may 
+ *  extend this exception to your version of Permafrost Engine, but you are not 
+ *  obliged to do so. If you do not wish to do so, delete this exception 
+ *  statement from your version.
+ *
+ */
+
+/* Prints a summary of a render command capture (see 'src/render/render_capture.c' 
+ * for the file format), aggregated by function. The summary does not need a GL 
+ * context, so captures of heavy frames can be inspected and compared offline.
+ *
+ * With '--replay', the engine is brought up without the scripting subsystem, a 
+ * game is started on the captured map and the captured commands are executed on 
+ * the render thread, the same way as 'pf.replay_render_cmds' does. With the null 
+ * renderer (RENDER=NULL), this measures the CPU side of the commands on machines 
+ * without a GPU.
+ */
+
+#include "../../src/main.h"
+#include "../../src/asset_load.h"
+#include "../../src/event.h"
+#include "../../src/ui.h"
+#include "../../src/perf.h"
+#include "../../src/settings.h"
+#include "../../src/worker.h"
+#include "../../src/render/public/render_ctrl.h"
+#include "../../src/game/public/game.h"
+#include "../../src/navigation/public/nav.h"
+#include "../../src/lib/public/stb_image.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+
+#define FOURCC(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define CAPTURE_MAGIC   FOURCC('P','F','R','C')
+#define CAPTURE_VERSION (2)
+#define RSRC_TAG        FOURCC('R','S','R','C')
+#define FRAME_TAG       FOURCC('F','R','M','E')
+#define SYMS_TAG        FOURCC('S','Y','M','S')
+#define END_TAG         FOURCC('C','E','N','D')
+
+#define ALIGN8(x)       (((x) + 7) & ~((uint64_t)7))
+#define MAX_SYM_LEN     (256)
+
+struct func_stat{
+    uint64_t func;
+    char     name[MAX_SYM_LEN];
+    uint64_t ncalls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+struct frame_stat{
+    uint64_t ncmds;
+    uint64_t nblobs;
+    uint64_t blob_bytes;
+    uint64_t total_ns;
+};
+
+/*****************************************************************************/
+/* GLOBAL VARIABLES                                                          */
+/*****************************************************************************/
+
+/* Normally provided by 'src/main.c', which isn't linked into the tool */
+const char                *g_basepath;
+unsigned long              g_frame_idx = 0;
+
+SDL_threadID               g_main_thread_id;
+SDL_threadID               g_render_thread_id;
+
+/*****************************************************************************/
+/* STATIC VARIABLES                                                          */
+/*****************************************************************************/
+
+static struct func_stat  *s_funcs;
+static size_t             s_nfuncs;
+static struct frame_stat *s_frames;
+static size_t             s_nframes;
+static uint64_t           s_nres;
+static uint64_t           s_res_bytes;
+
+static SDL_Window        *s_window;
+static bool               s_quit = false;
+static SDL_Thread        *s_render_thread;
+static struct render_sync_state s_rstate;
+
+/*****************************************************************************/
+/* STATIC FUNCTIONS                                                          */
+/*****************************************************************************/
+
+static bool read_u32(FILE *stream, uint32_t *out)
+{
+    return (fread(out, sizeof(*out), 1, stream) == 1);
+}
+
+static bool read_u64(FILE *stream, uint64_t *out)
+{
+    return (fread(out, sizeof(*out), 1, stream) == 1);
+}
+
+static bool skip(FILE *stream, uint64_t size)
+{
+    return (fseek(stream, (long)ALIGN8(size), SEEK_CUR) == 0);
+}
+
+static struct func_stat *func_stat_get(uint64_t func)
+{
+    for(int i = 0; i < s_nfuncs; i++) {
+        if(s_funcs[i].func == func)
+            return &s_funcs[i];
+    }
+
+    struct func_stat *funcs = realloc(s_funcs, (s_nfuncs + 1) * sizeof(struct func_stat));
+    if(!funcs)
+        return NULL;
+    s_funcs = funcs;
+
+    struct func_stat *ret = &s_funcs[s_nfuncs++];
+    memset(ret, 0, sizeof(*ret));
+    ret->func = func;
+    snprintf(ret->name, sizeof(ret->name), "0x%016llx", (unsigned long long)func);
+    return ret;
+}
+
+static bool read_res(FILE *stream)
+{
+    uint32_t kind, id, pad;
+    uint64_t size;
+
+    if(!read_u32(stream, &kind)
+    || !read_u32(stream, &id)
+    || !read_u32(stream, &pad)
+    || !read_u64(stream, &size)
+    || !skip(stream, size))
+        return false;
+
+    s_nres++;
+    s_res_bytes += size;
+    return true;
+}
+
+static bool read_frame(FILE *stream)
+{
+    uint32_t nblobs, ncmds, nfixups, pad;
+    if(!read_u32(stream, &nblobs)
+    || !read_u32(stream, &ncmds)
+    || !read_u32(stream, &nfixups))
+        return false;
+
+    struct frame_stat *frames = realloc(s_frames, (s_nframes + 1) * sizeof(struct frame_stat));
+    if(!frames)
+        return false;
+    s_frames = frames;
+
+    struct frame_stat *frame = &s_frames[s_nframes++];
+    memset(frame, 0, sizeof(*frame));
+    frame->ncmds = ncmds;
+    frame->nblobs = nblobs;
+
+    for(int i = 0; i < nblobs; i++) {
+    
+        uint64_t addr, size;
+        if(!read_u64(stream, &addr)
+        || !read_u64(stream, &size)
+        || !skip(stream, size))
+            return false;
+        frame->blob_bytes += size;
+    }
+
+    for(int i = 0; i < ncmds; i++) {
+
+        uint64_t func, ns;
+        uint32_t nargs;
+        if(!read_u64(stream, &func)
+        || !read_u64(stream, &ns)
+        || !read_u32(stream, &nargs)
+        || !read_u32(stream, &pad))
+            return false;
+
+        if(nargs > MAX_ARGS || !skip(stream, nargs * sizeof(uint64_t)))
+            return false;
+
+        struct func_stat *stat = func_stat_get(func);
+        if(!stat)
+            return false;
+
+        stat->ncalls++;
+        stat->total_ns += ns;
+        stat->max_ns = ns > stat->max_ns ? ns : stat->max_ns;
+        frame->total_ns += ns;
+    }
+
+    /* [res:u32] [blob:u32] [offset:u64] each */
+    return skip(stream, nfixups * 2 * sizeof(uint64_t));
+}
+
+static bool read_syms(FILE *stream)
+{
+    uint32_t nsyms;
+    if(!read_u32(stream, &nsyms))
+        return false;
+
+    for(int i = 0; i < nsyms; i++) {
+
+        uint64_t func;
+        uint32_t len, pad;
+        char name[MAX_SYM_LEN + 8];
+
+        if(!read_u64(stream, &func)
+        || !read_u32(stream, &len)
+        || !read_u32(stream, &pad))
+            return false;
+
+        if(len >= MAX_SYM_LEN)
+            return false;
+        if(len && fread(name, ALIGN8(len), 1, stream) != 1)
+            return false;
+        name[len] = '\0';
+
+        struct func_stat *stat = func_stat_get(func);
+        if(!stat)
+            return false;
+        strcpy(stat->name, name);
+    }
+    return true;
+}
+
+static bool read_capture(FILE *stream)
+{
+    uint32_t magic, version;
+
+    if(!read_u32(stream, &magic)
+    || !read_u32(stream, &version))
+        return false;
+
+    if(magic != CAPTURE_MAGIC || version != CAPTURE_VERSION)
+        return false;
+
+    while(true) {
+
+        uint32_t tag;
+        if(!read_u32(stream, &tag))
+            return false;
+
+        switch(tag) {
+        case RSRC_TAG:
+            if(!read_res(stream))
+                return false;
+            break;
+        case FRAME_TAG:
+            if(!read_frame(stream))
+                return false;
+            break;
+        case SYMS_TAG:
+            if(!read_syms(stream))
+                return false;
+            break;
+        case END_TAG:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+static int compare_total(const void *a, const void *b)
+{
+    const struct func_stat *fa = a, *fb = b;
+    if(fa->total_ns > fb->total_ns) return -1;
+    if(fa->total_ns < fb->total_ns) return  1;
+    return 0;
+}
+
+static void print_report(void)
+{
+    uint64_t total_ns = 0;
+    printf("%-6s %10s %10s %12s %12s\n", "frame", "commands", "args", "arg bytes", "total (ms)");
+
+    for(int i = 0; i < s_nframes; i++) {
+        const struct frame_stat *frame = &s_frames[i];
+        printf("%-6d %10llu %10llu %12llu %12.3f\n", i, 
+            (unsigned long long)frame->ncmds, 
+            (unsigned long long)frame->nblobs, 
+            (unsigned long long)frame->blob_bytes, 
+            frame->total_ns / 1e6);
+        total_ns += frame->total_ns;
+    }
+    printf("%llu resources, %llu bytes\n\n", 
+        (unsigned long long)s_nres, (unsigned long long)s_res_bytes);
+
+    qsort(s_funcs, s_nfuncs, sizeof(struct func_stat), compare_total);
+    printf("%-40s %8s %12s %10s %10s %7s\n", "function", "calls", "total (ms)", "avg (us)", "max (us)", "share");
+
+    for(int i = 0; i < s_nfuncs; i++) {
+        const struct func_stat *stat = &s_funcs[i];
+        if(stat->ncalls == 0)
+            continue;
+        printf("%-40s %8llu %12.3f %10.3f %10.3f %6.1f%%\n", stat->name, 
+            (unsigned long long)stat->ncalls,
+            stat->total_ns / 1e6,
+            stat->total_ns / 1e3 / stat->ncalls,
+            stat->max_ns / 1e3,
+            total_ns ? stat->total_ns * 100.0 / total_ns : 0.0);
+    }
+}
+
+static int summary(const char *path)
+{
+    int ret = EXIT_FAILURE;
+
+    FILE *stream = fopen(path, "rb");
+    if(!stream) {
+        fprintf(stderr, "Unable to open file (%s) for reading.\n", path);
+        goto fail_open;
+    }
+
+    if(!read_capture(stream)) {
+        fprintf(stderr, "Failed to read the render command capture (%s).\n", path);
+        goto fail_read;
+    }
+
+    print_report();
+    ret = EXIT_SUCCESS;
+
+fail_read:
+    fclose(stream);
+fail_open:
+    free(s_funcs);
+    free(s_frames);
+    return ret;
+}
+
+static bool rstate_init(struct render_sync_state *rstate)
+{
+    rstate->start = false;
+
+    rstate->sq_lock = SDL_CreateMutex();
+    if(!rstate->sq_lock)
+        goto fail_sq_lock;
+        
+    rstate->sq_cond = SDL_CreateCond();
+    if(!rstate->sq_cond)
+        goto fail_sq_cond;
+
+    rstate->done = false;
+
+    rstate->done_lock = SDL_CreateMutex();
+    if(!rstate->done_lock)
+        goto fail_done_lock;
+
+    rstate->done_cond = SDL_CreateCond();
+    if(!rstate->done_cond)
+        goto fail_done_cond;
+
+    rstate->swap_buffers = false;
+    return true;
+
+fail_done_cond:
+    SDL_DestroyMutex(rstate->done_lock);
+fail_done_lock:
+    SDL_DestroyCond(rstate->sq_cond);
+fail_sq_cond:
+    SDL_DestroyMutex(rstate->sq_lock);
+fail_sq_lock:
+    return false;
+}
+
+static void rstate_destroy(struct render_sync_state *rstate)
+{
+    SDL_DestroyCond(rstate->done_cond);
+    SDL_DestroyMutex(rstate->done_lock);
+    SDL_DestroyCond(rstate->sq_cond);
+    SDL_DestroyMutex(rstate->sq_lock);
+}
+
+static int render_thread_quit(void)
+{
+    SDL_LockMutex(s_rstate.sq_lock);
+    s_rstate.quit = true;
+    SDL_CondSignal(s_rstate.sq_cond);
+    SDL_UnlockMutex(s_rstate.sq_lock);
+
+    int ret;
+    SDL_WaitThread(s_render_thread, &ret);
+    return ret;
+}
+
+static void render_thread_start_work(void)
+{
+    SDL_LockMutex(s_rstate.sq_lock);
+    s_rstate.start = true;
+    SDL_CondSignal(s_rstate.sq_cond);
+    SDL_UnlockMutex(s_rstate.sq_lock);
+}
+
+static void wait_render_work_done(void)
+{
+    SDL_LockMutex(s_rstate.done_lock);
+    while(!s_rstate.done)
+        SDL_CondWait(s_rstate.done_cond, s_rstate.done_lock);
+    s_rstate.done = false;
+    SDL_UnlockMutex(s_rstate.done_lock);
+}
+
+/* The same as 'engine_init' in 'src/main.c', minus the subsystems that only 
+ * serve the interactive session (scripting, cursors, sessions). The user's 
+ * settings are loaded, so the replay renders at the same resolution as the 
+ * game, but they're never saved back.
+ */
+static bool engine_init(const char *basedir)
+{
+    g_main_thread_id = SDL_ThreadID();
+
+    if(!Perf_Init()) {
+        fprintf(stderr, "Failed to initialize performance module.\n");
+        goto fail_perf;
+    }
+
+    if(Settings_Init() != SS_OKAY) {
+        fprintf(stderr, "Failed to initialize settings module.\n");
+        goto fail_settings;
+    }
+
+    ss_e status;
+    if((status = Settings_LoadFromFile()) != SS_OKAY) {
+        fprintf(stderr, "Could not load settings from file: %s [status: %d]\n", 
+            Settings_GetFile(), status);
+    }
+
+#if defined(PF_NULL_RENDER)
+    /* Nothing is drawn - don't require a display unless one is asked for */
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+#endif
+
+    if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
+        fprintf(stderr, "Failed to initialize SDL: %s\n", SDL_GetError());
+        goto fail_sdl;
+    }
+
+    SDL_DisplayMode dm;
+    SDL_GetDesktopDisplayMode(0, &dm);
+
+    struct sval setting;
+    int res[2] = {dm.w, dm.h};
+
+    if(Settings_Get("pf.video.resolution", &setting) == SS_OKAY) {
+        res[0] = (int)setting.as_vec2.x;
+        res[1] = (int)setting.as_vec2.y;
+    }
+
+    uint32_t extra_flags = 0;
+#if !defined(PF_NULL_RENDER)
+    extra_flags |= SDL_WINDOW_OPENGL;
+#endif
+
+    s_window = SDL_CreateWindow(
+        "Permafrost Engine - Render Command Replay",
+        SDL_WINDOWPOS_UNDEFINED, 
+        SDL_WINDOWPOS_UNDEFINED,
+        res[0], 
+        res[1], 
+        SDL_WINDOW_SHOWN | extra_flags);
+
+    if(!s_window) {
+        fprintf(stderr, "Failed to create the window: %s\n", SDL_GetError());
+        goto fail_window;
+    }
+    stbi_set_flip_vertically_on_load(true);
+
+    if(!rstate_init(&s_rstate)) {
+        fprintf(stderr, "Failed to initialize the render sync state.\n");
+        goto fail_rstate;
+    }
+
+    struct render_init_arg rarg = (struct render_init_arg) {
+        .in_window = s_window,
+        .in_width = res[0],
+        .in_height = res[1],
+    };
+
+    s_rstate.arg = &rarg;
+    s_render_thread = R_Run(&s_rstate);
+
+    if(!s_render_thread) {
+        fprintf(stderr, "Failed to start the render thread.\n");
+        goto fail_rthread;
+    }
+    g_render_thread_id = SDL_GetThreadID(s_render_thread);
+
+    render_thread_start_work();
+    wait_render_work_done();
+
+    if(!rarg.out_success)
+        goto fail_render_init;
+
+    Perf_RegisterThread(g_main_thread_id, "main");
+    Perf_RegisterThread(g_render_thread_id, "render");
+
+    if(!Worker_Init()) {
+        fprintf(stderr, "Failed to initialize worker threads.\n");
+        goto fail_worker;
+    }
+
+    if(!AL_Init()) {
+        fprintf(stderr, "Failed to initialize asset-loading module.\n");
+        goto fail_al;
+    }
+
+    if(!E_Init()) {
+        fprintf(stderr, "Failed to initialize event subsystem\n");
+        goto fail_event;
+    }
+
+    if(!G_Init()) {
+        fprintf(stderr, "Failed to initialize game subsystem\n");
+        goto fail_game;
+    }
+
+    if(!R_Init(basedir)) {
+        fprintf(stderr, "Failed to intiaialize rendering subsystem\n");
+        goto fail_render;
+    }
+
+    /* The captured UI commands draw with the UI's render state */
+    if(!UI_Init(basedir, s_window)) {
+        fprintf(stderr, "Failed to initialize nuklear\n");
+        goto fail_nuklear;
+    }
+
+    if(!N_Init()) {
+        fprintf(stderr, "Failed to intialize navigation subsystem\n");
+        goto fail_nav;
+    }
+
+    s_rstate.swap_buffers = true;
+    return true;
+
+fail_nav:
+    UI_Shutdown();
+fail_nuklear:
+fail_render:
+    G_Shutdown();
+fail_game:
+    E_Shutdown();
+fail_event:
+    AL_Shutdown();
+fail_al:
+    Worker_Shutdown();
+fail_worker:
+fail_render_init:
+    render_thread_quit();
+fail_rthread:
+    rstate_destroy(&s_rstate);
+fail_rstate:
+    SDL_DestroyWindow(s_window);
+fail_window:
+    SDL_Quit();
+fail_sdl:
+    Settings_Shutdown();
+fail_settings:
+    Perf_Shutdown();
+fail_perf:
+    return false; 
+}
+
+static void engine_shutdown(void)
+{
+    /* The render thread is gone by the time 'G_Shutdown' waits on it */
+    s_quit = true;
+    UI_Shutdown();
+
+    render_thread_start_work();
+    wait_render_work_done();
+    render_thread_quit();
+
+    G_Shutdown(); 
+    N_Shutdown();
+
+    AL_Shutdown();
+    E_Shutdown();
+    Worker_Shutdown();
+    Perf_Shutdown();
+
+    rstate_destroy(&s_rstate);
+
+    SDL_DestroyWindow(s_window); 
+    SDL_Quit();
+
+    Settings_Shutdown();
+}
+
+static int replay(const char *basedir, const char *path, int nloops, const char *report_path)
+{
+    int ret = EXIT_FAILURE;
+    g_basepath = basedir;
+
+    if(!engine_init(basedir))
+        goto fail_init;
+
+    if(!R_ReplayNewGame(path)) {
+        fprintf(stderr, "Failed to start a game on the map of the capture (%s).\n", path);
+        goto fail_replay;
+    }
+    /* Fill in the previous tick's copy of the map, which the commands are bound to */
+    Engine_FlushRenderWorkQueue();
+
+    if(!R_ReplayCmds(path, nloops, report_path)) {
+        fprintf(stderr, "Failed to load the render command capture (%s).\n", path);
+        goto fail_replay;
+    }
+    Engine_FlushRenderWorkQueue();
+
+    printf("Wrote the replay report to: %s\n", report_path);
+    ret = EXIT_SUCCESS;
+
+fail_replay:
+    engine_shutdown();
+fail_init:
+    return ret;
+}
+
+/*****************************************************************************/
+/* EXTERN FUNCTIONS                                                          */
+/*****************************************************************************/
+
+int Engine_SetRes(int w, int h)
+{
+    SDL_DisplayMode dm = (SDL_DisplayMode) {
+        .format = SDL_PIXELFORMAT_UNKNOWN,
+        .w = w,
+        .h = h,
+        .refresh_rate = 0, /* Unspecified */
+        .driverdata = NULL,
+    };
+
+    SDL_SetWindowSize(s_window, w, h);
+    SDL_SetWindowPosition(s_window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+    return SDL_SetWindowDisplayMode(s_window, &dm);
+}
+
+void Engine_SetDispMode(enum pf_window_flags wf)
+{
+    SDL_SetWindowFullscreen(s_window, wf & SDL_WINDOW_FULLSCREEN);
+    SDL_SetWindowBordered(s_window, !(wf & (SDL_WINDOW_BORDERLESS | SDL_WINDOW_FULLSCREEN)));
+    SDL_SetWindowPosition(s_window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+}
+
+void Engine_WinDrawableSize(int *out_w, int *out_h)
+{
+#if defined(PF_NULL_RENDER)
+    SDL_GetWindowSize(s_window, out_w, out_h);
+#else
+    SDL_GL_GetDrawableSize(s_window, out_w, out_h);
+#endif
+}
+
+void Engine_FlushRenderWorkQueue(void)
+{
+    R_EndFrameCmds();
+    G_SwapBuffers();
+
+    render_thread_start_work();
+    wait_render_work_done();
+
+    G_SwapBuffers();
+}
+
+void Engine_WaitRenderWorkDone(void)
+{
+    if(s_quit)
+        return;
+
+    if(R_Pipelined()) {
+        R_WaitCmdsDrained();
+        return;
+    }
+
+    SDL_LockMutex(s_rstate.done_lock);
+    while(!s_rstate.done) {
+        SDL_CondWait(s_rstate.done_cond, s_rstate.done_lock);
+    }
+    SDL_UnlockMutex(s_rstate.done_lock);
+}
+
+void Engine_ClearPendingEvents(void)
+{
+    SDL_FlushEvents(0, SDL_LASTEVENT);
+    E_ClearPendingEvents();
+}
+
+int main(int argc, char **argv)
+{
+    if(argc == 2)
+        exit(summary(argv[1]));
+
+    if((argc == 4 || argc == 6) && !strcmp(argv[1], "--replay")) {
+
+        int nloops = argc == 6 ? atoi(argv[4]) : 1;
+        const char *report = argc == 6 ? argv[5] : "rcmd_replay.txt";
+
+        if(nloops <= 0) {
+            fprintf(stderr, "The number of loops must be positive.\n");
+            exit(EXIT_FAILURE);
+        }
+        exit(replay(argv[2], argv[3], nloops, report));
+    }
+
+    printf("Usage: %s [capture file]\n", argv[0]);
+    printf("       %s --replay [base directory path] [capture file] [loops] [report file]\n", argv[0]);
+    exit(EXIT_FAILURE);
+}
+